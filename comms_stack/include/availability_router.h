@@ -0,0 +1,62 @@
+#ifndef AVAILABILITY_ROUTER_H
+#define AVAILABILITY_ROUTER_H
+
+#include "transport.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace comms_stack {
+
+// Fans the availability reports of a transport out to every RpcClient and Subscriber watching
+// a service. A transport keeps one availability handler per (service, instance), as vsomeip
+// does, so objects registering their own replaced each other and only the last one was ever
+// told. The router registers that one handler and calls each object's handler from it.
+class AvailabilityRouter {
+public:
+    using HandlerId = uint64_t;
+
+    // Returns the router for `transport`, creating it on first use. Shared by everything
+    // created on that transport.
+    static std::shared_ptr<AvailabilityRouter> forTransport(const std::shared_ptr<Transport>& transport);
+
+    ~AvailabilityRouter(); // Unregisters its handlers from the transport
+
+    AvailabilityRouter(const AvailabilityRouter&) = delete;
+    AvailabilityRouter& operator=(const AvailabilityRouter&) = delete;
+
+    // `handler` gets every change of the matching services (instance_id may be ANY_INSTANCE),
+    // and right away the ones already known to be available.
+    HandlerId add(uint16_t service_id, uint16_t instance_id, Transport::AvailabilityHandler handler);
+    // Once this returns, the handler will not run and is not running (unless remove() is called
+    // from within a handler).
+    void remove(HandlerId id);
+
+private:
+    using Key = std::pair<uint16_t, uint16_t>; // (service, instance)
+
+    struct Route {
+        std::map<HandlerId, Transport::AvailabilityHandler> handlers;
+        std::map<Key, bool> known; // Last state reported per concrete service instance
+    };
+
+    explicit AvailabilityRouter(const std::shared_ptr<Transport>& transport);
+    void onAvailability(const Key& route, uint16_t service_id, uint16_t instance_id, bool is_available);
+
+    std::weak_ptr<Transport> transport_;
+    std::weak_ptr<AvailabilityRouter> self_;
+
+    std::mutex mutex_;
+    std::map<Key, Route> routes_; // Kept, and registered with the transport, until destruction
+    std::map<HandlerId, Key> handler_routes_;
+    HandlerId next_id_ = 1;
+    // Held while handlers run, so reports reach them in order, a new handler's catch-up cannot
+    // overtake a live report, and remove() can wait for a running handler.
+    std::recursive_mutex dispatch_mutex_;
+};
+
+} // namespace comms_stack
+
+#endif // AVAILABILITY_ROUTER_H
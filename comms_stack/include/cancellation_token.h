@@ -0,0 +1,48 @@
+#ifndef CANCELLATION_TOKEN_H
+#define CANCELLATION_TOKEN_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace comms_stack {
+
+// Cooperative cancellation for RPC calls. Copies share state, so the caller keeps one copy
+// and passes another to the call; cancel() on any copy cancels them all.
+class CancellationToken {
+public:
+    using CallbackId = uint64_t;
+
+    CancellationToken();
+
+    void cancel();
+    bool isCancelled() const;
+
+    // Runs `callback` once when the token is cancelled. If it already is, the callback runs
+    // right away and 0 is returned.
+    CallbackId onCancel(std::function<void()> callback) const;
+    // Once this returns, the callback will not run and is not running (unless removeCallback
+    // is called from within it).
+    void removeCallback(CallbackId id) const;
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable callback_done_cv;
+        std::atomic<bool> cancelled{false};
+        CallbackId next_id = 1;
+        std::map<CallbackId, std::function<void()>> callbacks;
+        CallbackId running_id = 0;
+        std::thread::id running_thread;
+    };
+    std::shared_ptr<State> state_;
+};
+
+} // namespace comms_stack
+
+#endif // CANCELLATION_TOKEN_H
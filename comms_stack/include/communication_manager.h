@@ -5,7 +5,21 @@
 #include <memory>
 #include <functional>
 #include <map> // For caches
+#include <set>
+#include <mutex>
+#include <atomic>
 #include "sample_rpc_service.pb.h" // Include the generated service header
+#include "rpc_response_cache.h"
+#include "response_demultiplexer.h"
+#include "rpc_stream.h"
+#include "rpc_controller.h"
+#include "topic_registry.h"
+#include "write_once_table.h"
+#include "local_bus.h"
+#include "transport.h"
+#include "discovery_cache.h"
+#include <chrono>
+#include <vector>
 
 
 // vsomeip forward declaration (or include if small)
@@ -23,6 +37,8 @@ namespace comms_stack {
     class Subscriber;
     // class RpcService; // Using protos::SampleRpc directly for now
     class RpcClient;
+    class LoopbackNetwork;
+    class IntrospectionServer;
     namespace protos {
         class SimpleNotification;
         // SampleRpc is now included directly
@@ -31,46 +47,194 @@ namespace comms_stack {
 
 namespace comms_stack {
 
+// Owns one transport (normally a vsomeip application) and everything created on it.
+// getInstance() is the process-wide default; further instances (each with its own transport,
+// dispatcher threads and caches) can be created to shard traffic across cores, see
+// ShardedCommunicationManager.
 class CommunicationManager {
 public:
+    struct Options {
+        std::string app_name = "CommsStackApp"; // Must be listed in the vsomeip configuration
+        std::string config_path;                // Optional if VSOMEIP_CONFIGURATION is set
+        // vsomeip dispatcher threads for this application; 0 keeps the "threads" value of its
+        // "applications" entry. Applied through an application-specific configuration file
+        // (VSOMEIP_CONFIGURATION_<app_name>) in a temporary directory, see writeDispatcherConfig().
+        unsigned dispatcher_threads = 0;
+        // Deliver topics between publishers and subscribers of this process (on any manager
+        // with this enabled) as message objects instead of through vsomeip, see local_bus.h.
+        bool intra_process = true;
+        // If set, runs on a LoopbackTransport attached to this network instead of vsomeip:
+        // everything stays in this process and no vsomeip configuration is needed. config_path
+        // still supplies the topic/service registry. See loopback_transport.h.
+        std::shared_ptr<LoopbackNetwork> loopback;
+        // If set, runs on this transport instead (e.g. an instrumented one in a benchmark); it
+        // must not be started yet. Takes precedence over loopback.
+        std::shared_ptr<Transport> transport;
+        // File remembering the services and eventgroups used on the previous run (see
+        // discovery_cache.h). init() requests and subscribes them right away, so they are usually
+        // discovered by the time the code using them asks. Empty disables the cache.
+        std::string discovery_cache_path;
+        // Set up the endpoints listed for app_name under "provisioning" in the registry (see
+        // ProvisioningPlan) during init(): publishers offer, subscribers register their handlers
+        // and subscribe, RPC clients request their service. Later getters return them ready.
+        bool provision = true;
+        // UNIX domain socket on which introspectionSnapshot() is served (see
+        // introspection_server.h), e.g. "/run/comms_stack/<app>.sock", or "@name" for the
+        // abstract namespace. Empty disables it.
+        std::string introspection_socket;
+    };
+
+    // One step of the last init(), for the startup timeline.
+    struct StartupPhase {
+        std::string name;
+        int64_t start_us = 0; // Since init() was entered
+        int64_t duration_us = 0;
+    };
+
+    // When a service used through this manager first became available, for boot-time measurements.
+    struct DiscoveryTiming {
+        uint16_t service_id = 0;
+        uint16_t instance_id = 0;
+        int64_t available_after_ms = -1; // Since init()
+        int64_t previous_run_ms = -1;    // Same, as recorded in the discovery cache; -1 if unknown
+        bool pre_requested = false;      // Requested from the discovery cache at init()
+    };
+
     static CommunicationManager& getInstance();
 
+    // Writes a copy of the vsomeip configuration at config_path with `threads` dispatcher
+    // threads for app_name to a new temporary directory and points VSOMEIP_CONFIGURATION_<app_name>
+    // at it. Returns the file written, or an empty string on failure. Calls setenv(), so run it
+    // before starting threads that may read the environment; init() does so first thing, and
+    // ShardedCommunicationManager for all shards before starting any.
+    static std::string writeDispatcherConfig(const std::string& app_name, const std::string& config_path,
+                                             unsigned threads);
+    // Deletes a file written by writeDispatcherConfig() and its directory.
+    static void removeDispatcherConfig(const std::string& path);
+
+    CommunicationManager();
+    ~CommunicationManager();
+
     CommunicationManager(const CommunicationManager&) = delete;
     CommunicationManager& operator=(const CommunicationManager&) = delete;
 
     bool init(const std::string& app_name = "CommsStackApp", const std::string& config_path = ""); // config_path can be optional
+    bool init(const Options& options);
     void shutdown();
+    const std::string& getAppName() const { return app_name_; }
+
+    // Topics and services are looked up in the registry loaded by init() (the "comms_stack"
+    // section of the configuration). Resolve a name once and keep the handle: the handle
+    // overloads are plain array indexing. Getters are thread-safe, and returning an
+    // already-created object never takes a lock.
+    TopicHandle findTopic(const std::string& topic_name) const;
+    ServiceHandle findService(const std::string& service_name) const;
+    const TopicRegistry& getTopicRegistry() const;
 
     std::shared_ptr<Publisher> getPublisher(const std::string& topic_name);
+    std::shared_ptr<Publisher> getPublisher(TopicHandle topic);
     std::shared_ptr<Subscriber> getSubscriber(const std::string& topic_name);
+    std::shared_ptr<Subscriber> getSubscriber(TopicHandle topic);
     // Changed RpcService to the specific generated type protos::SampleRpc
+    // cache_config optionally enables the server-side response cache, so retransmitted or
+    // duplicated requests (and repeated calls to idempotent methods) skip the handler.
     void registerRpcService(const std::string& user_service_name,
                               uint16_t service_id, uint16_t instance_id, // These would come from config
-                              std::shared_ptr<protos::SampleRpc> service_impl);
+                              std::shared_ptr<protos::SampleRpc> service_impl,
+                              const RpcResponseCacheConfig& cache_config = RpcResponseCacheConfig());
+    // Same, with service and instance IDs taken from the registry entry for user_service_name.
+    void registerRpcService(const std::string& user_service_name,
+                              std::shared_ptr<protos::SampleRpc> service_impl,
+                              const RpcResponseCacheConfig& cache_config = RpcResponseCacheConfig());
+    // Adds a server-streaming method to a service instance; each opened stream runs `handler`
+    // on its own thread (see rpc_stream.h). Typed handlers via makeStreamMethodHandler<Req>().
+    void registerStreamMethod(const std::string& user_service_name,
+                              uint16_t service_id, uint16_t instance_id,
+                              uint16_t method_id, const std::string& method_name,
+                              StreamMethodHandler handler);
     std::shared_ptr<RpcClient> getRpcClient(const std::string& service_name);
+    std::shared_ptr<RpcClient> getRpcClient(ServiceHandle service);
 
-    // Expose vsomeip application for internal use by Publisher/Subscriber/etc.
+    // Transport used by everything this manager creates; pass it to hand-made RpcClients etc.
+    std::shared_ptr<Transport> getTransport();
+    // The underlying vsomeip application; nullptr when running on a loopback transport.
     std::shared_ptr<vsomeip::application> getVsomeipApplication();
+    // Shared response router for all RpcClients created on this transport.
+    std::shared_ptr<ResponseDemultiplexer> getResponseDemultiplexer();
 
-private:
-    CommunicationManager();
-    ~CommunicationManager();
+    // Services that have become available since init(), in that order.
+    std::vector<DiscoveryTiming> getDiscoveryTimings() const;
+    // Steps of the last init(), provisioning included; init() also logs them.
+    std::vector<StartupPhase> getStartupTimeline() const;
 
-    bool is_initialized_ = false;
-    std::string app_name_;
-    std::shared_ptr<vsomeip::application> vsomeip_app_;
+    // JSON snapshot of this manager: the publishers, subscribers and RPC clients created through
+    // it with their availability and pending calls, the registered services with their calls in
+    // progress, the transport's queue depth, pooled resources and the process-wide metrics with
+    // their latency histograms. Only reads state the hot paths publish lock-free, so taking it
+    // never stalls dispatching or publishing.
+    std::string introspectionSnapshot();
 
-    // Caches
-    std::map<std::string, std::shared_ptr<Publisher>> publisher_cache_;
-    std::map<std::string, std::shared_ptr<Subscriber>> subscriber_cache_;
-    std::map<std::string, std::shared_ptr<RpcClient>> rpc_client_cache_;
+private:
+    void prewarmFromDiscoveryCache();
+    void saveDiscoveryCache(); // Also stops watching availability
+    void releasePrewarmed();
+    // Called on the dispatcher thread whenever a manager-created client or subscriber sees its
+    // service come or go; eventgroup is null for RPC clients.
+    void onDiscovered(uint16_t service_id, uint16_t instance_id, const DiscoveryCache::Eventgroup* eventgroup);
+    void provision(const ProvisioningPlan& plan);
+    void releaseProvisioned();
+    void recordPhase(const std::string& name, std::chrono::steady_clock::time_point started);
+
+    std::atomic<bool> is_initialized_{false};
+    std::string app_name_;
+    std::chrono::steady_clock::time_point init_started_;
+    std::shared_ptr<Transport> transport_;
+    std::shared_ptr<ResponseDemultiplexer> response_demux_; // Kept alive across RpcClient lifetimes
+    std::shared_ptr<LocalBus> local_bus_; // Null if intra-process delivery is disabled
+
+    TopicRegistry topic_registry_; // Read-only between init() and shutdown()
+
+    // Caches, indexed by registry handle; lock-free lookups (see write_once_table.h)
+    WriteOnceTable<Publisher> publisher_cache_;
+    WriteOnceTable<Subscriber> subscriber_cache_;
+    WriteOnceTable<RpcClient> rpc_client_cache_;
+    // Guards the server-side maps below (registration and shutdown only)
+    std::mutex services_mutex_;
     // Store the specific service implementations
     // Key: user_service_name or internal service_id
     std::map<std::string, std::shared_ptr<protos::SampleRpc>> actual_rpc_services_;
+    // Response caches for services registered with caching enabled (same key as above)
+    std::map<std::string, std::shared_ptr<RpcResponseCache>> rpc_response_caches_;
+    // In-flight calls per service, for client cancel notifications (same key as above)
+    std::map<std::string, std::shared_ptr<RpcCallRegistry>> rpc_call_registries_;
+    // Streaming method servers, one per offered service instance (same key as above)
+    std::map<std::string, std::unique_ptr<RpcStreamServer>> rpc_stream_servers_;
+    // Offered service and instance ID per service (same key as above)
+    std::map<std::string, std::pair<uint16_t, uint16_t>> rpc_service_ids_;
+
+    // Discovery cache: what was pre-requested at init(), and what live discovery confirmed
+    // this run (written back at shutdown)
+    std::string discovery_cache_path_;
+    DiscoveryCache prewarmed_;
+    DiscoveryCache discovered_;
+    std::vector<DiscoveryTiming> discovery_timings_;
+    std::vector<std::function<void()>> discovery_unwatchers_; // Remove availability callbacks
+    mutable std::mutex discovery_mutex_;
+
+    // Set up by provision(), undone at shutdown
+    std::set<std::pair<uint16_t, uint16_t>> provisioned_offers_;   // Services offered for publishers
+    std::set<std::pair<uint16_t, uint16_t>> provisioned_requests_; // Services requested for subscribers
+    std::vector<DiscoveryCache::Eventgroup> provisioned_subscriptions_;
+    std::mutex provisioning_mutex_;
+
+    std::vector<StartupPhase> startup_timeline_;
+    mutable std::mutex startup_mutex_;
+
+    std::unique_ptr<IntrospectionServer> introspection_server_; // Null unless enabled in Options
     // We might also need to store registered method handlers if they are member functions
     // or need to be explicitly unregistered. For lambdas, vsomeip handles it.
 
-    // Thread for vsomeip processing (alternative to vsomeip_app_->start() if more control is needed)
+    // Thread for vsomeip processing (alternative to transport_->start() if more control is needed)
     // std::unique_ptr<std::thread> processing_thread_;
     // bool running_ = false;
     // void processMessages(); // If using custom thread
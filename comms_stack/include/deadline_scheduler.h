@@ -0,0 +1,54 @@
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace comms_stack {
+
+// Runs tasks on a single background thread once their deadline has passed.
+// Used for timers that vsomeip does not provide to applications (e.g. RPC hedging).
+class DeadlineScheduler {
+public:
+    using Task = std::function<void()>;
+
+    DeadlineScheduler();
+    ~DeadlineScheduler(); // Stops and joins; pending tasks are discarded
+
+    DeadlineScheduler(const DeadlineScheduler&) = delete;
+    DeadlineScheduler& operator=(const DeadlineScheduler&) = delete;
+
+    void schedule(std::chrono::steady_clock::time_point deadline, Task task);
+    void stop();
+
+private:
+    struct Item {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t sequence; // FIFO among equal deadlines
+        Task task;
+    };
+    struct Later {
+        bool operator()(const Item& a, const Item& b) const {
+            return a.deadline > b.deadline || (a.deadline == b.deadline && a.sequence > b.sequence);
+        }
+    };
+
+    void run();
+
+    std::priority_queue<Item, std::vector<Item>, Later> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = true;
+    uint64_t next_sequence_ = 0;
+    std::thread thread_;
+};
+
+} // namespace comms_stack
+
+#endif // DEADLINE_SCHEDULER_H
@@ -0,0 +1,52 @@
+#ifndef DISCOVERY_CACHE_H
+#define DISCOVERY_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace comms_stack {
+
+// Services and eventgroups an application used on its last run, kept on disk so the next
+// CommunicationManager::init() can request and subscribe them as soon as the transport has
+// started, instead of when the code that uses them first asks. Only entries that live service
+// discovery confirmed again are written back, so services that are gone drop out after a run.
+//
+// File format (JSON, IDs as in the vsomeip configuration):
+//   { "services" :    [ { "service" : "0x2222", "instance" : "0x0001", "available_after_ms" : "35" } ],
+//     "eventgroups" : [ { "service" : "0x1111", "instance" : "0x0001", "eventgroup" : "0x9100", "event" : "0x9100" } ] }
+class DiscoveryCache {
+public:
+    struct Service {
+        uint16_t service_id = 0;
+        uint16_t instance_id = 0;
+        int64_t available_after_ms = -1; // Since init() on the run that saved it; -1 if unknown
+    };
+    struct Eventgroup {
+        uint16_t service_id = 0;
+        uint16_t instance_id = 0;
+        uint16_t eventgroup_id = 0; // 0 for a plain event
+        uint16_t event_id = 0;
+    };
+
+    bool load(const std::string& path);       // False if the file is missing or unreadable
+    bool save(const std::string& path) const; // Written to a temporary file, then renamed
+
+    // Both replace an existing entry with the same IDs.
+    void addService(const Service& service);
+    void addEventgroup(const Eventgroup& eventgroup);
+
+    const Service* findService(uint16_t service_id, uint16_t instance_id) const;
+    const std::vector<Service>& services() const { return services_; }
+    const std::vector<Eventgroup>& eventgroups() const { return eventgroups_; }
+    bool empty() const { return services_.empty() && eventgroups_.empty(); }
+    void clear();
+
+private:
+    std::vector<Service> services_;
+    std::vector<Eventgroup> eventgroups_;
+};
+
+} // namespace comms_stack
+
+#endif // DISCOVERY_CACHE_H
@@ -0,0 +1,132 @@
+#ifndef FIXED_LAYOUT_H
+#define FIXED_LAYOUT_H
+
+#include "common_messages.pb.h"
+#include "sample_rpc_service.pb.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "fixed_layout.h: the layouts are little-endian and copied as-is; big-endian hosts need byte swaps"
+#endif
+
+namespace comms_stack {
+
+// Compile-time wire layouts for messages made of fixed-size scalars and at most one trailing
+// bounded string. Each layout is a plain struct at fixed little-endian offsets, so encoding is
+// a memcpy of the struct (plus the string bytes) and decoding is one length check and the
+// reverse memcpy, with no per-field tags, varints or branches. The offsets are part of the wire
+// format: the static_asserts pin them, and a layout must never be changed once deployed.
+//
+// Only the messages specialized here have a layout; everything else is sent as protobuf
+// (see PayloadCodec). Both ends of a topic or method must select the same codec.
+template<typename Message>
+struct FixedLayout; // Specialized per message type below
+
+// | content_length u32 | id u32 | timestamp u64 | content bytes |
+// The content is bounded so that a payload can never begin with TraceEnvelope::MAGIC (read as
+// a little-endian content_length it would be 0x01544300), which subscribers strip wherever it
+// appears.
+template<>
+struct FixedLayout<protos::SimpleNotification> {
+    struct Header {
+        uint32_t content_length;
+        uint32_t id;
+        uint64_t timestamp;
+    };
+    static_assert(offsetof(Header, content_length) == 0 && offsetof(Header, id) == 4 &&
+                  offsetof(Header, timestamp) == 8 && sizeof(Header) == 16,
+                  "SimpleNotification layout changed");
+    static constexpr size_t HEADER_SIZE = sizeof(Header);
+    static constexpr uint32_t MAX_CONTENT = 0x00FFFFFF;
+
+    static size_t size(const protos::SimpleNotification& message) {
+        return HEADER_SIZE + message.message_content().size();
+    }
+    // `out` holds size(message) bytes. False if the content exceeds MAX_CONTENT.
+    static bool encode(const protos::SimpleNotification& message, uint8_t* out) {
+        const std::string& content = message.message_content();
+        if (content.size() > MAX_CONTENT) {
+            return false;
+        }
+        const Header header = {static_cast<uint32_t>(content.size()), message.id(), message.timestamp()};
+        std::memcpy(out, &header, HEADER_SIZE);
+        std::memcpy(out + HEADER_SIZE, content.data(), content.size());
+        return true;
+    }
+    static bool decode(const uint8_t* data, size_t length, protos::SimpleNotification& message) {
+        Header header;
+        if (length < HEADER_SIZE) {
+            return false;
+        }
+        std::memcpy(&header, data, HEADER_SIZE);
+        if (length - HEADER_SIZE != header.content_length) {
+            return false;
+        }
+        message.set_id(header.id);
+        message.set_timestamp(header.timestamp);
+        message.mutable_message_content()->assign(reinterpret_cast<const char*>(data + HEADER_SIZE),
+                                                  header.content_length);
+        return true;
+    }
+};
+
+// | a i32 | b i32 |
+template<>
+struct FixedLayout<protos::AddRequest> {
+    struct Wire {
+        int32_t a;
+        int32_t b;
+    };
+    static_assert(offsetof(Wire, a) == 0 && offsetof(Wire, b) == 4 && sizeof(Wire) == 8,
+                  "AddRequest layout changed");
+    static constexpr size_t SIZE = sizeof(Wire);
+
+    static size_t size(const protos::AddRequest&) { return SIZE; }
+    static bool encode(const protos::AddRequest& message, uint8_t* out) {
+        const Wire wire = {message.a(), message.b()};
+        std::memcpy(out, &wire, SIZE);
+        return true;
+    }
+    static bool decode(const uint8_t* data, size_t length, protos::AddRequest& message) {
+        Wire wire;
+        if (length != SIZE) {
+            return false;
+        }
+        std::memcpy(&wire, data, SIZE);
+        message.set_a(wire.a);
+        message.set_b(wire.b);
+        return true;
+    }
+};
+
+// | sum i32 |
+template<>
+struct FixedLayout<protos::AddResponse> {
+    struct Wire {
+        int32_t sum;
+    };
+    static_assert(offsetof(Wire, sum) == 0 && sizeof(Wire) == 4, "AddResponse layout changed");
+    static constexpr size_t SIZE = sizeof(Wire);
+
+    static size_t size(const protos::AddResponse&) { return SIZE; }
+    static bool encode(const protos::AddResponse& message, uint8_t* out) {
+        const Wire wire = {message.sum()};
+        std::memcpy(out, &wire, SIZE);
+        return true;
+    }
+    static bool decode(const uint8_t* data, size_t length, protos::AddResponse& message) {
+        Wire wire;
+        if (length != SIZE) {
+            return false;
+        }
+        std::memcpy(&wire, data, SIZE);
+        message.set_sum(wire.sum);
+        return true;
+    }
+};
+
+} // namespace comms_stack
+
+#endif // FIXED_LAYOUT_H
@@ -0,0 +1,32 @@
+#ifndef HASH_UTILS_H
+#define HASH_UTILS_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace comms_stack {
+
+// FNV-1a over a raw byte range. Used to key caches on serialized request payloads;
+// not a cryptographic hash, collisions are only a cache-miss/cache-hit concern.
+inline uint64_t fnv1a64(const uint8_t* data, size_t len, uint64_t seed = 0xcbf29ce484222325ULL) {
+    uint64_t hash = seed;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// 32-bit FNV-1a; names message types in MessageEnvelope (see message_envelope.h).
+inline uint32_t fnv1a32(const uint8_t* data, size_t len) {
+    uint32_t hash = 0x811c9dc5U;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= 0x01000193U;
+    }
+    return hash;
+}
+
+} // namespace comms_stack
+
+#endif // HASH_UTILS_H
@@ -0,0 +1,49 @@
+#ifndef INTROSPECTION_SERVER_H
+#define INTROSPECTION_SERVER_H
+
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace comms_stack {
+
+// Serves a JSON snapshot of a running process on a UNIX domain stream socket: each client that
+// connects is sent one snapshot, and the connection is closed. For example
+//
+//   socat - UNIX-CONNECT:/run/comms_stack/CommsStackApp.sock
+//
+// A path starting with '@' names a socket in the abstract namespace (no file). The snapshot is
+// built on the server's own thread, which runs at SCHED_IDLE priority so it only gets CPU time
+// no other thread wants; the snapshot function must therefore not take locks the hot paths
+// hold, or a preempted snapshot could stall them (see CommunicationManager::introspectionSnapshot()).
+class IntrospectionServer {
+public:
+    using SnapshotFunction = std::function<std::string()>;
+
+    IntrospectionServer() = default;
+    ~IntrospectionServer();
+
+    IntrospectionServer(const IntrospectionServer&) = delete;
+    IntrospectionServer& operator=(const IntrospectionServer&) = delete;
+
+    // Replaces a stale socket file at `path`. False if the socket cannot be set up.
+    bool start(const std::string& path, SnapshotFunction snapshot);
+    void stop(); // Waits for a snapshot in progress and removes the socket file
+
+    bool isRunning() const { return listen_fd_ >= 0; }
+    const std::string& getPath() const { return path_; }
+
+private:
+    void run();
+    void serve(int client_fd);
+
+    std::string path_;
+    SnapshotFunction snapshot_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1; // eventfd; written by stop()
+    std::thread thread_;
+};
+
+} // namespace comms_stack
+
+#endif // INTROSPECTION_SERVER_H
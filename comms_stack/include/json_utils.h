@@ -0,0 +1,28 @@
+#ifndef JSON_UTILS_H
+#define JSON_UTILS_H
+
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+namespace comms_stack {
+
+// Writes `text` as a quoted JSON string, escaping quotes, backslashes and control characters.
+inline void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec
+                << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace comms_stack
+
+#endif // JSON_UTILS_H
@@ -0,0 +1,93 @@
+#ifndef LOCAL_BUS_H
+#define LOCAL_BUS_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace google { namespace protobuf { class Message; } }
+
+namespace comms_stack {
+
+// Intra-process delivery for topics whose publisher and subscribers live in the same process
+// (possibly on different CommunicationManagers). Publishers hand the message object itself to
+// local subscribers, skipping serialization, vsomeip routing and parsing; remote subscribers
+// are still served by the publisher's regular vsomeip event.
+//
+// A SOME/IP event is offered by exactly one application, so while a local publisher is
+// registered for (service, instance, event), every wire copy of that event is one that was
+// already delivered here. Subscribers with a local sink drop those (see Topic::isPublishedLocally()).
+class LocalBus {
+public:
+    using MessagePtr = std::shared_ptr<const google::protobuf::Message>;
+    using Callback = std::function<void(const MessagePtr& message)>;
+
+    // One subscriber's registration. Once detach() returns the callback is not running and will
+    // not run again. No lock is held while it runs, so callbacks may publish to other topics.
+    class Sink {
+    public:
+        Sink(uint16_t instance_id, Callback callback) : instance_id_(instance_id), callback_(std::move(callback)) {}
+        void deliver(const MessagePtr& message);
+        void detach(); // Waits for deliveries in progress, except the caller's own (a callback may unsubscribe itself)
+        uint16_t instanceId() const { return instance_id_; }
+
+    private:
+        const uint16_t instance_id_; // 0xFFFF == any instance
+        const Callback callback_;
+        std::mutex mutex_;
+        std::condition_variable idle_;
+        size_t running_ = 0; // Deliveries in progress
+        bool detached_ = false;
+    };
+
+    // Sinks and publishers of one (service, event). Created on first use and kept as long as the
+    // bus, so publishers and subscribers look it up once and then read it without any lock.
+    class Topic {
+    public:
+        bool hasSubscribers(uint16_t instance_id) const;
+        // Runs the matching callbacks on the calling thread; returns how many there were.
+        size_t publish(uint16_t instance_id, const MessagePtr& message) const;
+        bool isPublishedLocally(uint16_t instance_id) const;
+
+    private:
+        friend class LocalBus;
+        // Never modified once published: a changed copy replaces it (under LocalBus::mutex_).
+        struct State {
+            std::vector<std::shared_ptr<Sink>> sinks;
+            std::vector<std::pair<uint16_t, uint32_t>> publishers; // (instance, registration count)
+        };
+        std::shared_ptr<const State> state() const { return std::atomic_load(&state_); }
+        void setState(std::shared_ptr<const State> state) { std::atomic_store(&state_, std::move(state)); }
+
+        std::shared_ptr<const State> state_ = std::make_shared<const State>();
+    };
+
+    // Process-wide bus shared by all CommunicationManagers.
+    static std::shared_ptr<LocalBus> getShared();
+
+    std::shared_ptr<Topic> topic(uint16_t service_id, uint16_t event_id);
+
+    void addPublisher(uint16_t service_id, uint16_t instance_id, uint16_t event_id);
+    void removePublisher(uint16_t service_id, uint16_t instance_id, uint16_t event_id);
+
+    // instance_id may be 0xFFFF to receive from any local instance.
+    std::shared_ptr<Sink> addSubscriber(uint16_t service_id, uint16_t instance_id, uint16_t event_id, Callback callback);
+    void removeSubscriber(uint16_t service_id, uint16_t event_id, const std::shared_ptr<Sink>& sink); // Detaches it
+
+private:
+    static uint32_t key(uint16_t service_id, uint16_t event_id) {
+        return (static_cast<uint32_t>(service_id) << 16) | event_id;
+    }
+
+    std::mutex mutex_; // Serializes registration changes; publishing and lookups through a Topic do not take it
+    std::unordered_map<uint32_t, std::shared_ptr<Topic>> topics_;
+};
+
+} // namespace comms_stack
+
+#endif // LOCAL_BUS_H
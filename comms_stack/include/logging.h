@@ -0,0 +1,175 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+// Statements below COMMS_STACK_MIN_LOG_LEVEL are compiled out: their arguments are type-checked
+// but never evaluated. Set it through the COMMS_STACK_MIN_LOG_LEVEL CMake cache variable.
+#define COMMS_LOG_LEVEL_DEBUG 0
+#define COMMS_LOG_LEVEL_INFO 1
+#define COMMS_LOG_LEVEL_WARN 2
+#define COMMS_LOG_LEVEL_ERROR 3
+#define COMMS_LOG_LEVEL_OFF 4
+#ifndef COMMS_STACK_MIN_LOG_LEVEL
+#define COMMS_STACK_MIN_LOG_LEVEL COMMS_LOG_LEVEL_DEBUG
+#endif
+
+// Usage: COMMS_LOG_INFO("Publisher ({}): Offered event 0x{:04x}", topic_name_, event_id);
+// "{}" formats any argument; "{:x}", "{:08X}", "{:.3f}", "{:<12}" etc. take printf-style
+// flags, width, precision and conversion ('<' left-aligns). Arguments are copied in binary form; the format
+// string must be a literal, as only its address is queued.
+#define COMMS_LOG(level, ...)                                                                   \
+    do {                                                                                        \
+        if (::comms_stack::Logger::compiledIn(level) && ::comms_stack::Logger::enabled(level)) { \
+            ::comms_stack::Logger::write(level, __VA_ARGS__);                                   \
+        }                                                                                       \
+    } while (0)
+#define COMMS_LOG_DEBUG(...) COMMS_LOG(::comms_stack::LogLevel::Debug, __VA_ARGS__)
+#define COMMS_LOG_INFO(...) COMMS_LOG(::comms_stack::LogLevel::Info, __VA_ARGS__)
+#define COMMS_LOG_WARN(...) COMMS_LOG(::comms_stack::LogLevel::Warn, __VA_ARGS__)
+#define COMMS_LOG_ERROR(...) COMMS_LOG(::comms_stack::LogLevel::Error, __VA_ARGS__)
+
+namespace comms_stack {
+
+enum class LogLevel : uint8_t { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
+// Levelled logging off the caller's thread. A statement copies its arguments into a slot of a
+// bounded lock-free queue; a background thread formats the records and hands the lines to the
+// sink. When the queue is full, records are dropped (and counted) rather than blocking.
+// Queued records are written at exit; flush() writes them right away.
+class Logger {
+public:
+    using Sink = std::function<void(LogLevel level, const std::string& line)>;
+
+    static constexpr size_t RECORD_SIZE = 256; // Per statement, arguments included
+    static constexpr size_t QUEUE_RECORDS = 4096;
+
+    static constexpr LogLevel MIN_LEVEL = static_cast<LogLevel>(COMMS_STACK_MIN_LOG_LEVEL);
+    static constexpr bool compiledIn(LogLevel level) { return level >= MIN_LEVEL; }
+    // Runtime threshold; Info unless the COMMS_STACK_LOG_LEVEL environment variable names
+    // another level (debug, info, warn, error, off).
+    static bool enabled(LogLevel level) {
+        return static_cast<uint8_t>(level) >= level_.load(std::memory_order_relaxed);
+    }
+    static void setLevel(LogLevel level) { level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+    static LogLevel level() { return static_cast<LogLevel>(level_.load(std::memory_order_relaxed)); }
+
+    // Receives each formatted line (without newline) on the logging thread. The default writes
+    // Debug and Info to std::cout, Warn and Error to std::cerr.
+    static void setSink(Sink sink);
+    static void flush();      // Returns once everything logged before the call was written
+    static uint64_t dropped(); // Records lost to a full queue
+
+    template<size_t N, typename... Args>
+    static void write(LogLevel level, const char (&format)[N], const Args&... args);
+
+    struct Record;
+    class Encoder;
+
+private:
+    static std::atomic<uint8_t> level_;
+    static Record* claim(Record& local); // Queue slot, `local` once the logging thread has stopped, or null if full
+    static void commit(Record* record, bool queued);
+};
+
+struct Logger::Record {
+    std::atomic<uint64_t> sequence{0}; // Queue bookkeeping
+    uint64_t timestamp_ns = 0;         // system_clock
+    const char* format = nullptr;
+    LogLevel level = LogLevel::Info;
+    bool truncated = false;
+    uint16_t size = 0;
+    uint8_t args[RECORD_SIZE - 3 * sizeof(uint64_t) - 4];
+};
+
+// Appends arguments to a record as (type tag, value); strings are copied, cut to what fits.
+class Logger::Encoder {
+public:
+    enum Tag : uint8_t { Signed, Unsigned, Double, String, Char, Bool, Pointer };
+
+    explicit Encoder(Record& record) : record_(record) {}
+
+    template<typename T>
+    void add(const T& value) {
+        using D = typename std::decay<T>::type;
+        if constexpr (std::is_same<D, bool>::value) {
+            put(Bool, static_cast<uint8_t>(value));
+        } else if constexpr (std::is_same<D, char>::value) {
+            put(Char, value);
+        } else if constexpr (std::is_enum<D>::value) {
+            add(static_cast<typename std::underlying_type<D>::type>(value));
+        } else if constexpr (std::is_integral<D>::value && std::is_signed<D>::value) {
+            put(Signed, static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral<D>::value) {
+            put(Unsigned, static_cast<uint64_t>(value));
+        } else if constexpr (std::is_floating_point<D>::value) {
+            put(Double, static_cast<double>(value));
+        } else if constexpr (std::is_same<D, std::string>::value) {
+            putString(value.data(), value.size());
+        } else if constexpr (std::is_convertible<D, const char*>::value) {
+            const char* text = value;
+            putString(text ? text : "(null)", text ? std::strlen(text) : 6);
+        } else if constexpr (std::is_pointer<D>::value) {
+            put(Pointer, reinterpret_cast<uint64_t>(static_cast<const void*>(value)));
+        } else {
+            static_assert(std::is_pointer<D>::value, "Unsupported log argument type");
+        }
+    }
+
+private:
+    template<typename V>
+    void put(Tag tag, V value) {
+        if (record_.size + 1 + sizeof(V) > sizeof(record_.args)) {
+            record_.truncated = true;
+            return;
+        }
+        record_.args[record_.size] = tag;
+        std::memcpy(record_.args + record_.size + 1, &value, sizeof(V));
+        record_.size = static_cast<uint16_t>(record_.size + 1 + sizeof(V));
+    }
+    void putString(const char* text, size_t length) {
+        const size_t header = 1 + sizeof(uint16_t);
+        if (record_.size + header > sizeof(record_.args)) {
+            record_.truncated = true;
+            return;
+        }
+        const size_t room = sizeof(record_.args) - record_.size - header;
+        if (length > room) {
+            length = room;
+            record_.truncated = true;
+        }
+        const uint16_t stored = static_cast<uint16_t>(length);
+        record_.args[record_.size] = String;
+        std::memcpy(record_.args + record_.size + 1, &stored, sizeof(stored));
+        std::memcpy(record_.args + record_.size + header, text, length);
+        record_.size = static_cast<uint16_t>(record_.size + header + length);
+    }
+
+    Record& record_;
+};
+
+template<size_t N, typename... Args>
+void Logger::write(LogLevel level, const char (&format)[N], const Args&... args) {
+    Record local;
+    Record* record = claim(local);
+    if (!record) {
+        return;
+    }
+    record->format = format;
+    record->level = level;
+    record->truncated = false;
+    record->size = 0;
+    Encoder encoder(*record);
+    (encoder.add(args), ...);
+    commit(record, record != &local);
+}
+
+} // namespace comms_stack
+
+#endif // LOGGING_H
@@ -0,0 +1,115 @@
+#ifndef LOOPBACK_TRANSPORT_H
+#define LOOPBACK_TRANSPORT_H
+
+#include "transport.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace comms_stack {
+
+class LoopbackTransport;
+
+// Routing state shared by the LoopbackTransports that should see each other, e.g. all
+// endpoints of one benchmark. Independent networks do not interact.
+class LoopbackNetwork {
+public:
+    LoopbackNetwork() = default;
+    LoopbackNetwork(const LoopbackNetwork&) = delete;
+    LoopbackNetwork& operator=(const LoopbackNetwork&) = delete;
+
+private:
+    friend class LoopbackTransport;
+
+    std::mutex mutex_;
+    std::vector<LoopbackTransport*> transports_;                               // Started ones
+    std::map<std::pair<uint16_t, uint16_t>, LoopbackTransport*> offered_;      // (service, instance) -> provider
+    uint16_t next_client_id_ = 0x0100;
+};
+
+// In-process Transport without vsomeip routing or sockets. Each transport has one dispatcher
+// thread that runs all of its handlers in arrival order, like a single-threaded vsomeip
+// application. Messages are copied on send, as they would be on the wire, so sender and
+// receiver never share a message object. Event subscriptions are acknowledged immediately.
+class LoopbackTransport : public Transport {
+public:
+    LoopbackTransport(std::shared_ptr<LoopbackNetwork> network, const std::string& name);
+    ~LoopbackTransport() override;
+
+    bool init() override { return true; }
+    void start() override; // Unlike vsomeip's, returns at once
+    void stop() override;
+    uint16_t getClientId() const override { return client_id_; }
+
+    void offerService(uint16_t service_id, uint16_t instance_id) override;
+    void stopOfferService(uint16_t service_id, uint16_t instance_id) override;
+    void requestService(uint16_t, uint16_t) override {}
+    void releaseService(uint16_t, uint16_t) override {}
+    void registerAvailabilityHandler(uint16_t service_id, uint16_t instance_id, AvailabilityHandler handler) override;
+    void unregisterAvailabilityHandler(uint16_t service_id, uint16_t instance_id) override;
+
+    void registerMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id,
+                                MessageHandler handler) override;
+    void unregisterMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id) override;
+    void send(const std::shared_ptr<vsomeip::message>& message) override;
+
+    void offerEvent(uint16_t, uint16_t, uint16_t, const std::set<uint16_t>&, bool) override {}
+    void stopOfferEvent(uint16_t, uint16_t, uint16_t) override {}
+    void requestEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                      const std::set<uint16_t>& eventgroups) override;
+    void releaseEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) override;
+    void subscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) override;
+    void unsubscribe(uint16_t, uint16_t, uint16_t) override {}
+    void registerSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id,
+                                           uint16_t event_id, SubscriptionStatusHandler handler) override;
+    void unregisterSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id,
+                                             uint16_t eventgroup_id, uint16_t event_id) override;
+    void notify(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                const std::shared_ptr<vsomeip::payload>& payload) override;
+    void notifyOne(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                   const std::shared_ptr<vsomeip::payload>& payload, uint16_t client_id) override;
+
+    int64_t queueDepth() const override { return static_cast<int64_t>(queue_depth_.load(std::memory_order_relaxed)); }
+
+    const std::string& getName() const { return name_; }
+
+private:
+    using Key = std::tuple<uint16_t, uint16_t, uint16_t>;
+
+    void post(std::function<void()> task);
+    void run();
+    void deliver(const std::shared_ptr<vsomeip::message>& message);
+    void notifyMatching(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                        const std::shared_ptr<vsomeip::payload>& payload, const uint16_t* client_id);
+    void postAvailability(uint16_t service_id, uint16_t instance_id, bool is_available);
+    // Called with network_->mutex_ held.
+    void broadcastAvailability(uint16_t service_id, uint16_t instance_id, bool is_available);
+
+    const std::shared_ptr<LoopbackNetwork> network_;
+    const std::string name_;
+    uint16_t client_id_;
+    std::atomic<uint16_t> next_session_{0};
+
+    std::mutex handlers_mutex_;
+    std::map<Key, MessageHandler> message_handlers_;
+    std::map<std::pair<uint16_t, uint16_t>, AvailabilityHandler> availability_handlers_;
+    std::map<Key, std::pair<uint16_t, SubscriptionStatusHandler>> subscription_status_handlers_; // By eventgroup
+    std::set<Key> requested_events_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<std::function<void()>> queue_;
+    std::atomic<size_t> queue_depth_{0}; // queue_.size(), stored under queue_mutex_ for lock-free reads
+    bool running_ = false;
+    std::thread dispatcher_;
+};
+
+} // namespace comms_stack
+
+#endif // LOOPBACK_TRANSPORT_H
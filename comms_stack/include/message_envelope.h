@@ -0,0 +1,114 @@
+#ifndef MESSAGE_ENVELOPE_H
+#define MESSAGE_ENVELOPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace google { namespace protobuf { class Descriptor; class FileDescriptor; class Message; } }
+
+namespace comms_stack {
+
+// Envelope settings of a topic or service ("envelope" in the registry, see topic_registry.h).
+// Off by default: peers built before the envelope existed cannot parse enveloped payloads.
+struct EnvelopeConfig {
+    bool enabled = false;
+    uint16_t schema_version = 0; // Sent as-is; lets receivers tell revisions of a message type apart
+    bool timestamp = false;      // Stamp each message with the wall-clock send time
+};
+
+// Fixed header in front of the payload of enveloped topics and services, so a receiver learns
+// the message type without being told in advance:
+//
+//   | magic 00 'C' 'E' 01 | type_hash u32 | schema_version u16 | flags u16 | sequence u32 | timestamp_ns u64 |
+//
+// 24 bytes, host (little-endian) byte order like TraceEnvelope, read in one copy of the whole
+// struct. The magic's last byte is the envelope format version. It begins with 0x00, which no
+// protobuf message does, and read as a fixed-layout content_length it exceeds the bound of
+// FixedLayout<SimpleNotification>, so receivers may accept payloads from peers without
+// envelopes. SOME/IP payloads never carry one.
+struct MessageEnvelope {
+    static constexpr size_t SIZE = 24;
+    static constexpr uint8_t MAGIC[4] = {0x00, 'C', 'E', 0x01};
+
+    enum Flag : uint16_t {
+        TIMESTAMP = 1 << 0, // timestamp_ns is set
+        TRACED = 1 << 1,    // A TraceEnvelope follows (see tracing.h)
+    };
+    // Other bits are reserved for payload transformations (compression, batching); a receiver
+    // must not parse a payload with a flag it does not know.
+    static constexpr uint16_t KNOWN_FLAGS = TIMESTAMP | TRACED;
+
+    uint32_t type_hash = 0;      // MessageTypes::hash() of the payload's type
+    uint16_t schema_version = 0;
+    uint16_t flags = 0;
+    uint32_t sequence = 0;       // Per publisher or client; a response repeats its request's
+    uint64_t timestamp_ns = 0;   // system_clock, if TIMESTAMP
+
+    bool supported() const { return (flags & ~KNOWN_FLAGS) == 0; }
+
+    void write(uint8_t* out) const {
+        const Wire wire = {{MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3]}, type_hash, schema_version, flags, sequence,
+                           timestamp_ns};
+        std::memcpy(out, &wire, SIZE);
+    }
+    // If `data` starts with an envelope, fills `envelope` and advances data/length past it.
+    static bool strip(const uint8_t*& data, size_t& length, MessageEnvelope& envelope) {
+        Wire wire;
+        if (length < SIZE || data[0] != 0x00) {
+            return false;
+        }
+        std::memcpy(&wire, data, SIZE);
+        if (std::memcmp(wire.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            return false;
+        }
+        envelope.type_hash = wire.type_hash;
+        envelope.schema_version = wire.schema_version;
+        envelope.flags = wire.flags;
+        envelope.sequence = wire.sequence;
+        envelope.timestamp_ns = wire.timestamp_ns;
+        data += SIZE;
+        length -= SIZE;
+        return true;
+    }
+    static uint64_t now(); // Wall-clock ns for timestamp_ns
+
+private:
+    struct Wire {
+        uint8_t magic[4];
+        uint32_t type_hash;
+        uint16_t schema_version;
+        uint16_t flags;
+        uint32_t sequence;
+        uint64_t timestamp_ns;
+    };
+    static_assert(offsetof(Wire, type_hash) == 4 && offsetof(Wire, schema_version) == 8 &&
+                  offsetof(Wire, flags) == 10 && offsetof(Wire, sequence) == 12 &&
+                  offsetof(Wire, timestamp_ns) == 16 && sizeof(Wire) == 24,
+                  "MessageEnvelope layout changed");
+};
+
+// Message types a receiver can name from an envelope's type hash. The generated types of this
+// library's protos are known from the start; applications add their own before subscribing.
+class MessageTypes {
+public:
+    // FNV-1a of the full proto name, e.g. "comms_stack.protos.SimpleNotification".
+    static uint32_t hash(const google::protobuf::Descriptor* descriptor);
+    // hash() of the message's type, through a small per-thread cache keyed by its C++ type.
+    static uint32_t hashOf(const google::protobuf::Message& message);
+
+    // Makes `descriptor` (a generated type) and the types nested in it findable. False if it
+    // has no generated class or its hash is taken by another type, which keeps the hash.
+    static bool add(const google::protobuf::Descriptor* descriptor);
+    static void addFile(const google::protobuf::FileDescriptor* file); // Every message type in it
+
+    // Default instance of the type with `hash`; New() it to parse. Null if unknown.
+    static const google::protobuf::Message* find(uint32_t hash);
+    // Full name of the type with `hash`, or its hash in hex if unknown; for logs.
+    static std::string name(uint32_t hash);
+};
+
+} // namespace comms_stack
+
+#endif // MESSAGE_ENVELOPE_H
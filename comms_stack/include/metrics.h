@@ -0,0 +1,138 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace comms_stack {
+
+// Latency distribution with HDR-style log-linear buckets: values below 16 ns get a bucket each,
+// above that every power of two is split into 16 buckets, so a bucket is at most 1/16 (6.25%)
+// wider than its lower bound. Values of 2^36 ns (about 69 s) and more share the last bucket.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr unsigned MAX_VALUE_BITS = 36;
+    static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    static size_t bucketIndex(uint64_t value_ns) {
+        if (value_ns >= (uint64_t(1) << MAX_VALUE_BITS)) {
+            return BUCKETS - 1;
+        }
+        if (value_ns < (uint64_t(1) << SUB_BUCKET_BITS)) {
+            return static_cast<size_t>(value_ns);
+        }
+        const unsigned shift = 63 - __builtin_clzll(value_ns) - SUB_BUCKET_BITS;
+        return ((shift + 1) << SUB_BUCKET_BITS) + static_cast<size_t>(value_ns >> shift) - (size_t(1) << SUB_BUCKET_BITS);
+    }
+    static uint64_t bucketLowerBound(size_t index);
+
+    void record(uint64_t value_ns, uint64_t count = 1);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+    // Lower bound of the bucket holding the given percentile (0-100); 0 if empty.
+    uint64_t percentile(double percentile) const;
+    uint64_t bucketCount(size_t index) const { return buckets_[index]; } // See bucketLowerBound()
+
+private:
+    friend class Metrics;
+    std::vector<uint64_t> buckets_ = std::vector<uint64_t>(BUCKETS);
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Process-wide counters (messages, bytes, errors, drops) and latency histograms per topic and
+// RPC method. Each thread records into blocks of its own, padded to cache lines, with plain
+// relaxed loads and stores: no lock, no read-modify-write, no sharing with other writers.
+// snapshot() sums all threads' blocks; a thread's counts are folded into a common block when
+// it exits. Recording costs a few nanoseconds (see metrics_bench).
+class Metrics {
+public:
+    enum class Kind : uint8_t { Publisher, Subscriber, RpcClient, RpcServer };
+
+    // Handle to one endpoint's series; cheap to copy. Default-constructed handles record nothing.
+    class Endpoint {
+    public:
+        Endpoint() = default;
+        void message(size_t bytes) const;
+        void latency(std::chrono::nanoseconds latency) const;
+        void error() const;
+        void drop() const;
+        explicit operator bool() const { return id_ != INVALID_ID; }
+
+    private:
+        friend class Metrics;
+        explicit Endpoint(uint32_t id) : id_(id) {}
+        uint32_t id_ = INVALID_ID;
+    };
+
+    struct EndpointStats {
+        Kind kind = Kind::Publisher;
+        std::string name;
+        uint64_t messages = 0; // Published, received, calls made or requests served
+        uint64_t bytes = 0;    // Serialized payload
+        uint64_t errors = 0;   // Failed sends, unparsable payloads, error responses
+        uint64_t drops = 0;    // Discarded without an error: cancelled calls, duplicate requests, no callback yet
+        LatencyHistogram latency;
+    };
+
+    static constexpr size_t MAX_ENDPOINTS = 1024;
+
+    static Metrics& global();
+
+    // Same handle for the same kind and name, so counts survive re-creating the endpoint.
+    Endpoint endpoint(Kind kind, const std::string& name);
+
+    std::vector<EndpointStats> snapshot() const;
+    void print(std::ostream& out) const; // One line per endpoint that recorded anything
+    static const char* kindName(Kind kind);
+
+private:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+    struct alignas(64) Cells {
+        std::atomic<uint64_t> messages{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> drops{0};
+        std::atomic<uint64_t> latency_sum{0};
+        std::atomic<uint64_t> latency_max{0};
+        std::atomic<uint64_t> buckets[LatencyHistogram::BUCKETS] = {};
+    };
+    struct ThreadBlock {
+        ~ThreadBlock();
+        std::atomic<Cells*> cells[MAX_ENDPOINTS] = {};
+    };
+    class ThreadExit; // Retires the thread's block
+
+    Metrics() = default;
+    static Cells* cells(uint32_t id); // This thread's cells for `id`, created on first use
+    static ThreadBlock* attachThread();
+    void retire(ThreadBlock* block);
+    static void addCells(EndpointStats& stats, const Cells& cells);
+
+    mutable std::mutex mutex_; // Guards everything below; taken by registration, retire and snapshot
+    std::map<std::pair<Kind, std::string>, uint32_t> ids_;
+    std::vector<std::pair<Kind, std::string>> endpoints_; // By id
+    std::vector<ThreadBlock*> threads_;
+    ThreadBlock retired_; // Counts of exited threads
+
+    static thread_local ThreadBlock* thread_block_;
+    static thread_local bool thread_exited_; // Set once the block is retired; later records are lost
+};
+
+} // namespace comms_stack
+
+#endif // METRICS_H
@@ -0,0 +1,65 @@
+#ifndef PAYLOAD_CODEC_H
+#define PAYLOAD_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace google { namespace protobuf { class Descriptor; class Message; } }
+
+namespace comms_stack {
+
+// Wire format of a topic's events or an RPC method's requests and responses, selected per
+// topic ("codec") and per method ("codecs") in the registry (see topic_registry.h).
+enum class Codec : uint8_t {
+    Protobuf,    // Protobuf wire format; every message type
+    FixedLayout, // Fixed little-endian layout (see fixed_layout.h) where the type has one, else protobuf
+    SomeIp,      // SOME/IP serialization (see someip_serializer.h) where the type maps onto it, else protobuf
+};
+
+const char* codecName(Codec codec);
+bool parseCodec(const std::string& name, Codec& codec); // "protobuf", "fixed" or "someip"
+
+// Parameters of Codec::SomeIp; both ends must use the same.
+struct SomeIpOptions {
+    uint32_t alignment = 1;         // Fields and array elements start at multiples of this; 1 == packed
+    uint32_t length_field_size = 4; // Bytes of the length field of strings and arrays: 1, 2 or 4
+};
+
+// Encodes and decodes payloads in one Codec. Cheap to copy; the choice between the codec and
+// protobuf is made per message type, so a topic configured as "fixed" or "someip" still
+// carries types the codec cannot represent, as long as both ends use the same message type.
+class PayloadCodec {
+public:
+    PayloadCodec() = default;
+    explicit PayloadCodec(Codec codec, const SomeIpOptions& someip = SomeIpOptions())
+        : codec_(codec), someip_(someip) {}
+
+    Codec codec() const { return codec_; }
+    const SomeIpOptions& someIpOptions() const { return someip_; }
+    // Builds the per-type state the codec needs (the SOME/IP table) now instead of on the
+    // first message of that type.
+    void prepare(const google::protobuf::Descriptor* descriptor) const;
+    // True if `message` is sent in a fixed layout rather than as protobuf.
+    bool isFixedLayout(const google::protobuf::Message& message) const;
+    // True if `message` is sent in SOME/IP serialization rather than as protobuf.
+    bool isSomeIp(const google::protobuf::Message& message) const;
+
+    // Call before encode(); for protobuf it also caches the size encode() relies on.
+    size_t byteSize(const google::protobuf::Message& message) const;
+    // Writes exactly `size` bytes, the value byteSize() returned, to `out`.
+    bool encode(const google::protobuf::Message& message, uint8_t* out, size_t size) const;
+    bool encodeToString(const google::protobuf::Message& message, std::string& out) const;
+    // Overwrites every field of `message`.
+    bool decode(const uint8_t* data, size_t length, google::protobuf::Message& message) const;
+    // The size byteSize() last returned for `message` (for metrics). Only SOME/IP recomputes it.
+    size_t encodedSize(const google::protobuf::Message& message) const;
+
+private:
+    Codec codec_ = Codec::Protobuf;
+    SomeIpOptions someip_;
+};
+
+} // namespace comms_stack
+
+#endif // PAYLOAD_CODEC_H
@@ -3,12 +3,18 @@
 
 #include <string>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include "local_bus.h"
+#include "message_envelope.h"
+#include "metrics.h"
+#include "payload_codec.h"
+#include "tracing.h"
 
-// Forward declare vsomeip application
-namespace vsomeip { class application; }
 // Forward declare Protobuf message types
 namespace google { namespace protobuf { class Message; } }
 namespace comms_stack { namespace protos { class SimpleNotification; } }
+namespace comms_stack { class ShmRingWriter; class UdpBatchSender; class Transport; struct SharedMemoryConfig; struct BatchedUdpConfig; }
 
 
 namespace comms_stack {
@@ -16,29 +22,87 @@ namespace comms_stack {
 class Publisher {
 public:
     Publisher(const std::string& topic_name,
-              std::shared_ptr<vsomeip::application> app,
+              std::shared_ptr<Transport> transport,
               uint16_t service_id, // For now, pass IDs directly
               uint16_t instance_id,
-              uint16_t eventgroup_id_or_event_id,
-              bool is_eventgroup = true); // True if eventgroup_id_or_event_id is an eventgroup
+              uint16_t event_id,
+              uint16_t eventgroup_id = 0, // Eventgroup the event is offered in; 0 if none
+              std::shared_ptr<LocalBus> local_bus = nullptr, // Set to serve in-process subscribers directly
+              bool reliable = false); // Offer the event over TCP instead of UDP
     ~Publisher();
 
+    // In-process subscribers get a copy of the message object; remote ones get the serialized event.
     bool publish(const protos::SimpleNotification& message);
     bool publishGeneric(const google::protobuf::Message& message);
+    // Same, but in-process subscribers share `message` itself: no copy, no serialization.
+    bool publishShared(std::shared_ptr<const google::protobuf::Message> message);
+
+    // Serializes into a shared-memory ring that same-host subscribers read in place (see
+    // shm_ring.h); the vsomeip event is then only sent if config.wire is set or the message
+    // exceeds config.slot_size.
+    bool enableSharedMemory(const SharedMemoryConfig& config);
+    // Sends the events as SOME/IP datagrams over a socket of its own, batched into few
+    // sendmmsg() calls (see udp_batch.h); the vsomeip event is then only sent if config.wire
+    // is set or the message exceeds config.max_payload.
+    bool enableBatchedUdp(const BatchedUdpConfig& config);
+    // Prepends a TraceEnvelope to every remote payload and records the Publish, Serialize and
+    // Send spans of each message in Tracer::global() (see tracing.h).
+    void enableTracing();
+    // Prepends a MessageEnvelope (see message_envelope.h) to every remote payload, in front of
+    // the TraceEnvelope if tracing. Subscribers must have it enabled too. Not with SOME/IP.
+    void enableEnvelope(const EnvelopeConfig& config);
+    // Wire format of the remote payloads (see payload_codec.h); subscribers must use the same.
+    // Set before the first publish.
+    void setCodec(const PayloadCodec& codec);
 
     std::string getTopicName() const;
     bool isOffered() const;
 
 private:
     std::string topic_name_;
-    std::shared_ptr<vsomeip::application> vsomeip_app_;
+    std::shared_ptr<Transport> transport_;
     uint16_t service_id_;
     uint16_t instance_id_;
-    uint16_t event_id_or_group_; // Can be event ID or eventgroup ID
-    bool is_eventgroup_;
-    bool is_offered_ = false;
+    uint16_t event_id_;
+    uint16_t eventgroup_id_; // 0 == event is not offered in an eventgroup
+    bool reliable_;
+    std::atomic<bool> is_offered_{false}; // Atomic: also read by introspection
+    std::shared_ptr<LocalBus> local_bus_;
+    std::shared_ptr<LocalBus::Topic> local_topic_; // Null if local_bus_ is
+    std::unique_ptr<ShmRingWriter> shm_writer_;
+    bool shm_wire_ = true;
+    std::unique_ptr<UdpBatchSender> udp_sender_;
+    bool udp_wire_ = true;
+    Metrics::Endpoint metrics_;
+    bool trace_ = false;
+    uint16_t trace_topic_ = 0;
+    PayloadCodec codec_;
+    EnvelopeConfig envelope_;
+    std::atomic<uint32_t> sequence_{0}; // Of the next enveloped message
+
+    // What precedes the encoded message in a remote payload; either part may be null.
+    struct Headers {
+        const MessageEnvelope* envelope;
+        const TraceEnvelope* trace;
+
+        size_t size() const {
+            return (envelope ? MessageEnvelope::SIZE : 0) + (trace ? TraceEnvelope::SIZE : 0);
+        }
+        void write(uint8_t* out) const;
+    };
 
     void offer(); // Helper to offer event
+    bool sendEvent(const google::protobuf::Message& message, const Headers& headers); // Wire path
+    bool writeToRing(const google::protobuf::Message& message, const Headers& headers); // False if it does not fit a slot
+    bool sendBatched(const google::protobuf::Message& message, const Headers& headers);
+    bool sendRemote(const google::protobuf::Message& message, const Headers& headers); // Ring, batched UDP and/or wire
+    bool recordPublish(bool sent, const google::protobuf::Message& message,
+                       std::chrono::steady_clock::time_point started, const TraceEnvelope* trace);
+    const TraceEnvelope* beginTrace(TraceEnvelope& envelope) const;
+    // Null unless the envelope is enabled; otherwise the next sequence number is taken.
+    const MessageEnvelope* beginEnvelope(const google::protobuf::Message& message, const TraceEnvelope* trace,
+                                         MessageEnvelope& envelope);
+    void traceSpan(const TraceEnvelope* trace, TraceStage stage, uint64_t start_ns) const;
 };
 
 } // namespace comms_stack
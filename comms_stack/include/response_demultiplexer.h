@@ -0,0 +1,120 @@
+#ifndef RESPONSE_DEMULTIPLEXER_H
+#define RESPONSE_DEMULTIPLEXER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Forward declare vsomeip types
+namespace vsomeip {
+    class message;
+    using client_t = uint16_t;
+    using service_t = uint16_t;
+    using instance_t = uint16_t;
+    using session_t = uint16_t;
+}
+
+namespace comms_stack {
+
+class RpcClient;
+class Transport;
+
+// Routes RPC responses to the RpcClient that sent the request.
+// One wildcard message handler is registered per transport, and responses are
+// looked up in a table indexed directly by session ID, so the cost per response does not
+// depend on how many RpcClients share the transport. Without it, every client registered
+// its own ANY_SERVICE/ANY_METHOD handler and saw every message.
+class ResponseDemultiplexer {
+public:
+    // Returns the demultiplexer for `transport`, creating and registering it on first use.
+    // Instances are shared by the CommunicationManager and all RpcClients of that transport.
+    static std::shared_ptr<ResponseDemultiplexer> forTransport(const std::shared_ptr<Transport>& transport);
+
+    ~ResponseDemultiplexer();
+
+    ResponseDemultiplexer(const ResponseDemultiplexer&) = delete;
+    ResponseDemultiplexer& operator=(const ResponseDemultiplexer&) = delete;
+
+    // What the demultiplexer knows about one RpcClient, kept in the client itself so that
+    // detach() visits only that client's sessions and waits only for deliveries to it.
+    class ClientState {
+        friend class ResponseDemultiplexer;
+        std::mutex mutex; // Taken after a stripe's mutex
+        std::unordered_set<vsomeip::session_t> sessions; // Bound and not yet answered or unbound
+        std::atomic<uint32_t> deliveries{0};            // Callbacks into the client in progress
+    };
+
+    // Associates a sent request's session with its client. If the response already arrived
+    // (it can overtake the bind), it is returned and the caller must deliver it itself.
+    std::shared_ptr<vsomeip::message> bind(vsomeip::session_t session, vsomeip::service_t service, RpcClient* client);
+    void unbind(vsomeip::session_t session, RpcClient* client);
+
+    // Routes the events of a server stream (see rpc_stream.h), keyed by the session of the
+    // request that opened it, until unbound.
+    void bindStream(vsomeip::session_t session, vsomeip::service_t service, RpcClient* client);
+    void unbindStream(vsomeip::session_t session, RpcClient* client);
+
+    // Subscribes the transport to the stream event of (service, instance) once and runs
+    // `on_ready` when the subscription is acknowledged (right away if it already is).
+    void whenStreamEventReady(vsomeip::service_t service, vsomeip::instance_t instance, RpcClient* client,
+                              std::function<void()> on_ready);
+
+    // Clears every session, stream and pending callback owned by `client` and waits for
+    // in-progress deliveries to it. Other clients' responses keep flowing meanwhile.
+    void detach(RpcClient* client);
+
+    // Transport message handler entry point.
+    void onMessage(const std::shared_ptr<vsomeip::message>& msg);
+
+    // A response for an unbound session is held this long for a bind() that is about to happen.
+    static constexpr std::chrono::milliseconds PARKED_RESPONSE_TTL{100};
+
+private:
+    explicit ResponseDemultiplexer(const std::shared_ptr<Transport>& transport);
+
+    struct Slot {
+        RpcClient* owner = nullptr;
+        vsomeip::service_t service = 0;
+    };
+    struct Parked {
+        std::shared_ptr<vsomeip::message> msg;
+        std::chrono::steady_clock::time_point parked_at;
+    };
+    static constexpr size_t SESSION_COUNT = 1 << 16;
+    static constexpr size_t STRIPE_COUNT = 256;
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+        std::unordered_map<vsomeip::session_t, Parked> parked; // Rare: responses that beat their bind()
+    };
+
+    struct StreamSubscription {
+        bool acknowledged = false;
+        std::vector<std::pair<RpcClient*, std::function<void()>>> waiters;
+    };
+
+    Stripe& stripeFor(vsomeip::session_t session) { return stripes_[session % STRIPE_COUNT]; }
+    static ClientState& stateOf(RpcClient* client);
+    void onStreamFrame(const std::shared_ptr<vsomeip::message>& msg);
+    void onStreamSubscriptionStatus(vsomeip::service_t service, vsomeip::instance_t instance, bool acknowledged);
+
+    std::weak_ptr<Transport> transport_;
+    vsomeip::client_t client_id_;
+    std::unique_ptr<Slot[]> slots_; // Direct-indexed by session ID
+    std::array<Stripe, STRIPE_COUNT> stripes_;
+
+    std::mutex streams_mutex_;
+    std::unordered_map<vsomeip::session_t, Slot> stream_routes_;
+    std::map<std::pair<vsomeip::service_t, vsomeip::instance_t>, StreamSubscription> stream_subscriptions_;
+};
+
+} // namespace comms_stack
+
+#endif // RESPONSE_DEMULTIPLEXER_H
@@ -7,12 +7,26 @@
 #include <future>
 #include <map> // For pending requests
 #include <mutex> // For pending_requests_mutex_
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include "rpc_client_cache.h"
+#include "deadline_scheduler.h"
+#include "response_demultiplexer.h"
+#include "rpc_stream.h"
+#include "cancellation_token.h"
+#include "service_availability.h"
+#include "availability_router.h"
+#include "message_envelope.h"
+#include "metrics.h"
+#include "payload_codec.h"
+#include "transport.h"
 
 // Forward declare vsomeip types
 namespace vsomeip {
-    class application;
     class message;
-    class client_t; // For client ID
+    class payload;
+    using client_t = uint16_t; // For client ID
     using service_t = uint16_t;
     using instance_t = uint16_t;
     using method_t = uint16_t;
@@ -24,34 +38,158 @@ namespace comms_stack { namespace protos {
     class EchoResponse;
     class AddRequest;
     class AddResponse;
+    class CountRequest;
+    class CountItem;
 }}
 // Forward declare google::protobuf::Message for generic response parsing (if needed)
-namespace google { namespace protobuf { class Message; } }
+namespace google { namespace protobuf { class Message; class MessageLite; } }
 
 
 namespace comms_stack {
 
 class RpcClient {
 public:
+    // Settings for multi-instance mode (see constructor).
+    struct LoadBalancingConfig {
+        bool hedging_enabled = false;
+        // A duplicate request is sent to a second instance once a call has been outstanding
+        // longer than this percentile of recent call latencies; the first response wins.
+        double hedge_percentile = 0.95;
+        std::chrono::milliseconds min_hedge_delay{2};
+        size_t latency_window = 256; // Number of recent latencies the percentile is taken over
+    };
+
+    struct LoadBalancingStats {
+        uint64_t hedges_sent = 0;
+        uint64_t hedge_wins = 0; // Calls answered first by the hedged duplicate
+        std::map<uint16_t, uint32_t> outstanding_by_instance;
+    };
+
+    // Passing vsomeip::ANY_INSTANCE (0xFFFF) as instance_id selects multi-instance mode: every
+    // offered instance is tracked via availability callbacks, and each call goes to the less
+    // loaded of two randomly chosen instances (power-of-two-choices on outstanding requests).
     RpcClient(const std::string& service_name,
-              std::shared_ptr<vsomeip::application> app,
+              std::shared_ptr<Transport> transport,
               uint16_t service_id,
               uint16_t instance_id); // Target service instance
     ~RpcClient();
 
     std::future<protos::EchoResponse> Echo(const protos::EchoRequest& request);
     std::future<protos::AddResponse> Add(const protos::AddRequest& request);
+    // Cancellable variants. token.cancel() fails the future with "RPC cancelled", releases the
+    // pending slot at once and notifies the server, whose handler sees RpcController::IsCanceled().
+    std::future<protos::EchoResponse> Echo(const protos::EchoRequest& request, const CancellationToken& token);
+    std::future<protos::AddResponse> Add(const protos::AddRequest& request, const CancellationToken& token);
+    // Server-streaming: on_item runs for each CountItem as it arrives.
+    std::shared_ptr<ClientStream> Count(const protos::CountRequest& request,
+                                        std::function<void(const protos::CountItem&)> on_item,
+                                        StreamCompletionHandler on_complete);
+
+    // Opens a server stream on `method_id` (see rpc_stream.h). Items are delivered to on_item in
+    // order and on_complete runs once with the terminal status. At most `window` items are in
+    // flight; the server blocks once they are all unconsumed.
+    std::shared_ptr<ClientStream> openStream(vsomeip::method_t method_id, const char* method_name,
+                                             const google::protobuf::MessageLite& request,
+                                             StreamItemHandler on_item, StreamCompletionHandler on_complete,
+                                             uint32_t window = DEFAULT_STREAM_WINDOW);
 
     std::string getServiceName() const;
     bool isServiceAvailable() const;
+    // Blocks until the service is available (any instance in multi-instance mode); false on
+    // timeout. Returns as soon as discovery reports it, so there is no need to poll.
+    bool waitForAvailability(std::chrono::milliseconds timeout) const;
+    std::future<bool> whenAvailable(); // See ServiceAvailability::whenAvailable()
+    // `callback` runs on the transport's dispatcher thread on every availability change.
+    ServiceAvailability::CallbackId onAvailabilityChange(ServiceAvailability::Callback callback);
+    void removeAvailabilityCallback(ServiceAvailability::CallbackId id);
+
+    // Opt-in response cache for read-only methods: identical requests within ttl are answered
+    // locally, and identical calls made while one is in flight share its response.
+    void enableResponseCache(uint16_t method_id, std::chrono::milliseconds ttl);
+    void disableResponseCache(uint16_t method_id);
+    RpcClientCache::Stats getCacheStats() const;
+
+    // Wire format of a method's requests and responses (see payload_codec.h); must match the
+    // server's. Protobuf unless set. Call before issuing requests.
+    void setMethodCodec(uint16_t method_id, const PayloadCodec& codec);
+    // Prepends a MessageEnvelope (see message_envelope.h) to every request; the server answers
+    // with one too if its service has the envelope enabled. Responses are checked to be of the
+    // method's response type. Call before issuing requests.
+    void enableEnvelope(const EnvelopeConfig& config);
+    // Sends requests over the service's TCP endpoint instead of UDP; the server must offer one.
+    // Cancels go the same way; streaming and flow-control requests always go over TCP. Call
+    // before issuing requests.
+    void setReliable(bool reliable);
+
+    bool isMultiInstance() const;
+    // Calls sent and not yet answered, failed or cancelled. Lock-free, for introspection.
+    size_t pendingRequests() const { return pending_count_.load(std::memory_order_relaxed); }
+    void setLoadBalancingConfig(const LoadBalancingConfig& config); // Call before issuing requests
+    LoadBalancingStats getLoadBalancingStats() const;
 
 private:
+    friend class ResponseDemultiplexer; // Delivers responses via onMessageReceived
+    friend class ClientStream;          // cancel() goes through sendStreamControl/finishStream
+
+    struct InstanceState {
+        std::atomic<uint32_t> outstanding{0};
+    };
+    struct RequestCopies;    // Wire copies (instance, session) of one logical call
+    struct BalancedCall;     // One logical call, possibly sent to two instances
+    struct CancellableCall;  // A call issued with a CancellationToken
+
+    // Passed to response handlers when a call is cancelled locally.
+    static constexpr int CANCELLED_RETURN_CODE = -1;
+
+    // Power-of-two-choices among available instances, skipping `exclude`. Returns null if none.
+    std::shared_ptr<InstanceState> pickInstance(vsomeip::instance_t exclude, vsomeip::instance_t& picked);
+    void sendBalanced(vsomeip::method_t method_id, const char* method_name,
+                      const std::shared_ptr<vsomeip::payload>& payload, RpcClientCache::ResponseHandler handler,
+                      const std::shared_ptr<RequestCopies>& copies);
+    void sendToInstance(const std::shared_ptr<BalancedCall>& balanced_call, vsomeip::instance_t instance,
+                        const std::shared_ptr<InstanceState>& instance_state, bool is_hedge);
+    bool hasInstance(vsomeip::instance_t instance) const;
+    // Answers the requests sent to an instance that went away with E_NOT_REACHABLE; balanced
+    // calls with no other copy out are then resent (see sendToInstance()).
+    void failRequestsTo(vsomeip::instance_t instance);
+    std::chrono::nanoseconds hedgeDelay();
+    void recordLatency(std::chrono::nanoseconds latency);
+
     void onAvailabilityChanged(vsomeip::service_t service, vsomeip::instance_t instance, bool is_available);
     void onMessageReceived(const std::shared_ptr<vsomeip::message>& msg);
 
-    // Helper to send request and manage promise
+    // Serializes, sends and tracks a request; shared by all typed method wrappers.
+    template<typename ReqProto, typename ResProto>
+    std::future<ResProto> call(vsomeip::method_t method_id, const char* method_name, const ReqProto& request,
+                               const CancellationToken* token = nullptr);
+
+    // Series for "<service>.<method>", created on the method's first call.
+    Metrics::Endpoint methodMetrics(vsomeip::method_t method_id, const char* method_name);
+
+    PayloadCodec methodCodec(vsomeip::method_t method_id) const;
+
+    // Builds the handler that decodes a raw response into ResProto and sets the promise.
     template<typename ResProto>
-    void registerPromise(vsomeip::client_t client_id, vsomeip::session_t session_id, std::promise<ResProto> promise);
+    RpcClientCache::ResponseHandler makeResponseHandler(std::promise<ResProto> promise, const PayloadCodec& codec);
+
+    // Sends the request and registers the handler under the session vsomeip assigned to it,
+    // which is returned.
+    vsomeip::session_t sendRequest(const std::shared_ptr<vsomeip::message>& rpc_request,
+                                   RpcClientCache::ResponseHandler handler);
+
+    // Cancellation support
+    void cancelCall(const std::shared_ptr<CancellableCall>& call);
+    // Records a sent copy of a call; cancels it right away if the call was closed meanwhile.
+    void trackCopy(const std::shared_ptr<RequestCopies>& copies, vsomeip::instance_t instance, vsomeip::session_t session);
+    void cancelCopy(vsomeip::instance_t instance, vsomeip::session_t session); // Frees the slot, tells the server
+    void untrackCancellable(const std::shared_ptr<CancellableCall>& call);
+
+    // Server-streaming support
+    void onStreamFrame(const std::shared_ptr<vsomeip::message>& msg, const StreamFrameHeader& header);
+    void drainStream(const std::shared_ptr<ClientStream>& stream);
+    void finishStream(const std::shared_ptr<ClientStream>& stream, int status, const std::string& error);
+    void finishStreams(vsomeip::instance_t instance, int status, const std::string& error); // ANY_INSTANCE: all
+    void sendStreamControl(vsomeip::instance_t instance, vsomeip::session_t session, uint32_t credits, uint8_t flags);
 
     template<typename ResProto>
     void fulfillPromise(vsomeip::client_t client_id, vsomeip::session_t session_id, const std::shared_ptr<vsomeip::message>& msg);
@@ -60,19 +198,55 @@ private:
 
 
     std::string service_name_;
-    std::shared_ptr<vsomeip::application> vsomeip_app_;
+    std::shared_ptr<Transport> transport_;
     uint16_t service_id_;
     uint16_t instance_id_; // Target service instance ID
-    vsomeip::client_t client_id_; // Our own client ID, assigned by vsomeip
+    bool reliable_ = false; // Requests over TCP; set before any are issued
+    vsomeip::client_t client_id_; // Our own client ID, assigned by the transport
+    std::shared_ptr<ResponseDemultiplexer> demux_; // Shared per transport; routes responses to us by session
+    ResponseDemultiplexer::ClientState demux_state_; // Our sessions and deliveries, kept by demux_
 
-    bool service_available_ = false;
+    ServiceAvailability availability_;
+    std::shared_ptr<AvailabilityRouter> availability_router_; // Shared per transport, like demux_
+    AvailabilityRouter::HandlerId availability_handler_id_ = 0;
 
     // For managing asynchronous responses
     struct PromiseContext {
-        std::function<void(const std::shared_ptr<vsomeip::message>&)> response_parser;
+        RpcClientCache::ResponseHandler handler; // Receives return code and payload of the response
+        vsomeip::instance_t instance = 0;        // The request was sent to
     };
     std::map<std::pair<vsomeip::client_t, vsomeip::session_t>, PromiseContext> pending_requests_;
     std::mutex pending_requests_mutex_; // Protect access to pending_requests_
+    std::atomic<size_t> pending_count_{0}; // pending_requests_.size(), stored under the mutex
+
+    RpcClientCache response_cache_;
+
+    std::map<vsomeip::method_t, Metrics::Endpoint> method_metrics_;
+    std::mutex method_metrics_mutex_;
+    std::map<vsomeip::method_t, PayloadCodec> method_codecs_; // Read-only once calls are issued
+    EnvelopeConfig envelope_;                                 // Likewise
+    std::atomic<uint32_t> envelope_sequence_{0};
+
+    // Calls whose token callback is still registered; unregistered on destruction
+    std::map<CancellableCall*, std::shared_ptr<CancellableCall>> cancellable_calls_;
+    std::mutex cancellable_calls_mutex_;
+
+    // Open server streams, keyed by the session of their open request
+    std::map<vsomeip::session_t, std::shared_ptr<ClientStream>> streams_;
+    std::mutex streams_mutex_;
+
+    // Multi-instance mode state
+    std::map<vsomeip::instance_t, std::shared_ptr<InstanceState>> instances_;
+    mutable std::mutex instances_mutex_;
+    LoadBalancingConfig lb_config_;
+    std::vector<int64_t> latency_samples_ns_; // Ring buffer of recent call latencies
+    size_t latency_next_ = 0;
+    size_t samples_since_recompute_ = 0;
+    int64_t hedge_delay_ns_ = 0;
+    std::mutex latency_mutex_;
+    std::atomic<uint64_t> hedges_sent_{0};
+    std::atomic<uint64_t> hedge_wins_{0};
+    std::unique_ptr<DeadlineScheduler> hedge_scheduler_;
 };
 
 } // namespace comms_stack
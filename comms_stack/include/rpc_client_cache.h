@@ -0,0 +1,100 @@
+#ifndef RPC_CLIENT_CACHE_H
+#define RPC_CLIENT_CACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace comms_stack {
+
+// Opt-in client-side cache for read-only RPC methods.
+// Responses are keyed by (method ID, hash of the serialized request) and kept for a
+// per-method TTL. Identical calls issued while one is already in flight are coalesced
+// onto that request (singleflight) instead of going out on the wire again.
+class RpcClientCache {
+public:
+    // Receives the outcome of a call: SOME/IP return code (0 == E_OK) and the serialized response.
+    using ResponseHandler = std::function<void(int return_code, const uint8_t* data, size_t len)>;
+
+    struct Key {
+        uint16_t method_id;
+        uint64_t request_hash;
+        bool operator==(const Key& other) const {
+            return method_id == other.method_id && request_hash == other.request_hash;
+        }
+    };
+
+    enum class LookupResult {
+        Hit,       // cached_response holds a fresh serialized response
+        Coalesced, // An identical call is in flight; the handler will be run with its result
+        Leader     // Caller must send the request and report the result via complete()
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t coalesced = 0;
+    };
+
+    RpcClientCache() = default;
+
+    void enableMethod(uint16_t method_id, std::chrono::milliseconds ttl);
+    void disableMethod(uint16_t method_id);
+    bool isMethodEnabled(uint16_t method_id) const;
+
+    Key makeKey(uint16_t method_id, const uint8_t* request_data, size_t request_len) const;
+
+    LookupResult lookup(const Key& key, std::vector<uint8_t>& cached_response, ResponseHandler& waiter);
+
+    // Called by the leader once its response arrived. Caches successful responses and
+    // returns the coalesced waiters, which the caller runs outside the cache lock.
+    std::vector<ResponseHandler> complete(const Key& key, int return_code, const uint8_t* data, size_t len);
+
+    // Called when the leader's caller cancels. Drops the in-flight entry and returns true if no
+    // call was coalesced onto it; otherwise the request must keep running for the waiters.
+    bool abandonIfUnshared(const Key& key);
+
+    // Drops in-flight bookkeeping (e.g. when the service goes away); waiters are released,
+    // which breaks their promises.
+    void clearInFlight();
+    void clear();
+
+    Stats getStats() const;
+
+    // Upper bound on how long an unanswered leader keeps absorbing identical calls.
+    static constexpr std::chrono::milliseconds IN_FLIGHT_TIMEOUT{5000};
+    static constexpr size_t MAX_ENTRIES = 1024;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.request_hash ^ (static_cast<uint64_t>(key.method_id) << 48));
+        }
+    };
+    struct Entry {
+        std::vector<uint8_t> response;
+        std::chrono::steady_clock::time_point expires_at;
+        bool in_flight = false;
+        std::chrono::steady_clock::time_point in_flight_since;
+        std::vector<ResponseHandler> waiters;
+    };
+
+    void sweepExpired(std::chrono::steady_clock::time_point now);
+
+    std::map<uint16_t, std::chrono::milliseconds> method_ttls_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    mutable std::mutex mutex_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> coalesced_{0};
+};
+
+} // namespace comms_stack
+
+#endif // RPC_CLIENT_CACHE_H
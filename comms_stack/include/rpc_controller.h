@@ -0,0 +1,66 @@
+#ifndef RPC_CONTROLLER_H
+#define RPC_CONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <google/protobuf/service.h> // For google::protobuf::RpcController and Closure
+
+namespace comms_stack {
+
+// Client -> server cancel notification, sent as MT_REQUEST_NO_RETURN to each RPC service
+// instance. Payload (big endian): session(2) of the request being cancelled; the client ID is
+// taken from the message header.
+constexpr uint16_t METHOD_ID_CANCEL = 0x00F1;
+
+// RpcController handed to service implementations by the server dispatcher.
+// IsCanceled() turns true once the client cancels the call, so long-running handlers can stop
+// early; the response of a cancelled call is not sent. SetFailed() makes the dispatcher answer
+// with E_NOT_OK instead of the response message.
+class ServerRpcController : public ::google::protobuf::RpcController {
+public:
+    ServerRpcController() = default;
+    ~ServerRpcController() override;
+
+    void Reset() override;
+    bool Failed() const override;
+    std::string ErrorText() const override;
+    void StartCancel() override {} // Client-side operation; nothing to do on the server
+    void SetFailed(const std::string& reason) override;
+    bool IsCanceled() const override;
+    // `callback` runs exactly once: on cancellation, or when the call completes.
+    void NotifyOnCancel(::google::protobuf::Closure* callback) override;
+
+    // Dispatcher side
+    void cancel();
+    void complete();
+
+private:
+    mutable std::mutex mutex_;
+    std::atomic<bool> canceled_{false};
+    bool failed_ = false;
+    std::string error_text_;
+    ::google::protobuf::Closure* cancel_callback_ = nullptr;
+};
+
+// In-flight calls of one service instance, keyed by (client, session), so that a cancel
+// notification can reach the controller of the call it refers to.
+class RpcCallRegistry {
+public:
+    std::shared_ptr<ServerRpcController> begin(uint16_t client_id, uint16_t session_id);
+    void end(uint16_t client_id, uint16_t session_id, const std::shared_ptr<ServerRpcController>& controller);
+    bool cancel(uint16_t client_id, uint16_t session_id); // False if the call is not (or no longer) running
+    size_t active() const { return active_.load(std::memory_order_relaxed); } // Lock-free, for introspection
+
+private:
+    std::mutex mutex_;
+    std::map<std::pair<uint16_t, uint16_t>, std::shared_ptr<ServerRpcController>> calls_;
+    std::atomic<size_t> active_{0}; // calls_.size(), stored under mutex_
+};
+
+} // namespace comms_stack
+
+#endif // RPC_CONTROLLER_H
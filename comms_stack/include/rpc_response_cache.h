@@ -0,0 +1,91 @@
+#ifndef RPC_RESPONSE_CACHE_H
+#define RPC_RESPONSE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace comms_stack {
+
+// Per-service configuration for the server-side response cache.
+// Disabled by default; pass to CommunicationManager::registerRpcService to enable.
+struct RpcResponseCacheConfig {
+    bool enabled = false;
+    size_t max_entries = 1024;                 // LRU bound, across all methods of the service
+    std::chrono::milliseconds ttl{5000};       // Entries older than this are treated as misses
+    // Methods whose responses depend only on the request bytes. Their responses are shared
+    // across clients (keyed by request hash); all other methods are keyed by client/session,
+    // which only catches retransmissions and duplicated datagrams of the same call.
+    std::set<uint16_t> idempotent_methods;
+};
+
+// Bounded LRU/TTL cache of serialized RPC responses, used by the server dispatcher to
+// answer retransmitted or duplicated requests without re-running the service handler.
+class RpcResponseCache {
+public:
+    struct Key {
+        uint64_t scope;        // method (+ client/session unless idempotent)
+        uint64_t request_hash; // hash of the serialized request payload
+        bool operator==(const Key& other) const {
+            return scope == other.scope && request_hash == other.request_hash;
+        }
+    };
+
+    enum class LookupResult {
+        Miss,     // Caller must run the handler; an in-flight marker has been reserved for session keys
+        Hit,      // cached_response holds the serialized response
+        InFlight  // Duplicate of a request whose handler is still running; caller should drop it
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t duplicates_dropped = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+    };
+
+    explicit RpcResponseCache(const RpcResponseCacheConfig& config);
+
+    Key makeKey(uint16_t method_id, uint16_t client_id, uint16_t session_id,
+                const uint8_t* request_data, size_t request_len) const;
+
+    LookupResult lookupOrReserve(const Key& key, std::vector<uint8_t>& cached_response);
+    void store(const Key& key, std::vector<uint8_t> serialized_response);
+    void abandon(const Key& key); // Handler failed; drop the in-flight marker so a retry re-executes
+
+    void clear();
+    Stats getStats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.scope * 0x9e3779b97f4a7c15ULL ^ key.request_hash);
+        }
+    };
+    struct Entry {
+        Key key;
+        std::vector<uint8_t> response;
+        std::chrono::steady_clock::time_point stored_at;
+        bool in_flight;
+    };
+    using EntryList = std::list<Entry>;
+
+    static bool isIdempotentKey(const Key& key);
+    void evictIfNeeded();
+
+    RpcResponseCacheConfig config_;
+    EntryList lru_; // Front is most recently used
+    std::unordered_map<Key, EntryList::iterator, KeyHash> index_;
+    Stats stats_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace comms_stack
+
+#endif // RPC_RESPONSE_CACHE_H
@@ -0,0 +1,189 @@
+#ifndef RPC_STREAM_H
+#define RPC_STREAM_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <google/protobuf/message_lite.h>
+
+// Forward declare vsomeip types
+namespace vsomeip {
+    class message;
+    using client_t = uint16_t;
+    using service_t = uint16_t;
+    using instance_t = uint16_t;
+    using method_t = uint16_t;
+    using session_t = uint16_t;
+}
+
+namespace comms_stack {
+
+class RpcClient;
+class Transport;
+
+// Server-streaming RPCs.
+// A stream is opened with an ordinary request to the streaming method; the server acknowledges
+// it with an empty E_OK response. Items are then pushed with notify_one() as STREAM_EVENT_ID
+// events addressed to the calling client, each carrying the open request's session so the
+// client can correlate them. The server only sends items the client has granted credits for;
+// the client grants an initial window once its event subscription is acknowledged and tops it
+// up as items are consumed. A terminal frame carries the final status.
+constexpr uint16_t STREAM_EVENT_ID = 0x9F01;
+constexpr uint16_t STREAM_EVENTGROUP_ID = 0x9F00;
+constexpr uint16_t METHOD_ID_STREAM_CONTROL = 0x00F0; // Client -> server credits/cancel, no response
+constexpr uint32_t DEFAULT_STREAM_WINDOW = 16;
+
+// Stream event payload (big endian): client(2) session(2) sequence(4) flags(1) status(1) data...
+// `data` is the serialized item, or the error text on a terminal frame with a non-zero status.
+struct StreamFrameHeader {
+    static constexpr size_t SIZE = 10;
+    static constexpr uint8_t FLAG_END = 0x01;
+
+    vsomeip::client_t client = 0;
+    vsomeip::session_t session = 0;
+    uint32_t sequence = 0; // Consecutive per stream, starting at 0; the terminal frame included
+    uint8_t flags = 0;
+    uint8_t status = 0;    // SOME/IP return code of the stream, valid with FLAG_END
+
+    void encode(uint8_t* out) const;
+    static bool decode(const uint8_t* data, size_t len, StreamFrameHeader& out);
+};
+
+// Stream control payload (big endian): session(2) credits(4) flags(1)
+struct StreamControl {
+    static constexpr size_t SIZE = 7;
+    static constexpr uint8_t FLAG_CANCEL = 0x01;
+
+    vsomeip::session_t session = 0;
+    uint32_t credits = 0;
+    uint8_t flags = 0;
+
+    void encode(uint8_t* out) const;
+    static bool decode(const uint8_t* data, size_t len, StreamControl& out);
+};
+
+// Receives each item of a stream, in order, as serialized bytes.
+using StreamItemHandler = std::function<void(const uint8_t* data, size_t len)>;
+// Runs exactly once when the stream ends: status 0 (E_OK) on normal completion.
+using StreamCompletionHandler = std::function<void(int status, const std::string& error)>;
+
+// Client-side handle of an open stream, returned by RpcClient::openStream().
+// Handles must not be used after their RpcClient has been destroyed.
+class ClientStream : public std::enable_shared_from_this<ClientStream> {
+public:
+    // Stops the stream: the server is told to stop producing, no further items are delivered
+    // and the completion handler runs with E_NOT_OK / "Cancelled".
+    void cancel();
+    bool isFinished() const;
+    // Blocks until the stream has finished and returns its status.
+    int wait();
+
+private:
+    friend class RpcClient;
+    struct Frame {
+        uint8_t flags;
+        uint8_t status;
+        std::vector<uint8_t> data;
+    };
+
+    RpcClient* client_ = nullptr;
+    vsomeip::instance_t instance_ = 0;
+    vsomeip::session_t session_ = 0;
+    uint32_t window_ = DEFAULT_STREAM_WINDOW;
+    StreamItemHandler on_item_;
+    StreamCompletionHandler on_complete_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable completed_cv_;
+    bool finished_ = false;   // No more items are delivered
+    bool completed_ = false;  // on_complete_ has returned; wait() wakes up
+    int status_ = 0;
+    bool delivering_ = false;           // One thread drains frames at a time, keeping items ordered
+    uint32_t next_sequence_ = 0;
+    uint32_t consumed_since_grant_ = 0;
+    std::map<uint32_t, Frame> pending_frames_; // Frames that arrived ahead of next_sequence_
+};
+
+// Server-side handle passed to a stream method handler.
+class ServerStreamWriter {
+public:
+    // Sends one item, blocking until the client has granted credit for it. Returns false once
+    // the stream was cancelled, the client stopped granting credits or the server is stopping;
+    // the handler should then return.
+    bool write(const ::google::protobuf::MessageLite& item);
+    bool writeRaw(const uint8_t* data, size_t len);
+
+    // Ends the stream with `status` (a SOME/IP return code, 0 == E_OK). If the handler returns
+    // without calling finish(), the stream ends with E_OK.
+    void finish(int status = 0, const std::string& error = "");
+
+    bool isCancelled() const;
+
+    // A producer blocked this long without credit treats the client as gone.
+    static constexpr std::chrono::seconds CREDIT_TIMEOUT{30};
+
+private:
+    friend class RpcStreamServer;
+    struct State;
+    explicit ServerStreamWriter(std::shared_ptr<State> state) : state_(std::move(state)) {}
+    void sendFrame(uint32_t sequence, uint8_t flags, uint8_t status, const uint8_t* data, size_t len);
+    std::shared_ptr<State> state_;
+};
+
+// Runs a stream: parse the request, write items, optionally finish().
+using StreamMethodHandler = std::function<void(const uint8_t* request, size_t len, ServerStreamWriter& writer)>;
+
+// Adapts a typed handler; malformed requests end the stream with E_MALFORMED_MESSAGE.
+template<typename ReqProto>
+StreamMethodHandler makeStreamMethodHandler(std::function<void(const ReqProto&, ServerStreamWriter&)> fn) {
+    return [fn](const uint8_t* data, size_t len, ServerStreamWriter& writer) {
+        ReqProto request;
+        if (!request.ParseFromArray(data, static_cast<int>(len))) {
+            writer.finish(0x09 /* E_MALFORMED_MESSAGE */, "Failed to parse stream request");
+            return;
+        }
+        fn(request, writer);
+    };
+}
+
+// Serves the streaming methods of one offered service instance. Each open stream runs its
+// handler on a dedicated thread, so handlers may block between items.
+class RpcStreamServer {
+public:
+    RpcStreamServer(std::shared_ptr<Transport> transport, uint16_t service_id, uint16_t instance_id);
+    ~RpcStreamServer(); // Cancels all streams and waits for their handlers to return
+
+    RpcStreamServer(const RpcStreamServer&) = delete;
+    RpcStreamServer& operator=(const RpcStreamServer&) = delete;
+
+    void addMethod(uint16_t method_id, const std::string& method_name, StreamMethodHandler handler);
+    size_t activeStreams() const;
+
+private:
+    void onOpen(const std::shared_ptr<vsomeip::message>& msg, const std::string& method_name,
+                const StreamMethodHandler& handler);
+    void onControl(const std::shared_ptr<vsomeip::message>& msg);
+    void runStream(std::shared_ptr<ServerStreamWriter::State> state, StreamMethodHandler handler,
+                   std::vector<uint8_t> request, std::string method_name);
+
+    std::shared_ptr<Transport> transport_;
+    uint16_t service_id_;
+    uint16_t instance_id_;
+    std::vector<uint16_t> method_ids_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable streams_done_cv_;
+    bool stopping_ = false;
+    std::map<std::pair<vsomeip::client_t, vsomeip::session_t>, std::shared_ptr<ServerStreamWriter::State>> streams_;
+};
+
+} // namespace comms_stack
+
+#endif // RPC_STREAM_H
@@ -0,0 +1,63 @@
+#ifndef SERVICE_AVAILABILITY_H
+#define SERVICE_AVAILABILITY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace comms_stack {
+
+// Availability of a remote service as reported by the transport's availability handler, with
+// ways to wait for it: block (waitFor), a future (whenAvailable) or a callback (onChange).
+// Waiters wake as soon as set(true) runs on the dispatcher thread, not on the next poll.
+class ServiceAvailability {
+public:
+    using CallbackId = uint64_t;
+    using Callback = std::function<void(bool available)>;
+
+    ServiceAvailability() = default;
+    ~ServiceAvailability(); // Outstanding whenAvailable() futures get false
+
+    ServiceAvailability(const ServiceAvailability&) = delete;
+    ServiceAvailability& operator=(const ServiceAvailability&) = delete;
+
+    // Called by the owner's availability handler; repeated values are ignored.
+    void set(bool available);
+    bool isAvailable() const { return available_.load(std::memory_order_acquire); }
+
+    // True as soon as the service is available, false once `timeout` passed without it.
+    bool waitFor(std::chrono::milliseconds timeout) const;
+    // Becomes true when the service is (or already was) available, false if this object is
+    // destroyed first.
+    std::future<bool> whenAvailable();
+
+    // Runs `callback` on every change, on the thread that reported it. If the service already is
+    // available, the callback also runs right away with true.
+    CallbackId onChange(Callback callback);
+    // Once this returns, the callback will not run and is not running (unless removeCallback
+    // is called from within it).
+    void removeCallback(CallbackId id);
+
+private:
+    mutable std::mutex mutex_;
+    mutable std::condition_variable available_cv_;
+    std::condition_variable callback_done_cv_;
+    std::atomic<bool> available_{false};
+    std::vector<std::promise<bool>> waiters_;
+    CallbackId next_id_ = 1;
+    std::map<CallbackId, Callback> callbacks_;
+    CallbackId running_id_ = 0;
+    std::thread::id running_thread_;
+    std::mutex dispatch_mutex_; // Keeps changes reported to callbacks in order
+};
+
+} // namespace comms_stack
+
+#endif // SERVICE_AVAILABILITY_H
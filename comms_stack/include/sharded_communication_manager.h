@@ -0,0 +1,56 @@
+#ifndef SHARDED_COMMUNICATION_MANAGER_H
+#define SHARDED_COMMUNICATION_MANAGER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "communication_manager.h"
+
+namespace comms_stack {
+
+// Spreads topics and services over several CommunicationManagers, each with its own vsomeip
+// application and dispatcher threads, so message handling scales with cores instead of
+// being serialized through one application.
+//
+// All shards load the same registry, so a handle means the same topic on every shard. An entry
+// belongs to the shard named by its "shard" attribute (modulo the shard count), or otherwise to
+// shard (handle % shard count).
+class ShardedCommunicationManager {
+public:
+    struct Options {
+        std::vector<std::string> app_names; // One vsomeip application per shard
+        std::string config_path;            // Optional if VSOMEIP_CONFIGURATION is set
+        unsigned dispatcher_threads = 0;    // Per shard; 0 == as configured
+        std::string discovery_cache_directory; // Optional; one "<app name>.discovery.json" per shard
+    };
+
+    ShardedCommunicationManager() = default;
+    ~ShardedCommunicationManager();
+
+    ShardedCommunicationManager(const ShardedCommunicationManager&) = delete;
+    ShardedCommunicationManager& operator=(const ShardedCommunicationManager&) = delete;
+
+    bool init(const Options& options); // All shards or none
+    void shutdown();
+
+    size_t shardCount() const { return shards_.size(); }
+    CommunicationManager& shard(size_t index) { return *shards_[index]; }
+
+    size_t shardOfTopic(TopicHandle topic) const;
+    size_t shardOfService(ServiceHandle service) const;
+
+    std::shared_ptr<Publisher> getPublisher(const std::string& topic_name);
+    std::shared_ptr<Subscriber> getSubscriber(const std::string& topic_name);
+    std::shared_ptr<RpcClient> getRpcClient(const std::string& service_name);
+    // Serves the service from its owning shard, with IDs from the registry.
+    void registerRpcService(const std::string& service_name,
+                            std::shared_ptr<protos::SampleRpc> service_impl,
+                            const RpcResponseCacheConfig& cache_config = RpcResponseCacheConfig());
+
+private:
+    std::vector<std::unique_ptr<CommunicationManager>> shards_;
+};
+
+} // namespace comms_stack
+
+#endif // SHARDED_COMMUNICATION_MANAGER_H
@@ -0,0 +1,91 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace comms_stack {
+
+struct ShmRingHeader; // Layout in shm_ring.cpp
+
+// Name of the ring file for one topic, e.g. "/dev/shm/comms_stack_1112_0001_9200".
+std::string shmRingPath(const std::string& directory, uint16_t service_id, uint16_t instance_id, uint16_t event_id);
+
+// Memory-mapped broadcast ring of fixed-size slots for same-host topics. One process writes,
+// any number of processes read, each with its own cursor kept on the reader side; the writer
+// never waits for readers. A slot is a seqlock: readers parse the payload in place and then
+// check that the writer did not lap them meanwhile, so a slow reader loses messages instead of
+// stalling the publisher. Readers block on a futex in the header while the ring is empty.
+class ShmRingWriter {
+public:
+    ShmRingWriter() = default;
+    ~ShmRingWriter();
+
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    // Replaces any existing ring at `path`. Readers of the old one are not disturbed, they just
+    // stop receiving and have to re-attach.
+    bool create(const std::string& path, uint32_t slot_count, uint32_t slot_size);
+    void close(); // Also removes the file
+
+    bool isOpen() const { return header_ != nullptr; }
+    uint32_t slotSize() const;
+
+    // Appends one message of `length` bytes; `fill` writes them straight into the slot and
+    // returns false to abandon the message. Thread-safe.
+    bool write(size_t length, const std::function<bool(uint8_t* slot)>& fill);
+
+private:
+    std::mutex mutex_; // One writer at a time
+    ShmRingHeader* header_ = nullptr;
+    size_t mapped_size_ = 0;
+    std::string path_;
+};
+
+class ShmRingReader {
+public:
+    enum class Status {
+        MESSAGE, // `parse` accepted a complete, untorn message
+        EMPTY,   // Nothing new
+        LOST,    // The writer overwrote the slot before or while it was read; skipped
+        INVALID  // `parse` rejected the bytes
+    };
+
+    ShmRingReader() = default;
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    // Fails if the ring does not exist, is not a ring of this version or its writer is gone.
+    // Reading starts with the next message written.
+    bool attach(const std::string& path);
+    void detach();
+    bool isAttached() const { return header_ != nullptr; }
+    uint32_t slotSize() const; // Largest message the ring holds; 0 if not attached
+
+    // Hands the next message to `parse` without copying it out of the ring. Whatever `parse`
+    // built from the bytes must be dropped unless MESSAGE is returned.
+    Status read(const std::function<bool(const uint8_t* data, size_t length)>& parse);
+    // Blocks until a message may be available, wake() is called or the timeout expires.
+    void wait(std::chrono::milliseconds timeout);
+    // Wakes every reader waiting on this ring (in any process), e.g. to stop a reader thread.
+    void wake();
+
+    uint64_t lostCount() const { return lost_; }
+
+private:
+    ShmRingHeader* header_ = nullptr;
+    size_t mapped_size_ = 0;
+    uint64_t next_ = 0; // Sequence number of the next message to read
+    uint64_t lost_ = 0;
+};
+
+} // namespace comms_stack
+
+#endif // SHM_RING_H
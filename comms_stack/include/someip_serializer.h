@@ -0,0 +1,81 @@
+#ifndef SOMEIP_SERIALIZER_H
+#define SOMEIP_SERIALIZER_H
+
+#include "payload_codec.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace google { namespace protobuf { class Descriptor; class FieldDescriptor; class Message; class Reflection; } }
+
+namespace comms_stack {
+
+// Encodes protobuf messages in the SOME/IP payload format classic AUTOSAR ECUs use, so they
+// can be talked to without a gateway. Fields are written in field-number order, big-endian:
+//
+//   bool                       1 byte
+//   (s)(u)int32, fixed32, enum 4 bytes      (s)(u)int64, fixed64  8 bytes
+//   float, double              IEEE 754, 4 and 8 bytes
+//   string                     length field, UTF-8 BOM, bytes, NUL (the length counts all three)
+//   bytes                      length field, bytes (a dynamic uint8 array)
+//   message                    its fields inline (a struct without length field)
+//   repeated                   length field (bytes, not elements), then the elements
+//
+// Length fields are SomeIpOptions::length_field_size bytes wide, and every field and array
+// element starts at a multiple of SomeIpOptions::alignment bytes from the start of the payload
+// (zero padding). Decoding accepts strings without BOM or NUL and ignores trailing bytes, so
+// a peer may append fields. Unset fields are sent as their defaults: the format has no presence.
+//
+// One table per message type, built from its descriptor on first use and kept for the life of
+// the process. Types with oneofs (proto3 `optional` included), or that contain themselves
+// other than through a repeated field, cannot be mapped; forType() returns null for them and
+// PayloadCodec sends them as protobuf.
+class SomeIpSerializer {
+public:
+    static const SomeIpSerializer* forType(const google::protobuf::Descriptor* descriptor);
+    // forType(message.GetDescriptor()), through a small per-thread cache.
+    static const SomeIpSerializer* forMessage(const google::protobuf::Message& message);
+
+    const google::protobuf::Descriptor* descriptor() const { return descriptor_; }
+
+    size_t byteSize(const google::protobuf::Message& message, const SomeIpOptions& options) const;
+    // False if `size` is not byteSize() or a string or array overflows its length field.
+    bool encode(const google::protobuf::Message& message, const SomeIpOptions& options,
+                uint8_t* out, size_t size) const;
+    // Clears `message` first. False on truncated or malformed input.
+    bool decode(const uint8_t* data, size_t length, const SomeIpOptions& options,
+                google::protobuf::Message& message) const;
+
+private:
+    enum class Kind : uint8_t { Bool, Int32, UInt32, Int64, UInt64, Float, Double, Enum, String, Bytes, Message };
+    struct Member {
+        const google::protobuf::FieldDescriptor* field;
+        Kind kind;
+        uint8_t width; // Bytes of a scalar value; 0 for strings, bytes and messages
+        bool repeated;
+        const SomeIpSerializer* nested; // Kind::Message only
+    };
+    class Writer;
+    class Reader;
+
+    explicit SomeIpSerializer(const google::protobuf::Descriptor* descriptor) : descriptor_(descriptor) {}
+    // Builds the table for `descriptor` and the types it contains; registry lock held.
+    static SomeIpSerializer* build(const google::protobuf::Descriptor* descriptor);
+
+    void write(Writer& writer, const google::protobuf::Message& message) const;
+    // `index` is the element of a repeated field, -1 for a singular one.
+    void writeValue(Writer& writer, const Member& member, const google::protobuf::Message& message,
+                    const google::protobuf::Reflection* reflection, int index) const;
+    bool read(Reader& reader, google::protobuf::Message& message) const;
+    bool readValue(Reader& reader, const Member& member, google::protobuf::Message& message,
+                   const google::protobuf::Reflection* reflection) const;
+
+    const google::protobuf::Descriptor* descriptor_;
+    std::vector<Member> members_;
+    bool valid_ = false;
+    bool building_ = true;
+};
+
+} // namespace comms_stack
+
+#endif // SOMEIP_SERIALIZER_H
@@ -5,10 +5,20 @@
 #include <memory>
 #include <functional>
 #include <set> // For eventgroup set
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "availability_router.h"
+#include "local_bus.h"
+#include "message_envelope.h"
+#include "transport.h"
+#include "service_availability.h"
+#include "metrics.h"
+#include "payload_codec.h"
+#include "tracing.h"
 
 // Forward declare vsomeip types
 namespace vsomeip {
-    class application;
     class message;
     using service_t = uint16_t;
     using instance_t = uint16_t;
@@ -19,51 +29,145 @@ namespace vsomeip {
 // Forward declare Protobuf message types
 namespace google { namespace protobuf { class Message; } }
 namespace comms_stack { namespace protos { class SimpleNotification; } }
+namespace comms_stack { class ShmRingReader; class UdpBatchReceiver; class UdpDuplicateFilter; struct SharedMemoryConfig; struct BatchedUdpConfig; }
 
 namespace comms_stack {
 
 class Subscriber {
 public:
     using SimpleNotificationCallback = std::function<void(const protos::SimpleNotification& message)>;
-    // For generic callback, providing the raw payload might be safer initially,
-    // or requiring the user to also provide a parser/prototype.
-    // Let's keep it as Message& for now, assuming a mechanism.
+    // Remote messages reach a generic callback only through an envelope, which names their type
+    // (see enableEnvelope()); in-process ones always do.
     using GenericMessageCallback = std::function<void(const std::string& topic_name, const google::protobuf::Message& message)>;
+    // Messages from in-process publishers arrive as the publisher's own object (see local_bus.h).
+    using SharedMessageCallback = std::function<void(const std::shared_ptr<const google::protobuf::Message>& message)>;
 
     Subscriber(const std::string& topic_name,
-                 std::shared_ptr<vsomeip::application> app,
+                 std::shared_ptr<Transport> transport,
                  uint16_t service_id,
                  uint16_t instance_id, // Usually ANY_INSTANCE for subscribers
-                 uint16_t event_id_or_group,
-                 bool is_eventgroup = true);
+                 uint16_t event_id,
+                 uint16_t eventgroup_id = 0, // Eventgroup the event is requested in; 0 if none
+                 std::shared_ptr<LocalBus> local_bus = nullptr); // Set to receive from in-process publishers directly
     ~Subscriber();
 
     bool subscribe(SimpleNotificationCallback callback);
     bool subscribeGeneric(GenericMessageCallback callback);
+    // Wire payloads are parsed into a new instance of `prototype`'s type; in-process publishers
+    // hand over their message without serialization or copying.
+    bool subscribeShared(const google::protobuf::Message& prototype, SharedMessageCallback callback);
+    // Registers the handlers and requests the event ahead of time, so a later subscribe*() only
+    // sets its callback. Events arriving before that are dropped. Used by pre-provisioning.
+    bool prepare();
+
+    // Reads the publisher's shared-memory ring when it is on this host (see shm_ring.h), on a
+    // thread of its own, and ignores the vsomeip copies of those events. Falls back to vsomeip
+    // while no ring is found; the ring is looked up again whenever the service becomes available.
+    void enableSharedMemory(const SharedMemoryConfig& config);
+    // Receives the publisher's batched SOME/IP datagrams (see udp_batch.h) with recvmmsg() on a
+    // thread of its own. The publisher sends a message as a vsomeip event instead when it does
+    // not fit config.max_payload or its sender could not send it, and as both if config.wire is
+    // set; then the second copy to arrive is dropped.
+    void enableBatchedUdp(const BatchedUdpConfig& config);
+    // Wire format of the payloads; must match the publisher's (see payload_codec.h). Set before
+    // subscribing, which prepares the codec for the message type.
+    void setCodec(const PayloadCodec& codec);
+    // Strips the MessageEnvelope of each payload (see message_envelope.h): its type is checked
+    // against the one subscribed to, and generic callbacks are served with the type it names.
+    // Payloads without one, from publishers without the envelope, are still accepted. Set
+    // before subscribing; ignored with SOME/IP.
+    void enableEnvelope(const EnvelopeConfig& config);
     bool unsubscribe();
 
     std::string getTopicName() const;
     bool isSubscribed() const;
+    // Availability of the publishing service, tracked from subscribe*() until unsubscribe().
+    // See RpcClient::waitForAvailability() and ServiceAvailability.
+    bool isServiceAvailable() const;
+    bool waitForAvailability(std::chrono::milliseconds timeout) const;
+    std::future<bool> whenAvailable();
+    ServiceAvailability::CallbackId onAvailabilityChange(ServiceAvailability::Callback callback);
+    void removeAvailabilityCallback(ServiceAvailability::CallbackId id);
 
 private:
+    // Everything a delivery reads about how to parse and whom to call. The handlers may already
+    // be running (see prepare()) when subscribe*() and friends change it, so it is never modified
+    // in place: a changed copy replaces it, and each delivery works on the snapshot it loaded.
+    struct Delivery {
+        SimpleNotificationCallback notification_callback;
+        GenericMessageCallback generic_callback;
+        SharedMessageCallback shared_callback;
+        std::shared_ptr<const google::protobuf::Message> prototype; // For shared_callback
+        PayloadCodec codec;
+        EnvelopeConfig envelope;
+        uint32_t type_hash = 0; // Of the type subscribe() or subscribeShared() parses into
+    };
+    std::shared_ptr<const Delivery> delivery() const { return std::atomic_load(&delivery_); }
+    void updateDelivery(const std::function<void(Delivery&)>& change);
+
+    void registerHandlers();
     void onAvailabilityChanged(vsomeip::service_t service, vsomeip::instance_t instance, bool is_available);
     void onMessageReceived(const std::shared_ptr<vsomeip::message>& msg);
+    void onLocalMessage(const LocalBus::MessagePtr& message);
+    void attachLocalSink();
+    void startShmReader();
+    void stopShmReader();
+    void runShmReader();
+    void startUdpReceiver();
+    void stopUdpReceiver();
+    void runUdpReceiver();
+    // What preceded a payload on the wire.
+    struct Headers {
+        MessageEnvelope envelope;
+        TraceEnvelope trace;
+        bool enveloped = false;
+        bool traced = false;
+    };
+    // Strips the envelopes off `data`. False, after logging why, if the payload cannot be
+    // parsed as the subscribed type; with a generic callback `prototype` is set to the type to parse.
+    bool readHeaders(const Delivery& delivery, const uint8_t*& data, size_t& length, Headers& headers,
+                     const google::protobuf::Message*& prototype) const;
+    void deliverPayload(uint16_t event_id, const uint8_t* data, size_t length);
+    // Records a span ending now if `trace` is set; returns now, or 0 if not traced.
+    uint64_t traceSpan(const TraceEnvelope* trace, TraceStage stage, uint64_t start_ns) const;
 
     std::string topic_name_;
-    std::shared_ptr<vsomeip::application> vsomeip_app_;
+    std::shared_ptr<Transport> transport_;
     uint16_t service_id_;
     uint16_t instance_id_; // Instance of the service to monitor for availability
-    uint16_t event_id_or_group_;
-    bool is_eventgroup_;
+    uint16_t event_id_;
+    uint16_t eventgroup_id_; // 0 == event is not requested through an eventgroup
+
+    std::shared_ptr<const Delivery> delivery_; // Only through std::atomic_load/atomic_store
+    std::mutex delivery_mutex_; // Serializes updateDelivery()
+
+    std::atomic<bool> is_subscribed_{false}; // Atomic: also read by introspection
+    ServiceAvailability availability_; // Track service availability
+    std::shared_ptr<AvailabilityRouter> availability_router_; // Shared per transport
+    AvailabilityRouter::HandlerId availability_handler_id_ = 0; // 0 while not registered
+
+    std::shared_ptr<LocalBus> local_bus_;
+    std::shared_ptr<LocalBus::Topic> local_topic_; // Null if local_bus_ is
+    std::shared_ptr<LocalBus::Sink> local_sink_;
 
-    SimpleNotificationCallback notification_callback_;
-    GenericMessageCallback generic_callback_;
+    std::string shm_path_; // Empty unless enableSharedMemory() was called
+    std::mutex shm_mutex_; // Serializes reader start/stop
+    std::unique_ptr<ShmRingReader> shm_reader_;
+    std::thread shm_thread_;
+    std::atomic<bool> shm_stop_{false};
+    std::atomic<bool> shm_attached_{false};
+    std::atomic<uint32_t> shm_slot_size_{0}; // Larger messages only arrive through vsomeip
 
-    bool is_subscribed_ = false;
-    bool service_available_ = false; // Track service availability
+    std::unique_ptr<BatchedUdpConfig> udp_config_; // Null unless enableBatchedUdp() was called
+    std::mutex udp_mutex_; // Serializes receiver start/stop
+    std::unique_ptr<UdpBatchReceiver> udp_receiver_;
+    std::thread udp_thread_;
+    std::atomic<bool> udp_stop_{false};
+    std::atomic<bool> udp_active_{false};
+    std::unique_ptr<UdpDuplicateFilter> udp_duplicates_; // Used if udp_config_->wire
 
-    // Store the specific eventgroup if it's an eventgroup subscription for request_event
-    std::set<vsomeip::eventgroup_t> subscribed_eventgroups_;
+    Metrics::Endpoint metrics_;
+    uint16_t trace_topic_; // Payloads carrying a TraceEnvelope are traced (see tracing.h)
 };
 
 } // namespace comms_stack
@@ -0,0 +1,137 @@
+#ifndef TOPIC_REGISTRY_H
+#define TOPIC_REGISTRY_H
+
+#include "message_envelope.h"
+#include "payload_codec.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace comms_stack {
+
+// Dense indices into the registry, handed out once per name. Hot paths keep the handle and
+// index arrays with it instead of comparing names.
+using TopicHandle = uint32_t;
+using ServiceHandle = uint32_t;
+constexpr uint32_t INVALID_HANDLE = 0xFFFFFFFF;
+
+// Same-host data plane for a topic (see shm_ring.h). vsomeip still offers the event for discovery.
+struct SharedMemoryConfig {
+    bool enabled = false;
+    uint32_t slots = 64;
+    uint32_t slot_size = 64 * 1024; // Largest serialized message
+    bool wire = false;              // Also send the vsomeip event, for subscribers on other hosts
+    std::string directory = "/dev/shm";
+};
+
+// Raw UDP data plane for high-rate unreliable topics (see udp_batch.h): SOME/IP-framed
+// notifications sent and received in batches. vsomeip still offers the event for discovery.
+struct BatchedUdpConfig {
+    bool enabled = false;
+    std::string address;            // IPv4 unicast or multicast group the events are sent to
+    uint16_t port = 0;
+    std::string interface_address;  // Local interface for multicast; empty == system default
+    uint32_t batch = 32;            // Datagrams per sendmmsg()/recvmmsg()
+    uint32_t linger_us = 100;       // Longest a datagram waits for its batch to fill; 0 == send at once
+    uint32_t max_payload = 1400;    // Larger messages go over vsomeip instead
+    bool wire = false;              // Also send the vsomeip event
+};
+
+struct TopicEntry {
+    std::string name;
+    uint16_t service_id = 0;
+    uint16_t instance_id = 0;
+    uint16_t event_id = 0;
+    uint16_t eventgroup_id = 0; // Eventgroup event_id is offered and requested in; 0 == none
+    bool reliable = false; // Event offered over TCP rather than UDP
+    int shard = -1; // Owning ShardedCommunicationManager shard; -1 == spread by handle
+    SharedMemoryConfig shm;
+    BatchedUdpConfig udp;
+    bool trace = false; // Publishers send a TraceEnvelope and record spans (see tracing.h)
+    Codec codec = Codec::Protobuf;
+    SomeIpOptions someip; // For Codec::SomeIp
+    EnvelopeConfig envelope; // Payloads carry a MessageEnvelope (see message_envelope.h)
+};
+
+struct ServiceEntry {
+    std::string name;
+    uint16_t service_id = 0;
+    uint16_t instance_id = 0;
+    bool reliable = true; // Clients send requests over TCP rather than UDP
+    int shard = -1;
+    std::unordered_map<std::string, Codec> method_codecs; // By method name; others use protobuf
+    SomeIpOptions someip; // For methods using Codec::SomeIp
+    EnvelopeConfig envelope; // Clients send a MessageEnvelope; the server answers in kind
+};
+
+// Endpoints one application sets up during init() instead of on first use (see
+// CommunicationManager::init()); names refer to the topics and services below.
+struct ProvisioningPlan {
+    std::vector<std::string> publish;   // Topics offered
+    std::vector<std::string> subscribe; // Topics requested, subscribed and given handlers
+    std::vector<std::string> call;      // RPC services requested
+};
+
+// Name -> (service, instance, event/eventgroup, reliability) mapping for topics and RPC
+// services, read from the "comms_stack" section of the vsomeip JSON configuration:
+//
+//   "comms_stack" : {
+//       "topics" : [ { "name" : "TestTopic", "service" : "0x1111", "instance" : "0x0001",
+//                      "event" : "0x9100", "eventgroup" : "0x9100", "reliable" : "false",
+//                      "shard" : "0",
+//                      "shm" : { "slots" : "64", "slot_size" : "65536", "wire" : "false" },
+//                      "udp" : { "address" : "239.255.0.10", "port" : "40100", "batch" : "32",
+//                                "linger_us" : "100", "max_payload" : "1400", "wire" : "false" },
+//                      "trace" : "false", "codec" : "protobuf",
+//                      "envelope" : { "schema_version" : "1", "timestamp" : "false" } } ],
+//       "services" : [ { "name" : "SampleRpc", "service" : "0x2222", "instance" : "0x0001",
+//                        "codecs" : { "Add" : "fixed", "Echo" : "someip" },
+//                        "someip" : { "alignment" : "1", "length_field_size" : "4" },
+//                        "envelope" : { "schema_version" : "1" } } ],
+//       "shm_directory" : "/dev/shm",
+//       "provisioning" : { "CommsStackApp_PubSub" : { "publish" : [ "TestTopic" ],
+//                                                     "subscribe" : [ "TestTopic" ], "call" : [ "SampleRpc" ] } }
+//   }
+//
+// Filled once by CommunicationManager::init() and read-only afterwards.
+class TopicRegistry {
+public:
+    // Returns false if the file cannot be read or parsed. A file without a "comms_stack"
+    // section yields an empty registry.
+    bool loadFromFile(const std::string& path);
+    void clear();
+
+    // Registers (or replaces) an entry and returns its handle.
+    TopicHandle addTopic(const TopicEntry& entry);
+    ServiceHandle addService(const ServiceEntry& entry);
+
+    TopicHandle findTopic(const std::string& name) const;     // INVALID_HANDLE if unknown
+    ServiceHandle findService(const std::string& name) const; // INVALID_HANDLE if unknown
+
+    // nullptr for an invalid handle.
+    const TopicEntry* topic(TopicHandle handle) const {
+        return handle < topics_.size() ? &topics_[handle] : nullptr;
+    }
+    const ServiceEntry* service(ServiceHandle handle) const {
+        return handle < services_.size() ? &services_[handle] : nullptr;
+    }
+
+    size_t topicCount() const { return topics_.size(); }
+    size_t serviceCount() const { return services_.size(); }
+
+    // nullptr if the configuration has no provisioning entry for app_name.
+    const ProvisioningPlan* provisioning(const std::string& app_name) const;
+    void setProvisioning(const std::string& app_name, const ProvisioningPlan& plan);
+
+private:
+    std::vector<TopicEntry> topics_;
+    std::vector<ServiceEntry> services_;
+    std::unordered_map<std::string, TopicHandle> topic_handles_;
+    std::unordered_map<std::string, ServiceHandle> service_handles_;
+    std::unordered_map<std::string, ProvisioningPlan> provisioning_;
+};
+
+} // namespace comms_stack
+
+#endif // TOPIC_REGISTRY_H
@@ -0,0 +1,127 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace comms_stack {
+
+// Prepended to each payload of a traced topic: the trace ID and the publish (enqueue) time,
+// so the subscriber can stamp the transport hop. 20 bytes, host (little-endian) byte order.
+// It starts with a 0x00 byte, which no non-empty protobuf message does (field number 0 is
+// invalid), so receivers recognise it without configuration.
+struct TraceEnvelope {
+    static constexpr size_t SIZE = 4 + 2 * sizeof(uint64_t);
+    static constexpr uint8_t MAGIC[4] = {0x00, 'C', 'T', 0x01};
+
+    uint64_t trace_id = 0;
+    uint64_t origin_ns = 0; // Tracer::now() at publish
+
+    void write(uint8_t* out) const {
+        std::memcpy(out, MAGIC, sizeof(MAGIC));
+        std::memcpy(out + 4, &trace_id, sizeof(trace_id));
+        std::memcpy(out + 12, &origin_ns, sizeof(origin_ns));
+    }
+    // If `data` starts with an envelope, fills `envelope` and advances data/length past it.
+    static bool strip(const uint8_t*& data, size_t& length, TraceEnvelope& envelope) {
+        if (length < SIZE || data[0] != 0x00 || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+            return false;
+        }
+        std::memcpy(&envelope.trace_id, data + 4, sizeof(envelope.trace_id));
+        std::memcpy(&envelope.origin_ns, data + 12, sizeof(envelope.origin_ns));
+        data += SIZE;
+        length -= SIZE;
+        return true;
+    }
+};
+
+// Hops of a traced message. Publisher side: Publish (enqueue until publish*() returns),
+// Serialize and Send. Subscriber side: Transit (the envelope's origin until the payload is
+// received), Parse and Callback.
+enum class TraceStage : uint8_t { Publish, Serialize, Send, Transit, Parse, Callback };
+
+// Span recorder for end-to-end latency tracing. Each thread writes into a ring of its own
+// (RING_EVENTS spans, oldest overwritten) without locks; the rings are read on export, so the
+// spans of the last RING_EVENTS messages per thread are kept. Timestamps are steady_clock
+// (CLOCK_MONOTONIC on Linux), which processes on one host share, so a subscriber's Transit
+// span is valid across processes but not across hosts.
+class Tracer {
+public:
+    static constexpr size_t RING_EVENTS = 16384;
+
+    struct Span {
+        uint64_t trace_id = 0;
+        uint64_t start_ns = 0;
+        uint64_t end_ns = 0;
+        uint32_t tid = 0;
+        uint16_t topic = 0;
+        TraceStage stage = TraceStage::Publish;
+    };
+    // Rings are pooled: a thread that exits hands its ring to the next thread that records.
+    struct RingUsage {
+        size_t allocated = 0;
+        size_t in_use = 0; // Attached to a live thread
+    };
+
+    static Tracer& global();
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Same ID for the same name; spans name their topic by it.
+    uint16_t topic(const std::string& name);
+    uint64_t nextTraceId(); // Unique per process and, with high probability, across processes
+
+    void record(uint64_t trace_id, uint16_t topic, TraceStage stage, uint64_t start_ns, uint64_t end_ns);
+
+    std::vector<Span> spans() const; // Spans currently held by all rings
+    // Chrome trace event JSON (chrome://tracing, ui.perfetto.dev). Transit spans are async
+    // events, drawn on tracks of their own; the others are complete events on their thread.
+    // The trace ID is in each event's args.
+    void writeChromeTrace(std::ostream& out) const;
+    bool writeChromeTrace(const std::string& path) const;
+    // Per-hop breakdown: count and p50/p99/max per topic and stage.
+    void print(std::ostream& out) const;
+    static const char* stageName(TraceStage stage);
+    RingUsage ringUsage() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> trace_id{0};
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> end_ns{0};
+        std::atomic<uint64_t> meta{0}; // tid << 32 | topic << 8 | stage
+    };
+    struct Ring {
+        std::atomic<uint64_t> head{0}; // Spans ever written
+        std::atomic<bool> in_use{true};
+        Slot slots[RING_EVENTS];
+    };
+    class ThreadExit; // Hands the thread's ring back for reuse
+
+    Tracer();
+    Ring* attachThread();
+    std::vector<std::string> topicNames() const;
+
+    mutable std::mutex mutex_; // Guards rings_ and topic names; not taken by record()
+    std::vector<Ring*> rings_; // Never freed: exited threads' spans stay readable
+    std::vector<std::string> topics_;
+    uint64_t trace_id_base_;
+    std::atomic<uint32_t> trace_sequence_{0};
+
+    static thread_local Ring* thread_ring_;
+    static thread_local uint32_t thread_id_;
+    static thread_local bool thread_exited_; // Set once the ring is handed back; later spans are lost
+};
+
+} // namespace comms_stack
+
+#endif // TRACING_H
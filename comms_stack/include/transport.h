@@ -0,0 +1,84 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+
+// Forward declare vsomeip types
+namespace vsomeip {
+    class application;
+    class message;
+    class payload;
+}
+
+namespace comms_stack {
+
+// The SOME/IP application services the stack needs: service and event offers, availability,
+// message routing and sending. Publisher, Subscriber, RpcClient, the RPC server side and
+// CommunicationManager only talk to this interface. Messages and payloads are vsomeip's value
+// types (created through vsomeip::runtime), which need neither an application nor routing.
+//
+// VsomeipTransport (the default) forwards to a vsomeip::application; LoopbackTransport routes
+// between transports of one process without any networking.
+//
+// Wildcards (0xFFFF) for service, instance and method match like they do in vsomeip.
+class Transport {
+public:
+    using MessageHandler = std::function<void(const std::shared_ptr<vsomeip::message>& message)>;
+    using AvailabilityHandler = std::function<void(uint16_t service_id, uint16_t instance_id, bool is_available)>;
+    using SubscriptionStatusHandler = std::function<void(uint16_t service_id, uint16_t instance_id,
+                                                         uint16_t eventgroup_id, uint16_t event_id, uint16_t error)>;
+
+    virtual ~Transport() = default;
+
+    virtual bool init() = 0;
+    virtual void start() = 0;
+    virtual void stop() = 0; // No handler runs after this returns
+    virtual uint16_t getClientId() const = 0;
+
+    virtual void offerService(uint16_t service_id, uint16_t instance_id) = 0;
+    virtual void stopOfferService(uint16_t service_id, uint16_t instance_id) = 0;
+    virtual void requestService(uint16_t service_id, uint16_t instance_id) = 0;
+    virtual void releaseService(uint16_t service_id, uint16_t instance_id) = 0;
+    // One handler per (service, instance), which a new registration replaces, as in vsomeip.
+    // Objects sharing a transport watch services through its AvailabilityRouter instead.
+    virtual void registerAvailabilityHandler(uint16_t service_id, uint16_t instance_id, AvailabilityHandler handler) = 0;
+    virtual void unregisterAvailabilityHandler(uint16_t service_id, uint16_t instance_id) = 0;
+
+    virtual void registerMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id,
+                                        MessageHandler handler) = 0;
+    virtual void unregisterMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id) = 0;
+    // Requests are stamped with this transport's client ID and a new session ID before they leave.
+    virtual void send(const std::shared_ptr<vsomeip::message>& message) = 0;
+
+    // `reliable` sends the event over the service's TCP endpoint rather than UDP.
+    virtual void offerEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                            const std::set<uint16_t>& eventgroups, bool reliable) = 0;
+    virtual void stopOfferEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) = 0;
+    virtual void requestEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                              const std::set<uint16_t>& eventgroups) = 0;
+    virtual void releaseEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) = 0;
+    virtual void subscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) = 0;
+    virtual void unsubscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) = 0;
+    virtual void registerSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id,
+                                                   uint16_t event_id, SubscriptionStatusHandler handler) = 0;
+    virtual void unregisterSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id,
+                                                     uint16_t eventgroup_id, uint16_t event_id) = 0;
+    virtual void notify(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                        const std::shared_ptr<vsomeip::payload>& payload) = 0;
+    // Notifies only the subscriber with the given client ID.
+    virtual void notifyOne(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                           const std::shared_ptr<vsomeip::payload>& payload, uint16_t client_id) = 0;
+
+    // The underlying vsomeip application, or nullptr if there is none.
+    virtual std::shared_ptr<vsomeip::application> getVsomeipApplication() const { return nullptr; }
+    // Messages and tasks waiting for a dispatcher thread, for introspection; -1 if the transport
+    // cannot tell (vsomeip does not expose its queues). Must not block the dispatchers.
+    virtual int64_t queueDepth() const { return -1; }
+};
+
+} // namespace comms_stack
+
+#endif // TRANSPORT_H
@@ -0,0 +1,149 @@
+#ifndef UDP_BATCH_H
+#define UDP_BATCH_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct mmsghdr;
+struct iovec;
+
+namespace comms_stack {
+
+struct BatchedUdpConfig;
+
+// SOME/IP header of a notification as sent by UdpBatchSender (16 bytes, big-endian).
+struct SomeIpNotificationHeader {
+    static constexpr size_t SIZE = 16;
+    uint16_t service_id = 0;
+    uint16_t event_id = 0;
+    uint32_t payload_length = 0;
+    uint16_t session = 0;
+
+    void encode(uint8_t* out) const;
+    // False unless `data` holds a complete SOME/IP notification.
+    bool decode(const uint8_t* data, size_t length);
+};
+
+// Sends the notifications of one topic as SOME/IP datagrams over a socket of its own, several
+// per sendmmsg() call, instead of one socket write per event. Datagrams are framed in place in
+// a preallocated batch buffer and sent when the batch is full or the oldest one has waited
+// config.linger_us, whichever comes first.
+class UdpBatchSender {
+public:
+    UdpBatchSender();
+    ~UdpBatchSender();
+
+    UdpBatchSender(const UdpBatchSender&) = delete;
+    UdpBatchSender& operator=(const UdpBatchSender&) = delete;
+
+    bool open(const BatchedUdpConfig& config);
+    void close(); // Sends what is queued
+
+    bool isOpen() const { return socket_ >= 0; }
+    size_t maxPayload() const { return max_payload_; }
+
+    // Queues one notification; `fill` writes its `length` payload bytes straight into the
+    // datagram and returns false to abandon it. Thread-safe.
+    bool send(uint16_t service_id, uint16_t event_id, size_t length, const std::function<bool(uint8_t* payload)>& fill);
+    void flush();
+
+    uint64_t datagramsSent() const { return datagrams_sent_; }
+    uint64_t sendCalls() const { return send_calls_; }
+
+private:
+    void flushLocked();
+    void runFlusher();
+
+    int socket_ = -1;
+    size_t batch_ = 0;
+    size_t max_payload_ = 0;
+    size_t stride_ = 0;
+    std::chrono::microseconds linger_{0};
+
+    std::mutex mutex_;
+    std::condition_variable flusher_cv_;
+    std::vector<uint8_t> buffer_;     // batch_ datagrams of stride_ bytes
+    std::unique_ptr<iovec[]> iovecs_;
+    std::unique_ptr<mmsghdr[]> messages_;
+    size_t queued_ = 0;
+    std::chrono::steady_clock::time_point first_queued_at_;
+    uint16_t next_session_ = 1;
+    bool stopping_ = false;
+    std::thread flusher_;
+
+    std::atomic<uint64_t> datagrams_sent_{0};
+    std::atomic<uint64_t> send_calls_{0};
+};
+
+// Receives the datagrams of one topic with recvmmsg(). Joins the group if the configured
+// address is multicast; several receivers on one host can share a multicast port.
+class UdpBatchReceiver {
+public:
+    using Handler = std::function<void(const SomeIpNotificationHeader& header, const uint8_t* payload)>;
+
+    UdpBatchReceiver();
+    ~UdpBatchReceiver();
+
+    UdpBatchReceiver(const UdpBatchReceiver&) = delete;
+    UdpBatchReceiver& operator=(const UdpBatchReceiver&) = delete;
+
+    bool open(const BatchedUdpConfig& config);
+    void close();
+    bool isOpen() const { return socket_ >= 0; }
+
+    // Waits up to `timeout` for datagrams, then hands every notification of `service_id` that
+    // one recvmmsg() returned to `handler`. Returns the number handed over, or -1 on error.
+    int receive(uint16_t service_id, const Handler& handler, std::chrono::milliseconds timeout);
+    // Makes a concurrent receive() return at once.
+    void wake();
+
+    uint64_t receiveCalls() const { return receive_calls_; }
+    uint64_t malformedCount() const { return malformed_; }
+
+private:
+    int socket_ = -1;
+    int wake_fd_ = -1;
+    size_t batch_ = 0;
+    size_t stride_ = 0;
+    std::vector<uint8_t> buffer_;
+    std::unique_ptr<iovec[]> iovecs_;
+    std::unique_ptr<mmsghdr[]> messages_;
+    std::atomic<uint64_t> receive_calls_{0};
+    std::atomic<uint64_t> malformed_{0};
+};
+
+// Lets each message through once when the publisher sends it both as a datagram and as a
+// vsomeip event (BatchedUdpConfig::wire): whichever copy comes first is delivered and its twin
+// from the other path is dropped. Copies are matched by payload hash and counted, so identical
+// messages sent in a row are each delivered once too. A copy whose twin never comes (a lost
+// datagram, a publisher whose sender failed to open) is forgotten after `capacity` newer ones.
+class UdpDuplicateFilter {
+public:
+    enum class Path { Udp, Wire };
+
+    explicit UdpDuplicateFilter(size_t capacity = 1024) : capacity_(capacity) {}
+
+    // False if this is the second copy of a message. Thread-safe.
+    bool firstCopy(Path path, const uint8_t* data, size_t length);
+    void clear();
+
+private:
+    std::mutex mutex_;
+    const size_t capacity_;
+    std::unordered_map<uint64_t, int64_t> unmatched_; // Hash -> datagram copies minus vsomeip copies
+    std::deque<std::pair<uint64_t, Path>> order_;     // Unmatched copies, oldest first
+};
+
+} // namespace comms_stack
+
+#endif // UDP_BATCH_H
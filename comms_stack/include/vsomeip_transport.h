@@ -0,0 +1,55 @@
+#ifndef VSOMEIP_TRANSPORT_H
+#define VSOMEIP_TRANSPORT_H
+
+#include "transport.h"
+
+namespace comms_stack {
+
+// Transport over a vsomeip::application; the production backend.
+class VsomeipTransport : public Transport {
+public:
+    explicit VsomeipTransport(std::shared_ptr<vsomeip::application> app);
+
+    bool init() override;
+    void start() override;
+    void stop() override;
+    uint16_t getClientId() const override;
+
+    void offerService(uint16_t service_id, uint16_t instance_id) override;
+    void stopOfferService(uint16_t service_id, uint16_t instance_id) override;
+    void requestService(uint16_t service_id, uint16_t instance_id) override;
+    void releaseService(uint16_t service_id, uint16_t instance_id) override;
+    void registerAvailabilityHandler(uint16_t service_id, uint16_t instance_id, AvailabilityHandler handler) override;
+    void unregisterAvailabilityHandler(uint16_t service_id, uint16_t instance_id) override;
+
+    void registerMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id,
+                                MessageHandler handler) override;
+    void unregisterMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id) override;
+    void send(const std::shared_ptr<vsomeip::message>& message) override;
+
+    void offerEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                    const std::set<uint16_t>& eventgroups, bool reliable) override;
+    void stopOfferEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) override;
+    void requestEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                      const std::set<uint16_t>& eventgroups) override;
+    void releaseEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) override;
+    void subscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) override;
+    void unsubscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) override;
+    void registerSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id,
+                                           uint16_t event_id, SubscriptionStatusHandler handler) override;
+    void unregisterSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id,
+                                             uint16_t eventgroup_id, uint16_t event_id) override;
+    void notify(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                const std::shared_ptr<vsomeip::payload>& payload) override;
+    void notifyOne(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                   const std::shared_ptr<vsomeip::payload>& payload, uint16_t client_id) override;
+
+    std::shared_ptr<vsomeip::application> getVsomeipApplication() const override { return app_; }
+
+private:
+    std::shared_ptr<vsomeip::application> app_;
+};
+
+} // namespace comms_stack
+
+#endif // VSOMEIP_TRANSPORT_H
@@ -0,0 +1,114 @@
+#ifndef WRITE_ONCE_TABLE_H
+#define WRITE_ONCE_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace comms_stack {
+
+// Reader registration for structures that are swapped out while lock-free readers may still
+// be using them (SRCU-style). Readers bump a striped counter for the current epoch; after
+// publishing a replacement, a writer calls synchronize(), which flips the epoch twice and
+// waits for both counter sets to drain. Readers never wait.
+class ReaderEpochs {
+public:
+    using Token = uint32_t;
+
+    Token enter() const;
+    void exit(Token token) const;
+    void synchronize() const; // Any reader that entered before this call has exited on return
+
+private:
+    static constexpr size_t STRIPES = 16;
+    struct alignas(64) Counter {
+        std::atomic<uint32_t> value{0};
+    };
+    uint64_t readers(unsigned epoch) const;
+
+    mutable std::atomic<unsigned> epoch_{0};
+    mutable Counter counters_[2][STRIPES];
+    mutable std::mutex synchronize_mutex_; // One writer flips at a time
+};
+
+// Fixed-size table of shared_ptr slots, each filled at most once and then only read.
+// get() never takes a lock: it is an array index plus a shared_ptr copy. Slots are filled
+// under a mutex (getOrCreate), and reset() swaps in a fresh table, freeing the old one (and
+// releasing its objects) once no reader can still see it.
+template<typename T>
+class WriteOnceTable {
+public:
+    WriteOnceTable() = default;
+    ~WriteOnceTable() { reset(0); }
+
+    WriteOnceTable(const WriteOnceTable&) = delete;
+    WriteOnceTable& operator=(const WriteOnceTable&) = delete;
+
+    // Replaces the table with `size` empty slots (0 == no table; every lookup fails).
+    void reset(size_t size) {
+        Table* old_table;
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            old_table = table_.exchange(size > 0 ? new Table(size) : nullptr);
+        }
+        epochs_.synchronize();
+        delete old_table; // Outside the lock: destructors may be slow (e.g. unoffer on vsomeip)
+    }
+
+    // nullptr if the slot is empty or out of range.
+    std::shared_ptr<T> get(size_t index) const {
+        ReaderEpochs::Token token = epochs_.enter();
+        std::shared_ptr<T> value;
+        const Table* table = table_.load();
+        if (table && index < table->size && table->slots[index].ready.load(std::memory_order_acquire)) {
+            value = table->slots[index].value;
+        }
+        epochs_.exit(token);
+        return value;
+    }
+
+    // Returns the slot's object, filling an empty slot with factory() first. A null result
+    // from the factory leaves the slot empty.
+    template<typename Factory>
+    std::shared_ptr<T> getOrCreate(size_t index, Factory&& factory) {
+        if (std::shared_ptr<T> value = get(index)) {
+            return value;
+        }
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        Table* table = table_.load(); // Stable while write_mutex_ is held
+        if (!table || index >= table->size) {
+            return nullptr;
+        }
+        Slot& slot = table->slots[index];
+        if (!slot.ready.load(std::memory_order_relaxed)) {
+            std::shared_ptr<T> value = factory();
+            if (!value) {
+                return nullptr;
+            }
+            slot.value = std::move(value);
+            slot.ready.store(true, std::memory_order_release);
+        }
+        return slot.value;
+    }
+
+private:
+    struct Slot {
+        std::atomic<bool> ready{false};
+        std::shared_ptr<T> value; // Written once before `ready`, immutable afterwards
+    };
+    struct Table {
+        explicit Table(size_t n) : size(n), slots(new Slot[n]) {}
+        size_t size;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    std::atomic<Table*> table_{nullptr};
+    std::mutex write_mutex_;
+    ReaderEpochs epochs_;
+};
+
+} // namespace comms_stack
+
+#endif // WRITE_ONCE_TABLE_H
@@ -0,0 +1,130 @@
+#include "availability_router.h"
+#include "logging.h"
+#include <vector>
+
+namespace comms_stack {
+
+namespace {
+std::mutex g_registry_mutex;
+std::map<const Transport*, std::weak_ptr<AvailabilityRouter>> g_registry;
+}
+
+std::shared_ptr<AvailabilityRouter> AvailabilityRouter::forTransport(const std::shared_ptr<Transport>& transport) {
+    if (!transport) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    auto it = g_registry.find(transport.get());
+    if (it != g_registry.end()) {
+        if (auto existing = it->second.lock()) {
+            return existing;
+        }
+    }
+    std::shared_ptr<AvailabilityRouter> router(new AvailabilityRouter(transport));
+    router->self_ = router;
+    g_registry[transport.get()] = router;
+    return router;
+}
+
+AvailabilityRouter::AvailabilityRouter(const std::shared_ptr<Transport>& transport) : transport_(transport) {}
+
+AvailabilityRouter::~AvailabilityRouter() {
+    std::shared_ptr<Transport> transport = transport_.lock();
+    if (transport) {
+        for (const auto& route : routes_) {
+            transport->unregisterAvailabilityHandler(route.first.first, route.first.second);
+        }
+    }
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    for (auto it = g_registry.begin(); it != g_registry.end();) {
+        it = it->second.expired() ? g_registry.erase(it) : std::next(it);
+    }
+}
+
+AvailabilityRouter::HandlerId AvailabilityRouter::add(uint16_t service_id, uint16_t instance_id,
+                                                      Transport::AvailabilityHandler handler) {
+    const Key key(service_id, instance_id);
+    HandlerId id;
+    bool first;
+    {
+        std::lock_guard<std::recursive_mutex> dispatch(dispatch_mutex_);
+        std::vector<Key> available;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = next_id_++;
+            auto inserted = routes_.emplace(key, Route());
+            first = inserted.second;
+            Route& route = inserted.first->second;
+            route.handlers.emplace(id, handler);
+            handler_routes_.emplace(id, key);
+            for (const auto& state : route.known) {
+                if (state.second) {
+                    available.push_back(state.first);
+                }
+            }
+        }
+        // The transport reported these before this handler was added.
+        for (const Key& instance : available) {
+            handler(instance.first, instance.second, true);
+        }
+    }
+    if (first) {
+        std::shared_ptr<Transport> transport = transport_.lock();
+        if (transport) {
+            std::weak_ptr<AvailabilityRouter> weak_self = self_;
+            transport->registerAvailabilityHandler(
+                service_id, instance_id,
+                [weak_self, key](uint16_t service, uint16_t instance, bool is_available) {
+                    if (std::shared_ptr<AvailabilityRouter> self = weak_self.lock()) {
+                        self->onAvailability(key, service, instance, is_available);
+                    }
+                });
+            COMMS_LOG_DEBUG("AvailabilityRouter: Watching Service 0x{:x}, Instance 0x{:x}", service_id, instance_id);
+        }
+    }
+    return id;
+}
+
+void AvailabilityRouter::remove(HandlerId id) {
+    std::lock_guard<std::recursive_mutex> dispatch(dispatch_mutex_); // Waits for a running handler
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = handler_routes_.find(id);
+    if (it == handler_routes_.end()) {
+        return;
+    }
+    routes_[it->second].handlers.erase(id);
+    handler_routes_.erase(it);
+}
+
+void AvailabilityRouter::onAvailability(const Key& route_key, uint16_t service_id, uint16_t instance_id,
+                                        bool is_available) {
+    std::lock_guard<std::recursive_mutex> dispatch(dispatch_mutex_);
+    std::vector<HandlerId> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = routes_.find(route_key);
+        if (it == routes_.end()) {
+            return;
+        }
+        it->second.known[Key(service_id, instance_id)] = is_available;
+        for (const auto& entry : it->second.handlers) {
+            ids.push_back(entry.first);
+        }
+    }
+    // Looked up one at a time, so a handler removed by an earlier one is skipped.
+    for (HandlerId id : ids) {
+        Transport::AvailabilityHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = routes_.find(route_key);
+            auto handler_it = it->second.handlers.find(id);
+            if (handler_it == it->second.handlers.end()) {
+                continue;
+            }
+            handler = handler_it->second;
+        }
+        handler(service_id, instance_id, is_available);
+    }
+}
+
+} // namespace comms_stack
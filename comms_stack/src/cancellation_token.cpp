@@ -0,0 +1,67 @@
+#include "cancellation_token.h"
+
+namespace comms_stack {
+
+CancellationToken::CancellationToken() : state_(std::make_shared<State>()) {}
+
+void CancellationToken::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->cancelled.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        state_->running_thread = std::this_thread::get_id();
+    }
+    // Callbacks run one at a time outside the lock, so removeCallback() can wait for exactly
+    // the one it is removing.
+    for (;;) {
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (state_->running_id != 0) {
+                state_->running_id = 0;
+                state_->callback_done_cv.notify_all();
+            }
+            if (state_->callbacks.empty()) {
+                return;
+            }
+            auto it = state_->callbacks.begin();
+            state_->running_id = it->first;
+            callback = std::move(it->second);
+            state_->callbacks.erase(it);
+        }
+        callback();
+    }
+}
+
+bool CancellationToken::isCancelled() const {
+    return state_->cancelled.load(std::memory_order_acquire);
+}
+
+CancellationToken::CallbackId CancellationToken::onCancel(std::function<void()> callback) const {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!state_->cancelled.load(std::memory_order_relaxed)) {
+            CallbackId id = state_->next_id++;
+            state_->callbacks.emplace(id, std::move(callback));
+            return id;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void CancellationToken::removeCallback(CallbackId id) const {
+    if (id == 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    if (state_->callbacks.erase(id) > 0) {
+        return;
+    }
+    if (state_->running_id == id && state_->running_thread != std::this_thread::get_id()) {
+        state_->callback_done_cv.wait(lock, [this, id] { return state_->running_id != id; });
+    }
+}
+
+} // namespace comms_stack
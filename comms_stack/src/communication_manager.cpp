@@ -3,16 +3,37 @@
 #include "subscriber.h"
 #include "rpc_client.h"
 #include "rpc_service.h"
+#include "rpc_response_cache.h"
+#include "rpc_controller.h"
+#include "vsomeip_transport.h"
+#include "loopback_transport.h"
+#include "introspection_server.h"
+#include "json_utils.h"
+#include "message_envelope.h"
+#include "metrics.h"
+#include "tracing.h"
+#include "logging.h"
 
 #include <vsomeip/vsomeip.hpp> // Main vsomeip header
-#include <iostream>
 #include <thread> // For std::this_thread::sleep_for if needed for shutdown
 #include <chrono> // For std::chrono::milliseconds
+#include <vector>
+#include <set>
+#include <future>
+#include <iomanip>
+#include <sstream>
+#include <cstdio> // For std::remove
+#include <cstring> // For std::strerror
+#include <cerrno>
+#include <cstdlib> // For std::getenv, setenv, mkdtemp
+#include <unistd.h> // For rmdir
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 // Forward declare or include actual protobuf message headers if used directly
 // #include "common_messages.pb.h" // If we were to use SimpleNotification directly
 #include "sample_rpc_service.pb.h" // For protos::SampleRpc
-#include <google/protobuf/rpc/rpc.h> // For google::protobuf::Closure
+#include <google/protobuf/service.h> // For google::protobuf::Closure and RpcController
 
 // Placeholder Method IDs - these should ideally come from a shared configuration or generated code
 // For now, ensure these are defined if not already visible from rpc_client.cpp (e.g. move to a common header)
@@ -25,29 +46,385 @@
 
 namespace comms_stack {
 
+namespace {
+
+// Self-deleting closure wrapping a lambda. google::protobuf::NewCallback only accepts
+// plain function/member pointers, and the service impl may call done->Run() after the
+// vsomeip handler has returned, so everything it touches is owned by the closure.
+class FunctionClosure : public ::google::protobuf::Closure {
+public:
+    explicit FunctionClosure(std::function<void()> fn) : fn_(std::move(fn)) {}
+    void Run() override {
+        std::function<void()> fn = std::move(fn_);
+        delete this;
+        fn();
+    }
+private:
+    std::function<void()> fn_;
+};
+
+void sendRpcError(const std::shared_ptr<Transport>& app,
+                  const std::shared_ptr<vsomeip::message>& req_msg,
+                  vsomeip::return_code_e return_code) {
+    std::shared_ptr<vsomeip::message> err_res = vsomeip::runtime::get()->create_response(req_msg);
+    err_res->set_return_code(return_code);
+    app->send(err_res);
+}
+
+void sendRpcResponse(const std::shared_ptr<Transport>& app,
+                     const std::shared_ptr<vsomeip::message>& req_msg,
+                     const std::vector<vsomeip::byte_t>& serialized_response) {
+    std::shared_ptr<vsomeip::message> vsomeip_res = vsomeip::runtime::get()->create_response(req_msg);
+    std::shared_ptr<vsomeip::payload> res_payload = vsomeip::runtime::get()->create_payload();
+    res_payload->set_data(serialized_response);
+    vsomeip_res->set_payload(res_payload);
+    app->send(vsomeip_res);
+}
+
+// Writes `envelope` in front of a response, stamped with the send time if it asks for one.
+void writeResponseEnvelope(MessageEnvelope envelope, uint8_t* out) {
+    if (envelope.flags & MessageEnvelope::TIMESTAMP) {
+        envelope.timestamp_ns = MessageEnvelope::now();
+    }
+    envelope.write(out);
+}
+
+// Common server-side path for every method: decode, consult the response cache,
+// invoke the service implementation and send the encoded response.
+// The call is registered in `calls` for its duration so a client cancel can reach its controller.
+// With the envelope enabled, a request that carries one is answered with one. The cache keys on
+// and holds the bare messages, so each reply gets an envelope of its own.
+template<typename ReqProto, typename ResProto, typename Invoke>
+void dispatchRpcRequest(const std::shared_ptr<Transport>& app,
+                        const std::shared_ptr<vsomeip::message>& req_msg,
+                        const char* method_name,
+                        const std::shared_ptr<RpcResponseCache>& cache,
+                        const std::shared_ptr<RpcCallRegistry>& calls,
+                        const Metrics::Endpoint& metrics,
+                        const PayloadCodec& codec,
+                        const EnvelopeConfig& envelope,
+                        Invoke invoke) {
+    if (!app) {
+        return;
+    }
+    if (req_msg->get_message_type() != vsomeip::message_type_e::MT_REQUEST) {
+        return; // E.g. a response to a client of the same application, which also matches this handler
+    }
+    const auto started = std::chrono::steady_clock::now();
+    auto payload = req_msg->get_payload();
+    if (!payload || payload->get_length() == 0) {
+        COMMS_LOG_ERROR("RPC Server ({}): Received empty payload.", method_name);
+        sendRpcError(app, req_msg, vsomeip::return_code_e::E_MALFORMED_MESSAGE);
+        metrics.error();
+        return;
+    }
+    metrics.message(payload->get_length());
+
+    const uint8_t* data = payload->get_data();
+    size_t length = payload->get_length();
+    MessageEnvelope request_envelope;
+    MessageEnvelope response_envelope;
+    const bool enveloped = envelope.enabled && MessageEnvelope::strip(data, length, request_envelope);
+    if (enveloped) {
+        static const uint32_t request_type = MessageTypes::hash(ReqProto::descriptor());
+        if (!request_envelope.supported() || request_envelope.type_hash != request_type) {
+            COMMS_LOG_ERROR("RPC Server ({}): Request is a {} (envelope flags 0x{:x}), expected {}.", method_name,
+                            MessageTypes::name(request_envelope.type_hash), request_envelope.flags,
+                            ReqProto::descriptor()->full_name());
+            sendRpcError(app, req_msg, vsomeip::return_code_e::E_MALFORMED_MESSAGE);
+            metrics.error();
+            return;
+        }
+        static const uint32_t response_type = MessageTypes::hash(ResProto::descriptor());
+        response_envelope.type_hash = response_type;
+        response_envelope.schema_version = envelope.schema_version;
+        response_envelope.flags = envelope.timestamp ? MessageEnvelope::TIMESTAMP : 0;
+        response_envelope.sequence = request_envelope.sequence;
+    }
+
+    RpcResponseCache::Key cache_key{};
+    if (cache) {
+        cache_key = cache->makeKey(req_msg->get_method(), req_msg->get_client(), req_msg->get_session(),
+                                   data, length);
+        std::vector<vsomeip::byte_t> cached_response;
+        switch (cache->lookupOrReserve(cache_key, cached_response)) {
+            case RpcResponseCache::LookupResult::Hit:
+                if (enveloped) {
+                    cached_response.insert(cached_response.begin(), MessageEnvelope::SIZE, 0);
+                    writeResponseEnvelope(response_envelope, cached_response.data());
+                }
+                sendRpcResponse(app, req_msg, cached_response);
+                metrics.latency(std::chrono::steady_clock::now() - started);
+                COMMS_LOG_DEBUG("RPC Server ({}): Sent cached response.", method_name);
+                return;
+            case RpcResponseCache::LookupResult::InFlight:
+                COMMS_LOG_DEBUG("RPC Server ({}): Dropped duplicate of in-flight request (Client: 0x{:x}, Session: 0x{:x})",
+                                method_name, req_msg->get_client(), req_msg->get_session());
+                metrics.drop();
+                return;
+            case RpcResponseCache::LookupResult::Miss:
+                break;
+        }
+    }
+
+    auto request = std::make_shared<ReqProto>();
+    auto response = std::make_shared<ResProto>();
+    if (!codec.decode(data, length, *request)) {
+        COMMS_LOG_ERROR("RPC Server ({}): Failed to parse request.", method_name);
+        if (cache) {
+            cache->abandon(cache_key);
+        }
+        sendRpcError(app, req_msg, vsomeip::return_code_e::E_MALFORMED_MESSAGE);
+        metrics.error();
+        return;
+    }
+
+    std::shared_ptr<ServerRpcController> controller = calls->begin(req_msg->get_client(), req_msg->get_session());
+    ::google::protobuf::Closure* done = new FunctionClosure(
+        [app, req_msg, request, response, cache, cache_key, method_name, calls, controller, metrics, started, codec,
+         enveloped, response_envelope]() {
+            calls->end(req_msg->get_client(), req_msg->get_session(), controller);
+            if (controller->IsCanceled()) {
+                // The client has already given up on this call; a handler that stopped early
+                // may also have left the response incomplete, so it is neither sent nor cached.
+                if (cache) {
+                    cache->abandon(cache_key);
+                }
+                COMMS_LOG_INFO("RPC Server ({}): Call was cancelled by the client.", method_name);
+                metrics.drop();
+                return;
+            }
+            if (controller->Failed()) {
+                COMMS_LOG_ERROR("RPC Server ({}): Handler failed: {}", method_name, controller->ErrorText());
+                if (cache) {
+                    cache->abandon(cache_key);
+                }
+                sendRpcError(app, req_msg, vsomeip::return_code_e::E_NOT_OK);
+                metrics.error();
+                return;
+            }
+            const size_t header = enveloped ? MessageEnvelope::SIZE : 0;
+            const size_t size = codec.byteSize(*response);
+            std::vector<vsomeip::byte_t> res_payload_data(header + size);
+            if (!codec.encode(*response, res_payload_data.data() + header, size)) {
+                COMMS_LOG_ERROR("RPC Server ({}): Failed to serialize response.", method_name);
+                if (cache) {
+                    cache->abandon(cache_key);
+                }
+                sendRpcError(app, req_msg, vsomeip::return_code_e::E_NOT_OK);
+                metrics.error();
+                return;
+            }
+            if (cache) {
+                cache->store(cache_key, std::vector<vsomeip::byte_t>(res_payload_data.begin() + header,
+                                                                     res_payload_data.end()));
+            }
+            if (enveloped) {
+                writeResponseEnvelope(response_envelope, res_payload_data.data());
+            }
+            sendRpcResponse(app, req_msg, res_payload_data);
+            metrics.latency(std::chrono::steady_clock::now() - started); // Request to response, handler included
+            COMMS_LOG_DEBUG("RPC Server ({}): Sent response.", method_name);
+        }
+    );
+
+    invoke(controller.get(), request.get(), response.get(), done);
+}
+
+// Codec the registry configures for one method of a service; protobuf if none (or no entry).
+PayloadCodec methodCodec(const ServiceEntry* entry, const char* method_name) {
+    if (entry) {
+        auto it = entry->method_codecs.find(method_name);
+        if (it != entry->method_codecs.end()) {
+            return PayloadCodec(it->second, entry->someip);
+        }
+    }
+    return PayloadCodec();
+}
+
+// Builds the codec's per-type state for a method's request and response types up front.
+template<typename ReqProto, typename ResProto>
+PayloadCodec preparedCodec(const PayloadCodec& codec) {
+    codec.prepare(ReqProto::descriptor());
+    codec.prepare(ResProto::descriptor());
+    return codec;
+}
+
+// Removes a file written by CommunicationManager::writeDispatcherConfig() when init() returns;
+// vsomeip has read it by then.
+struct DispatcherConfigFile {
+    std::string path;
+    ~DispatcherConfigFile() {
+        if (!path.empty()) {
+            CommunicationManager::removeDispatcherConfig(path);
+        }
+    }
+};
+
+// Runs on_available whenever `object` (an RpcClient or Subscriber) sees its service become
+// available; the returned function stops that again.
+template<typename T>
+std::function<void()> watchAvailability(const std::shared_ptr<T>& object, std::function<void()> on_available) {
+    ServiceAvailability::CallbackId id = object->onAvailabilityChange([on_available](bool available) {
+        if (available) {
+            on_available();
+        }
+    });
+    std::weak_ptr<T> weak_object = object;
+    return [weak_object, id]() {
+        if (std::shared_ptr<T> locked = weak_object.lock()) {
+            locked->removeAvailabilityCallback(id);
+        }
+    };
+}
+
+// Services requested on behalf of the cached entries, each once.
+std::set<std::pair<uint16_t, uint16_t>> cachedServices(const DiscoveryCache& cache) {
+    std::set<std::pair<uint16_t, uint16_t>> services;
+    for (const auto& service : cache.services()) {
+        services.emplace(service.service_id, service.instance_id);
+    }
+    for (const auto& eventgroup : cache.eventgroups()) {
+        services.emplace(eventgroup.service_id, eventgroup.instance_id);
+    }
+    return services;
+}
+
+std::string hexId(uint16_t id) {
+    std::ostringstream out;
+    out << "0x" << std::hex << std::setw(4) << std::setfill('0') << id;
+    return out.str();
+}
+
+void writeLatencyHistogram(std::ostream& out, const LatencyHistogram& latency) {
+    out << "{\"count\": " << latency.count() << ", \"mean_ns\": " << static_cast<uint64_t>(latency.mean())
+        << ", \"p50_ns\": " << latency.percentile(50) << ", \"p99_ns\": " << latency.percentile(99)
+        << ", \"p999_ns\": " << latency.percentile(99.9) << ", \"max_ns\": " << latency.max()
+        << ", \"buckets\": [";
+    // Non-empty buckets only, as [lower bound (ns), count]
+    bool first = true;
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+        if (const uint64_t count = latency.bucketCount(i)) {
+            out << (first ? "" : ", ") << "[" << LatencyHistogram::bucketLowerBound(i) << ", " << count << "]";
+            first = false;
+        }
+    }
+    out << "]}";
+}
+
+} // namespace
+
+// vsomeip sizes an application's dispatcher pool from the "threads" attribute of its
+// "applications" entry and has no API for it, so a copy of the configuration with that value
+// replaced is handed to vsomeip as the application-specific configuration. The copy goes to a
+// directory of its own under TMPDIR (or /tmp), not next to the original, which may be read-only
+// or shared with other processes.
+std::string CommunicationManager::writeDispatcherConfig(const std::string& app_name, const std::string& config_path,
+                                                        unsigned threads) {
+    namespace pt = boost::property_tree;
+    pt::ptree root;
+    try {
+        pt::read_json(config_path, root);
+        if (!root.get_child_optional("applications")) {
+            root.put_child("applications", pt::ptree());
+        }
+        pt::ptree& applications = root.get_child("applications");
+        pt::ptree* entry = nullptr;
+        for (auto& item : applications) {
+            if (item.second.get<std::string>("name", "") == app_name) {
+                entry = &item.second;
+                break;
+            }
+        }
+        if (!entry) {
+            pt::ptree new_entry;
+            new_entry.put("name", app_name);
+            entry = &applications.push_back(std::make_pair("", new_entry))->second;
+        }
+        entry->put("threads", std::to_string(threads));
+    } catch (const std::exception& e) {
+        COMMS_LOG_ERROR("CommunicationManager: Cannot set dispatcher threads for {}: {}", app_name, e.what());
+        return "";
+    }
+
+    const char* temp_root = std::getenv("TMPDIR");
+    std::string directory = std::string(temp_root && *temp_root ? temp_root : "/tmp") + "/comms_stack-XXXXXX";
+    if (!mkdtemp(&directory[0])) {
+        COMMS_LOG_ERROR("CommunicationManager: Cannot create a directory for the configuration of {}: {}",
+                        app_name, std::strerror(errno));
+        return "";
+    }
+    const std::string app_config_path = directory + "/" + app_name + ".json";
+    try {
+        pt::write_json(app_config_path, root);
+    } catch (const std::exception& e) {
+        COMMS_LOG_ERROR("CommunicationManager: Cannot write {}: {}", app_config_path, e.what());
+        removeDispatcherConfig(app_config_path);
+        return "";
+    }
+    setenv(("VSOMEIP_CONFIGURATION_" + app_name).c_str(), app_config_path.c_str(), 1);
+    COMMS_LOG_INFO("CommunicationManager: {} uses {} dispatcher thread(s) ({})", app_name, threads, app_config_path);
+    return app_config_path;
+}
+
+void CommunicationManager::removeDispatcherConfig(const std::string& path) {
+    std::remove(path.c_str());
+    const size_t slash = path.rfind('/');
+    if (slash != std::string::npos) {
+        rmdir(path.substr(0, slash).c_str());
+    }
+}
+
 CommunicationManager& CommunicationManager::getInstance() {
     static CommunicationManager instance;
     return instance;
 }
 
-CommunicationManager::CommunicationManager() : is_initialized_(false), vsomeip_app_(nullptr) {
-    std::cout << "CommunicationManager: Constructor" << std::endl;
+CommunicationManager::CommunicationManager() : transport_(nullptr) {
+    COMMS_LOG_INFO("CommunicationManager: Constructor");
 }
 
 CommunicationManager::~CommunicationManager() {
-    std::cout << "CommunicationManager: Destructor" << std::endl;
-    if (is_initialized_ && vsomeip_app_ != nullptr) { // Check vsomeip_app_ as well
+    COMMS_LOG_INFO("CommunicationManager: Destructor");
+    if (is_initialized_ && transport_ != nullptr) { // Check transport_ as well
         shutdown();
     }
 }
 
 bool CommunicationManager::init(const std::string& app_name, const std::string& config_path) {
+    Options options;
+    options.app_name = app_name;
+    options.config_path = config_path;
+    return init(options);
+}
+
+bool CommunicationManager::init(const Options& options) {
+    const std::string& app_name = options.app_name;
+    const std::string& config_path = options.config_path;
     if (is_initialized_) {
-        std::cout << "CommunicationManager: Already initialized with app name: " << app_name_ << std::endl;
+        COMMS_LOG_INFO("CommunicationManager: Already initialized with app name: {}", app_name_);
         return true;
     }
     app_name_ = app_name;
-    std::cout << "CommunicationManager: Initializing for app: " << app_name_ << std::endl;
+    init_started_ = std::chrono::steady_clock::now();
+    COMMS_LOG_INFO("CommunicationManager: Initializing for app: {}", app_name_);
+    {
+        std::lock_guard<std::mutex> lock(startup_mutex_);
+        startup_timeline_.clear();
+    }
+
+    // First, while this manager runs no threads yet: it calls setenv().
+    DispatcherConfigFile dispatcher_config;
+    if (options.dispatcher_threads > 0 && !options.transport && !options.loopback) {
+        const char* env_config = std::getenv("VSOMEIP_CONFIGURATION");
+        const std::string base_config = !config_path.empty() ? config_path : (env_config ? env_config : "");
+        if (!base_config.empty()) {
+            dispatcher_config.path = writeDispatcherConfig(app_name_, base_config, options.dispatcher_threads);
+        }
+        if (dispatcher_config.path.empty()) {
+            COMMS_LOG_WARN("CommunicationManager: Keeping the configured dispatcher threads for {}", app_name_);
+        }
+    }
 
     // Set configuration path if provided and not empty
     // vsomeip primarily uses the VSOMEIP_CONFIGURATION environment variable.
@@ -60,253 +437,774 @@ bool CommunicationManager::init(const std::string& app_name, const std::string&
         // The most reliable is VSOMEIP_CONFIGURATION.
         // Forcing environment variable from code:
         // setenv("VSOMEIP_CONFIGURATION", config_path.c_str(), 1); // For POSIX
-        std::cout << "CommunicationManager: Custom config path provided: " << config_path
-                  << ". Ensure VSOMEIP_CONFIGURATION is set or vsomeip can find it." << std::endl;
+        COMMS_LOG_INFO("CommunicationManager: Custom config path provided: {}. Ensure VSOMEIP_CONFIGURATION is set or vsomeip can find it.",
+                       config_path);
     }
 
 
-    vsomeip_app_ = vsomeip::runtime::get()->create_application(app_name_);
-    if (!vsomeip_app_) {
-        std::cerr << "CommunicationManager: Failed to create vsomeip application." << std::endl;
-        return false;
+    // The topic/service registry lives in the same JSON file vsomeip is configured with.
+    topic_registry_.clear();
+    if (!config_path.empty()) {
+        if (!topic_registry_.loadFromFile(config_path)) {
+            COMMS_LOG_ERROR("CommunicationManager: Failed to load topic registry from {}", config_path);
+            return false;
+        }
+    } else if (const char* env_config = std::getenv("VSOMEIP_CONFIGURATION")) {
+        // May also name a directory of vsomeip config files; the registry is then left empty.
+        if (!topic_registry_.loadFromFile(env_config)) {
+            COMMS_LOG_WARN("CommunicationManager: No topic registry loaded; only explicit IDs can be used.");
+        }
     }
+    recordPhase("load registry", init_started_);
 
-    if (!vsomeip_app_->init()) {
-        std::cerr << "CommunicationManager: Failed to initialize vsomeip application. Check configuration." << std::endl;
-        vsomeip_app_.reset(); // Release the shared_ptr
+    auto phase_started = std::chrono::steady_clock::now();
+    if (options.transport) {
+        transport_ = options.transport;
+        COMMS_LOG_INFO("CommunicationManager: Using the given transport.");
+    } else if (options.loopback) {
+        transport_ = std::make_shared<LoopbackTransport>(options.loopback, app_name_);
+        COMMS_LOG_INFO("CommunicationManager: Using loopback transport.");
+    } else {
+        std::shared_ptr<vsomeip::application> app = vsomeip::runtime::get()->create_application(app_name_);
+        if (!app) {
+            COMMS_LOG_ERROR("CommunicationManager: Failed to create vsomeip application.");
+            return false;
+        }
+        transport_ = std::make_shared<VsomeipTransport>(app);
+    }
+
+    if (!transport_->init()) {
+        COMMS_LOG_ERROR("CommunicationManager: Failed to initialize transport. Check configuration.");
+        transport_.reset(); // Release the shared_ptr
         return false;
     }
 
-    // Start the vsomeip application's dispatching threads
+    recordPhase("create and initialize transport", phase_started);
+
+    // One response handler for the whole transport; RpcClients bind their sessions to it.
+    response_demux_ = ResponseDemultiplexer::forTransport(transport_);
+    local_bus_ = options.intra_process ? LocalBus::getShared() : nullptr;
+
+    // Start the transport's dispatching threads
     // This call is non-blocking and starts internal threads in vsomeip.
-    vsomeip_app_->start();
-    std::cout << "CommunicationManager: vsomeip application started." << std::endl;
+    phase_started = std::chrono::steady_clock::now();
+    transport_->start();
+    COMMS_LOG_INFO("CommunicationManager: Transport started.");
+    recordPhase("start transport", phase_started);
+
+    // Lookups start succeeding once the tables exist; transport_ is set by then.
+    publisher_cache_.reset(topic_registry_.topicCount());
+    subscriber_cache_.reset(topic_registry_.topicCount());
+    rpc_client_cache_.reset(topic_registry_.serviceCount());
+
+    phase_started = std::chrono::steady_clock::now();
+    discovery_cache_path_ = options.discovery_cache_path;
+    prewarmFromDiscoveryCache();
+    recordPhase("pre-request from discovery cache", phase_started);
 
     is_initialized_ = true;
-    std::cout << "CommunicationManager: Initialized successfully for app: " << app_name_ << std::endl;
+
+    const ProvisioningPlan* plan = options.provision ? topic_registry_.provisioning(app_name_) : nullptr;
+    if (plan) {
+        phase_started = std::chrono::steady_clock::now();
+        provision(*plan);
+        recordPhase("provision", phase_started);
+    }
+    if (!options.introspection_socket.empty()) {
+        auto server = std::make_unique<IntrospectionServer>();
+        if (server->start(options.introspection_socket, [this]() { return introspectionSnapshot(); })) {
+            introspection_server_ = std::move(server);
+        } else {
+            COMMS_LOG_WARN("CommunicationManager: Continuing without introspection for {}", app_name_);
+        }
+    }
+    recordPhase("init total", init_started_);
+
+    COMMS_LOG_INFO("CommunicationManager: Initialized successfully for app: {}", app_name_);
+    COMMS_LOG_INFO("CommunicationManager: Startup timeline (start +duration, ms):");
+    for (const StartupPhase& phase : getStartupTimeline()) {
+        COMMS_LOG_INFO("  {:9.3f} +{:9.3f}  {}", phase.start_us / 1000.0, phase.duration_us / 1000.0, phase.name);
+    }
     return true;
 }
 
 void CommunicationManager::shutdown() {
-    if (!is_initialized_ || !vsomeip_app_) { // Check vsomeip_app_
-        std::cout << "CommunicationManager: Not initialized or app already null, nothing to shut down." << std::endl;
+    if (!is_initialized_ || !transport_) { // Check transport_
+        COMMS_LOG_INFO("CommunicationManager: Not initialized or app already null, nothing to shut down.");
         return;
     }
-    std::cout << "CommunicationManager: Shutting down for app: " << app_name_ << "..." << std::endl;
+    COMMS_LOG_INFO("CommunicationManager: Shutting down for app: {}...", app_name_);
+    introspection_server_.reset(); // Stops before anything a snapshot reads goes away
+    saveDiscoveryCache();
 
     // 1. Clear caches and let Publishers/Subscribers/RpcClients/Services unregister themselves
     //    in their destructors. The order might matter if there are interdependencies.
     //    Clearing these shared_ptrs will trigger their destructors if their ref count becomes 0.
-    std::cout << "CommunicationManager: Clearing RPC clients..." << std::endl;
-    rpc_client_cache_.clear();
-    std::cout << "CommunicationManager: Clearing subscribers..." << std::endl;
-    subscriber_cache_.clear();
-    std::cout << "CommunicationManager: Clearing publishers..." << std::endl;
-    publisher_cache_.clear();
-    std::cout << "CommunicationManager: Clearing RPC service registry..." << std::endl;
-    rpc_service_registry_.clear(); // This should trigger RpcService wrappers to stop offering services
+    //    reset() waits until no concurrent lookup can still be reading the old tables.
+    COMMS_LOG_INFO("CommunicationManager: Clearing RPC clients...");
+    rpc_client_cache_.reset(0);
+    COMMS_LOG_INFO("CommunicationManager: Clearing subscribers...");
+    subscriber_cache_.reset(0);
+    COMMS_LOG_INFO("CommunicationManager: Clearing publishers...");
+    publisher_cache_.reset(0);
+
+    std::map<std::string, std::unique_ptr<RpcStreamServer>> stream_servers;
+    std::map<std::string, std::shared_ptr<protos::SampleRpc>> rpc_services;
+    {
+        std::lock_guard<std::mutex> lock(services_mutex_);
+        stream_servers.swap(rpc_stream_servers_);
+        rpc_services.swap(actual_rpc_services_);
+        rpc_response_caches_.clear();
+        rpc_call_registries_.clear();
+        rpc_service_ids_.clear();
+    }
+    COMMS_LOG_INFO("CommunicationManager: Closing RPC streams...");
+    stream_servers.clear(); // Waits for running stream handlers
+    COMMS_LOG_INFO("CommunicationManager: Clearing RPC service registry...");
+    rpc_services.clear(); // This should trigger RpcService wrappers to stop offering services
+    releasePrewarmed();
+    releaseProvisioned();
 
     // 2. Stop all vsomeip event offers and service advertisements (if not handled by above destructors)
-    //    vsomeip_app_->clear_all_handler(); // Might be too aggressive, usually let objects manage their own state.
-    //    vsomeip_app_->release_all_events();
-    //    vsomeip_app_->unoffer_all_services();
+    //    clear_all_handler(), release_all_events(), unoffer_all_services() would be too aggressive,
+    //    usually let objects manage their own state.
     //    It's generally better practice for the individual Publisher/Subscriber/RpcService
     //    wrappers to clean up their specific vsomeip registrations in their destructors.
     //    The cache clearing above should trigger this.
 
-    // 3. Stop the vsomeip application. This stops its internal threads.
-    std::cout << "CommunicationManager: Stopping vsomeip application..." << std::endl;
-    if (vsomeip_app_) {
-        vsomeip_app_->stop(); // Stops dispatching, joins threads.
+    // 3. Stop the transport. This stops its internal threads.
+    COMMS_LOG_INFO("CommunicationManager: Stopping transport...");
+    if (transport_) {
+        transport_->stop(); // Stops dispatching, joins threads.
     }
+    response_demux_.reset(); // No more handler invocations after stop()
+    local_bus_.reset();
 
-    // Give a brief moment for threads to join, though vsomeip_app_->stop() should be synchronous.
+    // Give a brief moment for threads to join, though transport_->stop() should be synchronous.
     // std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-    vsomeip_app_.reset(); // Release the shared_ptr
+    transport_.reset(); // Release the shared_ptr
 
     is_initialized_ = false;
-    std::cout << "CommunicationManager: Shutdown complete for app: " << app_name_ << std::endl;
+    COMMS_LOG_INFO("CommunicationManager: Shutdown complete for app: {}", app_name_);
+    Logger::flush();
+}
+
+void CommunicationManager::prewarmFromDiscoveryCache() {
+    std::lock_guard<std::mutex> lock(discovery_mutex_);
+    prewarmed_.clear();
+    discovered_.clear();
+    discovery_timings_.clear();
+    if (discovery_cache_path_.empty() || !prewarmed_.load(discovery_cache_path_)) {
+        return;
+    }
+    // Requests and subscriptions go out now; vsomeip completes them when the offers arrive, and
+    // the clients and subscribers created later find them already in place.
+    for (const auto& service : cachedServices(prewarmed_)) {
+        transport_->requestService(service.first, service.second);
+    }
+    for (const auto& eventgroup : prewarmed_.eventgroups()) {
+        transport_->requestEvent(eventgroup.service_id, eventgroup.instance_id, eventgroup.event_id,
+                                 eventgroup.eventgroup_id ? std::set<uint16_t>{eventgroup.eventgroup_id}
+                                                          : std::set<uint16_t>());
+        if (eventgroup.eventgroup_id != 0) {
+            transport_->subscribe(eventgroup.service_id, eventgroup.instance_id, eventgroup.eventgroup_id);
+        }
+    }
+    COMMS_LOG_INFO("CommunicationManager: Pre-requested {} service(s) and {} eventgroup(s) from {}",
+                   prewarmed_.services().size(), prewarmed_.eventgroups().size(), discovery_cache_path_);
+}
+
+void CommunicationManager::saveDiscoveryCache() {
+    std::vector<std::function<void()>> unwatchers;
+    {
+        std::lock_guard<std::mutex> lock(discovery_mutex_);
+        unwatchers.swap(discovery_unwatchers_);
+    }
+    for (const auto& unwatch : unwatchers) {
+        unwatch(); // May wait for a running onDiscovered(), so not under the lock
+    }
+
+    std::lock_guard<std::mutex> lock(discovery_mutex_);
+    if (discovery_cache_path_.empty()) {
+        return;
+    }
+    if (discovered_.empty()) {
+        // Nothing was confirmed (e.g. the network was down); a cold cache would not help next time.
+        COMMS_LOG_INFO("CommunicationManager: No services discovered; keeping {}", discovery_cache_path_);
+        return;
+    }
+    if (discovered_.save(discovery_cache_path_)) {
+        COMMS_LOG_INFO("CommunicationManager: Saved {} service(s) and {} eventgroup(s) to {}",
+                       discovered_.services().size(), discovered_.eventgroups().size(), discovery_cache_path_);
+    }
+}
+
+void CommunicationManager::releasePrewarmed() {
+    std::lock_guard<std::mutex> lock(discovery_mutex_);
+    for (const auto& eventgroup : prewarmed_.eventgroups()) {
+        if (eventgroup.eventgroup_id != 0) {
+            transport_->unsubscribe(eventgroup.service_id, eventgroup.instance_id, eventgroup.eventgroup_id);
+        }
+        transport_->releaseEvent(eventgroup.service_id, eventgroup.instance_id, eventgroup.event_id);
+    }
+    for (const auto& service : cachedServices(prewarmed_)) {
+        transport_->releaseService(service.first, service.second);
+    }
+    prewarmed_.clear();
+}
+
+void CommunicationManager::provision(const ProvisioningPlan& plan) {
+    // Each cache table creates one object at a time, so publishers, subscribers and clients are
+    // set up side by side rather than one after another.
+    auto publishers = std::async(std::launch::async, [this, &plan]() {
+        const auto started = std::chrono::steady_clock::now();
+        size_t count = 0;
+        for (const std::string& name : plan.publish) {
+            std::shared_ptr<Publisher> publisher = getPublisher(name); // Offers its event
+            if (!publisher) {
+                continue;
+            }
+            const TopicEntry* entry = topic_registry_.topic(findTopic(name));
+            transport_->offerService(entry->service_id, entry->instance_id);
+            std::lock_guard<std::mutex> lock(provisioning_mutex_);
+            provisioned_offers_.emplace(entry->service_id, entry->instance_id);
+            ++count;
+        }
+        recordPhase("provision " + std::to_string(count) + " publisher(s)", started);
+    });
+    auto subscribers = std::async(std::launch::async, [this, &plan]() {
+        const auto started = std::chrono::steady_clock::now();
+        size_t count = 0;
+        for (const std::string& name : plan.subscribe) {
+            std::shared_ptr<Subscriber> subscriber = getSubscriber(name);
+            if (!subscriber || !subscriber->prepare()) {
+                continue;
+            }
+            const TopicEntry* entry = topic_registry_.topic(findTopic(name));
+            transport_->requestService(entry->service_id, entry->instance_id);
+            if (entry->eventgroup_id != 0) {
+                transport_->subscribe(entry->service_id, entry->instance_id, entry->eventgroup_id);
+            }
+            DiscoveryCache::Eventgroup subscription;
+            subscription.service_id = entry->service_id;
+            subscription.instance_id = entry->instance_id;
+            subscription.eventgroup_id = entry->eventgroup_id;
+            subscription.event_id = entry->event_id;
+            std::lock_guard<std::mutex> lock(provisioning_mutex_);
+            provisioned_requests_.emplace(entry->service_id, entry->instance_id);
+            provisioned_subscriptions_.push_back(subscription);
+            ++count;
+        }
+        recordPhase("provision " + std::to_string(count) + " subscriber(s)", started);
+    });
+    auto clients = std::async(std::launch::async, [this, &plan]() {
+        const auto started = std::chrono::steady_clock::now();
+        size_t count = 0;
+        for (const std::string& name : plan.call) {
+            if (getRpcClient(name)) { // Requests its service
+                ++count;
+            }
+        }
+        recordPhase("provision " + std::to_string(count) + " RPC client(s)", started);
+    });
+    publishers.get();
+    subscribers.get();
+    clients.get();
+}
+
+void CommunicationManager::releaseProvisioned() {
+    std::lock_guard<std::mutex> lock(provisioning_mutex_);
+    for (const auto& subscription : provisioned_subscriptions_) {
+        if (subscription.eventgroup_id != 0) {
+            transport_->unsubscribe(subscription.service_id, subscription.instance_id, subscription.eventgroup_id);
+        }
+    }
+    for (const auto& service : provisioned_requests_) {
+        transport_->releaseService(service.first, service.second);
+    }
+    for (const auto& service : provisioned_offers_) {
+        transport_->stopOfferService(service.first, service.second);
+    }
+    provisioned_subscriptions_.clear();
+    provisioned_requests_.clear();
+    provisioned_offers_.clear();
+}
+
+void CommunicationManager::recordPhase(const std::string& name, std::chrono::steady_clock::time_point started) {
+    StartupPhase phase;
+    phase.name = name;
+    phase.start_us = std::chrono::duration_cast<std::chrono::microseconds>(started - init_started_).count();
+    phase.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    startup_timeline_.push_back(phase);
+}
+
+std::vector<CommunicationManager::StartupPhase> CommunicationManager::getStartupTimeline() const {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    return startup_timeline_;
+}
+
+void CommunicationManager::onDiscovered(uint16_t service_id, uint16_t instance_id,
+                                        const DiscoveryCache::Eventgroup* eventgroup) {
+    const int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - init_started_).count();
+    std::lock_guard<std::mutex> lock(discovery_mutex_);
+    if (eventgroup) {
+        discovered_.addEventgroup(*eventgroup);
+    }
+    if (discovered_.findService(service_id, instance_id)) {
+        return; // Only the first time counts
+    }
+    DiscoveryCache::Service service;
+    service.service_id = service_id;
+    service.instance_id = instance_id;
+    service.available_after_ms = elapsed_ms;
+    discovered_.addService(service);
+
+    DiscoveryTiming timing;
+    timing.service_id = service_id;
+    timing.instance_id = instance_id;
+    timing.available_after_ms = elapsed_ms;
+    if (const DiscoveryCache::Service* cached = prewarmed_.findService(service_id, instance_id)) {
+        timing.pre_requested = true;
+        timing.previous_run_ms = cached->available_after_ms;
+    }
+    discovery_timings_.push_back(timing);
+
+    if (timing.pre_requested) {
+        COMMS_LOG_INFO("CommunicationManager: Service 0x{:x}, Instance 0x{:x} available {} ms after init"
+                       " (pre-requested; previous run: {} ms)",
+                       service_id, instance_id, elapsed_ms, timing.previous_run_ms);
+    } else {
+        COMMS_LOG_INFO("CommunicationManager: Service 0x{:x}, Instance 0x{:x} available {} ms after init",
+                       service_id, instance_id, elapsed_ms);
+    }
+}
+
+std::vector<CommunicationManager::DiscoveryTiming> CommunicationManager::getDiscoveryTimings() const {
+    std::lock_guard<std::mutex> lock(discovery_mutex_);
+    return discovery_timings_;
+}
+
+std::string CommunicationManager::introspectionSnapshot() {
+    // Everything below is read through lock-free paths (write-once tables, atomics), or under
+    // locks the hot paths do not take: services_mutex_ is only held by registration and
+    // shutdown, the Metrics and Tracer mutexes only by registration and thread attach/exit.
+    std::ostringstream out;
+    out << "{\"app\": ";
+    writeJsonString(out, app_name_);
+    out << ", \"initialized\": " << (is_initialized_ ? "true" : "false");
+    if (!is_initialized_ || !transport_) {
+        out << "}\n";
+        return out.str();
+    }
+    out << ", \"uptime_ms\": "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - init_started_).count()
+        << ",\n \"transport\": {\"client_id\": \"" << hexId(transport_->getClientId()) << "\", \"vsomeip\": "
+        << (transport_->getVsomeipApplication() ? "true" : "false") << ", \"queue_depth\": ";
+    const int64_t queue_depth = transport_->queueDepth();
+    if (queue_depth < 0) {
+        out << "null";
+    } else {
+        out << queue_depth;
+    }
+    out << ", \"intra_process\": " << (local_bus_ ? "true" : "false") << "}";
+
+    out << ",\n \"publishers\": [";
+    bool first = true;
+    for (TopicHandle handle = 0; handle < topic_registry_.topicCount(); ++handle) {
+        std::shared_ptr<Publisher> publisher = publisher_cache_.get(handle);
+        if (!publisher) {
+            continue;
+        }
+        const TopicEntry* entry = topic_registry_.topic(handle);
+        out << (first ? "\n  " : ",\n  ") << "{\"topic\": ";
+        writeJsonString(out, entry->name);
+        out << ", \"service\": \"" << hexId(entry->service_id) << "\", \"instance\": \"" << hexId(entry->instance_id)
+            << "\", \"event\": \"" << hexId(entry->event_id) << "\", \"offered\": "
+            << (publisher->isOffered() ? "true" : "false") << "}";
+        first = false;
+    }
+    out << "],\n \"subscribers\": [";
+    first = true;
+    for (TopicHandle handle = 0; handle < topic_registry_.topicCount(); ++handle) {
+        std::shared_ptr<Subscriber> subscriber = subscriber_cache_.get(handle);
+        if (!subscriber) {
+            continue;
+        }
+        const TopicEntry* entry = topic_registry_.topic(handle);
+        out << (first ? "\n  " : ",\n  ") << "{\"topic\": ";
+        writeJsonString(out, entry->name);
+        out << ", \"service\": \"" << hexId(entry->service_id) << "\", \"instance\": \"" << hexId(entry->instance_id)
+            << "\", \"event\": \"" << hexId(entry->event_id) << "\", \"subscribed\": "
+            << (subscriber->isSubscribed() ? "true" : "false") << ", \"available\": "
+            << (subscriber->isServiceAvailable() ? "true" : "false") << "}";
+        first = false;
+    }
+    out << "],\n \"rpc_clients\": [";
+    first = true;
+    for (ServiceHandle handle = 0; handle < topic_registry_.serviceCount(); ++handle) {
+        std::shared_ptr<RpcClient> client = rpc_client_cache_.get(handle);
+        if (!client) {
+            continue;
+        }
+        const ServiceEntry* entry = topic_registry_.service(handle);
+        out << (first ? "\n  " : ",\n  ") << "{\"service\": ";
+        writeJsonString(out, entry->name);
+        out << ", \"service_id\": \"" << hexId(entry->service_id) << "\", \"instance\": \""
+            << hexId(entry->instance_id) << "\", \"available\": " << (client->isServiceAvailable() ? "true" : "false")
+            << ", \"pending_requests\": " << client->pendingRequests() << "}";
+        first = false;
+    }
+    out << "],\n \"services\": [";
+    {
+        std::lock_guard<std::mutex> lock(services_mutex_);
+        first = true;
+        for (const auto& service : rpc_service_ids_) {
+            auto calls = rpc_call_registries_.find(service.first);
+            out << (first ? "\n  " : ",\n  ") << "{\"name\": ";
+            writeJsonString(out, service.first);
+            out << ", \"service_id\": \"" << hexId(service.second.first) << "\", \"instance\": \""
+                << hexId(service.second.second) << "\", \"calls_in_progress\": "
+                << (calls != rpc_call_registries_.end() ? calls->second->active() : 0) << ", \"response_cache\": "
+                << (rpc_response_caches_.count(service.first) ? "true" : "false") << ", \"stream_methods\": "
+                << (rpc_stream_servers_.count(service.first) ? "true" : "false") << "}";
+            first = false;
+        }
+    }
+
+    const std::vector<Metrics::EndpointStats> metrics = Metrics::global().snapshot();
+    const Tracer::RingUsage trace_rings = Tracer::global().ringUsage();
+    out << "],\n \"pools\": {\"trace_rings\": {\"allocated\": " << trace_rings.allocated << ", \"in_use\": "
+        << trace_rings.in_use << "}, \"metrics_endpoints\": {\"allocated\": " << metrics.size()
+        << ", \"capacity\": " << Metrics::MAX_ENDPOINTS << "}}";
+
+    // Process-wide: shared by all managers of this process.
+    out << ",\n \"metrics\": [";
+    first = true;
+    for (const Metrics::EndpointStats& stats : metrics) {
+        out << (first ? "\n  " : ",\n  ") << "{\"kind\": \"" << Metrics::kindName(stats.kind) << "\", \"name\": ";
+        writeJsonString(out, stats.name);
+        out << ", \"messages\": " << stats.messages << ", \"bytes\": " << stats.bytes << ", \"errors\": "
+            << stats.errors << ", \"drops\": " << stats.drops << ",\n   \"latency\": ";
+        writeLatencyHistogram(out, stats.latency);
+        out << "}";
+        first = false;
+    }
+    out << "]}\n";
+    return out.str();
+}
+
+std::shared_ptr<Transport> CommunicationManager::getTransport() {
+    return transport_;
 }
 
 std::shared_ptr<vsomeip::application> CommunicationManager::getVsomeipApplication() {
-    return vsomeip_app_;
+    return transport_ ? transport_->getVsomeipApplication() : nullptr;
+}
+
+std::shared_ptr<ResponseDemultiplexer> CommunicationManager::getResponseDemultiplexer() {
+    return response_demux_;
+}
+
+TopicHandle CommunicationManager::findTopic(const std::string& topic_name) const {
+    return topic_registry_.findTopic(topic_name);
+}
+
+ServiceHandle CommunicationManager::findService(const std::string& service_name) const {
+    return topic_registry_.findService(service_name);
+}
+
+const TopicRegistry& CommunicationManager::getTopicRegistry() const {
+    return topic_registry_;
 }
 
-// Placeholder implementations for getPublisher, getSubscriber, etc.
-// (These will be fleshed out in later steps but need to exist for linking)
 std::shared_ptr<Publisher> CommunicationManager::getPublisher(const std::string& topic_name) {
-    if (!is_initialized_ || !vsomeip_app_) {
-        std::cerr << "CommunicationManager: Not initialized. Cannot get publisher." << std::endl;
+    TopicHandle topic = topic_registry_.findTopic(topic_name);
+    if (topic == INVALID_HANDLE) {
+        COMMS_LOG_ERROR("CommunicationManager: Unknown topic: {}", topic_name);
+        return nullptr;
+    }
+    return getPublisher(topic);
+}
+
+std::shared_ptr<Publisher> CommunicationManager::getPublisher(TopicHandle topic) {
+    if (std::shared_ptr<Publisher> publisher = publisher_cache_.get(topic)) {
+        return publisher;
+    }
+    if (!is_initialized_) {
+        COMMS_LOG_ERROR("CommunicationManager: Not initialized. Cannot get publisher.");
         return nullptr;
     }
-    auto it = publisher_cache_.find(topic_name);
-    if (it != publisher_cache_.end()) {
-        return it->second;
+    const TopicEntry* entry = topic_registry_.topic(topic);
+    if (!entry) {
+        COMMS_LOG_ERROR("CommunicationManager: Invalid topic handle: {}", topic);
+        return nullptr;
     }
-    // Logic to create and cache publisher will be added later
-    std::cout << "CommunicationManager: Getting publisher for topic: " << topic_name << " (placeholder - not fully implemented)." << std::endl;
-    auto publisher = std::make_shared<Publisher>(topic_name, vsomeip_app_); // Pass app
-    publisher_cache_[topic_name] = publisher;
-    return publisher;
+    // The factory runs under the table's write lock, which shutdown() takes before
+    // releasing transport_.
+    return publisher_cache_.getOrCreate(topic, [this, entry]() {
+        auto publisher = std::make_shared<Publisher>(entry->name, transport_, entry->service_id, entry->instance_id,
+                                                     entry->event_id, entry->eventgroup_id, local_bus_, entry->reliable);
+        if (entry->shm.enabled) {
+            publisher->enableSharedMemory(entry->shm);
+        }
+        if (entry->udp.enabled) {
+            publisher->enableBatchedUdp(entry->udp);
+        }
+        if (entry->trace) {
+            publisher->enableTracing();
+        }
+        if (entry->codec != Codec::Protobuf) {
+            publisher->setCodec(PayloadCodec(entry->codec, entry->someip));
+        }
+        if (entry->envelope.enabled) {
+            publisher->enableEnvelope(entry->envelope);
+        }
+        return publisher;
+    });
 }
 
 std::shared_ptr<Subscriber> CommunicationManager::getSubscriber(const std::string& topic_name) {
-    if (!is_initialized_ || !vsomeip_app_) {
-        std::cerr << "CommunicationManager: Not initialized. Cannot get subscriber." << std::endl;
+    TopicHandle topic = topic_registry_.findTopic(topic_name);
+    if (topic == INVALID_HANDLE) {
+        COMMS_LOG_ERROR("CommunicationManager: Unknown topic: {}", topic_name);
+        return nullptr;
+    }
+    return getSubscriber(topic);
+}
+
+std::shared_ptr<Subscriber> CommunicationManager::getSubscriber(TopicHandle topic) {
+    if (std::shared_ptr<Subscriber> subscriber = subscriber_cache_.get(topic)) {
+        return subscriber;
+    }
+    if (!is_initialized_) {
+        COMMS_LOG_ERROR("CommunicationManager: Not initialized. Cannot get subscriber.");
         return nullptr;
     }
-     auto it = subscriber_cache_.find(topic_name);
-    if (it != subscriber_cache_.end()) {
-        return it->second;
+    const TopicEntry* entry = topic_registry_.topic(topic);
+    if (!entry) {
+        COMMS_LOG_ERROR("CommunicationManager: Invalid topic handle: {}", topic);
+        return nullptr;
     }
-    std::cout << "CommunicationManager: Getting subscriber for topic: " << topic_name << " (placeholder - not fully implemented)." << std::endl;
-    auto subscriber = std::make_shared<Subscriber>(topic_name, vsomeip_app_); // Pass app
-    subscriber_cache_[topic_name] = subscriber;
-    return subscriber;
+    return subscriber_cache_.getOrCreate(topic, [this, entry]() {
+        auto subscriber = std::make_shared<Subscriber>(entry->name, transport_, entry->service_id, entry->instance_id,
+                                                       entry->event_id, entry->eventgroup_id, local_bus_);
+        if (entry->shm.enabled) {
+            subscriber->enableSharedMemory(entry->shm);
+        }
+        if (entry->udp.enabled) {
+            subscriber->enableBatchedUdp(entry->udp);
+        }
+        if (entry->codec != Codec::Protobuf) {
+            subscriber->setCodec(PayloadCodec(entry->codec, entry->someip));
+        }
+        if (entry->envelope.enabled) {
+            subscriber->enableEnvelope(entry->envelope);
+        }
+        DiscoveryCache::Eventgroup eventgroup;
+        eventgroup.service_id = entry->service_id;
+        eventgroup.instance_id = entry->instance_id;
+        eventgroup.eventgroup_id = entry->eventgroup_id;
+        eventgroup.event_id = entry->event_id;
+        auto unwatch = watchAvailability(subscriber, [this, eventgroup]() {
+            onDiscovered(eventgroup.service_id, eventgroup.instance_id, &eventgroup);
+        });
+        std::lock_guard<std::mutex> lock(discovery_mutex_);
+        discovery_unwatchers_.push_back(std::move(unwatch));
+        return subscriber;
+    });
 }
 
 void CommunicationManager::registerRpcService(
     const std::string& user_service_name,
     uint16_t service_id,
     uint16_t instance_id,
-    std::shared_ptr<protos::SampleRpc> service_impl) {
+    std::shared_ptr<protos::SampleRpc> service_impl,
+    const RpcResponseCacheConfig& cache_config) {
 
-    if (!is_initialized_ || !vsomeip_app_) {
-        std::cerr << "CommunicationManager: Not initialized. Cannot register RPC service " << user_service_name << std::endl;
+    if (!is_initialized_ || !transport_) {
+        COMMS_LOG_ERROR("CommunicationManager: Not initialized. Cannot register RPC service {}", user_service_name);
         return;
     }
     if (!service_impl) {
-        std::cerr << "CommunicationManager: Service implementation for " << user_service_name << " is null." << std::endl;
+        COMMS_LOG_ERROR("CommunicationManager: Service implementation for {} is null.", user_service_name);
         return;
     }
 
-    actual_rpc_services_[user_service_name] = service_impl; // Store it
+    std::shared_ptr<RpcResponseCache> response_cache;
+    if (cache_config.enabled) {
+        response_cache = std::make_shared<RpcResponseCache>(cache_config);
+    }
+    auto calls = std::make_shared<RpcCallRegistry>();
+    {
+        std::lock_guard<std::mutex> lock(services_mutex_);
+        actual_rpc_services_[user_service_name] = service_impl; // Store it
+        if (response_cache) {
+            rpc_response_caches_[user_service_name] = response_cache;
+        }
+        rpc_call_registries_[user_service_name] = calls;
+        rpc_service_ids_[user_service_name] = std::make_pair(service_id, instance_id);
+    }
+    if (response_cache) {
+        COMMS_LOG_INFO("CommunicationManager: Response cache enabled for {} (max entries: {}, TTL: {} ms)",
+                       user_service_name, cache_config.max_entries, cache_config.ttl.count());
+    }
 
-    vsomeip_app_->offer_service(service_id, instance_id);
-    std::cout << "CommunicationManager: Offered RPC service " << user_service_name
-              << " (ID: 0x" << std::hex << service_id
-              << ", Instance: 0x" << instance_id << std::dec << ")" << std::endl;
 
-    // --- Register handler for Echo method ---
-    vsomeip_app_->register_message_handler(
-        service_id, vsomeip::ANY_INSTANCE, METHOD_ID_ECHO, // Listen on any instance for this service/method
-        [this, service_impl](const std::shared_ptr<vsomeip::message>& req_msg) {
-            std::cout << "RPC Server: Echo request received (Service: 0x" << std::hex << req_msg->get_service()
-                      << ", Method: 0x" << req_msg->get_method()
-                      << ", Client: 0x" << req_msg->get_client()
-                      << ", Session: 0x" << req_msg->get_session() << std::dec << ")" << std::endl;
-
-            protos::EchoRequest request;
-            protos::EchoResponse response;
-
-            auto payload = req_msg->get_payload();
-            if (payload && payload->get_length() > 0) {
-                if (!request.ParseFromArray(payload->get_data(), payload->get_length())) {
-                    std::cerr << "RPC Server (Echo): Failed to parse request." << std::endl;
-                    std::shared_ptr<vsomeip::message> err_res = vsomeip::runtime::get()->create_response(req_msg);
-                    err_res->set_return_code(vsomeip::return_code_e::E_MALFORMED_MESSAGE);
-                    vsomeip_app_->send(err_res);
-                    return;
-                }
-            } else {
-                 std::cerr << "RPC Server (Echo): Received empty payload." << std::endl;
-                std::shared_ptr<vsomeip::message> err_res = vsomeip::runtime::get()->create_response(req_msg);
-                err_res->set_return_code(vsomeip::return_code_e::E_MALFORMED_MESSAGE);
-                vsomeip_app_->send(err_res);
-                return;
-            }
+    const Metrics::Endpoint echo_metrics =
+        Metrics::global().endpoint(Metrics::Kind::RpcServer, user_service_name + ".Echo");
+    const Metrics::Endpoint add_metrics =
+        Metrics::global().endpoint(Metrics::Kind::RpcServer, user_service_name + ".Add");
+    // Codecs and envelope come from the registry entry of the same name, if there is one.
+    const ServiceEntry* entry = topic_registry_.service(topic_registry_.findService(user_service_name));
+    const PayloadCodec echo_codec =
+        preparedCodec<protos::EchoRequest, protos::EchoResponse>(methodCodec(entry, "Echo"));
+    const PayloadCodec add_codec = preparedCodec<protos::AddRequest, protos::AddResponse>(methodCodec(entry, "Add"));
+    const EnvelopeConfig envelope = entry ? entry->envelope : EnvelopeConfig();
 
-            ::google::protobuf::Closure* dummy_done = ::google::protobuf::NewCallback(
-                [this, req_msg, &response]() {
-                    std::string serialized_response;
-                    if (!response.SerializeToString(&serialized_response)) {
-                        std::cerr << "RPC Server (Echo): Failed to serialize response." << std::endl;
-                        std::shared_ptr<vsomeip::message> err_res = vsomeip::runtime::get()->create_response(req_msg);
-                        err_res->set_return_code(vsomeip::return_code_e::E_SERIALIZATION);
-                        vsomeip_app_->send(err_res);
-                        return;
-                    }
-
-                    std::shared_ptr<vsomeip::message> vsomeip_res = vsomeip::runtime::get()->create_response(req_msg);
-                    std::shared_ptr<vsomeip::payload> res_payload = vsomeip::runtime::get()->create_payload();
-                    std::vector<vsomeip::byte_t> res_payload_data(serialized_response.begin(), serialized_response.end());
-                    res_payload->set_data(res_payload_data);
-                    vsomeip_res->set_payload(res_payload);
-
-                    vsomeip_app_->send(vsomeip_res);
-                     std::cout << "RPC Server (Echo): Sent response." << std::endl;
-                }
-            );
+    transport_->offerService(service_id, instance_id);
+    COMMS_LOG_INFO("CommunicationManager: Offered RPC service {} (ID: 0x{:x}, Instance: 0x{:x})",
+                   user_service_name, service_id, instance_id);
+
+    // --- Register handler for Echo method ---
+    transport_->registerMessageHandler(
+        service_id, instance_id, METHOD_ID_ECHO, // Per instance, so several instances of a service can be served side by side
+        [this, service_impl, response_cache, calls, echo_metrics, echo_codec, envelope](const std::shared_ptr<vsomeip::message>& req_msg) {
+            COMMS_LOG_DEBUG("RPC Server: Echo request received (Service: 0x{:x}, Method: 0x{:x}, Client: 0x{:x}, Session: 0x{:x})",
+                            req_msg->get_service(), req_msg->get_method(), req_msg->get_client(),
+                            req_msg->get_session());
 
-            service_impl->Echo(nullptr, &request, &response, dummy_done);
+            dispatchRpcRequest<protos::EchoRequest, protos::EchoResponse>(
+                transport_, req_msg, "Echo", response_cache, calls, echo_metrics, echo_codec, envelope,
+                [service_impl](::google::protobuf::RpcController* controller, const protos::EchoRequest* request,
+                               protos::EchoResponse* response, ::google::protobuf::Closure* done) {
+                    service_impl->Echo(controller, request, response, done);
+                });
         }
     );
-     std::cout << "CommunicationManager: Registered handler for Echo method (0x" << std::hex << METHOD_ID_ECHO << std::dec << ")" << std::endl;
+     COMMS_LOG_INFO("CommunicationManager: Registered handler for Echo method (0x{:x})", METHOD_ID_ECHO);
 
     // --- Register handler for Add method ---
-    vsomeip_app_->register_message_handler(
-        service_id, vsomeip::ANY_INSTANCE, METHOD_ID_ADD,
-        [this, service_impl](const std::shared_ptr<vsomeip::message>& req_msg) {
-            std::cout << "RPC Server: Add request received." << std::endl;
-            protos::AddRequest request;
-            protos::AddResponse response;
-
-            auto payload = req_msg->get_payload();
-            if (payload && payload->get_length() > 0) {
-                if (!request.ParseFromArray(payload->get_data(), payload->get_length())) {
-                    std::cerr << "RPC Server (Add): Failed to parse request." << std::endl;
-                    std::shared_ptr<vsomeip::message> err_res = vsomeip::runtime::get()->create_response(req_msg);
-                    err_res->set_return_code(vsomeip::return_code_e::E_MALFORMED_MESSAGE);
-                    vsomeip_app_->send(err_res);
-                    return;
-                }
-            } else {
-                 std::cerr << "RPC Server (Add): Received empty payload." << std::endl;
-                std::shared_ptr<vsomeip::message> err_res = vsomeip::runtime::get()->create_response(req_msg);
-                err_res->set_return_code(vsomeip::return_code_e::E_MALFORMED_MESSAGE);
-                vsomeip_app_->send(err_res);
+    transport_->registerMessageHandler(
+        service_id, instance_id, METHOD_ID_ADD,
+        [this, service_impl, response_cache, calls, add_metrics, add_codec, envelope](const std::shared_ptr<vsomeip::message>& req_msg) {
+            COMMS_LOG_DEBUG("RPC Server: Add request received.");
+
+            dispatchRpcRequest<protos::AddRequest, protos::AddResponse>(
+                transport_, req_msg, "Add", response_cache, calls, add_metrics, add_codec, envelope,
+                [service_impl](::google::protobuf::RpcController* controller, const protos::AddRequest* request,
+                               protos::AddResponse* response, ::google::protobuf::Closure* done) {
+                    service_impl->Add(controller, request, response, done);
+                });
+        }
+    );
+    COMMS_LOG_INFO("CommunicationManager: Registered handler for Add method (0x{:x})", METHOD_ID_ADD);
+
+    // --- Cancel notifications from clients (no response) ---
+    transport_->registerMessageHandler(
+        service_id, instance_id, METHOD_ID_CANCEL,
+        [calls](const std::shared_ptr<vsomeip::message>& msg) {
+            auto payload = msg->get_payload();
+            if (!payload || payload->get_length() < 2) {
+                COMMS_LOG_ERROR("RPC Server: Malformed cancel notification.");
                 return;
             }
-
-            ::google::protobuf::Closure* dummy_done = ::google::protobuf::NewCallback(
-                [this, req_msg, &response]() {
-                    std::string serialized_response;
-                    if (!response.SerializeToString(&serialized_response)) {
-                        std::cerr << "RPC Server (Add): Failed to serialize response." << std::endl;
-                        std::shared_ptr<vsomeip::message> err_res = vsomeip::runtime::get()->create_response(req_msg);
-                        err_res->set_return_code(vsomeip::return_code_e::E_SERIALIZATION);
-                        vsomeip_app_->send(err_res);
-                        return;
-                    }
-                    std::shared_ptr<vsomeip::message> vsomeip_res = vsomeip::runtime::get()->create_response(req_msg);
-                    std::shared_ptr<vsomeip::payload> res_payload = vsomeip::runtime::get()->create_payload();
-                     std::vector<vsomeip::byte_t> res_payload_data(serialized_response.begin(), serialized_response.end());
-                    res_payload->set_data(res_payload_data);
-                    vsomeip_res->set_payload(res_payload);
-                    vsomeip_app_->send(vsomeip_res);
-                    std::cout << "RPC Server (Add): Sent response." << std::endl;
-                }
-            );
-            service_impl->Add(nullptr, &request, &response, dummy_done);
+            const vsomeip::session_t session =
+                static_cast<vsomeip::session_t>((payload->get_data()[0] << 8) | payload->get_data()[1]);
+            if (calls->cancel(msg->get_client(), session)) {
+                COMMS_LOG_INFO("RPC Server: Cancelled call (Client: 0x{:x}, Session: 0x{:x})",
+                               msg->get_client(), session);
+            }
         }
     );
-    std::cout << "CommunicationManager: Registered handler for Add method (0x" << std::hex << METHOD_ID_ADD << std::dec << ")" << std::endl;
+}
+
+void CommunicationManager::registerRpcService(
+    const std::string& user_service_name,
+    std::shared_ptr<protos::SampleRpc> service_impl,
+    const RpcResponseCacheConfig& cache_config) {
+
+    const ServiceEntry* entry = topic_registry_.service(topic_registry_.findService(user_service_name));
+    if (!entry) {
+        COMMS_LOG_ERROR("CommunicationManager: Unknown service: {}", user_service_name);
+        return;
+    }
+    registerRpcService(user_service_name, entry->service_id, entry->instance_id, std::move(service_impl), cache_config);
+}
+
+void CommunicationManager::registerStreamMethod(
+    const std::string& user_service_name,
+    uint16_t service_id,
+    uint16_t instance_id,
+    uint16_t method_id,
+    const std::string& method_name,
+    StreamMethodHandler handler) {
+
+    if (!is_initialized_ || !transport_) {
+        COMMS_LOG_ERROR("CommunicationManager: Not initialized. Cannot register stream method {}", method_name);
+        return;
+    }
+    if (!handler) {
+        COMMS_LOG_ERROR("CommunicationManager: Stream handler for {} is null.", method_name);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(services_mutex_);
+    auto& stream_server = rpc_stream_servers_[user_service_name];
+    rpc_service_ids_[user_service_name] = std::make_pair(service_id, instance_id);
+    if (!stream_server) {
+        transport_->offerService(service_id, instance_id); // No-op if registerRpcService already offered it
+        stream_server.reset(new RpcStreamServer(transport_, service_id, instance_id));
+    }
+    stream_server->addMethod(method_id, method_name, std::move(handler));
 }
 
 std::shared_ptr<RpcClient> CommunicationManager::getRpcClient(const std::string& service_name) {
-    if (!is_initialized_ || !vsomeip_app_) {
-        std::cerr << "CommunicationManager: Not initialized. Cannot get RPC client." << std::endl;
+    ServiceHandle service = topic_registry_.findService(service_name);
+    if (service == INVALID_HANDLE) {
+        COMMS_LOG_ERROR("CommunicationManager: Unknown service: {}", service_name);
         return nullptr;
     }
-    auto it = rpc_client_cache_.find(service_name);
-    if (it != rpc_client_cache_.end()) {
-        return it->second;
+    return getRpcClient(service);
+}
+
+std::shared_ptr<RpcClient> CommunicationManager::getRpcClient(ServiceHandle service) {
+    if (std::shared_ptr<RpcClient> client = rpc_client_cache_.get(service)) {
+        return client;
+    }
+    if (!is_initialized_) {
+        COMMS_LOG_ERROR("CommunicationManager: Not initialized. Cannot get RPC client.");
+        return nullptr;
     }
-    std::cout << "CommunicationManager: Getting RPC client for service: " << service_name << " (placeholder - not fully implemented)." << std::endl;
-    auto client = std::make_shared<RpcClient>(service_name, vsomeip_app_); // Pass app
-    rpc_client_cache_[service_name] = client;
-    return client;
+    const ServiceEntry* entry = topic_registry_.service(service);
+    if (!entry) {
+        COMMS_LOG_ERROR("CommunicationManager: Invalid service handle: {}", service);
+        return nullptr;
+    }
+    return rpc_client_cache_.getOrCreate(service, [this, entry]() {
+        auto client = std::make_shared<RpcClient>(entry->name, transport_, entry->service_id, entry->instance_id);
+        client->setReliable(entry->reliable);
+        if (!entry->method_codecs.empty()) {
+            client->setMethodCodec(METHOD_ID_ECHO,
+                                   preparedCodec<protos::EchoRequest, protos::EchoResponse>(methodCodec(entry, "Echo")));
+            client->setMethodCodec(METHOD_ID_ADD,
+                                   preparedCodec<protos::AddRequest, protos::AddResponse>(methodCodec(entry, "Add")));
+        }
+        if (entry->envelope.enabled) {
+            client->enableEnvelope(entry->envelope);
+        }
+        const uint16_t service_id = entry->service_id;
+        const uint16_t instance_id = entry->instance_id;
+        auto unwatch = watchAvailability(client, [this, service_id, instance_id]() {
+            onDiscovered(service_id, instance_id, nullptr);
+        });
+        std::lock_guard<std::mutex> lock(discovery_mutex_);
+        discovery_unwatchers_.push_back(std::move(unwatch));
+        return client;
+    });
 }
 
 } // namespace comms_stack
@@ -0,0 +1,55 @@
+#include "deadline_scheduler.h"
+
+namespace comms_stack {
+
+DeadlineScheduler::DeadlineScheduler()
+    : thread_(&DeadlineScheduler::run, this) {
+}
+
+DeadlineScheduler::~DeadlineScheduler() {
+    stop();
+}
+
+void DeadlineScheduler::schedule(std::chrono::steady_clock::time_point deadline, Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        queue_.push(Item{deadline, next_sequence_++, std::move(task)});
+    }
+    cv_.notify_one();
+}
+
+void DeadlineScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+        thread_.join();
+    }
+}
+
+void DeadlineScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (queue_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        const auto deadline = queue_.top().deadline;
+        if (std::chrono::steady_clock::now() < deadline) {
+            cv_.wait_until(lock, deadline);
+            continue;
+        }
+        Task task = queue_.top().task;
+        queue_.pop();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+} // namespace comms_stack
@@ -0,0 +1,143 @@
+#include "discovery_cache.h"
+#include "logging.h"
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace comms_stack {
+
+namespace {
+
+uint16_t parseId(const boost::property_tree::ptree& node, const char* key) {
+    const std::string value = node.get<std::string>(key);
+    unsigned long id = std::stoul(value, nullptr, 0);
+    if (id > 0xFFFF) {
+        throw std::out_of_range(std::string(key) + " out of range: " + value);
+    }
+    return static_cast<uint16_t>(id);
+}
+
+std::string formatId(uint16_t id) {
+    std::ostringstream out;
+    out << "0x" << std::hex << std::setw(4) << std::setfill('0') << id;
+    return out.str();
+}
+
+} // namespace
+
+bool DiscoveryCache::load(const std::string& path) {
+    clear();
+    boost::property_tree::ptree root;
+    try {
+        boost::property_tree::read_json(path, root);
+        if (auto services = root.get_child_optional("services")) {
+            for (const auto& item : *services) {
+                Service service;
+                service.service_id = parseId(item.second, "service");
+                service.instance_id = parseId(item.second, "instance");
+                service.available_after_ms = item.second.get<int64_t>("available_after_ms", -1);
+                addService(service);
+            }
+        }
+        if (auto eventgroups = root.get_child_optional("eventgroups")) {
+            for (const auto& item : *eventgroups) {
+                Eventgroup eventgroup;
+                eventgroup.service_id = parseId(item.second, "service");
+                eventgroup.instance_id = parseId(item.second, "instance");
+                eventgroup.eventgroup_id = parseId(item.second, "eventgroup");
+                eventgroup.event_id = parseId(item.second, "event");
+                addEventgroup(eventgroup);
+            }
+        }
+    } catch (const boost::property_tree::json_parser_error&) {
+        return false; // Usually no cache yet
+    } catch (const std::exception& e) {
+        COMMS_LOG_WARN("DiscoveryCache: Ignoring {}: {}", path, e.what());
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool DiscoveryCache::save(const std::string& path) const {
+    namespace pt = boost::property_tree;
+    pt::ptree root;
+    pt::ptree services;
+    for (const Service& service : services_) {
+        pt::ptree node;
+        node.put("service", formatId(service.service_id));
+        node.put("instance", formatId(service.instance_id));
+        node.put("available_after_ms", service.available_after_ms);
+        services.push_back(std::make_pair("", node));
+    }
+    pt::ptree eventgroups;
+    for (const Eventgroup& eventgroup : eventgroups_) {
+        pt::ptree node;
+        node.put("service", formatId(eventgroup.service_id));
+        node.put("instance", formatId(eventgroup.instance_id));
+        node.put("eventgroup", formatId(eventgroup.eventgroup_id));
+        node.put("event", formatId(eventgroup.event_id));
+        eventgroups.push_back(std::make_pair("", node));
+    }
+    // property_tree would write an empty list as "".
+    if (!services.empty()) {
+        root.put_child("services", services);
+    }
+    if (!eventgroups.empty()) {
+        root.put_child("eventgroups", eventgroups);
+    }
+
+    // A crash mid-write must not leave a truncated cache behind.
+    const std::string temporary = path + ".tmp";
+    try {
+        pt::write_json(temporary, root);
+    } catch (const pt::json_parser_error& e) {
+        COMMS_LOG_ERROR("DiscoveryCache: Failed to write {}: {}", temporary, e.what());
+        return false;
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        COMMS_LOG_ERROR("DiscoveryCache: Failed to replace {}", path);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void DiscoveryCache::addService(const Service& service) {
+    for (Service& existing : services_) {
+        if (existing.service_id == service.service_id && existing.instance_id == service.instance_id) {
+            existing = service;
+            return;
+        }
+    }
+    services_.push_back(service);
+}
+
+void DiscoveryCache::addEventgroup(const Eventgroup& eventgroup) {
+    for (Eventgroup& existing : eventgroups_) {
+        if (existing.service_id == eventgroup.service_id && existing.instance_id == eventgroup.instance_id &&
+            existing.eventgroup_id == eventgroup.eventgroup_id && existing.event_id == eventgroup.event_id) {
+            return;
+        }
+    }
+    eventgroups_.push_back(eventgroup);
+}
+
+const DiscoveryCache::Service* DiscoveryCache::findService(uint16_t service_id, uint16_t instance_id) const {
+    for (const Service& service : services_) {
+        if (service.service_id == service_id && service.instance_id == instance_id) {
+            return &service;
+        }
+    }
+    return nullptr;
+}
+
+void DiscoveryCache::clear() {
+    services_.clear();
+    eventgroups_.clear();
+}
+
+} // namespace comms_stack
@@ -0,0 +1,155 @@
+#include "introspection_server.h"
+#include "logging.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace comms_stack {
+
+namespace {
+
+// A client that does not read its snapshot within this long is dropped.
+const timeval SEND_TIMEOUT = {1, 0};
+
+// Returns the address length, or 0 if `path` does not fit.
+socklen_t makeAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return 0;
+    }
+    std::memcpy(address.sun_path, path.data(), path.size());
+    if (path[0] == '@') {
+        address.sun_path[0] = '\0'; // Abstract namespace; the name is not NUL-terminated
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+    }
+    return static_cast<socklen_t>(sizeof(address));
+}
+
+void lowerThreadPriority() {
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+        // Not permitted everywhere (e.g. under some seccomp profiles); niceness still helps.
+        setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19);
+    }
+}
+
+} // namespace
+
+IntrospectionServer::~IntrospectionServer() {
+    stop();
+}
+
+bool IntrospectionServer::start(const std::string& path, SnapshotFunction snapshot) {
+    stop();
+    sockaddr_un address;
+    const socklen_t address_length = makeAddress(path, address);
+    if (address_length == 0) {
+        COMMS_LOG_ERROR("IntrospectionServer: Invalid socket path '{}'", path);
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        COMMS_LOG_ERROR("IntrospectionServer: socket() failed: {}", std::strerror(errno));
+        return false;
+    }
+    if (path[0] != '@') {
+        ::unlink(path.c_str()); // Left behind by a previous run
+    }
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), address_length) != 0 || ::listen(fd, 8) != 0) {
+        COMMS_LOG_ERROR("IntrospectionServer: Cannot listen on {}: {}", path, std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    int wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        COMMS_LOG_ERROR("IntrospectionServer: eventfd() failed: {}", std::strerror(errno));
+        ::close(fd);
+        if (path[0] != '@') {
+            ::unlink(path.c_str());
+        }
+        return false;
+    }
+
+    path_ = path;
+    snapshot_ = std::move(snapshot);
+    listen_fd_ = fd;
+    wake_fd_ = wake_fd;
+    thread_ = std::thread(&IntrospectionServer::run, this);
+    COMMS_LOG_INFO("IntrospectionServer: Serving snapshots on {}", path_);
+    return true;
+}
+
+void IntrospectionServer::stop() {
+    if (listen_fd_ < 0) {
+        return;
+    }
+    const uint64_t one = 1;
+    ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(listen_fd_);
+    ::close(wake_fd_);
+    listen_fd_ = -1;
+    wake_fd_ = -1;
+    if (path_[0] != '@') {
+        ::unlink(path_.c_str());
+    }
+    snapshot_ = nullptr;
+}
+
+void IntrospectionServer::run() {
+    lowerThreadPriority();
+    for (;;) {
+        pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            COMMS_LOG_ERROR("IntrospectionServer: poll() failed: {}", std::strerror(errno));
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            int client_fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client_fd >= 0) {
+                serve(client_fd);
+                ::close(client_fd);
+            }
+        }
+    }
+}
+
+void IntrospectionServer::serve(int client_fd) {
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &SEND_TIMEOUT, sizeof(SEND_TIMEOUT));
+    const std::string snapshot = snapshot_();
+    size_t sent = 0;
+    while (sent < snapshot.size()) {
+        ssize_t count = ::send(client_fd, snapshot.data() + sent, snapshot.size() - sent, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            COMMS_LOG_DEBUG("IntrospectionServer: Client went away after {} of {} bytes", sent, snapshot.size());
+            return;
+        }
+        sent += static_cast<size_t>(count);
+    }
+}
+
+} // namespace comms_stack
@@ -0,0 +1,144 @@
+#include "local_bus.h"
+#include <algorithm>
+
+namespace comms_stack {
+
+namespace {
+const uint16_t ANY_INSTANCE = 0xFFFF;
+
+// Sinks whose callback is running on this thread, innermost last.
+thread_local std::vector<const LocalBus::Sink*> t_delivering;
+
+bool matches(const LocalBus::Sink& sink, uint16_t instance_id) {
+    return sink.instanceId() == instance_id || sink.instanceId() == ANY_INSTANCE;
+}
+}
+
+void LocalBus::Sink::deliver(const MessagePtr& message) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (detached_) {
+            return;
+        }
+        running_++;
+    }
+    t_delivering.push_back(this);
+    struct Running { // Ends the delivery however the callback returns
+        Sink* sink;
+        ~Running() {
+            t_delivering.pop_back();
+            std::lock_guard<std::mutex> lock(sink->mutex_);
+            if (--sink->running_ == 0) {
+                sink->idle_.notify_all();
+            }
+        }
+    } running{this};
+    callback_(message);
+}
+
+void LocalBus::Sink::detach() {
+    const size_t own = static_cast<size_t>(std::count(t_delivering.begin(), t_delivering.end(), this));
+    std::unique_lock<std::mutex> lock(mutex_);
+    detached_ = true;
+    idle_.wait(lock, [this, own]() { return running_ == own; });
+}
+
+bool LocalBus::Topic::hasSubscribers(uint16_t instance_id) const {
+    const std::shared_ptr<const State> current = state();
+    return std::any_of(current->sinks.begin(), current->sinks.end(),
+                       [instance_id](const std::shared_ptr<Sink>& sink) { return matches(*sink, instance_id); });
+}
+
+size_t LocalBus::Topic::publish(uint16_t instance_id, const MessagePtr& message) const {
+    const std::shared_ptr<const State> current = state(); // Keeps the sinks alive while delivering
+    size_t delivered = 0;
+    for (const auto& sink : current->sinks) {
+        if (matches(*sink, instance_id)) {
+            sink->deliver(message);
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+bool LocalBus::Topic::isPublishedLocally(uint16_t instance_id) const {
+    const std::shared_ptr<const State> current = state();
+    for (const auto& publisher : current->publishers) {
+        if (publisher.first == instance_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<LocalBus> LocalBus::getShared() {
+    static std::shared_ptr<LocalBus> bus = std::make_shared<LocalBus>();
+    return bus;
+}
+
+std::shared_ptr<LocalBus::Topic> LocalBus::topic(uint16_t service_id, uint16_t event_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& topic = topics_[key(service_id, event_id)];
+    if (!topic) {
+        topic = std::make_shared<Topic>();
+    }
+    return topic;
+}
+
+void LocalBus::addPublisher(uint16_t service_id, uint16_t instance_id, uint16_t event_id) {
+    std::shared_ptr<Topic> target = topic(service_id, event_id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto updated = std::make_shared<Topic::State>(*target->state());
+    auto it = std::find_if(updated->publishers.begin(), updated->publishers.end(),
+                           [instance_id](const std::pair<uint16_t, uint32_t>& entry) { return entry.first == instance_id; });
+    if (it != updated->publishers.end()) {
+        it->second++;
+    } else {
+        updated->publishers.emplace_back(instance_id, 1);
+    }
+    target->setState(std::move(updated));
+}
+
+void LocalBus::removePublisher(uint16_t service_id, uint16_t instance_id, uint16_t event_id) {
+    std::shared_ptr<Topic> target = topic(service_id, event_id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto updated = std::make_shared<Topic::State>(*target->state());
+    auto it = std::find_if(updated->publishers.begin(), updated->publishers.end(),
+                           [instance_id](const std::pair<uint16_t, uint32_t>& entry) { return entry.first == instance_id; });
+    if (it == updated->publishers.end()) {
+        return;
+    }
+    if (--it->second == 0) {
+        updated->publishers.erase(it);
+    }
+    target->setState(std::move(updated));
+}
+
+std::shared_ptr<LocalBus::Sink> LocalBus::addSubscriber(uint16_t service_id, uint16_t instance_id,
+                                                        uint16_t event_id, Callback callback) {
+    auto sink = std::make_shared<Sink>(instance_id, std::move(callback));
+    std::shared_ptr<Topic> target = topic(service_id, event_id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto updated = std::make_shared<Topic::State>(*target->state());
+    updated->sinks.push_back(sink);
+    target->setState(std::move(updated));
+    return sink;
+}
+
+void LocalBus::removeSubscriber(uint16_t service_id, uint16_t event_id, const std::shared_ptr<Sink>& sink) {
+    if (!sink) {
+        return;
+    }
+    std::shared_ptr<Topic> target = topic(service_id, event_id);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto updated = std::make_shared<Topic::State>(*target->state());
+        updated->sinks.erase(std::remove(updated->sinks.begin(), updated->sinks.end(), sink), updated->sinks.end());
+        target->setState(std::move(updated));
+    }
+    // A publisher may still hold a state containing the sink; detaching waits out a running
+    // delivery and disarms later ones.
+    sink->detach();
+}
+
+} // namespace comms_stack
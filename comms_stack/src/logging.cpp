@@ -0,0 +1,377 @@
+#include "logging.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace comms_stack {
+
+namespace {
+
+static_assert((Logger::QUEUE_RECORDS & (Logger::QUEUE_RECORDS - 1)) == 0, "QUEUE_RECORDS must be a power of two");
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+        case LogLevel::Error: return "ERROR";
+        case LogLevel::Off: break;
+    }
+    return "?";
+}
+
+uint8_t levelFromEnvironment() {
+    const char* value = std::getenv("COMMS_STACK_LOG_LEVEL");
+    if (value) {
+        const std::string name(value);
+        if (name == "debug") return static_cast<uint8_t>(LogLevel::Debug);
+        if (name == "info") return static_cast<uint8_t>(LogLevel::Info);
+        if (name == "warn") return static_cast<uint8_t>(LogLevel::Warn);
+        if (name == "error") return static_cast<uint8_t>(LogLevel::Error);
+        if (name == "off") return static_cast<uint8_t>(LogLevel::Off);
+    }
+    return static_cast<uint8_t>(LogLevel::Info);
+}
+
+void defaultSink(LogLevel level, const std::string& line) {
+    std::ostream& out = level >= LogLevel::Warn ? std::cerr : std::cout;
+    out << line << '\n';
+}
+
+// Reads back what Logger::Encoder wrote.
+class Decoder {
+public:
+    explicit Decoder(const Logger::Record& record) : record_(record) {}
+
+    bool next(Logger::Encoder::Tag& tag, uint64_t& bits, double& number, const char*& text, size_t& length) {
+        if (offset_ >= record_.size) {
+            return false;
+        }
+        tag = static_cast<Logger::Encoder::Tag>(record_.args[offset_++]);
+        switch (tag) {
+            case Logger::Encoder::Double:
+                std::memcpy(&number, record_.args + offset_, sizeof(number));
+                offset_ += sizeof(number);
+                return true;
+            case Logger::Encoder::String: {
+                uint16_t stored;
+                std::memcpy(&stored, record_.args + offset_, sizeof(stored));
+                text = reinterpret_cast<const char*>(record_.args + offset_ + sizeof(stored));
+                length = stored;
+                offset_ += sizeof(stored) + stored;
+                return true;
+            }
+            case Logger::Encoder::Char:
+            case Logger::Encoder::Bool:
+                bits = record_.args[offset_++];
+                return true;
+            default:
+                std::memcpy(&bits, record_.args + offset_, sizeof(bits));
+                offset_ += sizeof(bits);
+                return true;
+        }
+    }
+
+private:
+    const Logger::Record& record_;
+    size_t offset_ = 0;
+};
+
+// Formats one argument for a "{:spec}" placeholder; spec is printf-like: [flags][width][.precision][type].
+void appendArgument(std::string& out, const std::string& spec, Logger::Encoder::Tag tag, uint64_t bits, double number,
+                    const char* text, size_t length) {
+    std::string flags = spec;
+    if (!flags.empty() && flags[0] == '<') {
+        flags[0] = '-'; // Left-aligned
+    } else if (!flags.empty() && flags[0] == '>') {
+        flags.erase(0, 1); // Right-aligned is printf's default
+    }
+    char type = 0;
+    if (!flags.empty() && std::isalpha(static_cast<unsigned char>(flags.back()))) {
+        type = flags.back();
+        flags.pop_back();
+    }
+    char buffer[128];
+    int written = 0;
+    switch (tag) {
+        case Logger::Encoder::Signed:
+        case Logger::Encoder::Unsigned: {
+            if (type == 'f' || type == 'e' || type == 'g') {
+                const double value = tag == Logger::Encoder::Signed ? static_cast<double>(static_cast<int64_t>(bits))
+                                                                    : static_cast<double>(bits);
+                written = std::snprintf(buffer, sizeof(buffer), ("%" + flags + type).c_str(), value);
+            } else if (type == 'x' || type == 'X' || type == 'o' || tag == Logger::Encoder::Unsigned) {
+                const char conversion = (type == 'x' || type == 'X' || type == 'o') ? type : 'u';
+                written = std::snprintf(buffer, sizeof(buffer), ("%" + flags + "ll" + conversion).c_str(),
+                                        static_cast<unsigned long long>(bits));
+            } else {
+                written = std::snprintf(buffer, sizeof(buffer), ("%" + flags + "lld").c_str(),
+                                        static_cast<long long>(static_cast<int64_t>(bits)));
+            }
+            break;
+        }
+        case Logger::Encoder::Double:
+            if (type != 'f' && type != 'e' && type != 'g' && type != 'E' && type != 'G') {
+                type = 'g';
+            }
+            written = std::snprintf(buffer, sizeof(buffer), ("%" + flags + type).c_str(), number);
+            break;
+        case Logger::Encoder::Char:
+            written = std::snprintf(buffer, sizeof(buffer), ("%" + flags + "c").c_str(), static_cast<int>(bits));
+            break;
+        case Logger::Encoder::Bool:
+            written = std::snprintf(buffer, sizeof(buffer), ("%" + flags + "s").c_str(), bits ? "true" : "false");
+            break;
+        case Logger::Encoder::Pointer:
+            written = std::snprintf(buffer, sizeof(buffer), "%p", reinterpret_cast<void*>(static_cast<uintptr_t>(bits)));
+            break;
+        case Logger::Encoder::String:
+            if (flags.empty()) {
+                out.append(text, length);
+                return;
+            }
+            {
+                const std::string value(text, length);
+                written = std::snprintf(buffer, sizeof(buffer), ("%" + flags + "s").c_str(), value.c_str());
+            }
+            break;
+    }
+    if (written > 0) {
+        out.append(buffer, std::min(static_cast<size_t>(written), sizeof(buffer) - 1));
+    }
+}
+
+std::string formatRecord(const Logger::Record& record) {
+    const auto since_epoch = std::chrono::nanoseconds(record.timestamp_ns);
+    const std::time_t seconds = static_cast<std::time_t>(std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count());
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    char prefix[48];
+    size_t prefix_length = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+    prefix_length += std::snprintf(prefix + prefix_length, sizeof(prefix) - prefix_length, ".%06lu %-5s ",
+                                   static_cast<unsigned long>((record.timestamp_ns / 1000) % 1000000),
+                                   levelName(record.level));
+
+    std::string line(prefix, prefix_length);
+    Decoder decoder(record);
+    for (const char* p = record.format; *p; ++p) {
+        if (*p == '{' && p[1] == '{') {
+            line += '{';
+            ++p;
+        } else if (*p == '}' && p[1] == '}') {
+            line += '}';
+            ++p;
+        } else if (*p == '{') {
+            const char* end = std::strchr(p, '}');
+            if (!end) {
+                line.append(p);
+                break;
+            }
+            const std::string spec = p[1] == ':' ? std::string(p + 2, end) : std::string();
+            Logger::Encoder::Tag tag;
+            uint64_t bits = 0;
+            double number = 0;
+            const char* text = nullptr;
+            size_t length = 0;
+            if (decoder.next(tag, bits, number, text, length)) {
+                appendArgument(line, spec, tag, bits, number, text, length);
+            } else {
+                line += "{?}"; // Fewer arguments than placeholders, or cut off
+            }
+            p = end;
+        } else {
+            line += *p;
+        }
+    }
+    if (record.truncated) {
+        line += " [truncated]";
+    }
+    return line;
+}
+
+// Process-wide queue and logging thread. Never destroyed; the thread is stopped at exit.
+class LogQueue {
+public:
+    LogQueue() : slots_(new Logger::Record[Logger::QUEUE_RECORDS]), sink_(defaultSink) {
+        for (size_t i = 0; i < Logger::QUEUE_RECORDS; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        thread_ = std::thread(&LogQueue::run, this);
+        std::atexit([]() { instance().stop(); });
+    }
+
+    static LogQueue& instance() {
+        static LogQueue* queue = new LogQueue();
+        return *queue;
+    }
+
+    Logger::Record* claim() {
+        uint64_t position = enqueue_position_.load(std::memory_order_relaxed);
+        for (;;) {
+            Logger::Record& slot = slots_[position & (Logger::QUEUE_RECORDS - 1)];
+            const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+            if (difference == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (difference < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr; // Full
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void commit(Logger::Record* record) {
+        record->sequence.store(record->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        if (idle_.load(std::memory_order_relaxed)) {
+            wake_.notify_one();
+        }
+    }
+
+    bool stopped() const { return stopped_.load(std::memory_order_acquire); }
+
+    void writeNow(const Logger::Record& record) {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        sink_(record.level, formatRecord(record));
+    }
+
+    void setSink(Logger::Sink sink) {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        sink_ = sink ? std::move(sink) : Logger::Sink(defaultSink);
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        drainLocked();
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    bool hasRecord() const {
+        const uint64_t position = dequeue_position_.load(std::memory_order_relaxed);
+        const Logger::Record& slot = slots_[position & (Logger::QUEUE_RECORDS - 1)];
+        return slot.sequence.load(std::memory_order_acquire) == position + 1;
+    }
+
+    size_t drainLocked() {
+        size_t count = 0;
+        uint64_t position = dequeue_position_.load(std::memory_order_relaxed);
+        for (;;) {
+            Logger::Record& slot = slots_[position & (Logger::QUEUE_RECORDS - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+                break; // Empty, or the next record is still being written
+            }
+            sink_(slot.level, formatRecord(slot));
+            slot.sequence.store(position + Logger::QUEUE_RECORDS, std::memory_order_release);
+            dequeue_position_.store(++position, std::memory_order_relaxed);
+            ++count;
+        }
+        const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped_) {
+            sink_(LogLevel::Warn, "Logger: " + std::to_string(dropped - reported_dropped_) +
+                                  " record(s) dropped, queue full");
+            reported_dropped_ = dropped;
+        }
+        if (count > 0) {
+            std::cout.flush();
+        }
+        return count;
+    }
+
+    void run() {
+        for (;;) {
+            size_t drained;
+            {
+                std::lock_guard<std::mutex> lock(drain_mutex_);
+                drained = drainLocked();
+            }
+            if (drained > 0) {
+                continue;
+            }
+            if (stopping_.load(std::memory_order_acquire)) {
+                return;
+            }
+            // Writers only notify while idle_ is set; the timeout covers a wakeup lost in between.
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            idle_.store(true);
+            wake_.wait_for(lock, std::chrono::milliseconds(50),
+                           [this] { return stopping_.load(std::memory_order_acquire) || hasRecord(); });
+            idle_.store(false);
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_.store(true, std::memory_order_release);
+        }
+        wake_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        stopped_.store(true, std::memory_order_release); // Later statements are written synchronously
+        flush();
+    }
+
+    std::unique_ptr<Logger::Record[]> slots_;
+    alignas(64) std::atomic<uint64_t> enqueue_position_{0};
+    alignas(64) std::atomic<uint64_t> dequeue_position_{0};
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t reported_dropped_ = 0;  // Under drain_mutex_
+    std::mutex drain_mutex_;         // One drainer at a time; guards sink_
+    Logger::Sink sink_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> idle_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> stopped_{false};
+    std::thread thread_;
+};
+
+} // namespace
+
+std::atomic<uint8_t> Logger::level_{levelFromEnvironment()};
+
+Logger::Record* Logger::claim(Record& local) {
+    LogQueue& queue = LogQueue::instance();
+    Record* record = queue.stopped() ? &local : queue.claim();
+    if (record) {
+        record->timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+    return record;
+}
+
+void Logger::commit(Record* record, bool queued) {
+    if (queued) {
+        LogQueue::instance().commit(record);
+    } else {
+        LogQueue::instance().writeNow(*record);
+    }
+}
+
+void Logger::setSink(Sink sink) {
+    LogQueue::instance().setSink(std::move(sink));
+}
+
+void Logger::flush() {
+    LogQueue::instance().flush();
+}
+
+uint64_t Logger::dropped() {
+    return LogQueue::instance().dropped();
+}
+
+} // namespace comms_stack
@@ -0,0 +1,328 @@
+#include "loopback_transport.h"
+#include "logging.h"
+#include <vsomeip/vsomeip.hpp>
+#include <algorithm>
+
+namespace comms_stack {
+
+namespace {
+
+const uint16_t ANY = 0xFFFF;
+
+bool matches(uint16_t registered, uint16_t actual) {
+    return registered == actual || registered == ANY;
+}
+
+// What a receiver gets from the wire: an independent message with its own payload bytes.
+std::shared_ptr<vsomeip::message> copyMessage(const std::shared_ptr<vsomeip::message>& message) {
+    auto runtime = vsomeip::runtime::get();
+    std::shared_ptr<vsomeip::message> copy = runtime->create_message(message->is_reliable());
+    copy->set_service(message->get_service());
+    copy->set_instance(message->get_instance());
+    copy->set_method(message->get_method());
+    copy->set_client(message->get_client());
+    copy->set_session(message->get_session());
+    copy->set_message_type(message->get_message_type());
+    copy->set_return_code(message->get_return_code());
+    std::shared_ptr<vsomeip::payload> payload = message->get_payload();
+    copy->set_payload(payload ? runtime->create_payload(payload->get_data(), payload->get_length())
+                              : runtime->create_payload());
+    return copy;
+}
+
+} // namespace
+
+LoopbackTransport::LoopbackTransport(std::shared_ptr<LoopbackNetwork> network, const std::string& name)
+    : network_(std::move(network)), name_(name) {
+    std::lock_guard<std::mutex> lock(network_->mutex_);
+    client_id_ = network_->next_client_id_++;
+}
+
+LoopbackTransport::~LoopbackTransport() {
+    stop();
+}
+
+void LoopbackTransport::start() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (running_) {
+            return;
+        }
+        running_ = true;
+    }
+    dispatcher_ = std::thread(&LoopbackTransport::run, this);
+    std::lock_guard<std::mutex> lock(network_->mutex_);
+    network_->transports_.push_back(this);
+}
+
+void LoopbackTransport::stop() {
+    {
+        std::lock_guard<std::mutex> lock(network_->mutex_);
+        auto& transports = network_->transports_;
+        transports.erase(std::remove(transports.begin(), transports.end(), this), transports.end());
+        for (auto it = network_->offered_.begin(); it != network_->offered_.end();) {
+            if (it->second == this) {
+                broadcastAvailability(it->first.first, it->first.second, false);
+                it = network_->offered_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+    }
+    queue_cv_.notify_all();
+    if (dispatcher_.joinable() && dispatcher_.get_id() != std::this_thread::get_id()) {
+        dispatcher_.join();
+    }
+}
+
+void LoopbackTransport::offerService(uint16_t service_id, uint16_t instance_id) {
+    std::lock_guard<std::mutex> lock(network_->mutex_);
+    auto& provider = network_->offered_[{service_id, instance_id}];
+    if (provider && provider != this) {
+        COMMS_LOG_ERROR("LoopbackTransport ({}): Service 0x{:x}/0x{:x} is already offered by another transport.",
+                        name_, service_id, instance_id);
+        return;
+    }
+    provider = this;
+    broadcastAvailability(service_id, instance_id, true);
+}
+
+void LoopbackTransport::stopOfferService(uint16_t service_id, uint16_t instance_id) {
+    std::lock_guard<std::mutex> lock(network_->mutex_);
+    auto it = network_->offered_.find({service_id, instance_id});
+    if (it == network_->offered_.end() || it->second != this) {
+        return;
+    }
+    network_->offered_.erase(it);
+    broadcastAvailability(service_id, instance_id, false);
+}
+
+void LoopbackTransport::registerAvailabilityHandler(uint16_t service_id, uint16_t instance_id, AvailabilityHandler handler) {
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex_);
+        availability_handlers_[{service_id, instance_id}] = std::move(handler);
+    }
+    // Report what is already offered, as vsomeip does on registration.
+    std::lock_guard<std::mutex> lock(network_->mutex_);
+    for (const auto& entry : network_->offered_) {
+        if (matches(service_id, entry.first.first) && matches(instance_id, entry.first.second)) {
+            postAvailability(entry.first.first, entry.first.second, true);
+        }
+    }
+}
+
+void LoopbackTransport::unregisterAvailabilityHandler(uint16_t service_id, uint16_t instance_id) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    availability_handlers_.erase({service_id, instance_id});
+}
+
+void LoopbackTransport::registerMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id,
+                                               MessageHandler handler) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    message_handlers_[Key(service_id, instance_id, method_id)] = std::move(handler);
+}
+
+void LoopbackTransport::unregisterMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    message_handlers_.erase(Key(service_id, instance_id, method_id));
+}
+
+void LoopbackTransport::send(const std::shared_ptr<vsomeip::message>& message) {
+    const vsomeip::message_type_e type = message->get_message_type();
+    const bool is_request = type == vsomeip::message_type_e::MT_REQUEST ||
+                            type == vsomeip::message_type_e::MT_REQUEST_NO_RETURN;
+    if (is_request) {
+        uint16_t session = ++next_session_;
+        if (session == 0) {
+            session = ++next_session_; // 0 is not a valid session ID
+        }
+        message->set_client(client_id_);
+        message->set_session(session);
+    }
+    std::shared_ptr<vsomeip::message> copy = copyMessage(message);
+
+    std::lock_guard<std::mutex> lock(network_->mutex_);
+    if (is_request) {
+        auto it = network_->offered_.find({message->get_service(), message->get_instance()});
+        if (it != network_->offered_.end()) {
+            LoopbackTransport* provider = it->second;
+            provider->post([provider, copy]() { provider->deliver(copy); });
+        }
+        return; // Like vsomeip, requests to unavailable services are dropped
+    }
+    for (LoopbackTransport* transport : network_->transports_) {
+        if (transport->client_id_ == message->get_client()) {
+            transport->post([transport, copy]() { transport->deliver(copy); });
+            return;
+        }
+    }
+}
+
+void LoopbackTransport::requestEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                                     const std::set<uint16_t>&) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    requested_events_.insert(Key(service_id, instance_id, event_id));
+}
+
+void LoopbackTransport::releaseEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    requested_events_.erase(Key(service_id, instance_id, event_id));
+}
+
+void LoopbackTransport::subscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) {
+    post([this, service_id, instance_id, eventgroup_id]() {
+        std::vector<std::pair<uint16_t, SubscriptionStatusHandler>> handlers;
+        {
+            std::lock_guard<std::mutex> lock(handlers_mutex_);
+            for (const auto& entry : subscription_status_handlers_) {
+                if (matches(std::get<0>(entry.first), service_id) && matches(std::get<1>(entry.first), instance_id) &&
+                    std::get<2>(entry.first) == eventgroup_id) {
+                    handlers.push_back(entry.second);
+                }
+            }
+        }
+        for (const auto& handler : handlers) {
+            handler.second(service_id, instance_id, eventgroup_id, handler.first, 0);
+        }
+    });
+}
+
+void LoopbackTransport::registerSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id,
+                                                          uint16_t eventgroup_id, uint16_t event_id,
+                                                          SubscriptionStatusHandler handler) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    subscription_status_handlers_[Key(service_id, instance_id, eventgroup_id)] = {event_id, std::move(handler)};
+}
+
+void LoopbackTransport::unregisterSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id,
+                                                            uint16_t eventgroup_id, uint16_t) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    subscription_status_handlers_.erase(Key(service_id, instance_id, eventgroup_id));
+}
+
+void LoopbackTransport::notify(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                               const std::shared_ptr<vsomeip::payload>& payload) {
+    notifyMatching(service_id, instance_id, event_id, payload, nullptr);
+}
+
+void LoopbackTransport::notifyOne(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                                  const std::shared_ptr<vsomeip::payload>& payload, uint16_t client_id) {
+    notifyMatching(service_id, instance_id, event_id, payload, &client_id);
+}
+
+void LoopbackTransport::notifyMatching(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                                       const std::shared_ptr<vsomeip::payload>& payload, const uint16_t* client_id) {
+    auto runtime = vsomeip::runtime::get();
+    std::shared_ptr<vsomeip::message> notification = runtime->create_notification();
+    notification->set_service(service_id);
+    notification->set_instance(instance_id);
+    notification->set_method(event_id);
+    notification->set_payload(payload);
+
+    std::lock_guard<std::mutex> lock(network_->mutex_);
+    for (LoopbackTransport* transport : network_->transports_) {
+        if (client_id && transport->client_id_ != *client_id) {
+            continue;
+        }
+        bool wanted;
+        {
+            std::lock_guard<std::mutex> handlers_lock(transport->handlers_mutex_);
+            wanted = transport->requested_events_.count(Key(service_id, instance_id, event_id)) ||
+                     transport->requested_events_.count(Key(service_id, ANY, event_id));
+        }
+        if (wanted) {
+            std::shared_ptr<vsomeip::message> copy = copyMessage(notification);
+            transport->post([transport, copy]() { transport->deliver(copy); });
+        }
+    }
+}
+
+void LoopbackTransport::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!running_) {
+            return;
+        }
+        queue_.push_back(std::move(task));
+        queue_depth_.store(queue_.size(), std::memory_order_relaxed);
+    }
+    queue_cv_.notify_one();
+}
+
+void LoopbackTransport::run() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this]() { return !running_ || !queue_.empty(); });
+            if (!running_) {
+                queue_.clear(); // Nothing runs after stop()
+                queue_depth_.store(0, std::memory_order_relaxed);
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+            queue_depth_.store(queue_.size(), std::memory_order_relaxed);
+        }
+        task();
+    }
+}
+
+void LoopbackTransport::deliver(const std::shared_ptr<vsomeip::message>& message) {
+    const uint16_t service = message->get_service();
+    const uint16_t instance = message->get_instance();
+    const uint16_t method = message->get_method();
+    const vsomeip::message_type_e type = message->get_message_type();
+    const bool is_response = type == vsomeip::message_type_e::MT_RESPONSE || type == vsomeip::message_type_e::MT_ERROR;
+    // Most specific registration wins, as in vsomeip. Responses go to the client side's
+    // catch-all handler (the ResponseDemultiplexer) first: a transport that also serves the
+    // method would otherwise hand its own clients' responses to the server handler.
+    const Key candidates[] = {
+        Key(ANY, ANY, ANY),
+        Key(service, instance, method), Key(service, instance, ANY), Key(service, ANY, method),
+        Key(service, ANY, ANY), Key(ANY, ANY, method), Key(ANY, ANY, ANY),
+    };
+    MessageHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex_);
+        for (size_t i = is_response ? 0 : 1; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+            auto it = message_handlers_.find(candidates[i]);
+            if (it != message_handlers_.end()) {
+                handler = it->second;
+                break;
+            }
+        }
+    }
+    if (handler) {
+        handler(message);
+    }
+}
+
+void LoopbackTransport::postAvailability(uint16_t service_id, uint16_t instance_id, bool is_available) {
+    post([this, service_id, instance_id, is_available]() {
+        std::vector<AvailabilityHandler> handlers;
+        {
+            std::lock_guard<std::mutex> lock(handlers_mutex_);
+            for (const auto& entry : availability_handlers_) {
+                if (matches(entry.first.first, service_id) && matches(entry.first.second, instance_id)) {
+                    handlers.push_back(entry.second);
+                }
+            }
+        }
+        for (const auto& handler : handlers) {
+            handler(service_id, instance_id, is_available);
+        }
+    });
+}
+
+void LoopbackTransport::broadcastAvailability(uint16_t service_id, uint16_t instance_id, bool is_available) {
+    for (LoopbackTransport* transport : network_->transports_) {
+        transport->postAvailability(service_id, instance_id, is_available);
+    }
+}
+
+} // namespace comms_stack
@@ -0,0 +1,121 @@
+#include "message_envelope.h"
+#include "hash_utils.h"
+#include "common_messages.pb.h"
+#include "sample_rpc_service.pb.h"
+#include "logging.h"
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace comms_stack {
+
+namespace {
+
+struct TypeTable {
+    std::mutex mutex;
+    std::unordered_map<uint32_t, const google::protobuf::Message*> prototypes; // By type hash
+};
+
+bool addLocked(TypeTable& table, const google::protobuf::Descriptor* descriptor);
+
+void addFileLocked(TypeTable& table, const google::protobuf::FileDescriptor* file) {
+    for (int i = 0; i < file->message_type_count(); ++i) {
+        addLocked(table, file->message_type(i));
+    }
+}
+
+TypeTable& types() {
+    static TypeTable* table = [] {
+        TypeTable* t = new TypeTable(); // Never destroyed: receive threads may outlive statics
+        addFileLocked(*t, protos::SimpleNotification::descriptor()->file());
+        addFileLocked(*t, protos::EchoRequest::descriptor()->file());
+        return t;
+    }();
+    return *table;
+}
+
+bool addLocked(TypeTable& table, const google::protobuf::Descriptor* descriptor) {
+    const google::protobuf::Message* prototype =
+        google::protobuf::MessageFactory::generated_factory()->GetPrototype(descriptor);
+    if (!prototype) {
+        COMMS_LOG_WARN("MessageTypes: {} has no generated class; it cannot be received by type.",
+                       descriptor->full_name());
+        return false;
+    }
+    const uint32_t hash = MessageTypes::hash(descriptor);
+    auto it = table.prototypes.emplace(hash, prototype).first;
+    if (it->second->GetDescriptor() != descriptor) {
+        COMMS_LOG_ERROR("MessageTypes: {} has the type hash 0x{:08x} of {}; it cannot be received by type.",
+                        descriptor->full_name(), hash, it->second->GetDescriptor()->full_name());
+        return false;
+    }
+    for (int i = 0; i < descriptor->nested_type_count(); ++i) {
+        addLocked(table, descriptor->nested_type(i));
+    }
+    return true;
+}
+
+} // namespace
+
+uint64_t MessageEnvelope::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+uint32_t MessageTypes::hash(const google::protobuf::Descriptor* descriptor) {
+    const std::string& name = descriptor->full_name();
+    return fnv1a32(reinterpret_cast<const uint8_t*>(name.data()), name.size());
+}
+
+uint32_t MessageTypes::hashOf(const google::protobuf::Message& message) {
+    struct Slot {
+        const std::type_info* type;
+        uint32_t hash;
+    };
+    // typeid is a vtable load; GetDescriptor() and hashing the name are not.
+    thread_local Slot cache[4] = {};
+    thread_local unsigned next_slot = 0;
+    const std::type_info* type = &typeid(message);
+    for (const Slot& slot : cache) {
+        if (slot.type == type) {
+            return slot.hash;
+        }
+    }
+    const uint32_t type_hash = hash(message.GetDescriptor());
+    cache[next_slot++ % 4] = {type, type_hash};
+    return type_hash;
+}
+
+bool MessageTypes::add(const google::protobuf::Descriptor* descriptor) {
+    TypeTable& table = types();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return addLocked(table, descriptor);
+}
+
+void MessageTypes::addFile(const google::protobuf::FileDescriptor* file) {
+    TypeTable& table = types();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    addFileLocked(table, file);
+}
+
+const google::protobuf::Message* MessageTypes::find(uint32_t hash) {
+    TypeTable& table = types();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.prototypes.find(hash);
+    return it != table.prototypes.end() ? it->second : nullptr;
+}
+
+std::string MessageTypes::name(uint32_t hash) {
+    if (const google::protobuf::Message* prototype = find(hash)) {
+        return prototype->GetDescriptor()->full_name();
+    }
+    char text[16];
+    std::snprintf(text, sizeof(text), "0x%08x", hash);
+    return text;
+}
+
+} // namespace comms_stack
@@ -0,0 +1,269 @@
+#include "metrics.h"
+#include "logging.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace comms_stack {
+
+namespace {
+
+// Only the owning thread writes its cells, so a plain load and store replaces the locked add.
+inline void bump(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < (size_t(1) << SUB_BUCKET_BITS)) {
+        return index;
+    }
+    const unsigned shift = static_cast<unsigned>(index >> SUB_BUCKET_BITS) - 1;
+    const uint64_t mantissa = (index & ((size_t(1) << SUB_BUCKET_BITS) - 1)) + (uint64_t(1) << SUB_BUCKET_BITS);
+    return mantissa << shift;
+}
+
+void LatencyHistogram::record(uint64_t value_ns, uint64_t count) {
+    buckets_[bucketIndex(value_ns)] += count;
+    count_ += count;
+    sum_ += value_ns * count;
+    max_ = std::max(max_, value_ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * count_)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(bucketLowerBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+thread_local Metrics::ThreadBlock* Metrics::thread_block_ = nullptr;
+thread_local bool Metrics::thread_exited_ = false;
+
+class Metrics::ThreadExit {
+public:
+    explicit ThreadExit(ThreadBlock* block) : block_(block) {}
+    ~ThreadExit() {
+        thread_block_ = nullptr;
+        thread_exited_ = true;
+        Metrics::global().retire(block_);
+    }
+
+private:
+    ThreadBlock* block_;
+};
+
+Metrics::ThreadBlock::~ThreadBlock() {
+    for (auto& entry : cells) {
+        delete entry.load(std::memory_order_relaxed);
+    }
+}
+
+Metrics& Metrics::global() {
+    // Never destroyed: threads may still retire their blocks during static destruction.
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+Metrics::ThreadBlock* Metrics::attachThread() {
+    if (thread_exited_) {
+        return nullptr;
+    }
+    ThreadBlock* block = new ThreadBlock();
+    {
+        Metrics& metrics = global();
+        std::lock_guard<std::mutex> lock(metrics.mutex_);
+        metrics.threads_.push_back(block);
+    }
+    thread_block_ = block;
+    static thread_local ThreadExit retire_on_exit(block);
+    return block;
+}
+
+Metrics::Cells* Metrics::cells(uint32_t id) {
+    ThreadBlock* block = thread_block_;
+    if (!block) {
+        block = attachThread();
+        if (!block) {
+            return nullptr;
+        }
+    }
+    Cells* cells = block->cells[id].load(std::memory_order_relaxed);
+    if (!cells) {
+        cells = new Cells();
+        block->cells[id].store(cells, std::memory_order_release);
+    }
+    return cells;
+}
+
+void Metrics::Endpoint::message(size_t bytes) const {
+    if (id_ == INVALID_ID) {
+        return;
+    }
+    if (Cells* cells = Metrics::cells(id_)) {
+        bump(cells->messages, 1);
+        bump(cells->bytes, bytes);
+    }
+}
+
+void Metrics::Endpoint::latency(std::chrono::nanoseconds latency) const {
+    if (id_ == INVALID_ID) {
+        return;
+    }
+    if (Cells* cells = Metrics::cells(id_)) {
+        const uint64_t value = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+        bump(cells->buckets[LatencyHistogram::bucketIndex(value)], 1);
+        bump(cells->latency_sum, value);
+        if (value > cells->latency_max.load(std::memory_order_relaxed)) {
+            cells->latency_max.store(value, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Metrics::Endpoint::error() const {
+    if (id_ == INVALID_ID) {
+        return;
+    }
+    if (Cells* cells = Metrics::cells(id_)) {
+        bump(cells->errors, 1);
+    }
+}
+
+void Metrics::Endpoint::drop() const {
+    if (id_ == INVALID_ID) {
+        return;
+    }
+    if (Cells* cells = Metrics::cells(id_)) {
+        bump(cells->drops, 1);
+    }
+}
+
+Metrics::Endpoint Metrics::endpoint(Kind kind, const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto key = std::make_pair(kind, name);
+    auto it = ids_.find(key);
+    if (it != ids_.end()) {
+        return Endpoint(it->second);
+    }
+    if (endpoints_.size() >= MAX_ENDPOINTS) {
+        COMMS_LOG_ERROR("Metrics: More than {} endpoints; not recording {} {}", MAX_ENDPOINTS, kindName(kind), name);
+        return Endpoint();
+    }
+    const uint32_t id = static_cast<uint32_t>(endpoints_.size());
+    ids_.emplace(key, id);
+    endpoints_.push_back(key);
+    return Endpoint(id);
+}
+
+void Metrics::retire(ThreadBlock* block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t id = 0; id < MAX_ENDPOINTS; ++id) {
+        const Cells* cells = block->cells[id].load(std::memory_order_acquire);
+        if (!cells) {
+            continue;
+        }
+        Cells* retired = retired_.cells[id].load(std::memory_order_relaxed);
+        if (!retired) {
+            retired = new Cells();
+            retired_.cells[id].store(retired, std::memory_order_release);
+        }
+        bump(retired->messages, cells->messages.load(std::memory_order_relaxed));
+        bump(retired->bytes, cells->bytes.load(std::memory_order_relaxed));
+        bump(retired->errors, cells->errors.load(std::memory_order_relaxed));
+        bump(retired->drops, cells->drops.load(std::memory_order_relaxed));
+        bump(retired->latency_sum, cells->latency_sum.load(std::memory_order_relaxed));
+        const uint64_t max = cells->latency_max.load(std::memory_order_relaxed);
+        if (max > retired->latency_max.load(std::memory_order_relaxed)) {
+            retired->latency_max.store(max, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+            bump(retired->buckets[i], cells->buckets[i].load(std::memory_order_relaxed));
+        }
+    }
+    threads_.erase(std::remove(threads_.begin(), threads_.end(), block), threads_.end());
+    delete block;
+}
+
+void Metrics::addCells(EndpointStats& stats, const Cells& cells) {
+    stats.messages += cells.messages.load(std::memory_order_relaxed);
+    stats.bytes += cells.bytes.load(std::memory_order_relaxed);
+    stats.errors += cells.errors.load(std::memory_order_relaxed);
+    stats.drops += cells.drops.load(std::memory_order_relaxed);
+    LatencyHistogram& latency = stats.latency;
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+        const uint64_t count = cells.buckets[i].load(std::memory_order_relaxed);
+        latency.buckets_[i] += count;
+        latency.count_ += count;
+    }
+    latency.sum_ += cells.latency_sum.load(std::memory_order_relaxed);
+    latency.max_ = std::max(latency.max_, cells.latency_max.load(std::memory_order_relaxed));
+}
+
+std::vector<Metrics::EndpointStats> Metrics::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<EndpointStats> result(endpoints_.size());
+    for (size_t id = 0; id < endpoints_.size(); ++id) {
+        EndpointStats& stats = result[id];
+        stats.kind = endpoints_[id].first;
+        stats.name = endpoints_[id].second;
+        if (const Cells* cells = retired_.cells[id].load(std::memory_order_acquire)) {
+            addCells(stats, *cells);
+        }
+        for (const ThreadBlock* block : threads_) {
+            if (const Cells* cells = block->cells[id].load(std::memory_order_acquire)) {
+                addCells(stats, *cells);
+            }
+        }
+    }
+    return result;
+}
+
+void Metrics::print(std::ostream& out) const {
+    const auto flags = out.flags();
+    out << std::left << std::setw(12) << "kind" << std::setw(24) << "name" << std::right << std::setw(12)
+        << "messages" << std::setw(14) << "bytes" << std::setw(9) << "errors" << std::setw(9) << "drops"
+        << std::setw(11) << "p50 (us)" << std::setw(11) << "p99 (us)" << std::setw(11) << "max (us)" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (const EndpointStats& stats : snapshot()) {
+        if (stats.messages == 0 && stats.errors == 0 && stats.drops == 0 && stats.latency.count() == 0) {
+            continue;
+        }
+        out << std::left << std::setw(12) << kindName(stats.kind) << std::setw(24) << stats.name << std::right
+            << std::setw(12) << stats.messages << std::setw(14) << stats.bytes << std::setw(9) << stats.errors
+            << std::setw(9) << stats.drops << std::setw(11) << stats.latency.percentile(50) / 1000.0
+            << std::setw(11) << stats.latency.percentile(99) / 1000.0 << std::setw(11)
+            << stats.latency.max() / 1000.0 << std::endl;
+    }
+    out.flags(flags);
+}
+
+const char* Metrics::kindName(Kind kind) {
+    switch (kind) {
+        case Kind::Publisher: return "publisher";
+        case Kind::Subscriber: return "subscriber";
+        case Kind::RpcClient: return "rpc client";
+        case Kind::RpcServer: return "rpc server";
+    }
+    return "?";
+}
+
+} // namespace comms_stack
@@ -0,0 +1,147 @@
+#include "payload_codec.h"
+#include "fixed_layout.h"
+#include "someip_serializer.h"
+#include <google/protobuf/message.h>
+#include <typeinfo>
+
+namespace comms_stack {
+
+namespace {
+
+// FixedLayout<T> behind function pointers, looked up by dynamic type (cheaper than
+// GetDescriptor(), which goes through the reflection metadata).
+struct FixedLayoutOps {
+    const std::type_info* type;
+    size_t (*size)(const google::protobuf::Message&);
+    bool (*encode)(const google::protobuf::Message&, uint8_t*);
+    bool (*decode)(const uint8_t*, size_t, google::protobuf::Message&);
+};
+
+template<typename T>
+FixedLayoutOps makeOps() {
+    // The type has been compared already, so the casts cannot go wrong.
+    return {&typeid(T),
+            [](const google::protobuf::Message& message) {
+                return FixedLayout<T>::size(static_cast<const T&>(message));
+            },
+            [](const google::protobuf::Message& message, uint8_t* out) {
+                return FixedLayout<T>::encode(static_cast<const T&>(message), out);
+            },
+            [](const uint8_t* data, size_t length, google::protobuf::Message& message) {
+                return FixedLayout<T>::decode(data, length, static_cast<T&>(message));
+            }};
+}
+
+// Null if the type has no layout.
+const FixedLayoutOps* fixedLayoutOps(const google::protobuf::Message& message) {
+    static const FixedLayoutOps ops[] = {
+        makeOps<protos::SimpleNotification>(),
+        makeOps<protos::AddRequest>(),
+        makeOps<protos::AddResponse>(),
+    };
+    const std::type_info& type = typeid(message);
+    for (const FixedLayoutOps& entry : ops) {
+        if (*entry.type == type) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+const char* codecName(Codec codec) {
+    switch (codec) {
+        case Codec::Protobuf: return "protobuf";
+        case Codec::FixedLayout: return "fixed";
+        case Codec::SomeIp: return "someip";
+    }
+    return "unknown";
+}
+
+bool parseCodec(const std::string& name, Codec& codec) {
+    if (name == "protobuf") {
+        codec = Codec::Protobuf;
+    } else if (name == "fixed") {
+        codec = Codec::FixedLayout;
+    } else if (name == "someip") {
+        codec = Codec::SomeIp;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void PayloadCodec::prepare(const google::protobuf::Descriptor* descriptor) const {
+    if (codec_ == Codec::SomeIp) {
+        SomeIpSerializer::forType(descriptor);
+    }
+}
+
+bool PayloadCodec::isFixedLayout(const google::protobuf::Message& message) const {
+    return codec_ == Codec::FixedLayout && fixedLayoutOps(message);
+}
+
+bool PayloadCodec::isSomeIp(const google::protobuf::Message& message) const {
+    return codec_ == Codec::SomeIp && SomeIpSerializer::forMessage(message);
+}
+
+size_t PayloadCodec::byteSize(const google::protobuf::Message& message) const {
+    if (codec_ == Codec::FixedLayout) {
+        if (const FixedLayoutOps* ops = fixedLayoutOps(message)) {
+            return ops->size(message);
+        }
+    } else if (codec_ == Codec::SomeIp) {
+        if (const SomeIpSerializer* serializer = SomeIpSerializer::forMessage(message)) {
+            return serializer->byteSize(message, someip_);
+        }
+    }
+    return message.ByteSizeLong();
+}
+
+bool PayloadCodec::encode(const google::protobuf::Message& message, uint8_t* out, size_t size) const {
+    if (codec_ == Codec::FixedLayout) {
+        if (const FixedLayoutOps* ops = fixedLayoutOps(message)) {
+            return ops->encode(message, out);
+        }
+    } else if (codec_ == Codec::SomeIp) {
+        if (const SomeIpSerializer* serializer = SomeIpSerializer::forMessage(message)) {
+            return serializer->encode(message, someip_, out, size);
+        }
+    }
+    return message.SerializeToArray(out, static_cast<int>(size));
+}
+
+bool PayloadCodec::encodeToString(const google::protobuf::Message& message, std::string& out) const {
+    const size_t size = byteSize(message);
+    out.resize(size);
+    return encode(message, reinterpret_cast<uint8_t*>(&out[0]), size);
+}
+
+bool PayloadCodec::decode(const uint8_t* data, size_t length, google::protobuf::Message& message) const {
+    if (codec_ == Codec::FixedLayout) {
+        if (const FixedLayoutOps* ops = fixedLayoutOps(message)) {
+            return ops->decode(data, length, message);
+        }
+    } else if (codec_ == Codec::SomeIp) {
+        if (const SomeIpSerializer* serializer = SomeIpSerializer::forMessage(message)) {
+            return serializer->decode(data, length, someip_, message);
+        }
+    }
+    return message.ParseFromArray(data, static_cast<int>(length));
+}
+
+size_t PayloadCodec::encodedSize(const google::protobuf::Message& message) const {
+    if (codec_ == Codec::FixedLayout) {
+        if (const FixedLayoutOps* ops = fixedLayoutOps(message)) {
+            return ops->size(message);
+        }
+    } else if (codec_ == Codec::SomeIp) {
+        if (const SomeIpSerializer* serializer = SomeIpSerializer::forMessage(message)) {
+            return serializer->byteSize(message, someip_);
+        }
+    }
+    return static_cast<size_t>(message.GetCachedSize());
+}
+
+} // namespace comms_stack
@@ -1,80 +1,88 @@
 #include "publisher.h"
+#include "local_bus.h"
+#include "shm_ring.h"
+#include "topic_registry.h"
+#include "transport.h"
+#include "udp_batch.h"
 #include "common_messages.pb.h" // For specific publish method, and GetTypeName()
+#include "logging.h"
 #include <vsomeip/vsomeip.hpp>
 #include <google/protobuf/message.h>
-#include <iostream>
+#include <algorithm>
 #include <vector> // For payload data
 #include <set> // For eventgroup set in offer_event
 
 namespace comms_stack {
 
 Publisher::Publisher(const std::string& topic_name,
-                     std::shared_ptr<vsomeip::application> app,
+                     std::shared_ptr<Transport> transport,
                      uint16_t service_id,
                      uint16_t instance_id,
-                     uint16_t eventgroup_id_or_event_id,
-                     bool is_eventgroup)
+                     uint16_t event_id,
+                     uint16_t eventgroup_id,
+                     std::shared_ptr<LocalBus> local_bus,
+                     bool reliable)
     : topic_name_(topic_name),
-      vsomeip_app_(app),
+      transport_(std::move(transport)),
       service_id_(service_id),
       instance_id_(instance_id),
-      event_id_or_group_(eventgroup_id_or_event_id),
-      is_eventgroup_(is_eventgroup),
-      is_offered_(false) {
-    if (!vsomeip_app_) {
-        std::cerr << "Publisher (" << topic_name_ << "): vsomeip application is null!" << std::endl;
+      event_id_(event_id),
+      eventgroup_id_(eventgroup_id),
+      reliable_(reliable),
+      is_offered_(false),
+      local_bus_(std::move(local_bus)),
+      local_topic_(local_bus_ ? local_bus_->topic(service_id_, event_id_) : nullptr),
+      metrics_(Metrics::global().endpoint(Metrics::Kind::Publisher, topic_name)) {
+    if (local_bus_) {
+        local_bus_->addPublisher(service_id_, instance_id_, event_id_);
+    }
+    if (!transport_) {
+        COMMS_LOG_ERROR("Publisher ({}): Transport is null!", topic_name_);
         return;
     }
-    std::cout << "Publisher: Created for topic: " << topic_name_
-              << " (Service: 0x" << std::hex << service_id_
-              << ", Instance: 0x" << instance_id_
-              << (is_eventgroup_ ? ", Eventgroup: 0x" : ", Event: 0x") << event_id_or_group_
-              << std::dec << ")" << std::endl;
+    COMMS_LOG_INFO("Publisher: Created for topic: {} (Service: 0x{:x}, Instance: 0x{:x}, Event: 0x{:x}, Eventgroup: 0x{:x})",
+                   topic_name_, service_id_, instance_id_, event_id_, eventgroup_id_);
     offer(); // Call offer helper
 }
 
 Publisher::~Publisher() {
-    std::cout << "Publisher: Destroyed for topic: " << topic_name_ << std::endl;
-    if (is_offered_ && vsomeip_app_) {
-        // For event groups, and also for specific events that were offered.
-        vsomeip_app_->stop_offer_event(service_id_, instance_id_, event_id_or_group_);
-        std::cout << "Publisher (" << topic_name_ << "): Stopped offering "
-                  << (is_eventgroup_ ? "eventgroup 0x" : "event 0x")
-                  << std::hex << event_id_or_group_ << std::dec << std::endl;
+    COMMS_LOG_INFO("Publisher: Destroyed for topic: {}", topic_name_);
+    if (local_bus_) {
+        local_bus_->removePublisher(service_id_, instance_id_, event_id_);
+    }
+    if (is_offered_ && transport_) {
+        transport_->stopOfferEvent(service_id_, instance_id_, event_id_);
+        COMMS_LOG_INFO("Publisher ({}): Stopped offering event 0x{:x}", topic_name_, event_id_);
         is_offered_ = false;
     }
 }
 
 void Publisher::offer() {
-    if (!vsomeip_app_) {
-        std::cerr << "Publisher (" << topic_name_ << "): Cannot offer, vsomeip application is null." << std::endl;
+    if (!transport_) {
+        COMMS_LOG_ERROR("Publisher ({}): Cannot offer, transport is null.", topic_name_);
         return;
     }
     if (is_offered_) {
-        std::cout << "Publisher (" << topic_name_ << "): Already offered." << std::endl;
+        COMMS_LOG_INFO("Publisher ({}): Already offered.", topic_name_);
         return;
     }
 
+    // An event that is not in an eventgroup is offered without one.
     std::set<vsomeip::eventgroup_t> event_groups;
-    if(is_eventgroup_) {
-        event_groups.insert(event_id_or_group_);
+    if (eventgroup_id_ != 0) {
+        event_groups.insert(eventgroup_id_);
     }
-    // If it's a specific event not part of a group, the set can be empty or contain 0,
-    // depending on vsomeip interpretation or specific needs.
-    // For simplicity, if it's not an eventgroup, we offer the event without specifying a group in the set.
-    // The event_id_or_group_ is the event_id in this case.
 
-    vsomeip_app_->offer_event(
+    transport_->offerEvent(
         service_id_,
         instance_id_,
-        event_id_or_group_,
+        event_id_,
         event_groups,
-        vsomeip::event_type_e::ET_EVENT);
+        reliable_);
 
     is_offered_ = true;
-    std::cout << "Publisher (" << topic_name_ << "): Offered "
-              << (is_eventgroup_ ? "eventgroup 0x" : "event 0x") << std::hex << event_id_or_group_
-              << std::dec << " for Service 0x" << std::hex << service_id_ << std::dec << std::endl;
+    COMMS_LOG_INFO("Publisher ({}): Offered event 0x{:x} in eventgroup 0x{:x} for Service 0x{:x}",
+                   topic_name_, event_id_, eventgroup_id_, service_id_);
 }
 
 
@@ -83,52 +91,253 @@ bool Publisher::publish(const protos::SimpleNotification& message) {
 }
 
 bool Publisher::publishGeneric(const google::protobuf::Message& message) {
-    if (!vsomeip_app_) {
-        std::cerr << "Publisher (" << topic_name_ << "): Cannot publish, vsomeip application is null." << std::endl;
+    const auto started = std::chrono::steady_clock::now();
+    TraceEnvelope trace_envelope;
+    const TraceEnvelope* trace = beginTrace(trace_envelope);
+    MessageEnvelope envelope;
+    const Headers headers = {beginEnvelope(message, trace, envelope), trace};
+    if (local_topic_ && local_topic_->hasSubscribers(instance_id_)) {
+        // Subscribers may keep the message beyond this call, so they get their own copy.
+        std::shared_ptr<google::protobuf::Message> copy(message.New());
+        copy->CopyFrom(message);
+        local_topic_->publish(instance_id_, copy);
+    }
+    return recordPublish(sendRemote(message, headers), message, started, trace);
+}
+
+bool Publisher::publishShared(std::shared_ptr<const google::protobuf::Message> message) {
+    if (!message) {
+        COMMS_LOG_ERROR("Publisher ({}): Cannot publish a null message.", topic_name_);
+        metrics_.error();
+        return false;
+    }
+    const auto started = std::chrono::steady_clock::now();
+    TraceEnvelope trace_envelope;
+    const TraceEnvelope* trace = beginTrace(trace_envelope);
+    MessageEnvelope envelope;
+    const Headers headers = {beginEnvelope(*message, trace, envelope), trace};
+    if (local_topic_) {
+        local_topic_->publish(instance_id_, message);
+    }
+    return recordPublish(sendRemote(*message, headers), *message, started, trace);
+}
+
+bool Publisher::recordPublish(bool sent, const google::protobuf::Message& message,
+                              std::chrono::steady_clock::time_point started, const TraceEnvelope* trace) {
+    if (sent) {
+        metrics_.message(codec_.encodedSize(message)); // Every remote path encoded it
+        metrics_.latency(std::chrono::steady_clock::now() - started);
+    } else {
+        metrics_.error();
+    }
+    traceSpan(trace, TraceStage::Publish, trace ? trace->origin_ns : 0);
+    return sent;
+}
+
+void Publisher::enableTracing() {
+    if (codec_.codec() == Codec::SomeIp) {
+        COMMS_LOG_WARN("Publisher ({}): SOME/IP payloads cannot carry a trace envelope; not tracing.", topic_name_);
+        return;
+    }
+    trace_topic_ = Tracer::global().topic(topic_name_);
+    trace_ = true;
+    COMMS_LOG_INFO("Publisher ({}): Tracing enabled.", topic_name_);
+}
+
+void Publisher::enableEnvelope(const EnvelopeConfig& config) {
+    if (codec_.codec() == Codec::SomeIp) {
+        COMMS_LOG_WARN("Publisher ({}): SOME/IP payloads cannot carry a message envelope; not enabled.", topic_name_);
+        return;
+    }
+    envelope_ = config;
+    envelope_.enabled = true;
+    COMMS_LOG_INFO("Publisher ({}): Message envelope enabled (schema version {}{}).",
+                   topic_name_, envelope_.schema_version, envelope_.timestamp ? ", timestamped" : "");
+}
+
+void Publisher::setCodec(const PayloadCodec& codec) {
+    codec_ = codec;
+    if (trace_ && codec_.codec() == Codec::SomeIp) {
+        COMMS_LOG_WARN("Publisher ({}): SOME/IP payloads cannot carry a trace envelope; tracing disabled.", topic_name_);
+        trace_ = false;
+    }
+    if (envelope_.enabled && codec_.codec() == Codec::SomeIp) {
+        COMMS_LOG_WARN("Publisher ({}): SOME/IP payloads cannot carry a message envelope; envelope disabled.", topic_name_);
+        envelope_.enabled = false;
+    }
+    COMMS_LOG_INFO("Publisher ({}): Codec {}", topic_name_, codecName(codec_.codec()));
+}
+
+const TraceEnvelope* Publisher::beginTrace(TraceEnvelope& envelope) const {
+    if (!trace_) {
+        return nullptr;
+    }
+    envelope.trace_id = Tracer::global().nextTraceId();
+    envelope.origin_ns = Tracer::now();
+    return &envelope;
+}
+
+const MessageEnvelope* Publisher::beginEnvelope(const google::protobuf::Message& message, const TraceEnvelope* trace,
+                                                MessageEnvelope& envelope) {
+    if (!envelope_.enabled) {
+        return nullptr;
+    }
+    envelope.type_hash = MessageTypes::hashOf(message);
+    envelope.schema_version = envelope_.schema_version;
+    envelope.sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+    if (envelope_.timestamp) {
+        envelope.flags |= MessageEnvelope::TIMESTAMP;
+        envelope.timestamp_ns = MessageEnvelope::now();
+    }
+    if (trace) {
+        envelope.flags |= MessageEnvelope::TRACED;
+    }
+    return &envelope;
+}
+
+void Publisher::Headers::write(uint8_t* out) const {
+    if (envelope) {
+        envelope->write(out);
+        out += MessageEnvelope::SIZE;
+    }
+    if (trace) {
+        trace->write(out);
+    }
+}
+
+void Publisher::traceSpan(const TraceEnvelope* trace, TraceStage stage, uint64_t start_ns) const {
+    if (trace) {
+        Tracer::global().record(trace->trace_id, trace_topic_, stage, start_ns, Tracer::now());
+    }
+}
+
+bool Publisher::enableSharedMemory(const SharedMemoryConfig& config) {
+    const std::string path = shmRingPath(config.directory, service_id_, instance_id_, event_id_);
+    std::unique_ptr<ShmRingWriter> writer(new ShmRingWriter());
+    if (!writer->create(path, config.slots, config.slot_size)) {
+        COMMS_LOG_WARN("Publisher ({}): Shared memory unavailable, publishing over vsomeip only.", topic_name_);
+        return false;
+    }
+    shm_writer_ = std::move(writer);
+    shm_wire_ = config.wire;
+    COMMS_LOG_INFO("Publisher ({}): Shared-memory ring {} ({} x {} bytes)",
+                   topic_name_, path, config.slots, config.slot_size);
+    return true;
+}
+
+bool Publisher::enableBatchedUdp(const BatchedUdpConfig& config) {
+    std::unique_ptr<UdpBatchSender> sender(new UdpBatchSender());
+    if (!sender->open(config)) {
+        COMMS_LOG_WARN("Publisher ({}): Batched UDP unavailable, publishing over vsomeip only.", topic_name_);
+        return false;
+    }
+    udp_sender_ = std::move(sender);
+    udp_wire_ = config.wire;
+    COMMS_LOG_INFO("Publisher ({}): Batched UDP to {}:{} (batch {}, linger {} us)",
+                   topic_name_, config.address, config.port, config.batch, config.linger_us);
+    return true;
+}
+
+bool Publisher::sendRemote(const google::protobuf::Message& message, const Headers& headers) {
+    bool wire = true;
+    if (shm_writer_) {
+        // Messages too large for a slot go through vsomeip, where same-host subscribers take them.
+        wire = writeToRing(message, headers) ? shm_wire_ : true;
+    }
+    if (udp_sender_) {
+        // Messages too large for a datagram go through vsomeip, which segments them.
+        wire = sendBatched(message, headers) ? (wire && udp_wire_) : true;
+    }
+    return wire ? sendEvent(message, headers) : true;
+}
+
+bool Publisher::sendBatched(const google::protobuf::Message& message, const Headers& headers) {
+    const TraceEnvelope* trace = headers.trace;
+    const uint64_t send_start = trace ? Tracer::now() : 0;
+    const size_t header = headers.size();
+    const size_t size = codec_.byteSize(message);
+    if (header + size > udp_sender_->maxPayload()) {
+        return false;
+    }
+    // Serialized straight into the batch buffer, behind the SOME/IP header.
+    bool sent = udp_sender_->send(service_id_, event_id_, header + size, [&](uint8_t* payload) {
+        const uint64_t serialize_start = trace ? Tracer::now() : 0;
+        headers.write(payload);
+        bool serialized = codec_.encode(message, payload + header, size);
+        traceSpan(trace, TraceStage::Serialize, serialize_start);
+        return serialized;
+    });
+    traceSpan(trace, TraceStage::Send, send_start);
+    return sent;
+}
+
+bool Publisher::writeToRing(const google::protobuf::Message& message, const Headers& headers) {
+    const TraceEnvelope* trace = headers.trace;
+    const uint64_t send_start = trace ? Tracer::now() : 0;
+    const size_t header = headers.size();
+    const size_t size = codec_.byteSize(message);
+    if (header + size > shm_writer_->slotSize()) {
+        COMMS_LOG_DEBUG("Publisher ({}): {} ({} bytes) exceeds the {}-byte slots; sending over vsomeip.",
+                        topic_name_, message.GetTypeName(), header + size, shm_writer_->slotSize());
+        return false;
+    }
+    // Serialized straight into the slot; readers parse it from there.
+    bool written = shm_writer_->write(header + size, [&](uint8_t* slot) {
+        const uint64_t serialize_start = trace ? Tracer::now() : 0;
+        headers.write(slot);
+        bool serialized = codec_.encode(message, slot + header, size);
+        traceSpan(trace, TraceStage::Serialize, serialize_start);
+        return serialized;
+    });
+    traceSpan(trace, TraceStage::Send, send_start);
+    if (!written) {
+        COMMS_LOG_ERROR("Publisher ({}): Failed to write {} to shared memory.", topic_name_, message.GetTypeName());
+    }
+    return written;
+}
+
+bool Publisher::sendEvent(const google::protobuf::Message& message, const Headers& headers) {
+    const TraceEnvelope* trace = headers.trace;
+    if (!transport_) {
+        COMMS_LOG_ERROR("Publisher ({}): Cannot publish, transport is null.", topic_name_);
         return false;
     }
     if (!is_offered_) {
-        std::cout << "Publisher (" << topic_name_ << "): Event/group not offered. Attempting to offer now." << std::endl;
+        COMMS_LOG_INFO("Publisher ({}): Event/group not offered. Attempting to offer now.", topic_name_);
         offer();
         if(!is_offered_){
-            std::cerr << "Publisher (" << topic_name_ << "): Failed to offer event/group, cannot publish." << std::endl;
+            COMMS_LOG_ERROR("Publisher ({}): Failed to offer event/group, cannot publish.", topic_name_);
             return false;
         }
     }
 
-    std::string serialized_data;
-    if (!message.SerializeToString(&serialized_data)) {
-        std::cerr << "Publisher (" << topic_name_ << "): Failed to serialize " << message.GetTypeName() << std::endl;
+    const uint64_t serialize_start = trace ? Tracer::now() : 0;
+    // Serialized straight into the payload buffer, behind the envelopes if any.
+    const size_t header = headers.size();
+    const size_t size = codec_.byteSize(message);
+    std::vector<vsomeip::byte_t> payload_data(header + size);
+    if (!codec_.encode(message, payload_data.data() + header, size)) {
+        COMMS_LOG_ERROR("Publisher ({}): Failed to serialize {}", topic_name_, message.GetTypeName());
         return false;
     }
+    headers.write(payload_data.data());
+    traceSpan(trace, TraceStage::Serialize, serialize_start);
+    const uint64_t send_start = trace ? Tracer::now() : 0;
 
     std::shared_ptr<vsomeip::payload> payload = vsomeip::runtime::get()->create_payload();
-    // Use a std::vector<vsomeip::byte_t> for payload to ensure lifetime if needed, though for set_data it copies.
-    std::vector<vsomeip::byte_t> payload_data(serialized_data.begin(), serialized_data.end());
-    payload->set_data(payload_data);
-
-
-    if (is_eventgroup_) {
-         vsomeip_app_->fire_event(
-            service_id_,
-            instance_id_,
-            event_id_or_group_, // This is the eventgroup ID
-            payload,
-            vsomeip::reliable_e::UNRELIABLE); // Or vsomeip::reliable_e::RELIABLE based on topic config
-    } else {
-        vsomeip_app_->notify(
-            service_id_,
-            instance_id_,
-            event_id_or_group_, // This is the specific event ID
-            payload,
-            vsomeip::reliable_e::UNRELIABLE); // Or vsomeip::reliable_e::RELIABLE
-    }
+    payload->set_data(std::move(payload_data));
+
+
+    transport_->notify(
+        service_id_,
+        instance_id_,
+        event_id_,
+        payload);
+    traceSpan(trace, TraceStage::Send, send_start);
 
 
-    std::cout << "Publisher (" << topic_name_ << "): Published " << message.GetTypeName()
-              << " (size: " << serialized_data.length() << " bytes) to "
-              << (is_eventgroup_ ? "eventgroup 0x" : "event 0x") << std::hex << event_id_or_group_
-              << std::dec << std::endl;
+    COMMS_LOG_DEBUG("Publisher ({}): Published {} (size: {} bytes) to event 0x{:x}",
+                    topic_name_, message.GetTypeName(), size, event_id_);
     return true;
 }
 
@@ -0,0 +1,309 @@
+#include "response_demultiplexer.h"
+#include "rpc_client.h"
+#include "rpc_stream.h"
+#include "transport.h"
+#include "logging.h"
+#include <vsomeip/vsomeip.hpp>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <thread>
+
+namespace comms_stack {
+
+constexpr std::chrono::milliseconds ResponseDemultiplexer::PARKED_RESPONSE_TTL;
+
+namespace {
+std::mutex g_registry_mutex;
+std::map<const Transport*, std::weak_ptr<ResponseDemultiplexer>> g_registry;
+
+// Clients being delivered to on the current thread; detach() called from inside a response
+// callback must not wait for its own delivery to finish.
+thread_local std::vector<const RpcClient*> t_deliveries;
+
+// Counts a delivery to `client`, which the caller picked up under the lock detach() takes to
+// clear its routes, and lets detach() wait for it.
+class DeliveryScope {
+public:
+    DeliveryScope(const RpcClient* client, std::atomic<uint32_t>& deliveries) : deliveries_(deliveries) {
+        t_deliveries.push_back(client);
+    }
+    ~DeliveryScope() {
+        t_deliveries.pop_back();
+        deliveries_.fetch_sub(1, std::memory_order_acq_rel); // Last access: the client may go now
+    }
+
+private:
+    std::atomic<uint32_t>& deliveries_;
+};
+}
+
+ResponseDemultiplexer::ClientState& ResponseDemultiplexer::stateOf(RpcClient* client) {
+    return client->demux_state_;
+}
+
+std::shared_ptr<ResponseDemultiplexer> ResponseDemultiplexer::forTransport(const std::shared_ptr<Transport>& transport) {
+    if (!transport) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    auto it = g_registry.find(transport.get());
+    if (it != g_registry.end()) {
+        if (auto existing = it->second.lock()) {
+            return existing;
+        }
+    }
+    std::shared_ptr<ResponseDemultiplexer> demux(new ResponseDemultiplexer(transport));
+    g_registry[transport.get()] = demux;
+
+    ResponseDemultiplexer* raw = demux.get();
+    transport->registerMessageHandler(
+        vsomeip::ANY_SERVICE, vsomeip::ANY_INSTANCE, vsomeip::ANY_METHOD,
+        [raw](const std::shared_ptr<vsomeip::message>& msg) { raw->onMessage(msg); });
+    COMMS_LOG_INFO("ResponseDemultiplexer: Registered response handler for client 0x{:x}", raw->client_id_);
+    return demux;
+}
+
+ResponseDemultiplexer::ResponseDemultiplexer(const std::shared_ptr<Transport>& transport)
+    : transport_(transport),
+      client_id_(transport->getClientId()),
+      slots_(new Slot[SESSION_COUNT]) {
+}
+
+ResponseDemultiplexer::~ResponseDemultiplexer() {
+    if (auto transport = transport_.lock()) {
+        transport->unregisterMessageHandler(vsomeip::ANY_SERVICE, vsomeip::ANY_INSTANCE, vsomeip::ANY_METHOD);
+        for (const auto& entry : stream_subscriptions_) {
+            transport->unsubscribe(entry.first.first, entry.first.second, STREAM_EVENTGROUP_ID);
+            transport->releaseEvent(entry.first.first, entry.first.second, STREAM_EVENT_ID);
+            transport->unregisterSubscriptionStatusHandler(entry.first.first, entry.first.second,
+                                                           STREAM_EVENTGROUP_ID, STREAM_EVENT_ID);
+        }
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        auto it = g_registry.find(transport.get());
+        if (it != g_registry.end() && it->second.expired()) {
+            g_registry.erase(it);
+        }
+    } else {
+        // Transport already gone; drop any expired registry entries.
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        for (auto it = g_registry.begin(); it != g_registry.end();) {
+            it = it->second.expired() ? g_registry.erase(it) : std::next(it);
+        }
+    }
+}
+
+std::shared_ptr<vsomeip::message> ResponseDemultiplexer::bind(vsomeip::session_t session, vsomeip::service_t service,
+                                                              RpcClient* client) {
+    Stripe& stripe = stripeFor(session);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+
+    auto parked_it = stripe.parked.find(session);
+    if (parked_it != stripe.parked.end()) {
+        Parked parked = std::move(parked_it->second);
+        stripe.parked.erase(parked_it);
+        if (parked.msg->get_service() == service &&
+            std::chrono::steady_clock::now() - parked.parked_at < PARKED_RESPONSE_TTL) {
+            return parked.msg; // Response overtook the bind; caller delivers it
+        }
+    }
+    Slot& slot = slots_[session];
+    slot.owner = client;
+    slot.service = service;
+    ClientState& state = stateOf(client);
+    std::lock_guard<std::mutex> state_lock(state.mutex);
+    state.sessions.insert(session);
+    return nullptr;
+}
+
+void ResponseDemultiplexer::unbind(vsomeip::session_t session, RpcClient* client) {
+    Stripe& stripe = stripeFor(session);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    Slot& slot = slots_[session];
+    if (slot.owner == client) {
+        slot.owner = nullptr;
+        ClientState& state = stateOf(client);
+        std::lock_guard<std::mutex> state_lock(state.mutex);
+        state.sessions.erase(session);
+    }
+}
+
+void ResponseDemultiplexer::bindStream(vsomeip::session_t session, vsomeip::service_t service, RpcClient* client) {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    stream_routes_[session] = Slot{client, service};
+}
+
+void ResponseDemultiplexer::unbindStream(vsomeip::session_t session, RpcClient* client) {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    auto it = stream_routes_.find(session);
+    if (it != stream_routes_.end() && it->second.owner == client) {
+        stream_routes_.erase(it);
+    }
+}
+
+void ResponseDemultiplexer::whenStreamEventReady(vsomeip::service_t service, vsomeip::instance_t instance,
+                                                 RpcClient* client, std::function<void()> on_ready) {
+    auto transport = transport_.lock();
+    if (!transport) {
+        return;
+    }
+    bool first_request = false;
+    bool ready_now = false;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        auto key = std::make_pair(service, instance);
+        first_request = stream_subscriptions_.count(key) == 0;
+        StreamSubscription& subscription = stream_subscriptions_[key];
+        ready_now = subscription.acknowledged;
+        if (!ready_now) {
+            subscription.waiters.emplace_back(client, std::move(on_ready));
+        }
+    }
+    if (ready_now) {
+        on_ready(); // Already subscribed
+        return;
+    }
+    if (first_request) {
+        transport->registerSubscriptionStatusHandler(
+            service, instance, STREAM_EVENTGROUP_ID, STREAM_EVENT_ID,
+            [this](const vsomeip::service_t s, const vsomeip::instance_t i, const vsomeip::eventgroup_t,
+                   const vsomeip::event_t, const uint16_t error) {
+                onStreamSubscriptionStatus(s, i, error == 0);
+            });
+        std::set<vsomeip::eventgroup_t> event_groups{STREAM_EVENTGROUP_ID};
+        transport->requestEvent(service, instance, STREAM_EVENT_ID, event_groups);
+        transport->subscribe(service, instance, STREAM_EVENTGROUP_ID);
+    }
+}
+
+void ResponseDemultiplexer::onStreamSubscriptionStatus(vsomeip::service_t service, vsomeip::instance_t instance,
+                                                       bool acknowledged) {
+    std::vector<std::pair<RpcClient*, std::function<void()>>> ready;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        auto it = stream_subscriptions_.find(std::make_pair(service, instance));
+        if (it != stream_subscriptions_.end()) {
+            it->second.acknowledged = acknowledged;
+            if (acknowledged) {
+                ready.swap(it->second.waiters);
+            }
+        }
+        // Counted before the lock is released, so detach() cannot miss a callback into its client.
+        for (auto& waiter : ready) {
+            stateOf(waiter.first).deliveries.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+    if (!acknowledged) {
+        COMMS_LOG_ERROR("ResponseDemultiplexer: Stream event subscription to service 0x{:x}, instance 0x{:x} was not acknowledged.",
+                        service, instance);
+    }
+    for (auto& waiter : ready) {
+        DeliveryScope delivery(waiter.first, stateOf(waiter.first).deliveries);
+        waiter.second();
+    }
+}
+
+void ResponseDemultiplexer::detach(RpcClient* client) {
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        for (auto it = stream_routes_.begin(); it != stream_routes_.end();) {
+            it = it->second.owner == client ? stream_routes_.erase(it) : std::next(it);
+        }
+        for (auto& entry : stream_subscriptions_) {
+            auto& waiters = entry.second.waiters;
+            waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                         [client](const std::pair<RpcClient*, std::function<void()>>& w) {
+                                             return w.first == client;
+                                         }),
+                          waiters.end());
+        }
+    }
+    ClientState& state = stateOf(client);
+    std::unordered_set<vsomeip::session_t> sessions;
+    {
+        std::lock_guard<std::mutex> state_lock(state.mutex);
+        sessions.swap(state.sessions);
+    }
+    for (vsomeip::session_t session : sessions) {
+        Stripe& stripe = stripeFor(session);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        if (slots_[session].owner == client) {
+            slots_[session].owner = nullptr;
+        }
+    }
+    // A delivery that picked up `client` before its routes were cleared may still be running.
+    const uint32_t own = static_cast<uint32_t>(std::count(t_deliveries.begin(), t_deliveries.end(), client));
+    while (state.deliveries.load(std::memory_order_acquire) > own) {
+        std::this_thread::yield();
+    }
+}
+
+void ResponseDemultiplexer::onMessage(const std::shared_ptr<vsomeip::message>& msg) {
+    const vsomeip::message_type_e type = msg->get_message_type();
+    if (type == vsomeip::message_type_e::MT_NOTIFICATION) {
+        if (msg->get_method() == STREAM_EVENT_ID) {
+            onStreamFrame(msg);
+        }
+        return;
+    }
+    if ((type != vsomeip::message_type_e::MT_RESPONSE && type != vsomeip::message_type_e::MT_ERROR) ||
+        msg->get_client() != client_id_) {
+        return; // Not a response to one of our requests
+    }
+
+    const vsomeip::session_t session = msg->get_session();
+    RpcClient* owner = nullptr;
+    {
+        Stripe& stripe = stripeFor(session);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        Slot& slot = slots_[session];
+        if (slot.owner) {
+            if (slot.service == msg->get_service()) {
+                owner = slot.owner;
+                slot.owner = nullptr;
+                ClientState& state = stateOf(owner);
+                std::lock_guard<std::mutex> state_lock(state.mutex);
+                state.sessions.erase(session);
+                state.deliveries.fetch_add(1, std::memory_order_acq_rel);
+            }
+        } else {
+            const auto now = std::chrono::steady_clock::now();
+            if (stripe.parked.size() >= 16) {
+                // Late responses (e.g. to cancelled calls) are never bound; age them out.
+                for (auto it = stripe.parked.begin(); it != stripe.parked.end();) {
+                    it = (now - it->second.parked_at >= PARKED_RESPONSE_TTL) ? stripe.parked.erase(it) : std::next(it);
+                }
+            }
+            stripe.parked[session] = Parked{msg, now};
+        }
+    }
+    if (owner) {
+        DeliveryScope delivery(owner, stateOf(owner).deliveries);
+        owner->onMessageReceived(msg);
+    }
+}
+
+void ResponseDemultiplexer::onStreamFrame(const std::shared_ptr<vsomeip::message>& msg) {
+    auto payload = msg->get_payload();
+    StreamFrameHeader header;
+    if (!payload || !StreamFrameHeader::decode(payload->get_data(), payload->get_length(), header) ||
+        header.client != client_id_) {
+        return;
+    }
+
+    RpcClient* owner = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        auto it = stream_routes_.find(header.session);
+        if (it != stream_routes_.end() && it->second.service == msg->get_service()) {
+            owner = it->second.owner;
+            stateOf(owner).deliveries.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+    if (owner) {
+        DeliveryScope delivery(owner, stateOf(owner).deliveries);
+        owner->onStreamFrame(msg, header);
+    }
+}
+
+} // namespace comms_stack
@@ -1,127 +1,377 @@
 #include "rpc_client.h"
 #include "sample_rpc_service.pb.h" // For request/response types
+#include "rpc_controller.h" // For METHOD_ID_CANCEL
+#include "logging.h"
 #include <vsomeip/vsomeip.hpp>
-#include <iostream>
 #include <vector> // For payload data
 #include <stdexcept> // For std::runtime_error
+#include <algorithm> // For std::nth_element
+#include <random> // For instance selection
 
 // Placeholder Method IDs - these should come from configuration
 #define METHOD_ID_ECHO 0x0001
 #define METHOD_ID_ADD  0x0002
+#define METHOD_ID_COUNT 0x0003 // Server-streaming
 
 namespace comms_stack {
 
+struct RpcClient::RequestCopies {
+    std::mutex mutex;
+    bool closed = false;
+    std::vector<std::pair<vsomeip::instance_t, vsomeip::session_t>> sent;
+
+    bool add(vsomeip::instance_t instance, vsomeip::session_t session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed) {
+            return false;
+        }
+        sent.emplace_back(instance, session);
+        return true;
+    }
+    // Returns the copies sent so far; copies added afterwards are refused.
+    std::vector<std::pair<vsomeip::instance_t, vsomeip::session_t>> close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        return std::move(sent);
+    }
+    bool isClosed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return closed;
+    }
+};
+
+struct RpcClient::CancellableCall {
+    CancellationToken token;
+    std::atomic<CancellationToken::CallbackId> callback_id{0};
+    std::atomic<bool> done{false};           // Answered or cancelled
+    RpcClientCache::ResponseHandler handler; // The caller's own handler
+    std::shared_ptr<RequestCopies> copies;
+    bool has_cache_key = false;              // Leader of a client cache entry
+    RpcClientCache::Key cache_key{};
+};
+
 RpcClient::RpcClient(const std::string& service_name,
-                     std::shared_ptr<vsomeip::application> app,
+                     std::shared_ptr<Transport> transport,
                      uint16_t service_id,
                      uint16_t instance_id)
     : service_name_(service_name),
-      vsomeip_app_(app),
+      transport_(std::move(transport)),
       service_id_(service_id),
-      instance_id_(instance_id),
-      service_available_(false) {
+      instance_id_(instance_id) {
 
-    if (!vsomeip_app_) {
-        std::cerr << "RpcClient (" << service_name_ << "): vsomeip application is null!" << std::endl;
+    if (!transport_) {
+        COMMS_LOG_ERROR("RpcClient ({}): Transport is null!", service_name_);
         return;
     }
-    client_id_ = vsomeip_app_->get_client(); // Get the client ID assigned by vsomeip
+    client_id_ = transport_->getClientId(); // Get the client ID assigned by the transport
 
-    std::cout << "RpcClient: Created for service: " << service_name_
-              << " (Service ID: 0x" << std::hex << service_id_
-              << ", Instance ID: 0x" << instance_id_
-              << ", Client ID: 0x" << client_id_ << std::dec << ")" << std::endl;
+    COMMS_LOG_INFO("RpcClient: Created for service: {} (Service ID: 0x{:x}, Instance ID: 0x{:x}, Client ID: 0x{:x})",
+                   service_name_, service_id_, instance_id_, client_id_);
 
-    vsomeip_app_->register_availability_handler(
+    // All RPC responses arrive through the transport's shared demultiplexer, which hands
+    // each one to the client that bound its session in sendRequest().
+    demux_ = ResponseDemultiplexer::forTransport(transport_);
+
+    // Availability likewise, so every client of the service is told, not just the last one.
+    availability_router_ = AvailabilityRouter::forTransport(transport_);
+    availability_handler_id_ = availability_router_->add(
         service_id_, instance_id_,
         std::bind(&RpcClient::onAvailabilityChanged, this,
                   std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)
     );
 
-    // Register a general message handler for this client.
-    // All RPC responses will come through this handler.
-    // We differentiate them by session ID.
-    vsomeip_app_->register_message_handler(
-        vsomeip::ANY_SERVICE, vsomeip::ANY_INSTANCE, vsomeip::ANY_METHOD, // Or more specific if desired
-        std::bind(&RpcClient::onMessageReceived, this, std::placeholders::_1)
-    );
-    // It's often better to register for service_id_, ANY_INSTANCE, ANY_METHOD
-    // to only get messages related to the service this client is for.
-    // vsomeip_app_->register_message_handler(
-    //     service_id_, vsomeip::ANY_INSTANCE, vsomeip::ANY_METHOD,
-    //     std::bind(&RpcClient::onMessageReceived, this, std::placeholders::_1));
-
 
     // Requesting the service makes vsomeip try to find it.
     // Method calls will also trigger discovery if not found yet.
-    vsomeip_app_->request_service(service_id_, instance_id_);
+    transport_->requestService(service_id_, instance_id_);
 }
 
 RpcClient::~RpcClient() {
-    std::cout << "RpcClient: Destroyed for service: " << service_name_ << std::endl;
-    if (vsomeip_app_) {
-        vsomeip_app_->unregister_availability_handler(
-            service_id_, instance_id_,
-            std::bind(&RpcClient::onAvailabilityChanged, this,
-                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-
-        // Unregister the general message handler (if it was specific to this client's needs)
-        // If it was a truly global handler in CommunicationManager, it wouldn't be unregistered here.
-        // Assuming we registered one per RpcClient instance for its service_id:
-         vsomeip_app_->unregister_message_handler(
-            vsomeip::ANY_SERVICE, vsomeip::ANY_INSTANCE, vsomeip::ANY_METHOD, // Match registration
-            std::bind(&RpcClient::onMessageReceived, this, std::placeholders::_1));
-        // Or:
-        // vsomeip_app_->unregister_message_handler(
-        //    service_id_, vsomeip::ANY_INSTANCE, vsomeip::ANY_METHOD,
-        //    std::bind(&RpcClient::onMessageReceived, this, std::placeholders::_1));
-
-
-        vsomeip_app_->release_service(service_id_, instance_id_);
+    COMMS_LOG_INFO("RpcClient: Destroyed for service: {}", service_name_);
+    if (hedge_scheduler_) {
+        hedge_scheduler_->stop(); // No hedge may fire into a half-destroyed client
+    }
+    {
+        // Tokens may outlive us; their callbacks must not.
+        std::map<CancellableCall*, std::shared_ptr<CancellableCall>> calls;
+        {
+            std::lock_guard<std::mutex> lock(cancellable_calls_mutex_);
+            calls.swap(cancellable_calls_);
+        }
+        for (const auto& entry : calls) {
+            entry.second->token.removeCallback(entry.second->callback_id.load());
+        }
+    }
+    if (transport_) {
+        // Only our own handler; other clients of the service keep theirs.
+        availability_router_->remove(availability_handler_id_);
+
+        // Stop response delivery before our state goes away; the demultiplexer's handler
+        // stays registered for the other clients of this transport.
+        if (demux_) {
+            demux_->detach(this);
+        }
+        // Tell servers to stop producing for us and complete the stream handles.
+        finishStreams(vsomeip::ANY_INSTANCE, static_cast<int>(vsomeip::return_code_e::E_NOT_OK), "RpcClient destroyed");
+
+        transport_->releaseService(service_id_, instance_id_);
 
         // Cancel any pending promises
         std::lock_guard<std::mutex> lock(pending_requests_mutex_);
         for (auto const& [key, val] : pending_requests_) {
             // How to properly notify promise depends on what's stored in PromiseContext
             // For now, just log. A real implementation would set_exception.
-             std::cerr << "RpcClient (" << service_name_
-                       << "): Unfulfilled promise for client/session: 0x" << std::hex << key.first
-                       << "/0x" << key.second << std::dec << " on destruction." << std::endl;
+             COMMS_LOG_ERROR("RpcClient ({}): Unfulfilled promise for client/session: 0x{:x}/0x{:x} on destruction.",
+                             service_name_, key.first, key.second);
         }
         pending_requests_.clear();
+        pending_count_.store(0, std::memory_order_relaxed);
+        response_cache_.clear();
     }
 }
 
+Metrics::Endpoint RpcClient::methodMetrics(vsomeip::method_t method_id, const char* method_name) {
+    std::lock_guard<std::mutex> lock(method_metrics_mutex_);
+    auto it = method_metrics_.find(method_id);
+    if (it == method_metrics_.end()) {
+        it = method_metrics_.emplace(method_id, Metrics::global().endpoint(
+            Metrics::Kind::RpcClient, service_name_ + "." + method_name)).first;
+    }
+    return it->second;
+}
+
+void RpcClient::setMethodCodec(uint16_t method_id, const PayloadCodec& codec) {
+    method_codecs_[method_id] = codec;
+    COMMS_LOG_INFO("RpcClient ({}): Method 0x{:x} uses codec {}", service_name_, method_id, codecName(codec.codec()));
+}
+
+void RpcClient::enableEnvelope(const EnvelopeConfig& config) {
+    envelope_ = config;
+    envelope_.enabled = true;
+    COMMS_LOG_INFO("RpcClient ({}): Message envelope enabled (schema version {}).",
+                   service_name_, envelope_.schema_version);
+}
+
+PayloadCodec RpcClient::methodCodec(vsomeip::method_t method_id) const {
+    auto it = method_codecs_.find(method_id);
+    return it != method_codecs_.end() ? it->second : PayloadCodec();
+}
+
 template<typename ResProto>
-void RpcClient::registerPromise(vsomeip::client_t client_id, vsomeip::session_t session_id, std::promise<ResProto> promise) {
-    std::lock_guard<std::mutex> lock(pending_requests_mutex_);
-    pending_requests_[{client_id, session_id}] = {
-        // Store a lambda that knows how to parse into ResProto and set the promise
-        [this, p = std::move(promise)](const std::shared_ptr<vsomeip::message>& msg) mutable {
-            ResProto response_proto;
-            if (msg->get_return_code() != vsomeip::return_code_e::E_OK) {
-                std::string error_msg = "RPC Error: Received non-OK return code: " + std::to_string(static_cast<int>(msg->get_return_code()));
-                 std::cerr << "RpcClient (" << service_name_ << "): " << error_msg << std::endl;
-                try { p.set_exception(std::make_exception_ptr(std::runtime_error(error_msg))); } catch(...) {} // set_exception might throw
-                return;
-            }
+RpcClientCache::ResponseHandler RpcClient::makeResponseHandler(std::promise<ResProto> promise,
+                                                               const PayloadCodec& codec) {
+    // std::function must be copyable, so the move-only promise lives behind a shared_ptr.
+    auto p = std::make_shared<std::promise<ResProto>>(std::move(promise));
+    return [this, p, codec](int return_code, const uint8_t* data, size_t len) {
+        ResProto response_proto;
+        if (return_code == CANCELLED_RETURN_CODE) {
+            try { p->set_exception(std::make_exception_ptr(std::runtime_error("RPC cancelled"))); } catch(...) {}
+            return;
+        }
+        if (return_code != static_cast<int>(vsomeip::return_code_e::E_OK)) {
+            std::string error_msg = "RPC Error: Received non-OK return code: " + std::to_string(return_code);
+             COMMS_LOG_ERROR("RpcClient ({}): {}", service_name_, error_msg);
+            try { p->set_exception(std::make_exception_ptr(std::runtime_error(error_msg))); } catch(...) {} // set_exception might throw
+            return;
+        }
 
-            auto payload = msg->get_payload();
-            if (!payload || payload->get_length() == 0) {
-                std::string error_msg = "RPC Error: Received empty payload for response.";
-                std::cerr << "RpcClient (" << service_name_ << "): " << error_msg << std::endl;
-                try { p.set_exception(std::make_exception_ptr(std::runtime_error(error_msg))); } catch(...) {}
+        if (!data || len == 0) {
+            std::string error_msg = "RPC Error: Received empty payload for response.";
+            COMMS_LOG_ERROR("RpcClient ({}): {}", service_name_, error_msg);
+            try { p->set_exception(std::make_exception_ptr(std::runtime_error(error_msg))); } catch(...) {}
+            return;
+        }
+        MessageEnvelope envelope;
+        if (envelope_.enabled && MessageEnvelope::strip(data, len, envelope)) {
+            static const uint32_t type_hash = MessageTypes::hash(ResProto::descriptor());
+            if (!envelope.supported() || envelope.type_hash != type_hash) {
+                std::string error_msg = envelope.supported()
+                    ? "RPC Error: Response is a " + MessageTypes::name(envelope.type_hash) + ", expected " +
+                          response_proto.GetTypeName()
+                    : "RPC Error: Unsupported response envelope flags " + std::to_string(envelope.flags);
+                COMMS_LOG_ERROR("RpcClient ({}): {}", service_name_, error_msg);
+                try { p->set_exception(std::make_exception_ptr(std::runtime_error(error_msg))); } catch(...) {}
                 return;
             }
-            if (response_proto.ParseFromArray(payload->get_data(), payload->get_length())) {
-                try { p.set_value(response_proto); } catch(...) {}
+        }
+        if (codec.decode(data, len, response_proto)) {
+            try { p->set_value(response_proto); } catch(...) {}
+        } else {
+             std::string error_msg = "RPC Error: Failed to parse response payload into " + response_proto.GetTypeName();
+             COMMS_LOG_ERROR("RpcClient ({}): {}", service_name_, error_msg);
+            try { p->set_exception(std::make_exception_ptr(std::runtime_error(error_msg))); } catch(...) {}
+        }
+    };
+}
+
+vsomeip::session_t RpcClient::sendRequest(const std::shared_ptr<vsomeip::message>& rpc_request,
+                                          RpcClientCache::ResponseHandler handler) {
+    // vsomeip assigns the session ID inside send(), so the pending entry can only be keyed
+    // afterwards. Holding the lock across send() keeps a fast response from being looked up
+    // before it is registered.
+    std::shared_ptr<vsomeip::message> early_response;
+    {
+        std::lock_guard<std::mutex> lock(pending_requests_mutex_);
+        transport_->send(rpc_request);
+        pending_requests_[{rpc_request->get_client(), rpc_request->get_session()}] = {std::move(handler),
+                                                                                      rpc_request->get_instance()};
+        pending_count_.store(pending_requests_.size(), std::memory_order_relaxed);
+        if (demux_) {
+            early_response = demux_->bind(rpc_request->get_session(), service_id_, this);
+        }
+    }
+    if (early_response) {
+        onMessageReceived(early_response); // Arrived before the session was bound
+    }
+    return rpc_request->get_session();
+}
+
+template<typename ReqProto, typename ResProto>
+std::future<ResProto> RpcClient::call(vsomeip::method_t method_id, const char* method_name, const ReqProto& request,
+                                      const CancellationToken* token) {
+    std::promise<ResProto> promise;
+    auto future = promise.get_future();
+
+    const auto started = std::chrono::steady_clock::now();
+    const Metrics::Endpoint metrics = methodMetrics(method_id, method_name);
+
+    if (token && token->isCancelled()) {
+        promise.set_exception(std::make_exception_ptr(std::runtime_error("RPC cancelled")));
+        metrics.drop();
+        return future;
+    }
+
+    if (!transport_ || !availability_.isAvailable()) {
+        COMMS_LOG_ERROR("RpcClient ({}): Cannot call {}, app not ready or service unavailable.",
+                        service_name_, method_name);
+        promise.set_exception(std::make_exception_ptr(std::runtime_error("Service not available or app not ready")));
+        metrics.error();
+        return future;
+    }
+
+    const PayloadCodec codec = methodCodec(method_id);
+    // Encoded behind the envelope, if any; the cache keys on the request alone.
+    const size_t header = envelope_.enabled ? MessageEnvelope::SIZE : 0;
+    const size_t request_size = codec.byteSize(request);
+    std::vector<uint8_t> serialized_data(header + request_size);
+    if (!codec.encode(request, serialized_data.data() + header, request_size)) {
+        COMMS_LOG_ERROR("RpcClient ({}): Failed to serialize {}.", service_name_, request.GetTypeName());
+        promise.set_exception(std::make_exception_ptr(std::runtime_error("Failed to serialize request")));
+        metrics.error();
+        return future;
+    }
+    if (envelope_.enabled) {
+        static const uint32_t type_hash = MessageTypes::hash(ReqProto::descriptor());
+        MessageEnvelope envelope;
+        envelope.type_hash = type_hash;
+        envelope.schema_version = envelope_.schema_version;
+        envelope.sequence = envelope_sequence_.fetch_add(1, std::memory_order_relaxed);
+        if (envelope_.timestamp) {
+            envelope.flags |= MessageEnvelope::TIMESTAMP;
+            envelope.timestamp_ns = MessageEnvelope::now();
+        }
+        envelope.write(serialized_data.data());
+    }
+    const uint8_t* request_bytes = serialized_data.data() + header;
+    metrics.message(request_size);
+
+    // Round trip as the caller sees it, cache hits and coalesced calls included.
+    RpcClientCache::ResponseHandler handler =
+        [metrics, started, own = makeResponseHandler<ResProto>(std::move(promise), codec)](
+            int return_code, const uint8_t* data, size_t len) {
+            if (return_code == static_cast<int>(vsomeip::return_code_e::E_OK)) {
+                metrics.latency(std::chrono::steady_clock::now() - started);
+            } else if (return_code == CANCELLED_RETURN_CODE) {
+                metrics.drop();
             } else {
-                 std::string error_msg = "RPC Error: Failed to parse response payload into " + response_proto.GetTypeName();
-                 std::cerr << "RpcClient (" << service_name_ << "): " << error_msg << std::endl;
-                try { p.set_exception(std::make_exception_ptr(std::runtime_error(error_msg))); } catch(...) {}
+                metrics.error();
+            }
+            own(return_code, data, len);
+        };
+
+    // With a token, the caller's handler runs exactly once: for the response or the cancellation.
+    std::shared_ptr<CancellableCall> cancellable;
+    if (token) {
+        cancellable = std::make_shared<CancellableCall>();
+        cancellable->token = *token;
+        cancellable->copies = std::make_shared<RequestCopies>();
+        cancellable->handler = std::move(handler);
+        handler = [this, cancellable](int return_code, const uint8_t* data, size_t len) {
+            if (cancellable->done.exchange(true, std::memory_order_acq_rel)) {
+                return; // Cancelled already
             }
+            untrackCancellable(cancellable);
+            cancellable->handler(return_code, data, len);
+        };
+    }
+    // Registers the token callback once it is known whether this call leads a cache entry.
+    auto arm_cancellation = [this, &cancellable]() {
+        if (!cancellable) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(cancellable_calls_mutex_);
+            cancellable_calls_[cancellable.get()] = cancellable;
+        }
+        auto call = cancellable;
+        cancellable->callback_id = cancellable->token.onCancel([this, call]() { cancelCall(call); });
+        if (cancellable->done.load(std::memory_order_acquire)) {
+            untrackCancellable(cancellable); // Answered or cancelled while registering
         }
     };
+
+    if (response_cache_.isMethodEnabled(method_id)) {
+        RpcClientCache::Key cache_key = response_cache_.makeKey(method_id, request_bytes, request_size);
+        std::vector<uint8_t> cached_response;
+        switch (response_cache_.lookup(cache_key, cached_response, handler)) {
+            case RpcClientCache::LookupResult::Hit:
+                handler(static_cast<int>(vsomeip::return_code_e::E_OK), cached_response.data(), cached_response.size());
+                return future;
+            case RpcClientCache::LookupResult::Coalesced:
+                arm_cancellation(); // Only this caller's future is released on cancel
+                return future;
+            case RpcClientCache::LookupResult::Leader:
+                break;
+        }
+        if (cancellable) {
+            cancellable->has_cache_key = true;
+            cancellable->cache_key = cache_key;
+        }
+        // Fan the leader's response out to every call that was coalesced onto it.
+        handler = [this, cache_key, own = std::move(handler)](int return_code, const uint8_t* data, size_t len) {
+            own(return_code, data, len);
+            for (auto& waiter : response_cache_.complete(cache_key, return_code, data, len)) {
+                waiter(return_code, data, len);
+            }
+        };
+    }
+
+    arm_cancellation();
+    if (cancellable && cancellable->done.load(std::memory_order_acquire)) {
+        return future; // Cancelled before anything was sent
+    }
+
+    std::shared_ptr<vsomeip::payload> payload = vsomeip::runtime::get()->create_payload();
+    payload->set_data(std::move(serialized_data));
+
+    if (isMultiInstance()) {
+        sendBalanced(method_id, method_name, payload, std::move(handler),
+                     cancellable ? cancellable->copies : std::make_shared<RequestCopies>());
+        return future;
+    }
+
+    std::shared_ptr<vsomeip::message> rpc_request = vsomeip::runtime::get()->create_request(reliable_);
+    rpc_request->set_service(service_id_);
+    rpc_request->set_instance(instance_id_);
+    rpc_request->set_method(method_id);
+    rpc_request->set_payload(payload);
+
+    vsomeip::session_t session = sendRequest(rpc_request, std::move(handler));
+    if (cancellable) {
+        trackCopy(cancellable->copies, instance_id_, session);
+    }
+    COMMS_LOG_DEBUG("RpcClient ({}): Sent {} request (Session: 0x{:x})", service_name_, method_name, session);
+    return future;
 }
 
 template<typename ResProto>
@@ -130,12 +380,16 @@ void RpcClient::fulfillPromise(vsomeip::client_t client_id, vsomeip::session_t s
     auto key = std::make_pair(client_id, session_id);
     auto it = pending_requests_.find(key);
     if (it != pending_requests_.end()) {
-        it->second.response_parser(msg); // Call the stored lambda
+        auto payload = msg->get_payload();
+        const bool has_payload = payload && payload->get_length() > 0;
+        it->second.handler(static_cast<int>(msg->get_return_code()),
+                           has_payload ? payload->get_data() : nullptr,
+                           has_payload ? payload->get_length() : 0);
         pending_requests_.erase(it);
+        pending_count_.store(pending_requests_.size(), std::memory_order_relaxed);
     } else {
-        std::cerr << "RpcClient (" << service_name_
-                  << "): Received response for unknown client/session: 0x" << std::hex << client_id
-                  << "/0x" << session_id << std::dec << std::endl;
+        COMMS_LOG_ERROR("RpcClient ({}): Received response for unknown client/session: 0x{:x}/0x{:x}",
+                        service_name_, client_id, session_id);
     }
 }
 
@@ -148,91 +402,366 @@ void RpcClient::fulfillPromiseWithError(vsomeip::client_t client_id, vsomeip::se
         // We'd need to store std::shared_ptr<void> to the promise and type-erase it,
         // or store a std::function<void(const std::string&)> to set an error.
         // For simplicity now, just log and erase. A real system needs robust error propagation.
-        std::cerr << "RpcClient (" << service_name_ << "): Setting error for client/session 0x"
-                  << std::hex << client_id << "/0x" << session_id << ": " << error_msg << std::dec << std::endl;
+        COMMS_LOG_ERROR("RpcClient ({}): Setting error for client/session 0x{:x}/0x{:x}: {}",
+                        service_name_, client_id, session_id, error_msg);
         // it->second.promise_setter_with_error(error_msg); // If we had such a mechanism
         pending_requests_.erase(it); // Or let the original call timeout
+        pending_count_.store(pending_requests_.size(), std::memory_order_relaxed);
     }
 }
 
 
 std::future<protos::EchoResponse> RpcClient::Echo(const protos::EchoRequest& request) {
-    std::promise<protos::EchoResponse> promise;
-    auto future = promise.get_future();
+    return call<protos::EchoRequest, protos::EchoResponse>(METHOD_ID_ECHO, "Echo", request); // Placeholder method ID
+}
 
-    if (!vsomeip_app_ || !service_available_) {
-        std::cerr << "RpcClient (" << service_name_ << "): Cannot call Echo, app not ready or service unavailable." << std::endl;
-        promise.set_exception(std::make_exception_ptr(std::runtime_error("Service not available or app not ready")));
-        return future;
+std::future<protos::AddResponse> RpcClient::Add(const protos::AddRequest& request) {
+    return call<protos::AddRequest, protos::AddResponse>(METHOD_ID_ADD, "Add", request); // Placeholder method ID
+}
+
+std::future<protos::EchoResponse> RpcClient::Echo(const protos::EchoRequest& request, const CancellationToken& token) {
+    return call<protos::EchoRequest, protos::EchoResponse>(METHOD_ID_ECHO, "Echo", request, &token);
+}
+
+std::future<protos::AddResponse> RpcClient::Add(const protos::AddRequest& request, const CancellationToken& token) {
+    return call<protos::AddRequest, protos::AddResponse>(METHOD_ID_ADD, "Add", request, &token);
+}
+
+void RpcClient::cancelCall(const std::shared_ptr<CancellableCall>& call) {
+    if (call->done.exchange(true, std::memory_order_acq_rel)) {
+        return; // Already answered
+    }
+    untrackCancellable(call);
+    // A cache leader whose request other callers were coalesced onto keeps it running for them.
+    if (!call->has_cache_key || response_cache_.abandonIfUnshared(call->cache_key)) {
+        for (const auto& copy : call->copies->close()) {
+            cancelCopy(copy.first, copy.second);
+        }
     }
+    COMMS_LOG_INFO("RpcClient ({}): Call cancelled.", service_name_);
+    call->handler(CANCELLED_RETURN_CODE, nullptr, 0);
+}
 
-    std::shared_ptr<vsomeip::message> rpc_request = vsomeip::runtime::get()->create_request();
-    rpc_request->set_service(service_id_);
-    rpc_request->set_instance(instance_id_);
-    rpc_request->set_method(METHOD_ID_ECHO); // Placeholder
+void RpcClient::trackCopy(const std::shared_ptr<RequestCopies>& copies, vsomeip::instance_t instance,
+                          vsomeip::session_t session) {
+    if (!copies->add(instance, session)) {
+        cancelCopy(instance, session);
+    }
+}
 
-    std::string serialized_data;
-    if (!request.SerializeToString(&serialized_data)) {
-        std::cerr << "RpcClient (" << service_name_ << "): Failed to serialize EchoRequest." << std::endl;
-        promise.set_exception(std::make_exception_ptr(std::runtime_error("Failed to serialize request")));
-        return future;
+void RpcClient::cancelCopy(vsomeip::instance_t instance, vsomeip::session_t session) {
+    PromiseContext context;
+    {
+        std::lock_guard<std::mutex> lock(pending_requests_mutex_);
+        auto it = pending_requests_.find(std::make_pair(client_id_, session));
+        if (it == pending_requests_.end()) {
+            return; // Already answered; nothing left to stop
+        }
+        context = std::move(it->second);
+        pending_requests_.erase(it);
+        pending_count_.store(pending_requests_.size(), std::memory_order_relaxed);
+    }
+    if (demux_) {
+        demux_->unbind(session, this);
+    }
+
+    const vsomeip::byte_t cancel_payload[2] = {static_cast<vsomeip::byte_t>(session >> 8),
+                                               static_cast<vsomeip::byte_t>(session)};
+    std::shared_ptr<vsomeip::message> msg = vsomeip::runtime::get()->create_request(reliable_); // As the call went
+    msg->set_service(service_id_);
+    msg->set_instance(instance);
+    msg->set_method(METHOD_ID_CANCEL);
+    msg->set_message_type(vsomeip::message_type_e::MT_REQUEST_NO_RETURN);
+    msg->set_payload(vsomeip::runtime::get()->create_payload(cancel_payload, sizeof(cancel_payload)));
+    transport_->send(msg);
+
+    // Lets per-copy bookkeeping (e.g. outstanding counts) see the copy end.
+    context.handler(CANCELLED_RETURN_CODE, nullptr, 0);
+}
+
+void RpcClient::untrackCancellable(const std::shared_ptr<CancellableCall>& call) {
+    {
+        std::lock_guard<std::mutex> lock(cancellable_calls_mutex_);
+        cancellable_calls_.erase(call.get());
+    }
+    call->token.removeCallback(call->callback_id.load());
+}
+
+std::shared_ptr<ClientStream> RpcClient::Count(const protos::CountRequest& request,
+                                               std::function<void(const protos::CountItem&)> on_item,
+                                               StreamCompletionHandler on_complete) {
+    std::string name = service_name_;
+    return openStream(METHOD_ID_COUNT, "Count", request,
+                      [on_item, name](const uint8_t* data, size_t len) {
+                          protos::CountItem item;
+                          if (!item.ParseFromArray(data, static_cast<int>(len))) {
+                              COMMS_LOG_ERROR("RpcClient ({}): Failed to parse CountItem.", name);
+                              return;
+                          }
+                          on_item(item);
+                      },
+                      std::move(on_complete));
+}
+
+std::shared_ptr<ClientStream> RpcClient::openStream(vsomeip::method_t method_id, const char* method_name,
+                                                    const google::protobuf::MessageLite& request,
+                                                    StreamItemHandler on_item, StreamCompletionHandler on_complete,
+                                                    uint32_t window) {
+    auto stream = std::make_shared<ClientStream>();
+    stream->client_ = this;
+    stream->window_ = std::max<uint32_t>(window, 1);
+    stream->on_item_ = std::move(on_item);
+    stream->on_complete_ = std::move(on_complete);
+
+    vsomeip::instance_t instance = instance_id_;
+    if (isMultiInstance() && !pickInstance(vsomeip::ANY_INSTANCE, instance)) {
+        instance = vsomeip::ANY_INSTANCE;
+    }
+    if (!transport_ || !availability_.isAvailable() || instance == vsomeip::ANY_INSTANCE) {
+        COMMS_LOG_ERROR("RpcClient ({}): Service not available for stream {}", service_name_, method_name);
+        finishStream(stream, static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE), "Service not available");
+        return stream;
+    }
+    std::string serialized_request;
+    if (!request.SerializeToString(&serialized_request)) {
+        COMMS_LOG_ERROR("RpcClient ({}): Failed to serialize {} request.", service_name_, method_name);
+        finishStream(stream, static_cast<int>(vsomeip::return_code_e::E_NOT_OK), "Failed to serialize request");
+        return stream;
     }
 
+    std::shared_ptr<vsomeip::message> rpc_request = vsomeip::runtime::get()->create_request(true);
+    rpc_request->set_service(service_id_);
+    rpc_request->set_instance(instance);
+    rpc_request->set_method(method_id);
     std::shared_ptr<vsomeip::payload> payload = vsomeip::runtime::get()->create_payload();
-    std::vector<vsomeip::byte_t> payload_data(serialized_data.begin(), serialized_data.end());
-    payload->set_data(payload_data);
+    payload->set_data(reinterpret_cast<const vsomeip::byte_t*>(serialized_request.data()),
+                      static_cast<vsomeip::length_t>(serialized_request.size()));
     rpc_request->set_payload(payload);
 
-    // Store promise before sending, using client_id and generated session_id
-    registerPromise<protos::EchoResponse>(rpc_request->get_client(), rpc_request->get_session(), std::move(promise));
+    // The open request is acknowledged with an empty response; only a rejection matters here.
+    std::weak_ptr<ClientStream> weak_stream = stream;
+    vsomeip::session_t session = sendRequest(rpc_request, [this, weak_stream](int return_code, const uint8_t*, size_t) {
+        auto s = weak_stream.lock();
+        if (s && return_code != static_cast<int>(vsomeip::return_code_e::E_OK)) {
+            finishStream(s, return_code, "Stream rejected by server");
+        }
+    });
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex_);
+        stream->instance_ = instance;
+        stream->session_ = session;
+        if (stream->finished_) {
+            return stream; // Rejected before we got here
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        streams_[session] = stream;
+    }
+    demux_->bindStream(session, service_id_, this);
+    COMMS_LOG_INFO("RpcClient ({}): Opened {} stream (Session: 0x{:x}, window {})",
+                   service_name_, method_name, session, stream->window_);
 
-    vsomeip_app_->send(rpc_request);
-    std::cout << "RpcClient (" << service_name_ << "): Sent Echo request (Session: 0x"
-              << std::hex << rpc_request->get_session() << std::dec << ")" << std::endl;
-    return future;
+    // Items may only flow once our subscription to the stream event is in place, so the
+    // initial credit is granted from the subscription acknowledgement.
+    demux_->whenStreamEventReady(service_id_, instance, this, [this, weak_stream]() {
+        auto s = weak_stream.lock();
+        if (s && !s->isFinished()) {
+            sendStreamControl(s->instance_, s->session_, s->window_, 0);
+        }
+    });
+    return stream;
 }
 
-std::future<protos::AddResponse> RpcClient::Add(const protos::AddRequest& request) {
-    std::promise<protos::AddResponse> promise;
-    auto future = promise.get_future();
+void RpcClient::onStreamFrame(const std::shared_ptr<vsomeip::message>& msg, const StreamFrameHeader& header) {
+    std::shared_ptr<ClientStream> stream;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        auto it = streams_.find(header.session);
+        if (it != streams_.end()) {
+            stream = it->second;
+        }
+    }
+    if (!stream) {
+        return; // Late frame of a finished stream
+    }
 
-    if (!vsomeip_app_ || !service_available_) {
-        std::cerr << "RpcClient (" << service_name_ << "): Cannot call Add, app not ready or service unavailable." << std::endl;
-        promise.set_exception(std::make_exception_ptr(std::runtime_error("Service not available or app not ready")));
-        return future;
+    auto payload = msg->get_payload();
+    const uint8_t* data = payload->get_data() + StreamFrameHeader::SIZE;
+    const size_t len = payload->get_length() - StreamFrameHeader::SIZE;
+    bool overflow = false;
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex_);
+        if (stream->finished_ || header.sequence < stream->next_sequence_) {
+            return; // Duplicate
+        }
+        // The server may not run further ahead than the credits we granted.
+        overflow = stream->pending_frames_.size() > stream->window_;
+        if (!overflow) {
+            stream->pending_frames_[header.sequence] =
+                ClientStream::Frame{header.flags, header.status, std::vector<uint8_t>(data, data + len)};
+            if (stream->delivering_) {
+                return; // The delivering thread picks it up
+            }
+            stream->delivering_ = true;
+        }
+    }
+    if (overflow) {
+        COMMS_LOG_ERROR("RpcClient ({}): Stream 0x{:x} exceeded its flow control window.",
+                        service_name_, header.session);
+        sendStreamControl(stream->instance_, stream->session_, 0, StreamControl::FLAG_CANCEL);
+        finishStream(stream, static_cast<int>(vsomeip::return_code_e::E_NOT_OK), "Flow control violation");
+        return;
     }
+    drainStream(stream);
+}
 
-    std::shared_ptr<vsomeip::message> rpc_request = vsomeip::runtime::get()->create_request();
-    rpc_request->set_service(service_id_);
-    rpc_request->set_instance(instance_id_);
-    rpc_request->set_method(METHOD_ID_ADD); // Placeholder
+void RpcClient::drainStream(const std::shared_ptr<ClientStream>& stream) {
+    for (;;) {
+        ClientStream::Frame frame;
+        uint32_t grant = 0;
+        {
+            std::lock_guard<std::mutex> lock(stream->mutex_);
+            auto it = stream->pending_frames_.find(stream->next_sequence_);
+            if (stream->finished_ || it == stream->pending_frames_.end()) {
+                stream->delivering_ = false;
+                return;
+            }
+            frame = std::move(it->second);
+            stream->pending_frames_.erase(it);
+            ++stream->next_sequence_;
+            if (!(frame.flags & StreamFrameHeader::FLAG_END) &&
+                ++stream->consumed_since_grant_ >= std::max<uint32_t>(stream->window_ / 2, 1)) {
+                grant = stream->consumed_since_grant_;
+                stream->consumed_since_grant_ = 0;
+            }
+        }
+        if (frame.flags & StreamFrameHeader::FLAG_END) {
+            finishStream(stream, frame.status, std::string(frame.data.begin(), frame.data.end()));
+            continue; // Resets delivering_ and returns
+        }
+        if (stream->on_item_) {
+            stream->on_item_(frame.data.data(), frame.data.size());
+        }
+        // Credit is returned only after the item was consumed, so a slow consumer slows the producer.
+        if (grant > 0) {
+            sendStreamControl(stream->instance_, stream->session_, grant, 0);
+        }
+    }
+}
 
-    std::string serialized_data;
-    if (!request.SerializeToString(&serialized_data)) {
-        std::cerr << "RpcClient (" << service_name_ << "): Failed to serialize AddRequest." << std::endl;
-        promise.set_exception(std::make_exception_ptr(std::runtime_error("Failed to serialize request")));
-        return future;
+void RpcClient::finishStream(const std::shared_ptr<ClientStream>& stream, int status, const std::string& error) {
+    StreamCompletionHandler on_complete;
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex_);
+        if (stream->finished_) {
+            return;
+        }
+        stream->finished_ = true;
+        stream->status_ = status;
+        stream->pending_frames_.clear();
+        on_complete = std::move(stream->on_complete_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        auto it = streams_.find(stream->session_);
+        if (it != streams_.end() && it->second == stream) {
+            streams_.erase(it);
+        }
+    }
+    if (demux_) {
+        demux_->unbindStream(stream->session_, this);
     }
 
-    std::shared_ptr<vsomeip::payload> payload = vsomeip::runtime::get()->create_payload();
-    std::vector<vsomeip::byte_t> payload_data(serialized_data.begin(), serialized_data.end());
-    payload->set_data(payload_data);
-    rpc_request->set_payload(payload);
+    if (on_complete) {
+        on_complete(status, error);
+    }
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex_);
+        stream->completed_ = true;
+    }
+    stream->completed_cv_.notify_all();
+}
+
+void RpcClient::finishStreams(vsomeip::instance_t instance, int status, const std::string& error) {
+    std::vector<std::shared_ptr<ClientStream>> affected;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        for (const auto& entry : streams_) {
+            if (instance == vsomeip::ANY_INSTANCE || entry.second->instance_ == instance) {
+                affected.push_back(entry.second);
+            }
+        }
+    }
+    for (const auto& stream : affected) {
+        if (status != static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE)) {
+            sendStreamControl(stream->instance_, stream->session_, 0, StreamControl::FLAG_CANCEL);
+        }
+        finishStream(stream, status, error);
+    }
+}
 
-    registerPromise<protos::AddResponse>(rpc_request->get_client(), rpc_request->get_session(), std::move(promise));
+void RpcClient::sendStreamControl(vsomeip::instance_t instance, vsomeip::session_t session, uint32_t credits,
+                                  uint8_t flags) {
+    StreamControl control;
+    control.session = session;
+    control.credits = credits;
+    control.flags = flags;
+    vsomeip::byte_t buffer[StreamControl::SIZE];
+    control.encode(buffer);
 
-    vsomeip_app_->send(rpc_request);
-    std::cout << "RpcClient (" << service_name_ << "): Sent Add request (Session: 0x"
-              << std::hex << rpc_request->get_session() << std::dec << ")" << std::endl;
-    return future;
+    std::shared_ptr<vsomeip::message> msg = vsomeip::runtime::get()->create_request(true);
+    msg->set_service(service_id_);
+    msg->set_instance(instance);
+    msg->set_method(METHOD_ID_STREAM_CONTROL);
+    msg->set_message_type(vsomeip::message_type_e::MT_REQUEST_NO_RETURN);
+    msg->set_payload(vsomeip::runtime::get()->create_payload(buffer, StreamControl::SIZE));
+    transport_->send(msg);
+}
+
+void RpcClient::enableResponseCache(uint16_t method_id, std::chrono::milliseconds ttl) {
+    response_cache_.enableMethod(method_id, ttl);
+    COMMS_LOG_INFO("RpcClient ({}): Response cache enabled for method 0x{:x} (TTL: {} ms)",
+                   service_name_, method_id, ttl.count());
+}
+
+void RpcClient::disableResponseCache(uint16_t method_id) {
+    response_cache_.disableMethod(method_id);
+}
+
+RpcClientCache::Stats RpcClient::getCacheStats() const {
+    return response_cache_.getStats();
 }
 
 void RpcClient::onAvailabilityChanged(vsomeip::service_t service, vsomeip::instance_t instance, bool is_available) {
+    if (service == service_id_ && isMultiInstance()) {
+        size_t instance_count = 0;
+        {
+            std::lock_guard<std::mutex> lock(instances_mutex_);
+            if (is_available) {
+                instances_.emplace(instance, std::make_shared<InstanceState>());
+            } else {
+                instances_.erase(instance);
+            }
+            instance_count = instances_.size();
+        }
+        availability_.set(instance_count > 0);
+        COMMS_LOG_INFO("RpcClient ({}): Instance 0x{:x} of Service 0x{:x} -> {} ({} instance(s) available)",
+                       service_name_, instance, service, (is_available ? "AVAILABLE" : "NOT AVAILABLE"),
+                       instance_count);
+        if (!is_available) {
+            finishStreams(instance, static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE), "Service instance went away");
+            failRequestsTo(instance); // After the erase, so they are not resent to it
+        }
+        if (instance_count == 0) {
+            response_cache_.clearInFlight();
+        }
+        return;
+    }
     if (service == service_id_ && instance == instance_id_) {
-        service_available_ = is_available;
-        std::cout << "RpcClient (" << service_name_ << "): Service availability changed for Service 0x"
-                  << std::hex << service << ", Instance 0x" << instance
-                  << " -> " << (is_available ? "AVAILABLE" : "NOT AVAILABLE") << std::dec << std::endl;
+        availability_.set(is_available);
+        COMMS_LOG_INFO("RpcClient ({}): Service availability changed for Service 0x{:x}, Instance 0x{:x} -> {}",
+                       service_name_, service, instance, (is_available ? "AVAILABLE" : "NOT AVAILABLE"));
 
         if (!is_available) {
             // Service went down, fail any pending requests for this service
@@ -241,11 +770,17 @@ void RpcClient::onAvailabilityChanged(vsomeip::service_t service, vsomeip::insta
             // as we don't have client/session. A more robust way is needed, e.g. storing service_id
             // with promises or iterating and checking.
             // For now, this is a conceptual cleanup.
-            std::cout << "RpcClient (" << service_name_ << "): Service became unavailable. Pending requests might fail." << std::endl;
+            COMMS_LOG_INFO("RpcClient ({}): Service became unavailable. Pending requests might fail.", service_name_);
+            // Coalesced callers must not keep waiting on a leader that will not be answered.
+            response_cache_.clearInFlight();
             // A better approach: iterate pending_requests_ and set_exception on promises
             // that were targeting this service_id/instance_id if we stored that info.
             // Or, rely on timeouts for futures.
         }
+        if (!is_available) {
+            // Streams from this instance will not receive their terminal frame.
+            finishStreams(instance, static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE), "Service went away");
+        }
     }
 }
 
@@ -259,10 +794,9 @@ void RpcClient::onMessageReceived(const std::shared_ptr<vsomeip::message>& msg)
         (msg->get_message_type() == vsomeip::message_type_e::MT_RESPONSE ||
          msg->get_message_type() == vsomeip::message_type_e::MT_ERROR)) {
 
-        std::cout << "RpcClient (" << service_name_ << "): Received response/error for session 0x"
-                  << std::hex << msg->get_session() << std::dec
-                  << ", Type: " << static_cast<int>(msg->get_message_type())
-                  << ", RC: " << static_cast<int>(msg->get_return_code()) << std::endl;
+        COMMS_LOG_DEBUG("RpcClient ({}): Received response/error for session 0x{:x}, Type: {}, RC: {}",
+                        service_name_, msg->get_session(), static_cast<int>(msg->get_message_type()),
+                        static_cast<int>(msg->get_return_code()));
 
         // The generic fulfillPromise will call the stored lambda which knows the ResProto type.
         // This is a simplified way to call the templated fulfill.
@@ -273,16 +807,28 @@ void RpcClient::onMessageReceived(const std::shared_ptr<vsomeip::message>& msg)
         // The current `fulfillPromise` is not generic enough for this direct call.
 
         // Corrected approach: The lambda stored in PromiseContext does the work.
-        std::lock_guard<std::mutex> lock(pending_requests_mutex_);
-        auto key = std::make_pair(client_id_, msg->get_session());
-        auto it = pending_requests_.find(key);
-        if (it != pending_requests_.end()) {
-            it->second.response_parser(msg); // Call the stored lambda
-            pending_requests_.erase(it);
+        // The handler runs outside the lock: it may resend the request to another instance, or
+        // complete a stream whose callback issues new calls.
+        PromiseContext context;
+        {
+            std::lock_guard<std::mutex> lock(pending_requests_mutex_);
+            auto it = pending_requests_.find(std::make_pair(client_id_, msg->get_session()));
+            if (it != pending_requests_.end()) {
+                context = std::move(it->second);
+                pending_requests_.erase(it);
+                pending_count_.store(pending_requests_.size(), std::memory_order_relaxed);
+            }
+        }
+        if (context.handler) {
+            auto payload = msg->get_payload();
+            const bool has_payload = payload && payload->get_length() > 0;
+            context.handler(static_cast<int>(msg->get_return_code()),
+                            has_payload ? payload->get_data() : nullptr,
+                            has_payload ? payload->get_length() : 0);
         } else {
             // Stale or unexpected response
-            std::cout << "RpcClient (" << service_name_ << "): Received response for unknown session 0x"
-                      << std::hex << msg->get_session() << std::dec << " for this client." << std::endl;
+            COMMS_LOG_INFO("RpcClient ({}): Received response for unknown session 0x{:x} for this client.",
+                           service_name_, msg->get_session());
         }
 
     } else {
@@ -292,12 +838,272 @@ void RpcClient::onMessageReceived(const std::shared_ptr<vsomeip::message>& msg)
     }
 }
 
+struct RpcClient::BalancedCall {
+    vsomeip::method_t method_id;
+    std::shared_ptr<vsomeip::payload> payload;
+    RpcClientCache::ResponseHandler handler;
+    std::shared_ptr<RequestCopies> copies;
+    std::chrono::steady_clock::time_point started_at;
+    std::atomic<bool> completed{false};
+    std::atomic<uint32_t> copies_out{0}; // Sent and not yet answered, failed or cancelled
+};
+
+void RpcClient::setReliable(bool reliable) {
+    reliable_ = reliable;
+}
+
+bool RpcClient::isMultiInstance() const {
+    return instance_id_ == vsomeip::ANY_INSTANCE;
+}
+
+void RpcClient::setLoadBalancingConfig(const LoadBalancingConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(latency_mutex_);
+        lb_config_ = config;
+        if (lb_config_.latency_window == 0) {
+            lb_config_.latency_window = 1;
+        }
+        latency_samples_ns_.clear();
+        latency_samples_ns_.reserve(lb_config_.latency_window);
+        latency_next_ = 0;
+        samples_since_recompute_ = 0;
+        hedge_delay_ns_ = lb_config_.hedging_enabled
+            ? std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(lb_config_.min_hedge_delay).count())
+            : 0;
+    }
+    if (config.hedging_enabled && !hedge_scheduler_) {
+        hedge_scheduler_ = std::make_unique<DeadlineScheduler>();
+    }
+    if (!isMultiInstance()) {
+        COMMS_LOG_WARN("RpcClient ({}): Load balancing config has no effect; client is bound to instance 0x{:x}",
+                       service_name_, instance_id_);
+    }
+}
+
+RpcClient::LoadBalancingStats RpcClient::getLoadBalancingStats() const {
+    LoadBalancingStats stats;
+    stats.hedges_sent = hedges_sent_.load(std::memory_order_relaxed);
+    stats.hedge_wins = hedge_wins_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(instances_mutex_);
+    for (const auto& [instance, state] : instances_) {
+        stats.outstanding_by_instance[instance] = state->outstanding.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+bool RpcClient::hasInstance(vsomeip::instance_t instance) const {
+    std::lock_guard<std::mutex> lock(instances_mutex_);
+    return instances_.count(instance) != 0;
+}
+
+void RpcClient::failRequestsTo(vsomeip::instance_t instance) {
+    std::vector<std::pair<vsomeip::session_t, PromiseContext>> lost;
+    {
+        std::lock_guard<std::mutex> lock(pending_requests_mutex_);
+        for (auto it = pending_requests_.begin(); it != pending_requests_.end();) {
+            if (it->second.instance == instance) {
+                lost.emplace_back(it->first.second, std::move(it->second));
+                it = pending_requests_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        pending_count_.store(pending_requests_.size(), std::memory_order_relaxed);
+    }
+    if (lost.empty()) {
+        return;
+    }
+    COMMS_LOG_INFO("RpcClient ({}): {} request(s) to instance 0x{:x} will not be answered.",
+                   service_name_, lost.size(), instance);
+    // Handlers run outside the lock, as in onMessageReceived(): they may resend.
+    for (auto& request : lost) {
+        if (demux_) {
+            demux_->unbind(request.first, this);
+        }
+        request.second.handler(static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE), nullptr, 0);
+    }
+}
+
+std::shared_ptr<RpcClient::InstanceState> RpcClient::pickInstance(vsomeip::instance_t exclude, vsomeip::instance_t& picked) {
+    thread_local std::minstd_rand rng(std::random_device{}());
+    std::lock_guard<std::mutex> lock(instances_mutex_);
+
+    const size_t candidates = instances_.size() - (instances_.count(exclude) ? 1 : 0);
+    if (candidates == 0) {
+        return nullptr;
+    }
+    auto nth_candidate = [&](size_t n) {
+        for (auto it = instances_.begin(); it != instances_.end(); ++it) {
+            if (it->first == exclude) {
+                continue;
+            }
+            if (n-- == 0) {
+                return it;
+            }
+        }
+        return instances_.end();
+    };
+
+    auto first = nth_candidate(rng() % candidates);
+    if (candidates > 1) {
+        // Second choice drawn from the remaining candidates so the two picks always differ.
+        size_t offset = 1 + rng() % (candidates - 1);
+        size_t first_index = 0;
+        for (auto it = instances_.begin(); it != first; ++it) {
+            if (it->first != exclude) {
+                ++first_index;
+            }
+        }
+        auto second = nth_candidate((first_index + offset) % candidates);
+        if (second->second->outstanding.load(std::memory_order_relaxed) <
+            first->second->outstanding.load(std::memory_order_relaxed)) {
+            first = second;
+        }
+    }
+    picked = first->first;
+    return first->second;
+}
+
+void RpcClient::sendBalanced(vsomeip::method_t method_id, const char* method_name,
+                             const std::shared_ptr<vsomeip::payload>& payload,
+                             RpcClientCache::ResponseHandler handler,
+                             const std::shared_ptr<RequestCopies>& copies) {
+    vsomeip::instance_t primary = vsomeip::ANY_INSTANCE;
+    std::shared_ptr<InstanceState> primary_state = pickInstance(vsomeip::ANY_INSTANCE, primary);
+    if (!primary_state) {
+        COMMS_LOG_ERROR("RpcClient ({}): No instance available for {}.", service_name_, method_name);
+        handler(static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE), nullptr, 0);
+        return;
+    }
+
+    auto balanced_call = std::make_shared<BalancedCall>();
+    balanced_call->method_id = method_id;
+    balanced_call->payload = payload;
+    balanced_call->handler = std::move(handler);
+    balanced_call->copies = copies;
+    balanced_call->started_at = std::chrono::steady_clock::now();
+
+    sendToInstance(balanced_call, primary, primary_state, false);
+    COMMS_LOG_DEBUG("RpcClient ({}): Sent {} request to instance 0x{:x}", service_name_, method_name, primary);
+
+    const std::chrono::nanoseconds hedge_delay = hedgeDelay();
+    if (!hedge_scheduler_ || hedge_delay.count() == 0) {
+        return; // Hedging disabled
+    }
+    hedge_scheduler_->schedule(balanced_call->started_at + hedge_delay,
+        [this, balanced_call, primary]() {
+            if (balanced_call->completed.load(std::memory_order_acquire) || balanced_call->copies->isClosed()) {
+                return; // Answered or cancelled
+            }
+            vsomeip::instance_t alternate = vsomeip::ANY_INSTANCE;
+            std::shared_ptr<InstanceState> alternate_state = pickInstance(primary, alternate);
+            if (!alternate_state) {
+                return; // Only one instance left; nothing to hedge to
+            }
+            hedges_sent_.fetch_add(1, std::memory_order_relaxed);
+            sendToInstance(balanced_call, alternate, alternate_state, true);
+        });
+}
+
+void RpcClient::sendToInstance(const std::shared_ptr<BalancedCall>& balanced_call, vsomeip::instance_t instance,
+                               const std::shared_ptr<InstanceState>& instance_state, bool is_hedge) {
+    std::shared_ptr<vsomeip::message> rpc_request = vsomeip::runtime::get()->create_request(reliable_);
+    rpc_request->set_service(service_id_);
+    rpc_request->set_instance(instance);
+    rpc_request->set_method(balanced_call->method_id);
+    rpc_request->set_payload(balanced_call->payload);
+
+    instance_state->outstanding.fetch_add(1, std::memory_order_relaxed);
+    balanced_call->copies_out.fetch_add(1, std::memory_order_relaxed);
+    vsomeip::session_t session = sendRequest(rpc_request,
+        [this, balanced_call, instance, instance_state, is_hedge](int return_code, const uint8_t* data, size_t len) {
+            instance_state->outstanding.fetch_sub(1, std::memory_order_relaxed);
+            const uint32_t copies_left = balanced_call->copies_out.fetch_sub(1, std::memory_order_acq_rel) - 1;
+            if (return_code == CANCELLED_RETURN_CODE) {
+                return; // This copy was withdrawn
+            }
+            if (return_code == static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE) && !hasInstance(instance)) {
+                // The instance went away with this copy (failRequestsTo()).
+                if (copies_left > 0) {
+                    return; // The other copy may still be answered
+                }
+                vsomeip::instance_t other = vsomeip::ANY_INSTANCE;
+                std::shared_ptr<InstanceState> other_state = pickInstance(instance, other);
+                if (other_state && !balanced_call->copies->isClosed()) {
+                    COMMS_LOG_DEBUG("RpcClient ({}): Resending request from lost instance 0x{:x} to 0x{:x}",
+                                    service_name_, instance, other);
+                    sendToInstance(balanced_call, other, other_state, is_hedge);
+                    return;
+                }
+                // No instance left (or the call is over): fails as it is
+            }
+            if (balanced_call->completed.exchange(true, std::memory_order_acq_rel)) {
+                return; // The other copy of this call already answered
+            }
+            // The server still working on the other copy can stop.
+            for (const auto& copy : balanced_call->copies->close()) {
+                cancelCopy(copy.first, copy.second);
+            }
+            if (is_hedge) {
+                hedge_wins_.fetch_add(1, std::memory_order_relaxed);
+            }
+            recordLatency(std::chrono::steady_clock::now() - balanced_call->started_at);
+            balanced_call->handler(return_code, data, len);
+        });
+    trackCopy(balanced_call->copies, instance, session);
+}
+
+std::chrono::nanoseconds RpcClient::hedgeDelay() {
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    return std::chrono::nanoseconds(hedge_delay_ns_);
+}
+
+void RpcClient::recordLatency(std::chrono::nanoseconds latency) {
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    if (!lb_config_.hedging_enabled) {
+        return;
+    }
+    if (latency_samples_ns_.size() < lb_config_.latency_window) {
+        latency_samples_ns_.push_back(latency.count());
+    } else {
+        latency_samples_ns_[latency_next_] = latency.count();
+    }
+    latency_next_ = (latency_next_ + 1) % lb_config_.latency_window;
+
+    // Re-derive the percentile every few samples rather than on every call.
+    if (++samples_since_recompute_ < 32) {
+        return;
+    }
+    samples_since_recompute_ = 0;
+    std::vector<int64_t> sorted(latency_samples_ns_);
+    size_t rank = static_cast<size_t>(lb_config_.hedge_percentile * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    int64_t min_delay = std::chrono::duration_cast<std::chrono::nanoseconds>(lb_config_.min_hedge_delay).count();
+    hedge_delay_ns_ = std::max<int64_t>({sorted[rank], min_delay, 1});
+}
+
 std::string RpcClient::getServiceName() const {
     return service_name_;
 }
 
 bool RpcClient::isServiceAvailable() const {
-    return service_available_;
+    return availability_.isAvailable();
+}
+
+bool RpcClient::waitForAvailability(std::chrono::milliseconds timeout) const {
+    return availability_.waitFor(timeout);
+}
+
+std::future<bool> RpcClient::whenAvailable() {
+    return availability_.whenAvailable();
+}
+
+ServiceAvailability::CallbackId RpcClient::onAvailabilityChange(ServiceAvailability::Callback callback) {
+    return availability_.onChange(std::move(callback));
+}
+
+void RpcClient::removeAvailabilityCallback(ServiceAvailability::CallbackId id) {
+    availability_.removeCallback(id);
 }
 
 } // namespace comms_stack
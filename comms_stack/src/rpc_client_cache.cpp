@@ -0,0 +1,140 @@
+#include "rpc_client_cache.h"
+#include "hash_utils.h"
+
+namespace comms_stack {
+
+constexpr std::chrono::milliseconds RpcClientCache::IN_FLIGHT_TIMEOUT;
+constexpr size_t RpcClientCache::MAX_ENTRIES;
+
+void RpcClientCache::enableMethod(uint16_t method_id, std::chrono::milliseconds ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    method_ttls_[method_id] = ttl;
+}
+
+void RpcClientCache::disableMethod(uint16_t method_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    method_ttls_.erase(method_id);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        // In-flight entries stay so their waiters still get the leader's response.
+        if (it->first.method_id == method_id && !it->second.in_flight) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool RpcClientCache::isMethodEnabled(uint16_t method_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return method_ttls_.count(method_id) > 0;
+}
+
+RpcClientCache::Key RpcClientCache::makeKey(uint16_t method_id, const uint8_t* request_data, size_t request_len) const {
+    return Key{method_id, fnv1a64(request_data, request_len)};
+}
+
+RpcClientCache::LookupResult RpcClientCache::lookup(const Key& key, std::vector<uint8_t>& cached_response,
+                                                    ResponseHandler& waiter) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        Entry& entry = it->second;
+        if (entry.in_flight) {
+            if (now - entry.in_flight_since < IN_FLIGHT_TIMEOUT) {
+                entry.waiters.push_back(std::move(waiter));
+                ++coalesced_;
+                return LookupResult::Coalesced;
+            }
+            // The leader never got an answer; release its waiters and take over.
+            entry.waiters.clear();
+        } else if (now < entry.expires_at) {
+            cached_response = entry.response;
+            ++hits_;
+            return LookupResult::Hit;
+        }
+    } else if (entries_.size() >= MAX_ENTRIES) {
+        sweepExpired(now);
+    }
+
+    Entry& entry = entries_[key];
+    entry.response.clear();
+    entry.in_flight = true;
+    entry.in_flight_since = now;
+    ++misses_;
+    return LookupResult::Leader;
+}
+
+std::vector<RpcClientCache::ResponseHandler> RpcClientCache::complete(const Key& key, int return_code,
+                                                                      const uint8_t* data, size_t len) {
+    std::vector<ResponseHandler> waiters;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        return waiters;
+    }
+    waiters.swap(it->second.waiters);
+
+    auto ttl_it = method_ttls_.find(key.method_id);
+    if (return_code != 0 || ttl_it == method_ttls_.end() || entries_.size() > MAX_ENTRIES) {
+        // Errors are shared with the coalesced callers but never cached.
+        entries_.erase(it);
+        return waiters;
+    }
+    Entry& entry = it->second;
+    entry.response.assign(data, data + len);
+    entry.in_flight = false;
+    entry.expires_at = std::chrono::steady_clock::now() + ttl_it->second;
+    return waiters;
+}
+
+bool RpcClientCache::abandonIfUnshared(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || !it->second.in_flight) {
+        return true;
+    }
+    if (!it->second.waiters.empty()) {
+        return false;
+    }
+    entries_.erase(it);
+    return true;
+}
+
+void RpcClientCache::sweepExpired(std::chrono::steady_clock::time_point now) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (!it->second.in_flight && now >= it->second.expires_at) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RpcClientCache::clearInFlight() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.in_flight) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RpcClientCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+RpcClientCache::Stats RpcClientCache::getStats() const {
+    Stats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace comms_stack
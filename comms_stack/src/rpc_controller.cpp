@@ -0,0 +1,106 @@
+#include "rpc_controller.h"
+
+namespace comms_stack {
+
+ServerRpcController::~ServerRpcController() {
+    complete(); // A registered callback must still run exactly once
+}
+
+void ServerRpcController::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = false;
+    error_text_.clear();
+}
+
+bool ServerRpcController::Failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+std::string ServerRpcController::ErrorText() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_text_;
+}
+
+void ServerRpcController::SetFailed(const std::string& reason) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = true;
+    error_text_ = reason;
+}
+
+bool ServerRpcController::IsCanceled() const {
+    return canceled_.load(std::memory_order_acquire);
+}
+
+void ServerRpcController::NotifyOnCancel(::google::protobuf::Closure* callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!canceled_.load(std::memory_order_relaxed)) {
+            cancel_callback_ = callback;
+            return;
+        }
+    }
+    callback->Run();
+}
+
+void ServerRpcController::cancel() {
+    ::google::protobuf::Closure* callback = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (canceled_.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        std::swap(callback, cancel_callback_);
+    }
+    if (callback) {
+        callback->Run();
+    }
+}
+
+void ServerRpcController::complete() {
+    ::google::protobuf::Closure* callback = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(callback, cancel_callback_);
+    }
+    if (callback) {
+        callback->Run();
+    }
+}
+
+std::shared_ptr<ServerRpcController> RpcCallRegistry::begin(uint16_t client_id, uint16_t session_id) {
+    auto controller = std::make_shared<ServerRpcController>();
+    std::lock_guard<std::mutex> lock(mutex_);
+    calls_[std::make_pair(client_id, session_id)] = controller;
+    active_.store(calls_.size(), std::memory_order_relaxed);
+    return controller;
+}
+
+void RpcCallRegistry::end(uint16_t client_id, uint16_t session_id,
+                          const std::shared_ptr<ServerRpcController>& controller) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = calls_.find(std::make_pair(client_id, session_id));
+        if (it != calls_.end() && it->second == controller) {
+            calls_.erase(it);
+            active_.store(calls_.size(), std::memory_order_relaxed);
+        }
+    }
+    controller->complete();
+}
+
+bool RpcCallRegistry::cancel(uint16_t client_id, uint16_t session_id) {
+    std::shared_ptr<ServerRpcController> controller;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = calls_.find(std::make_pair(client_id, session_id));
+        if (it == calls_.end()) {
+            return false;
+        }
+        controller = it->second;
+    }
+    controller->cancel();
+    return true;
+}
+
+} // namespace comms_stack
@@ -0,0 +1,122 @@
+#include "rpc_response_cache.h"
+#include "hash_utils.h"
+
+namespace comms_stack {
+
+namespace {
+constexpr uint64_t IDEMPOTENT_SCOPE_BIT = 1ULL << 63;
+}
+
+RpcResponseCache::RpcResponseCache(const RpcResponseCacheConfig& config)
+    : config_(config) {
+    if (config_.max_entries == 0) {
+        config_.max_entries = 1;
+    }
+    index_.reserve(config_.max_entries);
+}
+
+RpcResponseCache::Key RpcResponseCache::makeKey(uint16_t method_id, uint16_t client_id, uint16_t session_id,
+                                                const uint8_t* request_data, size_t request_len) const {
+    Key key;
+    key.request_hash = fnv1a64(request_data, request_len);
+    if (config_.idempotent_methods.count(method_id)) {
+        key.scope = IDEMPOTENT_SCOPE_BIT | method_id;
+    } else {
+        // The request hash stays part of the key so a wrapped-around session ID carrying a
+        // different request is not answered with a stale response.
+        key.scope = (static_cast<uint64_t>(method_id) << 32) |
+                    (static_cast<uint64_t>(client_id) << 16) |
+                    session_id;
+    }
+    return key;
+}
+
+bool RpcResponseCache::isIdempotentKey(const Key& key) {
+    return (key.scope & IDEMPOTENT_SCOPE_BIT) != 0;
+}
+
+RpcResponseCache::LookupResult RpcResponseCache::lookupOrReserve(const Key& key, std::vector<uint8_t>& cached_response) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        Entry& entry = *it->second;
+        if (now - entry.stored_at <= config_.ttl) {
+            if (!entry.in_flight) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                cached_response = entry.response;
+                ++stats_.hits;
+                return LookupResult::Hit;
+            }
+            if (!isIdempotentKey(key)) {
+                ++stats_.duplicates_dropped;
+                return LookupResult::InFlight;
+            }
+            // Same request from another client while the first is still executing:
+            // let it run rather than leave the second caller without a response.
+            ++stats_.misses;
+            return LookupResult::Miss;
+        }
+        // Expired (or an in-flight marker whose handler never completed)
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    ++stats_.misses;
+    lru_.push_front(Entry{key, {}, now, true});
+    index_[key] = lru_.begin();
+    evictIfNeeded();
+    return LookupResult::Miss;
+}
+
+void RpcResponseCache::store(const Key& key, std::vector<uint8_t> serialized_response) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        Entry& entry = *it->second;
+        entry.response = std::move(serialized_response);
+        entry.stored_at = now;
+        entry.in_flight = false;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    // Marker was evicted while the handler ran; insert afresh.
+    lru_.push_front(Entry{key, std::move(serialized_response), now, false});
+    index_[key] = lru_.begin();
+    evictIfNeeded();
+}
+
+void RpcResponseCache::abandon(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end() && it->second->in_flight) {
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+}
+
+void RpcResponseCache::evictIfNeeded() {
+    while (lru_.size() > config_.max_entries) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+void RpcResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+}
+
+RpcResponseCache::Stats RpcResponseCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.entries = lru_.size();
+    return stats;
+}
+
+} // namespace comms_stack
@@ -0,0 +1,341 @@
+#include "rpc_stream.h"
+#include "rpc_client.h"
+#include "transport.h"
+#include "logging.h"
+#include <vsomeip/vsomeip.hpp>
+#include <algorithm>
+#include <set>
+#include <thread>
+
+namespace comms_stack {
+
+constexpr size_t StreamFrameHeader::SIZE;
+constexpr uint8_t StreamFrameHeader::FLAG_END;
+constexpr size_t StreamControl::SIZE;
+constexpr uint8_t StreamControl::FLAG_CANCEL;
+constexpr std::chrono::seconds ServerStreamWriter::CREDIT_TIMEOUT;
+
+namespace {
+// Upper bound on outstanding credits a client can grant a single stream.
+constexpr uint32_t MAX_STREAM_CREDITS = 1u << 20;
+
+void putU16(uint8_t* out, uint16_t v) {
+    out[0] = static_cast<uint8_t>(v >> 8);
+    out[1] = static_cast<uint8_t>(v);
+}
+void putU32(uint8_t* out, uint32_t v) {
+    out[0] = static_cast<uint8_t>(v >> 24);
+    out[1] = static_cast<uint8_t>(v >> 16);
+    out[2] = static_cast<uint8_t>(v >> 8);
+    out[3] = static_cast<uint8_t>(v);
+}
+uint16_t getU16(const uint8_t* in) {
+    return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+uint32_t getU32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+} // namespace
+
+void StreamFrameHeader::encode(uint8_t* out) const {
+    putU16(out, client);
+    putU16(out + 2, session);
+    putU32(out + 4, sequence);
+    out[8] = flags;
+    out[9] = status;
+}
+
+bool StreamFrameHeader::decode(const uint8_t* data, size_t len, StreamFrameHeader& out) {
+    if (!data || len < SIZE) {
+        return false;
+    }
+    out.client = getU16(data);
+    out.session = getU16(data + 2);
+    out.sequence = getU32(data + 4);
+    out.flags = data[8];
+    out.status = data[9];
+    return true;
+}
+
+void StreamControl::encode(uint8_t* out) const {
+    putU16(out, session);
+    putU32(out + 2, credits);
+    out[6] = flags;
+}
+
+bool StreamControl::decode(const uint8_t* data, size_t len, StreamControl& out) {
+    if (!data || len < SIZE) {
+        return false;
+    }
+    out.session = getU16(data);
+    out.credits = getU32(data + 2);
+    out.flags = data[6];
+    return true;
+}
+
+// --- Client side ---
+
+void ClientStream::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_) {
+            return;
+        }
+    }
+    client_->sendStreamControl(instance_, session_, 0, StreamControl::FLAG_CANCEL);
+    client_->finishStream(shared_from_this(), static_cast<int>(vsomeip::return_code_e::E_NOT_OK), "Cancelled");
+}
+
+bool ClientStream::isFinished() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_;
+}
+
+int ClientStream::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    completed_cv_.wait(lock, [this] { return completed_; });
+    return status_;
+}
+
+// --- Server side ---
+
+struct ServerStreamWriter::State {
+    std::shared_ptr<Transport> transport;
+    uint16_t service_id = 0;
+    uint16_t instance_id = 0;
+    vsomeip::client_t client = 0;
+    vsomeip::session_t session = 0;
+
+    std::mutex mutex;
+    std::condition_variable credit_cv;
+    uint32_t credits = 0;
+    uint32_t next_sequence = 0;
+    bool finished = false;        // Terminal frame sent (or not needed)
+    bool cancelled = false;       // Producer must stop; see abort_status
+    bool client_cancelled = false; // Client asked to stop; it expects no terminal frame
+    int abort_status = 0;
+    std::string abort_error;
+};
+
+void ServerStreamWriter::sendFrame(uint32_t sequence, uint8_t flags, uint8_t status, const uint8_t* data, size_t len) {
+    State& state = *state_;
+    StreamFrameHeader header;
+    header.client = state.client;
+    header.session = state.session;
+    header.sequence = sequence;
+    header.flags = flags;
+    header.status = status;
+
+    std::vector<vsomeip::byte_t> buffer(StreamFrameHeader::SIZE + len);
+    header.encode(buffer.data());
+    if (len > 0) {
+        std::copy(data, data + len, buffer.begin() + StreamFrameHeader::SIZE);
+    }
+    std::shared_ptr<vsomeip::payload> payload = vsomeip::runtime::get()->create_payload();
+    payload->set_data(std::move(buffer));
+    state.transport->notifyOne(state.service_id, state.instance_id, STREAM_EVENT_ID, payload, state.client);
+}
+
+bool ServerStreamWriter::write(const ::google::protobuf::MessageLite& item) {
+    std::string serialized;
+    if (!item.SerializeToString(&serialized)) {
+        COMMS_LOG_ERROR("RpcStreamServer: Failed to serialize stream item.");
+        return false;
+    }
+    return writeRaw(reinterpret_cast<const uint8_t*>(serialized.data()), serialized.size());
+}
+
+bool ServerStreamWriter::writeRaw(const uint8_t* data, size_t len) {
+    State& state = *state_;
+    uint32_t sequence = 0;
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        if (state.finished) {
+            return false;
+        }
+        if (!state.credit_cv.wait_for(lock, CREDIT_TIMEOUT,
+                                      [&state] { return state.credits > 0 || state.cancelled; })) {
+            COMMS_LOG_ERROR("RpcStreamServer: No credit from client 0x{:x} for session 0x{:x}, giving up.",
+                            state.client, state.session);
+            state.cancelled = true;
+            state.abort_status = static_cast<int>(vsomeip::return_code_e::E_TIMEOUT);
+            state.abort_error = "Flow control timeout";
+        }
+        if (state.cancelled) {
+            return false;
+        }
+        --state.credits;
+        sequence = state.next_sequence++;
+    }
+    sendFrame(sequence, 0, 0, data, len);
+    return true;
+}
+
+void ServerStreamWriter::finish(int status, const std::string& error) {
+    State& state = *state_;
+    uint32_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.finished) {
+            return;
+        }
+        state.finished = true;
+        if (state.client_cancelled) {
+            return;
+        }
+        sequence = state.next_sequence++;
+    }
+    // The terminal frame is not subject to flow control.
+    sendFrame(sequence, StreamFrameHeader::FLAG_END, static_cast<uint8_t>(status),
+              status != 0 ? reinterpret_cast<const uint8_t*>(error.data()) : nullptr,
+              status != 0 ? error.size() : 0);
+}
+
+bool ServerStreamWriter::isCancelled() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->cancelled;
+}
+
+RpcStreamServer::RpcStreamServer(std::shared_ptr<Transport> transport, uint16_t service_id, uint16_t instance_id)
+    : transport_(std::move(transport)), service_id_(service_id), instance_id_(instance_id) {
+    std::set<vsomeip::eventgroup_t> event_groups{STREAM_EVENTGROUP_ID};
+    transport_->offerEvent(service_id_, instance_id_, STREAM_EVENT_ID, event_groups, true); // Like the control requests
+    transport_->registerMessageHandler(
+        service_id_, instance_id_, METHOD_ID_STREAM_CONTROL,
+        [this](const std::shared_ptr<vsomeip::message>& msg) { onControl(msg); });
+    COMMS_LOG_INFO("RpcStreamServer: Offered stream event 0x{:x} on service 0x{:x}, instance 0x{:x}",
+                   STREAM_EVENT_ID, service_id_, instance_id_);
+}
+
+RpcStreamServer::~RpcStreamServer() {
+    transport_->unregisterMessageHandler(service_id_, instance_id_, METHOD_ID_STREAM_CONTROL);
+    for (uint16_t method_id : method_ids_) {
+        transport_->unregisterMessageHandler(service_id_, instance_id_, method_id);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+    for (auto& entry : streams_) {
+        std::lock_guard<std::mutex> state_lock(entry.second->mutex);
+        if (!entry.second->cancelled) {
+            entry.second->cancelled = true;
+            entry.second->abort_status = static_cast<int>(vsomeip::return_code_e::E_NOT_REACHABLE);
+            entry.second->abort_error = "Stream server stopped";
+        }
+        entry.second->credit_cv.notify_all();
+    }
+    streams_done_cv_.wait(lock, [this] { return streams_.empty(); });
+    lock.unlock();
+
+    transport_->stopOfferEvent(service_id_, instance_id_, STREAM_EVENT_ID);
+}
+
+void RpcStreamServer::addMethod(uint16_t method_id, const std::string& method_name, StreamMethodHandler handler) {
+    method_ids_.push_back(method_id);
+    transport_->registerMessageHandler(
+        service_id_, instance_id_, method_id,
+        [this, method_name, handler](const std::shared_ptr<vsomeip::message>& msg) { onOpen(msg, method_name, handler); });
+    COMMS_LOG_INFO("RpcStreamServer: Registered stream method {} (0x{:x})", method_name, method_id);
+}
+
+size_t RpcStreamServer::activeStreams() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return streams_.size();
+}
+
+void RpcStreamServer::onOpen(const std::shared_ptr<vsomeip::message>& msg, const std::string& method_name,
+                             const StreamMethodHandler& handler) {
+    if (msg->get_message_type() != vsomeip::message_type_e::MT_REQUEST) {
+        return;
+    }
+    auto key = std::make_pair(msg->get_client(), msg->get_session());
+    auto state = std::make_shared<ServerStreamWriter::State>();
+    state->transport = transport_;
+    state->service_id = service_id_;
+    state->instance_id = instance_id_;
+    state->client = key.first;
+    state->session = key.second;
+
+    vsomeip::return_code_e ack_code = vsomeip::return_code_e::E_OK;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            ack_code = vsomeip::return_code_e::E_NOT_READY;
+        } else if (streams_.count(key)) {
+            return; // Duplicated open request; the stream is already running
+        } else {
+            streams_[key] = state;
+        }
+    }
+
+    std::shared_ptr<vsomeip::message> ack = vsomeip::runtime::get()->create_response(msg);
+    ack->set_return_code(ack_code);
+    transport_->send(ack);
+    if (ack_code != vsomeip::return_code_e::E_OK) {
+        return;
+    }
+
+    COMMS_LOG_INFO("RpcStreamServer: Opened {} stream (Client: 0x{:x}, Session: 0x{:x})",
+                   method_name, key.first, key.second);
+
+    std::vector<uint8_t> request;
+    auto payload = msg->get_payload();
+    if (payload && payload->get_length() > 0) {
+        request.assign(payload->get_data(), payload->get_data() + payload->get_length());
+    }
+    std::thread(&RpcStreamServer::runStream, this, state, handler, std::move(request), method_name).detach();
+}
+
+void RpcStreamServer::onControl(const std::shared_ptr<vsomeip::message>& msg) {
+    auto payload = msg->get_payload();
+    StreamControl control;
+    if (!payload || !StreamControl::decode(payload->get_data(), payload->get_length(), control)) {
+        COMMS_LOG_ERROR("RpcStreamServer: Malformed stream control message.");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = streams_.find(std::make_pair(msg->get_client(), control.session));
+    if (it == streams_.end()) {
+        return; // Stream already ended
+    }
+    ServerStreamWriter::State& state = *it->second;
+    std::lock_guard<std::mutex> state_lock(state.mutex);
+    if (control.flags & StreamControl::FLAG_CANCEL) {
+        state.cancelled = true;
+        state.client_cancelled = true;
+    } else {
+        state.credits = std::min(MAX_STREAM_CREDITS, state.credits + std::min(control.credits, MAX_STREAM_CREDITS));
+    }
+    state.credit_cv.notify_all();
+}
+
+void RpcStreamServer::runStream(std::shared_ptr<ServerStreamWriter::State> state, StreamMethodHandler handler,
+                                std::vector<uint8_t> request, std::string method_name) {
+    ServerStreamWriter writer(state);
+    try {
+        handler(request.data(), request.size(), writer);
+    } catch (const std::exception& e) {
+        COMMS_LOG_ERROR("RpcStreamServer: {} handler threw: {}", method_name, e.what());
+        writer.finish(static_cast<int>(vsomeip::return_code_e::E_NOT_OK), e.what());
+    }
+
+    int status = 0;
+    std::string error;
+    {
+        std::lock_guard<std::mutex> state_lock(state->mutex);
+        status = state->abort_status;
+        error = state->abort_error;
+    }
+    writer.finish(status, error); // No-op if the handler already finished
+
+    COMMS_LOG_INFO("RpcStreamServer: Closed {} stream (Client: 0x{:x}, Session: 0x{:x})",
+                   method_name, state->client, state->session);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.erase(std::make_pair(state->client, state->session));
+    streams_done_cv_.notify_all();
+}
+
+} // namespace comms_stack
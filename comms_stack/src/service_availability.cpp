@@ -0,0 +1,97 @@
+#include "service_availability.h"
+
+namespace comms_stack {
+
+ServiceAvailability::~ServiceAvailability() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& waiter : waiters_) {
+        waiter.set_value(false);
+    }
+}
+
+void ServiceAvailability::set(bool available) {
+    std::lock_guard<std::mutex> dispatch(dispatch_mutex_);
+    std::vector<std::promise<bool>> ready;
+    std::vector<CallbackId> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (available_.exchange(available, std::memory_order_acq_rel) == available) {
+            return;
+        }
+        if (available) {
+            ready.swap(waiters_);
+        }
+        for (const auto& entry : callbacks_) {
+            ids.push_back(entry.first);
+        }
+    }
+    available_cv_.notify_all();
+    for (auto& waiter : ready) {
+        waiter.set_value(true);
+    }
+
+    // Like CancellationToken, callbacks run one at a time outside the lock, so removeCallback()
+    // can wait for exactly the one it is removing.
+    for (CallbackId id : ids) {
+        Callback callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = callbacks_.find(id);
+            if (it == callbacks_.end()) {
+                continue; // Removed meanwhile
+            }
+            callback = it->second;
+            running_id_ = id;
+            running_thread_ = std::this_thread::get_id();
+        }
+        callback(available);
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_id_ = 0;
+        callback_done_cv_.notify_all();
+    }
+}
+
+bool ServiceAvailability::waitFor(std::chrono::milliseconds timeout) const {
+    if (isAvailable()) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    return available_cv_.wait_for(lock, timeout, [this] { return isAvailable(); });
+}
+
+std::future<bool> ServiceAvailability::whenAvailable() {
+    std::promise<bool> promise;
+    std::future<bool> future = promise.get_future();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (isAvailable()) {
+        promise.set_value(true);
+    } else {
+        waiters_.push_back(std::move(promise));
+    }
+    return future;
+}
+
+ServiceAvailability::CallbackId ServiceAvailability::onChange(Callback callback) {
+    CallbackId id;
+    bool available;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_id_++;
+        callbacks_.emplace(id, callback);
+        available = isAvailable();
+    }
+    if (available) {
+        callback(true);
+    }
+    return id;
+}
+
+void ServiceAvailability::removeCallback(CallbackId id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    callbacks_.erase(id);
+    if (running_id_ == id && running_thread_ != std::this_thread::get_id()) {
+        callback_done_cv_.wait(lock, [this, id] { return running_id_ != id; });
+    }
+}
+
+} // namespace comms_stack
@@ -0,0 +1,126 @@
+#include "sharded_communication_manager.h"
+#include "logging.h"
+#include <cstdlib> // For std::getenv
+
+namespace comms_stack {
+
+ShardedCommunicationManager::~ShardedCommunicationManager() {
+    shutdown();
+}
+
+bool ShardedCommunicationManager::init(const Options& options) {
+    if (!shards_.empty()) {
+        COMMS_LOG_INFO("ShardedCommunicationManager: Already initialized with {} shard(s).", shards_.size());
+        return true;
+    }
+    if (options.app_names.empty()) {
+        COMMS_LOG_ERROR("ShardedCommunicationManager: No application names given.");
+        return false;
+    }
+    // All configuration files are written before the first shard starts its threads, since
+    // writing one calls setenv(). vsomeip has read them once the shards are initialized.
+    std::vector<std::string> dispatcher_configs;
+    if (options.dispatcher_threads > 0) {
+        const char* env_config = std::getenv("VSOMEIP_CONFIGURATION");
+        const std::string base_config = !options.config_path.empty() ? options.config_path : (env_config ? env_config : "");
+        for (const std::string& app_name : options.app_names) {
+            const std::string path = base_config.empty() ? std::string()
+                : CommunicationManager::writeDispatcherConfig(app_name, base_config, options.dispatcher_threads);
+            if (path.empty()) {
+                COMMS_LOG_WARN("ShardedCommunicationManager: Keeping the configured dispatcher threads for {}", app_name);
+            } else {
+                dispatcher_configs.push_back(path);
+            }
+        }
+    }
+    auto remove_dispatcher_configs = [&dispatcher_configs]() {
+        for (const std::string& path : dispatcher_configs) {
+            CommunicationManager::removeDispatcherConfig(path);
+        }
+    };
+
+    for (const std::string& app_name : options.app_names) {
+        CommunicationManager::Options shard_options;
+        shard_options.app_name = app_name;
+        shard_options.config_path = options.config_path;
+        shard_options.dispatcher_threads = 0; // Written above
+        if (!options.discovery_cache_directory.empty()) {
+            shard_options.discovery_cache_path = options.discovery_cache_directory + "/" + app_name + ".discovery.json";
+        }
+
+        std::unique_ptr<CommunicationManager> shard(new CommunicationManager());
+        if (!shard->init(shard_options)) {
+            COMMS_LOG_ERROR("ShardedCommunicationManager: Failed to initialize shard {}", app_name);
+            shutdown();
+            remove_dispatcher_configs();
+            return false;
+        }
+        shards_.push_back(std::move(shard));
+    }
+    remove_dispatcher_configs();
+    COMMS_LOG_INFO("ShardedCommunicationManager: Initialized {} shard(s).", shards_.size());
+    return true;
+}
+
+void ShardedCommunicationManager::shutdown() {
+    for (auto& shard : shards_) {
+        shard->shutdown();
+    }
+    shards_.clear();
+}
+
+size_t ShardedCommunicationManager::shardOfTopic(TopicHandle topic) const {
+    const TopicEntry* entry = shards_.empty() ? nullptr : shards_[0]->getTopicRegistry().topic(topic);
+    if (!entry) {
+        return 0;
+    }
+    return (entry->shard >= 0 ? static_cast<size_t>(entry->shard) : topic) % shards_.size();
+}
+
+size_t ShardedCommunicationManager::shardOfService(ServiceHandle service) const {
+    const ServiceEntry* entry = shards_.empty() ? nullptr : shards_[0]->getTopicRegistry().service(service);
+    if (!entry) {
+        return 0;
+    }
+    return (entry->shard >= 0 ? static_cast<size_t>(entry->shard) : service) % shards_.size();
+}
+
+std::shared_ptr<Publisher> ShardedCommunicationManager::getPublisher(const std::string& topic_name) {
+    if (shards_.empty()) {
+        COMMS_LOG_ERROR("ShardedCommunicationManager: Not initialized. Cannot get publisher.");
+        return nullptr;
+    }
+    TopicHandle topic = shards_[0]->findTopic(topic_name);
+    return shards_[shardOfTopic(topic)]->getPublisher(topic);
+}
+
+std::shared_ptr<Subscriber> ShardedCommunicationManager::getSubscriber(const std::string& topic_name) {
+    if (shards_.empty()) {
+        COMMS_LOG_ERROR("ShardedCommunicationManager: Not initialized. Cannot get subscriber.");
+        return nullptr;
+    }
+    TopicHandle topic = shards_[0]->findTopic(topic_name);
+    return shards_[shardOfTopic(topic)]->getSubscriber(topic);
+}
+
+std::shared_ptr<RpcClient> ShardedCommunicationManager::getRpcClient(const std::string& service_name) {
+    if (shards_.empty()) {
+        COMMS_LOG_ERROR("ShardedCommunicationManager: Not initialized. Cannot get RPC client.");
+        return nullptr;
+    }
+    ServiceHandle service = shards_[0]->findService(service_name);
+    return shards_[shardOfService(service)]->getRpcClient(service);
+}
+
+void ShardedCommunicationManager::registerRpcService(const std::string& service_name,
+                                                     std::shared_ptr<protos::SampleRpc> service_impl,
+                                                     const RpcResponseCacheConfig& cache_config) {
+    if (shards_.empty()) {
+        COMMS_LOG_ERROR("ShardedCommunicationManager: Not initialized. Cannot register RPC service {}", service_name);
+        return;
+    }
+    ServiceHandle service = shards_[0]->findService(service_name);
+    shards_[shardOfService(service)]->registerRpcService(service_name, std::move(service_impl), cache_config);
+}
+
+} // namespace comms_stack
@@ -0,0 +1,291 @@
+#include "shm_ring.h"
+#include "logging.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace comms_stack {
+
+namespace {
+const uint32_t RING_MAGIC = 0x43535252; // "CSRR"
+const uint32_t RING_VERSION = 1;
+const size_t CACHE_LINE = 64;
+
+size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+// Shared between processes, so only lock-free atomics and plain data.
+struct ShmRingHeader {
+    std::atomic<uint32_t> magic; // Stored last by the writer; readers ignore the file until set
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint64_t slot_stride;
+    uint64_t slots_offset;
+    int32_t writer_pid;
+    alignas(CACHE_LINE) std::atomic<uint64_t> write_seq; // Messages written so far
+    alignas(CACHE_LINE) std::atomic<uint32_t> futex_word; // Bumped on every write and wake()
+    std::atomic<uint32_t> waiters;
+};
+
+// Message n (counting from 1) lives in slot (n - 1) % slot_count. seq is 2n - 1 while the writer
+// fills the slot and 2n once it is complete.
+struct ShmSlot {
+    std::atomic<uint64_t> seq;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory ring needs lock-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared-memory ring needs lock-free 32-bit atomics");
+
+namespace {
+
+ShmSlot* slotFor(ShmRingHeader* header, uint64_t seq) {
+    uint8_t* base = reinterpret_cast<uint8_t*>(header) + header->slots_offset;
+    return reinterpret_cast<ShmSlot*>(base + ((seq - 1) % header->slot_count) * header->slot_stride);
+}
+
+uint8_t* slotData(ShmSlot* slot) {
+    return reinterpret_cast<uint8_t*>(slot) + sizeof(ShmSlot);
+}
+
+long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const struct timespec* timeout) {
+    // Not FUTEX_PRIVATE_FLAG: waiters and wakers are in different processes.
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+}
+
+void wakeAll(ShmRingHeader* header) {
+    header->futex_word.fetch_add(1);
+    if (header->waiters.load() > 0) {
+        futex(&header->futex_word, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+bool processAlive(int32_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+} // namespace
+
+std::string shmRingPath(const std::string& directory, uint16_t service_id, uint16_t instance_id, uint16_t event_id) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "comms_stack_%04x_%04x_%04x", service_id, instance_id, event_id);
+    return directory + "/" + name;
+}
+
+ShmRingWriter::~ShmRingWriter() {
+    close();
+}
+
+bool ShmRingWriter::create(const std::string& path, uint32_t slot_count, uint32_t slot_size) {
+    close();
+    if (slot_count == 0 || slot_size == 0) {
+        COMMS_LOG_ERROR("ShmRingWriter: Invalid ring geometry for {}", path);
+        return false;
+    }
+    const size_t slots_offset = roundUp(sizeof(ShmRingHeader), CACHE_LINE);
+    const size_t slot_stride = roundUp(sizeof(ShmSlot) + slot_size, CACHE_LINE);
+    const size_t total_size = slots_offset + slot_stride * slot_count;
+
+    // Built under a temporary name and renamed into place, so readers never see a partial ring.
+    const std::string temp_path = path + "." + std::to_string(getpid()) + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0660);
+    if (fd < 0) {
+        COMMS_LOG_ERROR("ShmRingWriter: Cannot create {}: {}", temp_path, std::strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(total_size)) != 0) {
+        COMMS_LOG_ERROR("ShmRingWriter: Cannot size {}: {}", temp_path, std::strerror(errno));
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        COMMS_LOG_ERROR("ShmRingWriter: Cannot map {}: {}", temp_path, std::strerror(errno));
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+
+    // The file is zero-filled, which is a valid state for every atomic and every slot.
+    ShmRingHeader* header = static_cast<ShmRingHeader*>(memory);
+    header->version = RING_VERSION;
+    header->slot_count = slot_count;
+    header->slot_size = slot_size;
+    header->slot_stride = slot_stride;
+    header->slots_offset = slots_offset;
+    header->writer_pid = getpid();
+    header->magic.store(RING_MAGIC, std::memory_order_release);
+
+    if (::rename(temp_path.c_str(), path.c_str()) != 0) {
+        COMMS_LOG_ERROR("ShmRingWriter: Cannot publish {}: {}", path, std::strerror(errno));
+        munmap(memory, total_size);
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    header_ = header;
+    mapped_size_ = total_size;
+    path_ = path;
+    return true;
+}
+
+void ShmRingWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!header_) {
+        return;
+    }
+    header_->writer_pid = 0; // Late attachers treat the ring as orphaned
+    wakeAll(header_);
+    munmap(header_, mapped_size_);
+    ::unlink(path_.c_str());
+    header_ = nullptr;
+    mapped_size_ = 0;
+    path_.clear();
+}
+
+uint32_t ShmRingWriter::slotSize() const {
+    return header_ ? header_->slot_size : 0;
+}
+
+bool ShmRingWriter::write(size_t length, const std::function<bool(uint8_t* slot)>& fill) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!header_ || length > header_->slot_size) {
+        return false;
+    }
+    const uint64_t seq = header_->write_seq.load(std::memory_order_relaxed) + 1;
+    ShmSlot* slot = slotFor(header_, seq);
+
+    slot->seq.store(2 * seq - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // Odd seq is visible before any payload byte
+    if (!fill(slotData(slot))) {
+        return false; // The odd seq keeps readers off the half-overwritten slot; seq is reused next time
+    }
+    slot->length = static_cast<uint32_t>(length);
+    slot->seq.store(2 * seq, std::memory_order_release);
+    header_->write_seq.store(seq, std::memory_order_release);
+    wakeAll(header_);
+    return true;
+}
+
+ShmRingReader::~ShmRingReader() {
+    detach();
+}
+
+bool ShmRingReader::attach(const std::string& path) {
+    detach();
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC); // Writable for the futex and waiter count
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        COMMS_LOG_ERROR("ShmRingReader: Cannot map {}: {}", path, std::strerror(errno));
+        return false;
+    }
+    ShmRingHeader* header = static_cast<ShmRingHeader*>(memory);
+    if (header->magic.load(std::memory_order_acquire) != RING_MAGIC || header->version != RING_VERSION ||
+        header->slots_offset + header->slot_stride * header->slot_count > size ||
+        !processAlive(header->writer_pid)) {
+        munmap(memory, size);
+        return false;
+    }
+    header_ = header;
+    mapped_size_ = size;
+    next_ = header->write_seq.load(std::memory_order_acquire) + 1;
+    lost_ = 0;
+    return true;
+}
+
+void ShmRingReader::detach() {
+    if (!header_) {
+        return;
+    }
+    munmap(header_, mapped_size_);
+    header_ = nullptr;
+    mapped_size_ = 0;
+}
+
+uint32_t ShmRingReader::slotSize() const {
+    return header_ ? header_->slot_size : 0;
+}
+
+ShmRingReader::Status ShmRingReader::read(const std::function<bool(const uint8_t* data, size_t length)>& parse) {
+    if (!header_) {
+        return Status::EMPTY;
+    }
+    const uint64_t written = header_->write_seq.load(std::memory_order_acquire);
+    if (next_ > written) {
+        return Status::EMPTY;
+    }
+    if (written - next_ >= header_->slot_count) {
+        // Lapped: everything older than one ring's worth is gone.
+        const uint64_t oldest = written - header_->slot_count + 1;
+        lost_ += oldest - next_;
+        next_ = oldest;
+    }
+
+    ShmSlot* slot = slotFor(header_, next_);
+    const uint64_t expected = 2 * next_;
+    if (slot->seq.load(std::memory_order_acquire) != expected) {
+        lost_++;
+        next_++;
+        return Status::LOST;
+    }
+    const size_t length = std::min<size_t>(slot->length, header_->slot_size); // Torn lengths stay in bounds
+    const bool parsed = parse(slotData(slot), length);
+    std::atomic_thread_fence(std::memory_order_acquire); // Payload reads complete before the re-check
+    if (slot->seq.load(std::memory_order_relaxed) != expected) {
+        lost_++;
+        next_++;
+        return Status::LOST;
+    }
+    next_++;
+    return parsed ? Status::MESSAGE : Status::INVALID;
+}
+
+void ShmRingReader::wait(std::chrono::milliseconds timeout) {
+    if (!header_) {
+        return;
+    }
+    // Announce the waiter before sampling the futex word; the writer bumps the word before
+    // checking for waiters, so either it sees us or we see its write.
+    header_->waiters.fetch_add(1);
+    const uint32_t observed = header_->futex_word.load();
+    if (header_->write_seq.load(std::memory_order_acquire) < next_) {
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+        ts.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+        futex(&header_->futex_word, FUTEX_WAIT, observed, &ts);
+    }
+    header_->waiters.fetch_sub(1);
+}
+
+void ShmRingReader::wake() {
+    if (header_) {
+        wakeAll(header_);
+    }
+}
+
+} // namespace comms_stack
@@ -0,0 +1,491 @@
+#include "someip_serializer.h"
+#include "logging.h"
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace comms_stack {
+
+namespace {
+
+const uint8_t UTF8_BOM[3] = {0xEF, 0xBB, 0xBF};
+
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Never shrinks: tables are referenced by pointer from per-thread caches and from each other.
+std::unordered_map<const google::protobuf::Descriptor*, std::unique_ptr<SomeIpSerializer>>& registry() {
+    static std::unordered_map<const google::protobuf::Descriptor*, std::unique_ptr<SomeIpSerializer>> table;
+    return table;
+}
+
+size_t alignUp(size_t offset, uint32_t alignment) {
+    return alignment > 1 ? (offset + alignment - 1) / alignment * alignment : offset;
+}
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+// Appends big-endian values at a running offset. With a null buffer it only counts, which is
+// how byteSize() works; length fields are written once their contents are.
+class SomeIpSerializer::Writer {
+public:
+    Writer(uint8_t* out, size_t capacity, const SomeIpOptions& options)
+        : out_(out), capacity_(capacity), options_(options) {}
+
+    void align() {
+        const size_t aligned = alignUp(offset_, options_.alignment);
+        if (out_ && fits(aligned - offset_)) {
+            std::memset(out_ + offset_, 0, aligned - offset_);
+        }
+        offset_ = aligned;
+    }
+    void put(uint64_t value, size_t width) {
+        if (out_ && fits(width)) {
+            store(offset_, value, width);
+        }
+        offset_ += width;
+    }
+    void bytes(const void* data, size_t size) {
+        if (out_ && fits(size)) {
+            std::memcpy(out_ + offset_, data, size);
+        }
+        offset_ += size;
+    }
+    size_t beginLength() {
+        const size_t position = offset_;
+        offset_ += options_.length_field_size;
+        return position;
+    }
+    void endLength(size_t position) {
+        const size_t width = options_.length_field_size;
+        const uint64_t length = offset_ - position - width;
+        if (length > (width < 4 ? (1ULL << (8 * width)) - 1 : 0xFFFFFFFFULL)) {
+            ok_ = false;
+        }
+        if (out_ && position + width <= capacity_) {
+            store(position, length, width);
+        }
+    }
+
+    // Fixed-size values are only skipped when counting.
+    void skip(size_t size) { offset_ += size; }
+    bool counting() const { return out_ == nullptr; }
+    size_t offset() const { return offset_; }
+    bool ok() const { return ok_; }
+
+private:
+    bool fits(size_t size) {
+        if (offset_ + size > capacity_) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+    void store(size_t position, uint64_t value, size_t width) {
+        for (size_t i = 0; i < width; ++i) {
+            out_[position + i] = static_cast<uint8_t>(value >> (8 * (width - 1 - i)));
+        }
+    }
+
+    uint8_t* out_;
+    size_t capacity_;
+    const SomeIpOptions& options_;
+    size_t offset_ = 0;
+    bool ok_ = true;
+};
+
+// Bounds-checked reads of big-endian values; arrays narrow the readable range to their length.
+class SomeIpSerializer::Reader {
+public:
+    Reader(const uint8_t* data, size_t length, const SomeIpOptions& options)
+        : data_(data), end_(length), options_(options) {}
+
+    bool align() {
+        const size_t aligned = alignUp(offset_, options_.alignment);
+        if (aligned > end_) {
+            return false;
+        }
+        offset_ = aligned;
+        return true;
+    }
+    bool get(size_t width, uint64_t& value) {
+        if (end_ - offset_ < width) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < width; ++i) {
+            value = (value << 8) | data_[offset_ + i];
+        }
+        offset_ += width;
+        return true;
+    }
+    // Reads a length field and returns the bytes it covers.
+    bool lengthPrefixed(const uint8_t*& bytes, size_t& size) {
+        uint64_t length;
+        if (!get(options_.length_field_size, length) || end_ - offset_ < length) {
+            return false;
+        }
+        bytes = data_ + offset_;
+        size = static_cast<size_t>(length);
+        offset_ += size;
+        return true;
+    }
+    // Reads a length field and limits reading to what it covers; returns the previous limit.
+    bool beginArray(size_t& outer_end) {
+        uint64_t length;
+        if (!get(options_.length_field_size, length) || end_ - offset_ < length) {
+            return false;
+        }
+        outer_end = end_;
+        end_ = offset_ + static_cast<size_t>(length);
+        return true;
+    }
+    void endArray(size_t outer_end) { end_ = outer_end; }
+    bool atEnd() const { return offset_ >= end_; }
+
+private:
+    const uint8_t* data_;
+    size_t end_;
+    const SomeIpOptions& options_;
+    size_t offset_ = 0;
+};
+
+const SomeIpSerializer* SomeIpSerializer::forType(const google::protobuf::Descriptor* descriptor) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    auto it = registry().find(descriptor);
+    if (it != registry().end()) {
+        return it->second->valid_ ? it->second.get() : nullptr;
+    }
+    SomeIpSerializer* serializer = build(descriptor);
+    // A type reached through a repeated field of itself (or of a type it contains) was still
+    // being built when that field was checked; invalidity spreads to whatever contains it.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto& entry : registry()) {
+            SomeIpSerializer& table = *entry.second;
+            if (!table.valid_) {
+                continue;
+            }
+            for (const Member& member : table.members_) {
+                if (member.nested && !member.nested->valid_) {
+                    table.valid_ = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    if (serializer->valid_) {
+        COMMS_LOG_INFO("SomeIpSerializer: Built table for {} ({} fields)",
+                       descriptor->full_name(), serializer->members_.size());
+    }
+    return serializer->valid_ ? serializer : nullptr;
+}
+
+const SomeIpSerializer* SomeIpSerializer::forMessage(const google::protobuf::Message& message) {
+    struct Slot {
+        const google::protobuf::Descriptor* descriptor;
+        const SomeIpSerializer* serializer;
+    };
+    // A few types per thread (an RPC's request and response, a topic or two) never need the lock.
+    thread_local Slot cache[4] = {};
+    thread_local unsigned next_slot = 0;
+    const google::protobuf::Descriptor* descriptor = message.GetDescriptor();
+    for (const Slot& slot : cache) {
+        if (slot.descriptor == descriptor) {
+            return slot.serializer;
+        }
+    }
+    const SomeIpSerializer* serializer = forType(descriptor);
+    cache[next_slot++ % 4] = {descriptor, serializer};
+    return serializer;
+}
+
+SomeIpSerializer* SomeIpSerializer::build(const google::protobuf::Descriptor* descriptor) {
+    using google::protobuf::FieldDescriptor;
+    auto it = registry().find(descriptor);
+    if (it != registry().end()) {
+        return it->second.get();
+    }
+    SomeIpSerializer* serializer = new SomeIpSerializer(descriptor);
+    registry().emplace(descriptor, std::unique_ptr<SomeIpSerializer>(serializer)); // Before recursing
+
+    std::vector<const FieldDescriptor*> fields;
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        fields.push_back(descriptor->field(i));
+    }
+    std::sort(fields.begin(), fields.end(), [](const FieldDescriptor* a, const FieldDescriptor* b) {
+        return a->number() < b->number();
+    });
+
+    bool valid = true;
+    for (const FieldDescriptor* field : fields) {
+        if (field->containing_oneof()) {
+            COMMS_LOG_WARN("SomeIpSerializer: {} has oneof field {}; it is sent as protobuf.",
+                           descriptor->full_name(), field->name());
+            valid = false;
+            break;
+        }
+        Member member = {field, Kind::Bool, 0, field->is_repeated(), nullptr};
+        switch (field->cpp_type()) {
+            case FieldDescriptor::CPPTYPE_BOOL: member.kind = Kind::Bool; member.width = 1; break;
+            case FieldDescriptor::CPPTYPE_INT32: member.kind = Kind::Int32; member.width = 4; break;
+            case FieldDescriptor::CPPTYPE_UINT32: member.kind = Kind::UInt32; member.width = 4; break;
+            case FieldDescriptor::CPPTYPE_INT64: member.kind = Kind::Int64; member.width = 8; break;
+            case FieldDescriptor::CPPTYPE_UINT64: member.kind = Kind::UInt64; member.width = 8; break;
+            case FieldDescriptor::CPPTYPE_FLOAT: member.kind = Kind::Float; member.width = 4; break;
+            case FieldDescriptor::CPPTYPE_DOUBLE: member.kind = Kind::Double; member.width = 8; break;
+            case FieldDescriptor::CPPTYPE_ENUM: member.kind = Kind::Enum; member.width = 4; break;
+            case FieldDescriptor::CPPTYPE_STRING:
+                member.kind = field->type() == FieldDescriptor::TYPE_BYTES ? Kind::Bytes : Kind::String;
+                break;
+            case FieldDescriptor::CPPTYPE_MESSAGE:
+                member.kind = Kind::Message;
+                member.nested = build(field->message_type());
+                if (member.nested->building_ && !member.repeated) {
+                    COMMS_LOG_WARN("SomeIpSerializer: {} contains itself through {}; it is sent as protobuf.",
+                                   descriptor->full_name(), field->name());
+                    valid = false;
+                } else if (!member.nested->building_ && !member.nested->valid_) {
+                    valid = false;
+                }
+                break;
+        }
+        if (!valid) {
+            break;
+        }
+        serializer->members_.push_back(member);
+    }
+    serializer->valid_ = valid;
+    serializer->building_ = false;
+    return serializer;
+}
+
+size_t SomeIpSerializer::byteSize(const google::protobuf::Message& message, const SomeIpOptions& options) const {
+    Writer counter(nullptr, 0, options);
+    write(counter, message);
+    return counter.offset();
+}
+
+bool SomeIpSerializer::encode(const google::protobuf::Message& message, const SomeIpOptions& options,
+                              uint8_t* out, size_t size) const {
+    Writer writer(out, size, options);
+    write(writer, message);
+    return writer.ok() && writer.offset() == size;
+}
+
+bool SomeIpSerializer::decode(const uint8_t* data, size_t length, const SomeIpOptions& options,
+                              google::protobuf::Message& message) const {
+    message.Clear();
+    Reader reader(data, length, options);
+    return read(reader, message);
+}
+
+void SomeIpSerializer::write(Writer& writer, const google::protobuf::Message& message) const {
+    const google::protobuf::Reflection* reflection = message.GetReflection();
+    for (const Member& member : members_) {
+        writer.align();
+        if (!member.repeated) {
+            writeValue(writer, member, message, reflection, -1);
+            continue;
+        }
+        const size_t length_position = writer.beginLength();
+        const int count = reflection->FieldSize(message, member.field);
+        for (int i = 0; i < count; ++i) {
+            writer.align();
+            writeValue(writer, member, message, reflection, i);
+        }
+        writer.endLength(length_position);
+    }
+}
+
+void SomeIpSerializer::writeValue(Writer& writer, const Member& member, const google::protobuf::Message& message,
+                                  const google::protobuf::Reflection* r, int index) const {
+    if (member.width && writer.counting()) {
+        writer.skip(member.width);
+        return;
+    }
+    const google::protobuf::FieldDescriptor* f = member.field;
+    const bool element = index >= 0; // Of a repeated field
+    switch (member.kind) {
+        case Kind::Bool:
+            writer.put(element ? r->GetRepeatedBool(message, f, index) : r->GetBool(message, f), 1);
+            break;
+        case Kind::Int32:
+            writer.put(static_cast<uint32_t>(element ? r->GetRepeatedInt32(message, f, index) : r->GetInt32(message, f)), 4);
+            break;
+        case Kind::UInt32:
+            writer.put(element ? r->GetRepeatedUInt32(message, f, index) : r->GetUInt32(message, f), 4);
+            break;
+        case Kind::Int64:
+            writer.put(static_cast<uint64_t>(element ? r->GetRepeatedInt64(message, f, index) : r->GetInt64(message, f)), 8);
+            break;
+        case Kind::UInt64:
+            writer.put(element ? r->GetRepeatedUInt64(message, f, index) : r->GetUInt64(message, f), 8);
+            break;
+        case Kind::Float:
+            writer.put(floatBits(element ? r->GetRepeatedFloat(message, f, index) : r->GetFloat(message, f)), 4);
+            break;
+        case Kind::Double:
+            writer.put(doubleBits(element ? r->GetRepeatedDouble(message, f, index) : r->GetDouble(message, f)), 8);
+            break;
+        case Kind::Enum:
+            writer.put(static_cast<uint32_t>(element ? r->GetRepeatedEnumValue(message, f, index)
+                                                     : r->GetEnumValue(message, f)), 4);
+            break;
+        case Kind::String:
+        case Kind::Bytes: {
+            std::string scratch;
+            const std::string& value = element ? r->GetRepeatedStringReference(message, f, index, &scratch)
+                                               : r->GetStringReference(message, f, &scratch);
+            const size_t length_position = writer.beginLength();
+            if (member.kind == Kind::String) {
+                writer.bytes(UTF8_BOM, sizeof(UTF8_BOM));
+                writer.bytes(value.data(), value.size());
+                writer.put(0, 1);
+            } else {
+                writer.bytes(value.data(), value.size());
+            }
+            writer.endLength(length_position);
+            break;
+        }
+        case Kind::Message:
+            member.nested->write(writer, element ? r->GetRepeatedMessage(message, f, index) : r->GetMessage(message, f));
+            break;
+    }
+}
+
+bool SomeIpSerializer::read(Reader& reader, google::protobuf::Message& message) const {
+    const google::protobuf::Reflection* reflection = message.GetReflection();
+    for (const Member& member : members_) {
+        if (!reader.align()) {
+            return false;
+        }
+        if (!member.repeated) {
+            if (!readValue(reader, member, message, reflection)) {
+                return false;
+            }
+            continue;
+        }
+        size_t outer_end;
+        if (!reader.beginArray(outer_end)) {
+            return false;
+        }
+        while (!reader.atEnd()) {
+            if (!reader.align() || !readValue(reader, member, message, reflection)) {
+                return false;
+            }
+        }
+        reader.endArray(outer_end);
+    }
+    return true;
+}
+
+bool SomeIpSerializer::readValue(Reader& reader, const Member& member, google::protobuf::Message& message,
+                                 const google::protobuf::Reflection* r) const {
+    const google::protobuf::FieldDescriptor* f = member.field;
+    google::protobuf::Message* m = &message;
+    uint64_t value = 0;
+    switch (member.kind) {
+        case Kind::Bool:
+            if (!reader.get(1, value)) {
+                return false;
+            }
+            member.repeated ? r->AddBool(m, f, value != 0) : r->SetBool(m, f, value != 0);
+            return true;
+        case Kind::Int32:
+            if (!reader.get(4, value)) {
+                return false;
+            }
+            member.repeated ? r->AddInt32(m, f, static_cast<int32_t>(value)) : r->SetInt32(m, f, static_cast<int32_t>(value));
+            return true;
+        case Kind::UInt32:
+            if (!reader.get(4, value)) {
+                return false;
+            }
+            member.repeated ? r->AddUInt32(m, f, static_cast<uint32_t>(value)) : r->SetUInt32(m, f, static_cast<uint32_t>(value));
+            return true;
+        case Kind::Int64:
+            if (!reader.get(8, value)) {
+                return false;
+            }
+            member.repeated ? r->AddInt64(m, f, static_cast<int64_t>(value)) : r->SetInt64(m, f, static_cast<int64_t>(value));
+            return true;
+        case Kind::UInt64:
+            if (!reader.get(8, value)) {
+                return false;
+            }
+            member.repeated ? r->AddUInt64(m, f, value) : r->SetUInt64(m, f, value);
+            return true;
+        case Kind::Float: {
+            if (!reader.get(4, value)) {
+                return false;
+            }
+            const uint32_t bits = static_cast<uint32_t>(value);
+            float number;
+            std::memcpy(&number, &bits, sizeof(number));
+            member.repeated ? r->AddFloat(m, f, number) : r->SetFloat(m, f, number);
+            return true;
+        }
+        case Kind::Double: {
+            if (!reader.get(8, value)) {
+                return false;
+            }
+            double number;
+            std::memcpy(&number, &value, sizeof(number));
+            member.repeated ? r->AddDouble(m, f, number) : r->SetDouble(m, f, number);
+            return true;
+        }
+        case Kind::Enum:
+            if (!reader.get(4, value)) {
+                return false;
+            }
+            member.repeated ? r->AddEnumValue(m, f, static_cast<int32_t>(value))
+                            : r->SetEnumValue(m, f, static_cast<int32_t>(value));
+            return true;
+        case Kind::String:
+        case Kind::Bytes: {
+            const uint8_t* bytes;
+            size_t size;
+            if (!reader.lengthPrefixed(bytes, size)) {
+                return false;
+            }
+            if (member.kind == Kind::String) {
+                if (size >= sizeof(UTF8_BOM) && std::memcmp(bytes, UTF8_BOM, sizeof(UTF8_BOM)) == 0) {
+                    bytes += sizeof(UTF8_BOM);
+                    size -= sizeof(UTF8_BOM);
+                }
+                if (size > 0 && bytes[size - 1] == 0) {
+                    --size;
+                }
+            }
+            std::string text(reinterpret_cast<const char*>(bytes), size);
+            member.repeated ? r->AddString(m, f, std::move(text)) : r->SetString(m, f, std::move(text));
+            return true;
+        }
+        case Kind::Message:
+            return member.nested->read(reader, member.repeated ? *r->AddMessage(m, f) : *r->MutableMessage(m, f));
+    }
+    return false;
+}
+
+} // namespace comms_stack
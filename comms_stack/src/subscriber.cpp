@@ -1,283 +1,578 @@
 #include "subscriber.h"
+#include "shm_ring.h"
+#include "topic_registry.h"
+#include "udp_batch.h"
 #include "common_messages.pb.h" // For specific deserialization and GetTypeName()
+#include "logging.h"
 #include <vsomeip/vsomeip.hpp>
 #include <google/protobuf/message.h>
-#include <iostream>
 #include <vector>
 
 namespace comms_stack {
 
 Subscriber::Subscriber(const std::string& topic_name,
-                       std::shared_ptr<vsomeip::application> app,
+                       std::shared_ptr<Transport> transport,
                        uint16_t service_id,
                        uint16_t instance_id, // Instance to watch for availability
-                       uint16_t event_id_or_group,
-                       bool is_eventgroup)
+                       uint16_t event_id,
+                       uint16_t eventgroup_id,
+                       std::shared_ptr<LocalBus> local_bus)
     : topic_name_(topic_name),
-      vsomeip_app_(app),
+      transport_(std::move(transport)),
       service_id_(service_id),
       instance_id_(instance_id), // Specific instance or vsomeip::ANY_INSTANCE
-      event_id_or_group_(event_id_or_group),
-      is_eventgroup_(is_eventgroup),
+      event_id_(event_id),
+      eventgroup_id_(eventgroup_id),
+      delivery_(std::make_shared<const Delivery>()),
       is_subscribed_(false),
-      service_available_(false) {
-    if (!vsomeip_app_) {
-        std::cerr << "Subscriber (" << topic_name_ << "): vsomeip application is null!" << std::endl;
+      local_bus_(std::move(local_bus)),
+      local_topic_(local_bus_ ? local_bus_->topic(service_id_, event_id_) : nullptr),
+      shm_reader_(new ShmRingReader()),
+      metrics_(Metrics::global().endpoint(Metrics::Kind::Subscriber, topic_name)),
+      trace_topic_(Tracer::global().topic(topic_name)) {
+    if (!transport_) {
+        COMMS_LOG_ERROR("Subscriber ({}): Transport is null!", topic_name_);
         return;
     }
-    std::cout << "Subscriber: Created for topic: " << topic_name_
-              << " (Service: 0x" << std::hex << service_id_
-              << ", Instance: 0x" << instance_id_
-              << (is_eventgroup_ ? ", Eventgroup: 0x" : ", Event: 0x") << event_id_or_group_
-              << std::dec << ")" << std::endl;
-    if (is_eventgroup_) {
-        subscribed_eventgroups_.insert(event_id_or_group_);
-    }
+    COMMS_LOG_INFO("Subscriber: Created for topic: {} (Service: 0x{:x}, Instance: 0x{:x}, Event: 0x{:x}, Eventgroup: 0x{:x})",
+                   topic_name_, service_id_, instance_id_, event_id_, eventgroup_id_);
 }
 
 Subscriber::~Subscriber() {
-    std::cout << "Subscriber: Destroyed for topic: " << topic_name_ << std::endl;
-    if (is_subscribed_ && vsomeip_app_) {
+    COMMS_LOG_INFO("Subscriber: Destroyed for topic: {}", topic_name_);
+    if (is_subscribed_ && transport_) {
         unsubscribe();
     }
+    stopShmReader();
+    stopUdpReceiver();
+}
+
+void Subscriber::updateDelivery(const std::function<void(Delivery&)>& change) {
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    auto updated = std::make_shared<Delivery>(*delivery());
+    change(*updated);
+    std::atomic_store(&delivery_, std::shared_ptr<const Delivery>(std::move(updated)));
+}
+
+void Subscriber::setCodec(const PayloadCodec& codec) {
+    updateDelivery([&codec](Delivery& delivery) { delivery.codec = codec; });
+}
+
+void Subscriber::enableEnvelope(const EnvelopeConfig& config) {
+    updateDelivery([&config](Delivery& delivery) { delivery.envelope = config; });
 }
 
 bool Subscriber::subscribe(SimpleNotificationCallback callback) {
-    if (!vsomeip_app_) {
-        std::cerr << "Subscriber (" << topic_name_ << "): Cannot subscribe, vsomeip app is null." << std::endl;
+    if (!transport_) {
+        COMMS_LOG_ERROR("Subscriber ({}): Cannot subscribe, transport is null.", topic_name_);
         return false;
     }
+    updateDelivery([&callback](Delivery& delivery) {
+        delivery.codec.prepare(protos::SimpleNotification::descriptor());
+        delivery.type_hash = MessageTypes::hash(protos::SimpleNotification::descriptor());
+        delivery.notification_callback = std::move(callback);
+        delivery.generic_callback = nullptr;
+        delivery.shared_callback = nullptr;
+    });
     if (is_subscribed_) {
-        std::cout << "Subscriber (" << topic_name_ << "): Already subscribed." << std::endl;
-        // Optionally update callback if different, or just return true
-        notification_callback_ = callback;
-        generic_callback_ = nullptr;
+        COMMS_LOG_INFO("Subscriber ({}): Already subscribed.", topic_name_);
         return true;
     }
+    registerHandlers();
+    return true;
+}
 
-    notification_callback_ = callback;
-    generic_callback_ = nullptr;
+bool Subscriber::subscribeGeneric(GenericMessageCallback callback) {
+    // For now, this is largely the same as the specific subscribe.
+    // The main difference is in onMessageReceived for deserialization.
+    if (!transport_) {
+        COMMS_LOG_ERROR("Subscriber ({}): Cannot subscribe, transport is null.", topic_name_);
+        return false;
+    }
+    updateDelivery([&callback](Delivery& delivery) {
+        delivery.generic_callback = std::move(callback);
+        delivery.notification_callback = nullptr;
+        delivery.shared_callback = nullptr;
+    });
+    if (is_subscribed_) {
+        COMMS_LOG_INFO("Subscriber ({}): Already subscribed (generic).", topic_name_);
+        return true;
+    }
+    registerHandlers();
+    return true;
+}
 
-    // Register availability handler for the service instance we care about
-    vsomeip_app_->register_availability_handler(
+bool Subscriber::subscribeShared(const google::protobuf::Message& prototype, SharedMessageCallback callback) {
+    if (!transport_) {
+        COMMS_LOG_ERROR("Subscriber ({}): Cannot subscribe, transport is null.", topic_name_);
+        return false;
+    }
+    updateDelivery([&prototype, &callback](Delivery& delivery) {
+        delivery.codec.prepare(prototype.GetDescriptor());
+        delivery.type_hash = MessageTypes::hash(prototype.GetDescriptor());
+        if (delivery.envelope.enabled) {
+            MessageTypes::add(prototype.GetDescriptor()); // Names it in logs
+        }
+        delivery.prototype.reset(prototype.New());
+        delivery.shared_callback = std::move(callback);
+        delivery.notification_callback = nullptr;
+        delivery.generic_callback = nullptr;
+    });
+    if (is_subscribed_) {
+        COMMS_LOG_INFO("Subscriber ({}): Already subscribed (shared).", topic_name_);
+        return true;
+    }
+    registerHandlers();
+    return true;
+}
+
+bool Subscriber::prepare() {
+    if (!transport_) {
+        COMMS_LOG_ERROR("Subscriber ({}): Cannot prepare, transport is null.", topic_name_);
+        return false;
+    }
+    if (!is_subscribed_) {
+        registerHandlers();
+    }
+    return true;
+}
+
+void Subscriber::registerHandlers() {
+    // Register availability handler for the service instance we care about; through the
+    // transport's router, as other subscribers and RPC clients may watch the same service.
+    availability_router_ = AvailabilityRouter::forTransport(transport_);
+    availability_handler_id_ = availability_router_->add(
         service_id_,
         instance_id_, // Watch specific instance or vsomeip::ANY_INSTANCE
         std::bind(&Subscriber::onAvailabilityChanged, this,
                   std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)
     );
-    std::cout << "Subscriber (" << topic_name_ << "): Registered availability handler for Service 0x"
-              << std::hex << service_id_ << ", Instance 0x" << instance_id_ << std::dec << std::endl;
+    COMMS_LOG_INFO("Subscriber ({}): Registered availability handler for Service 0x{:x}, Instance 0x{:x}",
+                   topic_name_, service_id_, instance_id_);
 
-    // Register message handler for the event or events in the eventgroup
-    vsomeip_app_->register_message_handler(
+    // Register message handler for the event
+    transport_->registerMessageHandler(
         service_id_,
         instance_id_, // Or vsomeip::ANY_INSTANCE if messages can come from any provider instance
-        event_id_or_group_, // If is_eventgroup_ is true, this is the eventgroup ID.
-                            // vsomeip handles routing messages for any event within this group.
-                            // If false, this is a specific event ID.
+        event_id_,
         std::bind(&Subscriber::onMessageReceived, this, std::placeholders::_1)
     );
-    std::cout << "Subscriber (" << topic_name_ << "): Registered message handler for "
-              << (is_eventgroup_ ? "Eventgroup 0x" : "Event 0x") << std::hex << event_id_or_group_
-              << std::dec << std::endl;
-
-    // Request the event or eventgroup
-    // If it's an eventgroup, subscribed_eventgroups_ contains its ID.
-    // If it's a specific event, subscribed_eventgroups_ can be empty or specific if the event belongs to a group.
-    // For a specific event not in a group, the set is typically empty.
-    if (is_eventgroup_) {
-         vsomeip_app_->request_event(
-            service_id_,
-            instance_id_, // Instance providing the event group, or ANY_INSTANCE
-            event_id_or_group_, // This is treated as a "major event ID" by someip, often 0xFFFF for event groups
-                               // but vsomeip uses the actual eventgroup ID here for the _event parameter
-                               // and the set for _eventgroups. It's a bit confusing.
-                               // Let's assume event_id_or_group_ is the event ID to request (even if it's also group ID)
-                               // and subscribed_eventgroups_ correctly lists the group.
-            subscribed_eventgroups_,
-            vsomeip::event_type_e::ET_EVENT); // Or ET_FIELD if applicable
-    } else {
-        // Requesting a specific event
-         vsomeip_app_->request_event(
-            service_id_,
-            instance_id_,
-            event_id_or_group_, // The specific event ID
-            {}, // No specific eventgroup set, or the relevant one if known
-            vsomeip::event_type_e::ET_EVENT);
-    }
+    COMMS_LOG_INFO("Subscriber ({}): Registered message handler for Event 0x{:x}", topic_name_, event_id_);
 
-    std::cout << "Subscriber (" << topic_name_ << "): Requested "
-              << (is_eventgroup_ ? "eventgroup 0x" : "event 0x") << std::hex << event_id_or_group_
-              << std::dec << std::endl;
+    // Request the event in its eventgroup; an event that is not in one is requested without.
+    transport_->requestEvent(service_id_, instance_id_, event_id_,
+                             eventgroup_id_ != 0 ? std::set<vsomeip::eventgroup_t>{eventgroup_id_}
+                                                 : std::set<vsomeip::eventgroup_t>());
+    COMMS_LOG_INFO("Subscriber ({}): Requested event 0x{:x} in eventgroup 0x{:x}",
+                   topic_name_, event_id_, eventgroup_id_);
 
+    attachLocalSink();
     is_subscribed_ = true;
-    return true;
+    startShmReader();
+    startUdpReceiver();
 }
 
-bool Subscriber::subscribeGeneric(GenericMessageCallback callback) {
-    // For now, this is largely the same as the specific subscribe.
-    // The main difference is in onMessageReceived for deserialization.
-    if (!vsomeip_app_) {
-        std::cerr << "Subscriber (" << topic_name_ << "): Cannot subscribe, vsomeip app is null." << std::endl;
-        return false;
+void Subscriber::attachLocalSink() {
+    if (!local_bus_ || local_sink_) {
+        return;
     }
+    local_sink_ = local_bus_->addSubscriber(service_id_, instance_id_, event_id_,
+                                            [this](const LocalBus::MessagePtr& message) { onLocalMessage(message); });
+}
+
+void Subscriber::onLocalMessage(const LocalBus::MessagePtr& message) {
+    const auto started = std::chrono::steady_clock::now();
+    const std::shared_ptr<const Delivery> delivery = this->delivery();
+    if (delivery->shared_callback) {
+        delivery->shared_callback(message);
+    } else if (delivery->notification_callback) {
+        const auto* notification = dynamic_cast<const protos::SimpleNotification*>(message.get());
+        if (notification) {
+            delivery->notification_callback(*notification);
+        } else {
+            COMMS_LOG_ERROR("Subscriber ({}): Local message is a {}, not a SimpleNotification.",
+                            topic_name_, message->GetTypeName());
+            metrics_.error();
+            return;
+        }
+    } else if (delivery->generic_callback) {
+        // The publisher's object carries its type, so unlike the wire path nothing is lost here.
+        delivery->generic_callback(topic_name_, *message);
+    } else {
+        metrics_.drop(); // Prepared, not subscribed yet
+        return;
+    }
+    metrics_.message(0); // Never serialized
+    metrics_.latency(std::chrono::steady_clock::now() - started);
+}
+
+void Subscriber::enableSharedMemory(const SharedMemoryConfig& config) {
+    if (instance_id_ == 0xFFFF) {
+        COMMS_LOG_WARN("Subscriber ({}): Shared memory needs a specific instance; using vsomeip.", topic_name_);
+        return;
+    }
+    shm_path_ = shmRingPath(config.directory, service_id_, instance_id_, event_id_);
     if (is_subscribed_) {
-        std::cout << "Subscriber (" << topic_name_ << "): Already subscribed (generic)." << std::endl;
-        generic_callback_ = callback;
-        notification_callback_ = nullptr;
-        return true;
+        startShmReader();
     }
+}
 
-    generic_callback_ = callback;
-    notification_callback_ = nullptr;
+void Subscriber::startShmReader() {
+    std::lock_guard<std::mutex> lock(shm_mutex_);
+    if (shm_path_.empty() || shm_thread_.joinable()) {
+        return;
+    }
+    if (!shm_reader_->attach(shm_path_)) {
+        COMMS_LOG_INFO("Subscriber ({}): No shared-memory ring at {} (yet); receiving over vsomeip.",
+                       topic_name_, shm_path_);
+        return;
+    }
+    shm_stop_ = false;
+    shm_slot_size_ = shm_reader_->slotSize();
+    shm_attached_ = true;
+    shm_thread_ = std::thread(&Subscriber::runShmReader, this);
+    COMMS_LOG_INFO("Subscriber ({}): Reading shared-memory ring {}", topic_name_, shm_path_);
+}
 
-    vsomeip_app_->register_availability_handler(
-        service_id_, instance_id_,
-        std::bind(&Subscriber::onAvailabilityChanged, this,
-                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-     std::cout << "Subscriber (" << topic_name_ << "): Registered availability handler (generic) for Service 0x"
-              << std::hex << service_id_ << ", Instance 0x" << instance_id_ << std::dec << std::endl;
+void Subscriber::stopShmReader() {
+    std::lock_guard<std::mutex> lock(shm_mutex_);
+    if (!shm_thread_.joinable()) {
+        return;
+    }
+    shm_stop_ = true;
+    shm_reader_->wake();
+    shm_thread_.join();
+    shm_reader_->detach();
+    shm_attached_ = false;
+}
+
+void Subscriber::runShmReader() {
+    protos::SimpleNotification notification; // Reused; only shared and generic messages are handed out
+    while (!shm_stop_) {
+        const std::shared_ptr<const Delivery> delivery = this->delivery();
+        std::shared_ptr<google::protobuf::Message> message;
+        Headers headers;
+        const TraceEnvelope* trace = nullptr;
+        uint64_t callback_start = 0;
+        size_t payload_length = 0;
+        std::chrono::steady_clock::time_point started;
+        ShmRingReader::Status status = shm_reader_->read([&](const uint8_t* data, size_t length) {
+            started = std::chrono::steady_clock::now();
+            payload_length = length;
+            const google::protobuf::Message* prototype;
+            if (!readHeaders(*delivery, data, length, headers, prototype)) {
+                return false;
+            }
+            trace = headers.traced ? &headers.trace : nullptr;
+            const uint64_t parse_start = traceSpan(trace, TraceStage::Transit, headers.trace.origin_ns);
+            bool parsed;
+            if (delivery->shared_callback) {
+                message.reset(delivery->prototype->New());
+                parsed = delivery->codec.decode(data, length, *message);
+            } else if (prototype) {
+                message.reset(prototype->New());
+                parsed = delivery->codec.decode(data, length, *message);
+            } else {
+                parsed = delivery->codec.decode(data, length, notification);
+            }
+            callback_start = traceSpan(trace, TraceStage::Parse, parse_start);
+            return parsed;
+        });
+        if (status == ShmRingReader::Status::EMPTY) {
+            shm_reader_->wait(std::chrono::milliseconds(100));
+            continue;
+        }
+        if (status == ShmRingReader::Status::INVALID) {
+            COMMS_LOG_ERROR("Subscriber ({}): Failed to parse message from shared memory.", topic_name_);
+            metrics_.error();
+            continue;
+        }
+        if (status != ShmRingReader::Status::MESSAGE) {
+            continue; // Overwritten before we got to it; see ShmRingReader::lostCount()
+        }
+        if (local_sink_ && local_topic_->isPublishedLocally(instance_id_)) {
+            continue; // Already delivered in-process by the publisher
+        }
+        if (delivery->shared_callback) {
+            delivery->shared_callback(message);
+        } else if (delivery->notification_callback) {
+            delivery->notification_callback(notification);
+        } else if (delivery->generic_callback && message) {
+            delivery->generic_callback(topic_name_, *message);
+        } else {
+            metrics_.drop(); // Prepared, not subscribed yet
+            continue;
+        }
+        traceSpan(trace, TraceStage::Callback, callback_start);
+        metrics_.message(payload_length);
+        metrics_.latency(std::chrono::steady_clock::now() - started);
+    }
+}
 
+void Subscriber::enableBatchedUdp(const BatchedUdpConfig& config) {
+    udp_config_.reset(new BatchedUdpConfig(config));
+    udp_duplicates_.reset(new UdpDuplicateFilter());
+    if (is_subscribed_) {
+        startUdpReceiver();
+    }
+}
 
-    vsomeip_app_->register_message_handler(
-        service_id_, instance_id_, event_id_or_group_,
-        std::bind(&Subscriber::onMessageReceived, this, std::placeholders::_1));
-    std::cout << "Subscriber (" << topic_name_ << "): Registered message handler (generic) for "
-              << (is_eventgroup_ ? "Eventgroup 0x" : "Event 0x") << std::hex << event_id_or_group_
-              << std::dec << std::endl;
+void Subscriber::startUdpReceiver() {
+    std::lock_guard<std::mutex> lock(udp_mutex_);
+    if (!udp_config_ || udp_thread_.joinable()) {
+        return;
+    }
+    std::unique_ptr<UdpBatchReceiver> receiver(new UdpBatchReceiver());
+    if (!receiver->open(*udp_config_)) {
+        COMMS_LOG_WARN("Subscriber ({}): Batched UDP unavailable; receiving over vsomeip.", topic_name_);
+        return;
+    }
+    udp_receiver_ = std::move(receiver);
+    udp_duplicates_->clear();
+    udp_stop_ = false;
+    udp_active_ = true;
+    udp_thread_ = std::thread(&Subscriber::runUdpReceiver, this);
+    COMMS_LOG_INFO("Subscriber ({}): Receiving batched UDP on {}:{}",
+                   topic_name_, udp_config_->address, udp_config_->port);
+}
 
-    if (is_eventgroup_) {
-        vsomeip_app_->request_event(service_id_, instance_id_, event_id_or_group_, subscribed_eventgroups_, vsomeip::event_type_e::ET_EVENT);
-    } else {
-        vsomeip_app_->request_event(service_id_, instance_id_, event_id_or_group_, {}, vsomeip::event_type_e::ET_EVENT);
+void Subscriber::stopUdpReceiver() {
+    std::lock_guard<std::mutex> lock(udp_mutex_);
+    if (!udp_thread_.joinable()) {
+        return;
     }
-    std::cout << "Subscriber (" << topic_name_ << "): Requested (generic) "
-              << (is_eventgroup_ ? "eventgroup 0x" : "event 0x") << std::hex << event_id_or_group_
-              << std::dec << std::endl;
+    udp_stop_ = true;
+    udp_receiver_->wake();
+    udp_thread_.join();
+    udp_receiver_.reset();
+    udp_active_ = false;
+}
 
-    is_subscribed_ = true;
-    return true;
+void Subscriber::runUdpReceiver() {
+    const uint16_t instance = instance_id_;
+    auto handler = [this, instance](const SomeIpNotificationHeader& header, const uint8_t* payload) {
+        if (header.event_id != event_id_) {
+            return;
+        }
+        if (shm_attached_ && header.payload_length <= shm_slot_size_) {
+            return; // Same-host publisher; read from the shared-memory ring instead
+        }
+        if (local_sink_ && local_topic_->isPublishedLocally(instance)) {
+            return; // Already delivered in-process by the publisher
+        }
+        if (udp_config_->wire &&
+            !udp_duplicates_->firstCopy(UdpDuplicateFilter::Path::Udp, payload, header.payload_length)) {
+            return; // Its vsomeip copy came first
+        }
+        deliverPayload(header.event_id, payload, header.payload_length);
+    };
+    while (!udp_stop_) {
+        if (udp_receiver_->receive(service_id_, handler, std::chrono::milliseconds(100)) < 0) {
+            COMMS_LOG_WARN("Subscriber ({}): Batched UDP receive failed; falling back to vsomeip.", topic_name_);
+            udp_active_ = false;
+            return;
+        }
+    }
 }
 
 bool Subscriber::unsubscribe() {
-    if (!vsomeip_app_) {
-         std::cerr << "Subscriber (" << topic_name_ << "): Cannot unsubscribe, vsomeip app is null." << std::endl;
+    if (!transport_) {
+         COMMS_LOG_ERROR("Subscriber ({}): Cannot unsubscribe, transport is null.", topic_name_);
         return !is_subscribed_; // Return true if not subscribed, false if was subscribed but app is null
     }
     if (!is_subscribed_) {
-        std::cout << "Subscriber (" << topic_name_ << "): Not currently subscribed." << std::endl;
+        COMMS_LOG_INFO("Subscriber ({}): Not currently subscribed.", topic_name_);
         return true;
     }
 
+    stopShmReader();
+    stopUdpReceiver();
+    if (local_sink_) {
+        local_bus_->removeSubscriber(service_id_, event_id_, local_sink_);
+        local_sink_.reset();
+    }
+
     // Unregister message handler
-    vsomeip_app_->unregister_message_handler(
-        service_id_, instance_id_, event_id_or_group_);
+    transport_->unregisterMessageHandler(
+        service_id_, instance_id_, event_id_);
 
-    // Release the event/eventgroup
-    if (is_eventgroup_) {
-        vsomeip_app_->release_event(service_id_, instance_id_, event_id_or_group_, subscribed_eventgroups_);
-    } else {
-        vsomeip_app_->release_event(service_id_, instance_id_, event_id_or_group_, {});
-    }
+    // Release the event
+    transport_->releaseEvent(service_id_, instance_id_, event_id_);
 
-    // Unregister availability handler
-    vsomeip_app_->unregister_availability_handler(
-        service_id_, instance_id_,
-        std::bind(&Subscriber::onAvailabilityChanged, this,
-                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    // Note: Unregistering the *exact same* std::function object can be tricky if the std::bind creates a new one.
-    // vsomeip might handle this by service/instance pair, or it might require storing the bound functor.
-    // For simplicity, we assume vsomeip unregisters based on service/instance. If not, a more robust
-    // handler storage and unregistration mechanism is needed (e.g., using vsomeip:: γίνεται_handler_type_t).
-    // A common practice is to just unregister all handlers for a service/instance if one is unregistering.
-    // Or, more simply, vsomeip might allow unregistering with just service_id and instance_id.
-    // Let's assume the unregister call with a new bind works or it unregisters all for that service/instance.
-    // A safer way for availability is to use register_availability_handler(service, instance, handler, connection_id)
-    // and then unregister_availability_handler(connection_id). But this requires managing connection_id.
-    // For now, we'll use the simpler unregister form.
-
-    std::cout << "Subscriber (" << topic_name_ << "): Unsubscribed from "
-              << (is_eventgroup_ ? "eventgroup 0x" : "event 0x") << std::hex << event_id_or_group_
-              << std::dec << std::endl;
-
-    notification_callback_ = nullptr;
-    generic_callback_ = nullptr;
+    // Unregister availability handler; only ours, by ID
+    availability_router_->remove(availability_handler_id_);
+    availability_handler_id_ = 0;
+
+    COMMS_LOG_INFO("Subscriber ({}): Unsubscribed from event 0x{:x}", topic_name_, event_id_);
+
+    updateDelivery([](Delivery& delivery) {
+        delivery.notification_callback = nullptr;
+        delivery.generic_callback = nullptr;
+        delivery.shared_callback = nullptr;
+    });
     is_subscribed_ = false;
-    service_available_ = false;
+    availability_.set(false);
     return true;
 }
 
 void Subscriber::onAvailabilityChanged(vsomeip::service_t service, vsomeip::instance_t instance, bool is_available) {
     if (service == service_id_ && instance == instance_id_) { // Check if it's for the service we are interested in
-        service_available_ = is_available;
-        std::cout << "Subscriber (" << topic_name_ << "): Availability changed for Service 0x"
-                  << std::hex << service << ", Instance 0x" << instance
-                  << " -> " << (is_available ? "AVAILABLE" : "NOT AVAILABLE") << std::dec << std::endl;
-
+        availability_.set(is_available);
+        COMMS_LOG_INFO("Subscriber ({}): Availability changed for Service 0x{:x}, Instance 0x{:x} -> {}",
+                       topic_name_, service, instance, (is_available ? "AVAILABLE" : "NOT AVAILABLE"));
+
+        if (is_available && is_subscribed_ && !shm_path_.empty()) {
+            // A (re)started publisher has created a new ring.
+            stopShmReader();
+            startShmReader();
+        }
         if (is_available && is_subscribed_) {
             // Service became available, ensure our event request is active
             // (vsomeip usually handles re-requesting if service appears after initial request)
             // We can re-issue request_event here if necessary, but often not needed.
-            std::cout << "Subscriber (" << topic_name_ << "): Service is now available. Event subscription should be active." << std::endl;
+            COMMS_LOG_INFO("Subscriber ({}): Service is now available. Event subscription should be active.",
+                           topic_name_);
         } else if (!is_available) {
-            std::cout << "Subscriber (" << topic_name_ << "): Service is no longer available." << std::endl;
+            COMMS_LOG_INFO("Subscriber ({}): Service is no longer available.", topic_name_);
         }
     }
 }
 
 void Subscriber::onMessageReceived(const std::shared_ptr<vsomeip::message>& msg) {
-    // Check if the message is for the event/eventgroup we are interested in.
-    // This check is important if a single handler is registered for ANY_EVENT or if an eventgroup
-    // handler receives events from multiple specific events within that group.
-    // If we registered for a specific event_id_or_group_, this check is more of a safeguard.
-    if (msg->get_service() == service_id_ &&
-        (is_eventgroup_ || msg->get_event() == event_id_or_group_)) {
-        // If it's an eventgroup, the event ID in the message (msg->get_event()) will be the specific event
-        // from that group that was triggered. event_id_or_group_ is our group ID.
-        // We need to ensure the message is indeed for an event we care about if subscribed to a group.
-        // For now, if is_eventgroup_ is true, we assume any message for that service on ANY_EVENT (if handler was so general)
-        // or the group ID (if handler was for group) is relevant.
-
+    // Check if the message is for the event we are interested in. The handler is registered for
+    // event_id_ only, so this is a safeguard.
+    if (msg->get_service() == service_id_ && msg->get_method() == event_id_) {
+        if (local_sink_ && local_topic_->isPublishedLocally(msg->get_instance())) {
+            return; // Already delivered in-process by the publisher
+        }
         std::shared_ptr<vsomeip::payload> payload = msg->get_payload();
         if (!payload || payload->get_length() == 0) {
-            std::cerr << "Subscriber (" << topic_name_ << "): Received empty payload for event 0x"
-                      << std::hex << msg->get_event() << std::dec << std::endl;
+            COMMS_LOG_ERROR("Subscriber ({}): Received empty payload for event 0x{:x}", topic_name_, msg->get_method());
+            metrics_.error();
             return;
         }
 
         const vsomeip::byte_t* data = payload->get_data();
         vsomeip::length_t len = payload->get_length();
+        if (shm_attached_ && len <= shm_slot_size_) {
+            return; // Read from the shared-memory ring instead; larger ones only come this way
+        }
+        // Without wire, the publisher only sends an event this way if it did not send the
+        // datagram (too large, or its sender is unavailable), so none is a duplicate.
+        if (udp_active_ && udp_config_->wire && len <= udp_config_->max_payload &&
+            !udp_duplicates_->firstCopy(UdpDuplicateFilter::Path::Wire, data, len)) {
+            return; // Already delivered from its datagram
+        }
+
+        deliverPayload(msg->get_method(), data, len);
+    } else {
+         // Message for a different service/event, ignore if our handler was too broad.
+    }
+}
 
-        std::cout << "Subscriber (" << topic_name_ << "): Message received for event 0x"
-                  << std::hex << msg->get_event() << std::dec << " (Payload size: " << len << ")" << std::endl;
+void Subscriber::deliverPayload(uint16_t event_id, const uint8_t* data, size_t length) {
+    const auto started = std::chrono::steady_clock::now();
+    const std::shared_ptr<const Delivery> delivery = this->delivery();
+    Headers headers;
+    const google::protobuf::Message* prototype;
+    if (!readHeaders(*delivery, data, length, headers, prototype)) {
+        metrics_.error();
+        return;
+    }
+    const TraceEnvelope* trace = headers.traced ? &headers.trace : nullptr;
+    const uint64_t parse_start = traceSpan(trace, TraceStage::Transit, headers.trace.origin_ns);
+    COMMS_LOG_DEBUG("Subscriber ({}): Message received for event 0x{:x} (Payload size: {})",
+                    topic_name_, event_id, length);
+
+    if (delivery->shared_callback) {
+        std::shared_ptr<google::protobuf::Message> message(delivery->prototype->New());
+        if (delivery->codec.decode(data, length, *message)) {
+            const uint64_t callback_start = traceSpan(trace, TraceStage::Parse, parse_start);
+            delivery->shared_callback(message);
+            traceSpan(trace, TraceStage::Callback, callback_start);
+        } else {
+            COMMS_LOG_ERROR("Subscriber ({}): Failed to parse {}", topic_name_, delivery->prototype->GetTypeName());
+            metrics_.error();
+            return;
+        }
+    } else if (delivery->notification_callback) {
+        protos::SimpleNotification notification;
+        if (delivery->codec.decode(data, length, notification)) {
+            const uint64_t callback_start = traceSpan(trace, TraceStage::Parse, parse_start);
+            delivery->notification_callback(notification);
+            traceSpan(trace, TraceStage::Callback, callback_start);
+        } else {
+            COMMS_LOG_ERROR("Subscriber ({}): Failed to parse SimpleNotification.", topic_name_);
+            metrics_.error();
+            return;
+        }
+    } else if (delivery->generic_callback) {
+        std::unique_ptr<google::protobuf::Message> message(prototype->New()); // Type named by the envelope
+        if (delivery->codec.decode(data, length, *message)) {
+            const uint64_t callback_start = traceSpan(trace, TraceStage::Parse, parse_start);
+            delivery->generic_callback(topic_name_, *message);
+            traceSpan(trace, TraceStage::Callback, callback_start);
+        } else {
+            COMMS_LOG_ERROR("Subscriber ({}): Failed to parse {}", topic_name_, message->GetTypeName());
+            metrics_.error();
+            return;
+        }
+    } else {
+        metrics_.drop(); // Prepared, not subscribed yet
+        return;
+    }
+    metrics_.message(length);
+    metrics_.latency(std::chrono::steady_clock::now() - started);
+}
 
-        if (notification_callback_) {
-            protos::SimpleNotification notification;
-            if (notification.ParseFromArray(data, len)) {
-                notification_callback_(notification);
-            } else {
-                std::cerr << "Subscriber (" << topic_name_ << "): Failed to parse SimpleNotification." << std::endl;
+bool Subscriber::readHeaders(const Delivery& delivery, const uint8_t*& data, size_t& length, Headers& headers,
+                             const google::protobuf::Message*& prototype) const {
+    prototype = nullptr;
+    // SOME/IP payloads carry neither envelope; one may well begin with either magic.
+    if (delivery.codec.codec() != Codec::SomeIp) {
+        headers.enveloped = delivery.envelope.enabled && MessageEnvelope::strip(data, length, headers.envelope);
+        if (!headers.enveloped) {
+            headers.traced = TraceEnvelope::strip(data, length, headers.trace); // Found by its magic
+        } else if (!headers.envelope.supported()) {
+            COMMS_LOG_ERROR("Subscriber ({}): Unsupported envelope flags 0x{:x}.", topic_name_, headers.envelope.flags);
+            return false;
+        } else if (headers.envelope.flags & MessageEnvelope::TRACED) {
+            headers.traced = TraceEnvelope::strip(data, length, headers.trace);
+            if (!headers.traced) {
+                COMMS_LOG_ERROR("Subscriber ({}): Envelope announces a trace envelope that is missing.", topic_name_);
+                return false;
             }
-        } else if (generic_callback_) {
-            // For generic callback, we need a way to know WHAT message type to parse into.
-            // This is a complex problem. A common solution is to have a factory or a map
-            // from an identifier (e.g., event ID, or a type field within the message itself)
-            // to a std::function that can create and parse the correct message type.
-            // For now, we'll indicate this limitation.
-            std::cerr << "Subscriber (" << topic_name_
-                      << "): Generic callback invoked, but dynamic Protobuf message parsing not fully implemented. "
-                      << "Payload received, but cannot determine specific type." << std::endl;
-            // One simple approach IF the type is known by topic_name (e.g. only one type per topic):
-            // if (topic_name_ == "some_known_topic_for_simple_notification") {
-            //    protos::SimpleNotification concrete_message;
-            //    if (concrete_message.ParseFromArray(data, len)) {
-            //       generic_callback_(topic_name_, concrete_message);
-            //    } // ...
-            // }
         }
-    } else {
-         // Message for a different service/event, ignore if our handler was too broad.
     }
+    if (delivery.shared_callback || delivery.notification_callback) {
+        if (headers.enveloped && headers.envelope.type_hash != delivery.type_hash) {
+            COMMS_LOG_ERROR("Subscriber ({}): Received {}, subscribed to {}.", topic_name_,
+                            MessageTypes::name(headers.envelope.type_hash), MessageTypes::name(delivery.type_hash));
+            return false;
+        }
+    } else if (delivery.generic_callback) {
+        if (!headers.enveloped) {
+            COMMS_LOG_ERROR("Subscriber ({}): Payload without message envelope; a generic callback cannot tell its type.",
+                            topic_name_);
+            return false;
+        }
+        prototype = MessageTypes::find(headers.envelope.type_hash);
+        if (!prototype) {
+            COMMS_LOG_ERROR("Subscriber ({}): Received unknown type {}; see MessageTypes::add().",
+                            topic_name_, MessageTypes::name(headers.envelope.type_hash));
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t Subscriber::traceSpan(const TraceEnvelope* trace, TraceStage stage, uint64_t start_ns) const {
+    if (!trace) {
+        return 0;
+    }
+    const uint64_t now = Tracer::now();
+    Tracer::global().record(trace->trace_id, trace_topic_, stage, start_ns, now);
+    return now;
 }
 
 std::string Subscriber::getTopicName() const {
@@ -288,4 +583,24 @@ bool Subscriber::isSubscribed() const {
     return is_subscribed_;
 }
 
+bool Subscriber::isServiceAvailable() const {
+    return availability_.isAvailable();
+}
+
+bool Subscriber::waitForAvailability(std::chrono::milliseconds timeout) const {
+    return availability_.waitFor(timeout);
+}
+
+std::future<bool> Subscriber::whenAvailable() {
+    return availability_.whenAvailable();
+}
+
+ServiceAvailability::CallbackId Subscriber::onAvailabilityChange(ServiceAvailability::Callback callback) {
+    return availability_.onChange(std::move(callback));
+}
+
+void Subscriber::removeAvailabilityCallback(ServiceAvailability::CallbackId id) {
+    availability_.removeCallback(id);
+}
+
 } // namespace comms_stack
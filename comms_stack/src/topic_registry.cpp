@@ -0,0 +1,223 @@
+#include "topic_registry.h"
+#include "logging.h"
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace comms_stack {
+
+namespace {
+
+// IDs are written as strings in vsomeip style ("0x1111"); plain decimal works too.
+uint16_t parseId(const boost::property_tree::ptree& node, const char* key, uint16_t default_value) {
+    auto value = node.get_optional<std::string>(key);
+    if (!value) {
+        return default_value;
+    }
+    unsigned long id = std::stoul(*value, nullptr, 0);
+    if (id > 0xFFFF) {
+        throw std::out_of_range(std::string(key) + " out of range: " + *value);
+    }
+    return static_cast<uint16_t>(id);
+}
+
+SharedMemoryConfig parseShm(const boost::property_tree::ptree& node, const std::string& directory) {
+    SharedMemoryConfig shm;
+    if (auto shm_node = node.get_child_optional("shm")) {
+        shm.enabled = true;
+        shm.slots = shm_node->get<uint32_t>("slots", shm.slots);
+        shm.slot_size = shm_node->get<uint32_t>("slot_size", shm.slot_size);
+        shm.wire = shm_node->get<bool>("wire", shm.wire);
+        shm.directory = directory;
+    }
+    return shm;
+}
+
+BatchedUdpConfig parseUdp(const boost::property_tree::ptree& node) {
+    BatchedUdpConfig udp;
+    if (auto udp_node = node.get_child_optional("udp")) {
+        udp.enabled = true;
+        udp.address = udp_node->get<std::string>("address");
+        udp.port = udp_node->get<uint16_t>("port");
+        udp.interface_address = udp_node->get<std::string>("interface", udp.interface_address);
+        udp.batch = std::max<uint32_t>(1, udp_node->get<uint32_t>("batch", udp.batch));
+        udp.linger_us = udp_node->get<uint32_t>("linger_us", udp.linger_us);
+        udp.max_payload = udp_node->get<uint32_t>("max_payload", udp.max_payload);
+        udp.wire = udp_node->get<bool>("wire", udp.wire);
+    }
+    return udp;
+}
+
+Codec parseCodecName(const std::string& name) {
+    Codec codec;
+    if (!parseCodec(name, codec)) {
+        throw std::invalid_argument("unknown codec: " + name);
+    }
+    return codec;
+}
+
+SomeIpOptions parseSomeIp(const boost::property_tree::ptree& node) {
+    SomeIpOptions options;
+    if (auto someip_node = node.get_child_optional("someip")) {
+        options.alignment = someip_node->get<uint32_t>("alignment", options.alignment);
+        options.length_field_size = someip_node->get<uint32_t>("length_field_size", options.length_field_size);
+        if (options.alignment == 0 || options.alignment > 8 || (options.alignment & (options.alignment - 1)) != 0) {
+            throw std::invalid_argument("someip alignment must be 1, 2, 4 or 8");
+        }
+        if (options.length_field_size != 1 && options.length_field_size != 2 && options.length_field_size != 4) {
+            throw std::invalid_argument("someip length_field_size must be 1, 2 or 4");
+        }
+    }
+    return options;
+}
+
+EnvelopeConfig parseEnvelope(const boost::property_tree::ptree& node) {
+    EnvelopeConfig envelope;
+    if (auto envelope_node = node.get_child_optional("envelope")) {
+        envelope.enabled = true;
+        envelope.schema_version = envelope_node->get<uint16_t>("schema_version", envelope.schema_version);
+        envelope.timestamp = envelope_node->get<bool>("timestamp", envelope.timestamp);
+    }
+    return envelope;
+}
+
+std::vector<std::string> parseNames(const boost::property_tree::ptree& node, const char* key) {
+    std::vector<std::string> names;
+    if (auto list = node.get_child_optional(key)) {
+        for (const auto& item : *list) {
+            names.push_back(item.second.get_value<std::string>());
+        }
+    }
+    return names;
+}
+
+} // namespace
+
+bool TopicRegistry::loadFromFile(const std::string& path) {
+    boost::property_tree::ptree root;
+    try {
+        boost::property_tree::read_json(path, root);
+    } catch (const boost::property_tree::json_parser_error& e) {
+        COMMS_LOG_ERROR("TopicRegistry: Failed to read {}: {}", path, e.what());
+        return false;
+    }
+
+    auto section = root.get_child_optional("comms_stack");
+    if (!section) {
+        COMMS_LOG_INFO("TopicRegistry: No \"comms_stack\" section in {}.", path);
+        return true;
+    }
+
+    try {
+        const std::string shm_directory = section->get<std::string>("shm_directory", SharedMemoryConfig().directory);
+        if (auto topics = section->get_child_optional("topics")) {
+            for (const auto& item : *topics) {
+                const auto& node = item.second;
+                TopicEntry entry;
+                entry.name = node.get<std::string>("name");
+                entry.service_id = parseId(node, "service", 0);
+                entry.instance_id = parseId(node, "instance", 0x0001);
+                entry.event_id = parseId(node, "event", 0);
+                entry.eventgroup_id = parseId(node, "eventgroup", 0);
+                entry.reliable = node.get<bool>("reliable", false);
+                entry.shard = node.get<int>("shard", -1);
+                entry.shm = parseShm(node, shm_directory);
+                entry.udp = parseUdp(node);
+                entry.trace = node.get<bool>("trace", false);
+                entry.codec = parseCodecName(node.get<std::string>("codec", codecName(entry.codec)));
+                entry.someip = parseSomeIp(node);
+                entry.envelope = parseEnvelope(node);
+                addTopic(entry);
+            }
+        }
+        if (auto services = section->get_child_optional("services")) {
+            for (const auto& item : *services) {
+                const auto& node = item.second;
+                ServiceEntry entry;
+                entry.name = node.get<std::string>("name");
+                entry.service_id = parseId(node, "service", 0);
+                entry.instance_id = parseId(node, "instance", 0x0001);
+                entry.reliable = node.get<bool>("reliable", true);
+                entry.shard = node.get<int>("shard", -1);
+                if (auto codecs = node.get_child_optional("codecs")) {
+                    for (const auto& method : *codecs) {
+                        entry.method_codecs[method.first] = parseCodecName(method.second.get_value<std::string>());
+                    }
+                }
+                entry.someip = parseSomeIp(node);
+                entry.envelope = parseEnvelope(node);
+                addService(entry);
+            }
+        }
+        if (auto provisioning = section->get_child_optional("provisioning")) {
+            for (const auto& item : *provisioning) {
+                ProvisioningPlan plan;
+                plan.publish = parseNames(item.second, "publish");
+                plan.subscribe = parseNames(item.second, "subscribe");
+                plan.call = parseNames(item.second, "call");
+                setProvisioning(item.first, plan);
+            }
+        }
+    } catch (const std::exception& e) {
+        COMMS_LOG_ERROR("TopicRegistry: Invalid \"comms_stack\" section in {}: {}", path, e.what());
+        return false;
+    }
+
+    COMMS_LOG_INFO("TopicRegistry: Loaded {} topic(s) and {} service(s) from {}",
+                   topics_.size(), services_.size(), path);
+    return true;
+}
+
+void TopicRegistry::clear() {
+    topics_.clear();
+    services_.clear();
+    topic_handles_.clear();
+    service_handles_.clear();
+    provisioning_.clear();
+}
+
+TopicHandle TopicRegistry::addTopic(const TopicEntry& entry) {
+    auto it = topic_handles_.find(entry.name);
+    if (it != topic_handles_.end()) {
+        topics_[it->second] = entry;
+        return it->second;
+    }
+    TopicHandle handle = static_cast<TopicHandle>(topics_.size());
+    topics_.push_back(entry);
+    topic_handles_.emplace(entry.name, handle);
+    return handle;
+}
+
+ServiceHandle TopicRegistry::addService(const ServiceEntry& entry) {
+    auto it = service_handles_.find(entry.name);
+    if (it != service_handles_.end()) {
+        services_[it->second] = entry;
+        return it->second;
+    }
+    ServiceHandle handle = static_cast<ServiceHandle>(services_.size());
+    services_.push_back(entry);
+    service_handles_.emplace(entry.name, handle);
+    return handle;
+}
+
+const ProvisioningPlan* TopicRegistry::provisioning(const std::string& app_name) const {
+    auto it = provisioning_.find(app_name);
+    return it != provisioning_.end() ? &it->second : nullptr;
+}
+
+void TopicRegistry::setProvisioning(const std::string& app_name, const ProvisioningPlan& plan) {
+    provisioning_[app_name] = plan;
+}
+
+TopicHandle TopicRegistry::findTopic(const std::string& name) const {
+    auto it = topic_handles_.find(name);
+    return it != topic_handles_.end() ? it->second : INVALID_HANDLE;
+}
+
+ServiceHandle TopicRegistry::findService(const std::string& name) const {
+    auto it = service_handles_.find(name);
+    return it != service_handles_.end() ? it->second : INVALID_HANDLE;
+}
+
+} // namespace comms_stack
@@ -0,0 +1,246 @@
+#include "tracing.h"
+#include "hash_utils.h"
+#include "json_utils.h"
+#include "logging.h"
+#include "metrics.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace comms_stack {
+
+namespace {
+
+// Chrome trace timestamps are microseconds; keep nanosecond resolution in the fraction.
+void writeMicros(std::ostream& out, uint64_t ns) {
+    out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+}
+
+} // namespace
+
+thread_local Tracer::Ring* Tracer::thread_ring_ = nullptr;
+thread_local uint32_t Tracer::thread_id_ = 0;
+thread_local bool Tracer::thread_exited_ = false;
+
+class Tracer::ThreadExit {
+public:
+    explicit ThreadExit(Ring* ring) : ring_(ring) {}
+    ~ThreadExit() {
+        thread_ring_ = nullptr;
+        thread_exited_ = true;
+        ring_->in_use.store(false, std::memory_order_release);
+    }
+
+private:
+    Ring* ring_;
+};
+
+Tracer::Tracer() {
+    const uint64_t seed[2] = {static_cast<uint64_t>(::getpid()), now()};
+    trace_id_base_ = fnv1a64(reinterpret_cast<const uint8_t*>(seed), sizeof(seed)) << 32;
+}
+
+Tracer& Tracer::global() {
+    // Never destroyed: threads may still record during static destruction.
+    static Tracer* tracer = new Tracer();
+    return *tracer;
+}
+
+uint16_t Tracer::topic(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(topics_.begin(), topics_.end(), name);
+    if (it != topics_.end()) {
+        return static_cast<uint16_t>(it - topics_.begin());
+    }
+    if (topics_.size() > UINT16_MAX) {
+        COMMS_LOG_ERROR("Tracer: More than {} topics; tracing {} as {}", UINT16_MAX + 1, name, topics_.back());
+        return UINT16_MAX;
+    }
+    topics_.push_back(name);
+    return static_cast<uint16_t>(topics_.size() - 1);
+}
+
+uint64_t Tracer::nextTraceId() {
+    return trace_id_base_ | trace_sequence_.fetch_add(1, std::memory_order_relaxed);
+}
+
+Tracer::Ring* Tracer::attachThread() {
+    if (thread_exited_) {
+        return nullptr;
+    }
+    Ring* ring = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Ring* candidate : rings_) {
+            bool free = false;
+            if (candidate->in_use.compare_exchange_strong(free, true, std::memory_order_acquire)) {
+                ring = candidate; // Left by an exited thread; its spans are overwritten as we go
+                break;
+            }
+        }
+        if (!ring) {
+            ring = new Ring();
+            rings_.push_back(ring);
+        }
+    }
+    thread_ring_ = ring;
+    thread_id_ = static_cast<uint32_t>(::syscall(SYS_gettid));
+    static thread_local ThreadExit release_on_exit(ring);
+    return ring;
+}
+
+void Tracer::record(uint64_t trace_id, uint16_t topic, TraceStage stage, uint64_t start_ns, uint64_t end_ns) {
+    Ring* ring = thread_ring_;
+    if (!ring) {
+        ring = attachThread();
+        if (!ring) {
+            return;
+        }
+    }
+    // Only this thread writes the ring. Readers copy the slots and then discard those the head
+    // has since moved past (see spans()).
+    const uint64_t index = ring->head.load(std::memory_order_relaxed);
+    Slot& slot = ring->slots[index % RING_EVENTS];
+    slot.trace_id.store(trace_id, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    slot.meta.store(uint64_t(thread_id_) << 32 | uint64_t(topic) << 8 | static_cast<uint8_t>(stage),
+                    std::memory_order_relaxed);
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+std::vector<Tracer::Span> Tracer::spans() const {
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings = rings_;
+    }
+    std::vector<Span> result;
+    for (const Ring* ring : rings) {
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t first = head > RING_EVENTS ? head - RING_EVENTS : 0;
+        std::vector<Span> copied;
+        copied.reserve(head - first);
+        for (uint64_t index = first; index < head; ++index) {
+            const Slot& slot = ring->slots[index % RING_EVENTS];
+            Span span;
+            span.trace_id = slot.trace_id.load(std::memory_order_relaxed);
+            span.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+            span.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+            const uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+            span.tid = static_cast<uint32_t>(meta >> 32);
+            span.topic = static_cast<uint16_t>(meta >> 8);
+            span.stage = static_cast<TraceStage>(meta & 0xFF);
+            copied.push_back(span);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // The writer may have moved on meanwhile; slot `head_now % RING_EVENTS` and the ones
+        // before it were (possibly) being rewritten while we copied.
+        const uint64_t head_now = ring->head.load(std::memory_order_relaxed);
+        const uint64_t valid = head_now >= RING_EVENTS ? head_now - RING_EVENTS + 1 : 0;
+        for (uint64_t index = std::max(first, valid); index < head; ++index) {
+            result.push_back(copied[index - first]);
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const Span& a, const Span& b) { return a.start_ns < b.start_ns; });
+    return result;
+}
+
+std::vector<std::string> Tracer::topicNames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return topics_;
+}
+
+void Tracer::writeChromeTrace(std::ostream& out) const {
+    const std::vector<Span> all = spans();
+    const std::vector<std::string> names = topicNames();
+    const int pid = static_cast<int>(::getpid());
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto begin = [&](const char* phase, const Span& span, uint64_t ts) {
+        out << (first ? "\n" : ",\n") << "{\"ph\":\"" << phase << "\",\"name\":";
+        first = false;
+        writeJsonString(out, std::string(stageName(span.stage)) + " " +
+                                 (span.topic < names.size() ? names[span.topic] : std::string("?")));
+        out << ",\"cat\":\"" << stageName(span.stage) << "\",\"pid\":" << pid << ",\"tid\":" << span.tid
+            << ",\"ts\":";
+        writeMicros(out, ts);
+    };
+    for (const Span& span : all) {
+        const uint64_t end = std::max(span.start_ns, span.end_ns);
+        if (span.stage == TraceStage::Transit) {
+            // Starts in the publisher's process; as an async pair it does not have to nest
+            // within the receiving thread's other spans.
+            begin("b", span, span.start_ns);
+            out << ",\"id\":\"0x" << std::hex << span.trace_id << std::dec << "\",\"args\":{\"trace_id\":\"0x"
+                << std::hex << span.trace_id << std::dec << "\"}}";
+            begin("e", span, end);
+            out << ",\"id\":\"0x" << std::hex << span.trace_id << std::dec << "\"}";
+        } else {
+            begin("X", span, span.start_ns);
+            out << ",\"dur\":";
+            writeMicros(out, end - span.start_ns);
+            out << ",\"args\":{\"trace_id\":\"0x" << std::hex << span.trace_id << std::dec << "\"}}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+bool Tracer::writeChromeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        COMMS_LOG_ERROR("Tracer: Cannot write {}", path);
+        return false;
+    }
+    writeChromeTrace(out);
+    return static_cast<bool>(out);
+}
+
+void Tracer::print(std::ostream& out) const {
+    const std::vector<std::string> names = topicNames();
+    std::map<std::pair<uint16_t, TraceStage>, LatencyHistogram> hops;
+    for (const Span& span : spans()) {
+        hops[std::make_pair(span.topic, span.stage)].record(span.end_ns > span.start_ns ? span.end_ns - span.start_ns : 0);
+    }
+    const auto flags = out.flags();
+    out << std::left << std::setw(24) << "topic" << std::setw(11) << "stage" << std::right << std::setw(10)
+        << "spans" << std::setw(11) << "p50 (us)" << std::setw(11) << "p99 (us)" << std::setw(11) << "max (us)"
+        << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (const auto& hop : hops) {
+        const LatencyHistogram& latency = hop.second;
+        out << std::left << std::setw(24) << (hop.first.first < names.size() ? names[hop.first.first] : "?")
+            << std::setw(11) << stageName(hop.first.second) << std::right << std::setw(10) << latency.count()
+            << std::setw(11) << latency.percentile(50) / 1000.0 << std::setw(11) << latency.percentile(99) / 1000.0
+            << std::setw(11) << latency.max() / 1000.0 << std::endl;
+    }
+    out.flags(flags);
+}
+
+Tracer::RingUsage Tracer::ringUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RingUsage usage;
+    usage.allocated = rings_.size();
+    for (const Ring* ring : rings_) {
+        usage.in_use += ring->in_use.load(std::memory_order_relaxed) ? 1 : 0;
+    }
+    return usage;
+}
+
+const char* Tracer::stageName(TraceStage stage) {
+    switch (stage) {
+        case TraceStage::Publish: return "publish";
+        case TraceStage::Serialize: return "serialize";
+        case TraceStage::Send: return "send";
+        case TraceStage::Transit: return "transit";
+        case TraceStage::Parse: return "parse";
+        case TraceStage::Callback: return "callback";
+    }
+    return "?";
+}
+
+} // namespace comms_stack
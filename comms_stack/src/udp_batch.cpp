@@ -0,0 +1,412 @@
+#include "udp_batch.h"
+#include "topic_registry.h"
+#include "hash_utils.h"
+#include "logging.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace comms_stack {
+
+namespace {
+const uint8_t SOMEIP_PROTOCOL_VERSION = 0x01;
+const uint8_t SOMEIP_MT_NOTIFICATION = 0x02;
+const size_t MAX_UDP_PAYLOAD = 65507;
+const int SOCKET_BUFFER_BYTES = 4 * 1024 * 1024;
+
+bool parseEndpoint(const BatchedUdpConfig& config, sockaddr_in& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config.port);
+    if (config.port == 0 || inet_pton(AF_INET, config.address.c_str(), &address.sin_addr) != 1) {
+        COMMS_LOG_ERROR("UdpBatch: Invalid endpoint {}:{} (IPv4 address and non-zero port required).",
+                        config.address, config.port);
+        return false;
+    }
+    return true;
+}
+
+bool parseInterface(const BatchedUdpConfig& config, in_addr& interface_address) {
+    interface_address.s_addr = htonl(INADDR_ANY);
+    if (!config.interface_address.empty() &&
+        inet_pton(AF_INET, config.interface_address.c_str(), &interface_address) != 1) {
+        COMMS_LOG_ERROR("UdpBatch: Invalid interface address {}", config.interface_address);
+        return false;
+    }
+    return true;
+}
+
+bool isMulticast(const sockaddr_in& address) {
+    return IN_MULTICAST(ntohl(address.sin_addr.s_addr));
+}
+
+void setupBatch(size_t batch, size_t stride, std::vector<uint8_t>& buffer, std::unique_ptr<iovec[]>& iovecs,
+                std::unique_ptr<mmsghdr[]>& messages) {
+    buffer.assign(batch * stride, 0);
+    iovecs.reset(new iovec[batch]);
+    messages.reset(new mmsghdr[batch]);
+    std::memset(messages.get(), 0, batch * sizeof(mmsghdr));
+    for (size_t i = 0; i < batch; ++i) {
+        iovecs[i].iov_base = buffer.data() + i * stride;
+        iovecs[i].iov_len = stride;
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+void put16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value >> 16));
+    put16(out + 2, static_cast<uint16_t>(value));
+}
+
+uint16_t get16(const uint8_t* in) {
+    return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+uint32_t get32(const uint8_t* in) {
+    return (static_cast<uint32_t>(get16(in)) << 16) | get16(in + 2);
+}
+} // namespace
+
+constexpr size_t SomeIpNotificationHeader::SIZE;
+
+void SomeIpNotificationHeader::encode(uint8_t* out) const {
+    put16(out, service_id);
+    put16(out + 2, event_id);
+    put32(out + 4, payload_length + 8); // SOME/IP length covers request ID onwards
+    put16(out + 8, 0);                  // Client ID; notifications have none
+    put16(out + 10, session);
+    out[12] = SOMEIP_PROTOCOL_VERSION;
+    out[13] = 0; // Interface version
+    out[14] = SOMEIP_MT_NOTIFICATION;
+    out[15] = 0; // E_OK
+}
+
+bool SomeIpNotificationHeader::decode(const uint8_t* data, size_t length) {
+    if (length < SIZE || data[12] != SOMEIP_PROTOCOL_VERSION || data[14] != SOMEIP_MT_NOTIFICATION) {
+        return false;
+    }
+    const uint32_t someip_length = get32(data + 4);
+    if (someip_length < 8 || someip_length - 8 != length - SIZE) {
+        return false;
+    }
+    service_id = get16(data);
+    event_id = get16(data + 2);
+    payload_length = someip_length - 8;
+    session = get16(data + 10);
+    return true;
+}
+
+// --- Sender ---
+
+UdpBatchSender::UdpBatchSender() = default;
+
+UdpBatchSender::~UdpBatchSender() {
+    close();
+}
+
+bool UdpBatchSender::open(const BatchedUdpConfig& config) {
+    close();
+    sockaddr_in destination;
+    in_addr interface_address;
+    if (!parseEndpoint(config, destination) || !parseInterface(config, interface_address)) {
+        return false;
+    }
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        COMMS_LOG_ERROR("UdpBatchSender: socket() failed: {}", std::strerror(errno));
+        return false;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &SOCKET_BUFFER_BYTES, sizeof(SOCKET_BUFFER_BYTES)); // Best effort
+    if (isMulticast(destination)) {
+        const int loop = 1;
+        const int ttl = 1;
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)); // Same-host subscribers
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        if (interface_address.s_addr != htonl(INADDR_ANY) &&
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface_address, sizeof(interface_address)) != 0) {
+            COMMS_LOG_ERROR("UdpBatchSender: Cannot use interface {}: {}",
+                            config.interface_address, std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+    }
+    // Connected, so the datagrams need no address and the kernel routes once.
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&destination), sizeof(destination)) != 0) {
+        COMMS_LOG_ERROR("UdpBatchSender: connect({}:{}) failed: {}", config.address, config.port, std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    socket_ = fd;
+    batch_ = std::max<uint32_t>(1, config.batch);
+    max_payload_ = std::min<size_t>(config.max_payload, MAX_UDP_PAYLOAD - SomeIpNotificationHeader::SIZE);
+    stride_ = (SomeIpNotificationHeader::SIZE + max_payload_ + 7) / 8 * 8;
+    linger_ = batch_ > 1 ? std::chrono::microseconds(config.linger_us) : std::chrono::microseconds(0);
+    setupBatch(batch_, stride_, buffer_, iovecs_, messages_);
+    queued_ = 0;
+    stopping_ = false;
+    if (linger_.count() > 0) {
+        flusher_ = std::thread(&UdpBatchSender::runFlusher, this);
+    }
+    return true;
+}
+
+void UdpBatchSender::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (socket_ < 0) {
+            return;
+        }
+        flushLocked();
+        stopping_ = true;
+    }
+    flusher_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ::close(socket_);
+    socket_ = -1;
+}
+
+bool UdpBatchSender::send(uint16_t service_id, uint16_t event_id, size_t length,
+                          const std::function<bool(uint8_t* payload)>& fill) {
+    if (length > max_payload_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_ < 0) {
+        return false;
+    }
+    uint8_t* datagram = buffer_.data() + queued_ * stride_;
+    if (!fill(datagram + SomeIpNotificationHeader::SIZE)) {
+        return false;
+    }
+    SomeIpNotificationHeader header;
+    header.service_id = service_id;
+    header.event_id = event_id;
+    header.payload_length = static_cast<uint32_t>(length);
+    header.session = next_session_++;
+    if (next_session_ == 0) {
+        next_session_ = 1;
+    }
+    header.encode(datagram);
+    iovecs_[queued_].iov_len = SomeIpNotificationHeader::SIZE + length;
+
+    if (queued_++ == 0) {
+        first_queued_at_ = std::chrono::steady_clock::now();
+        if (linger_.count() > 0) {
+            flusher_cv_.notify_one();
+        }
+    }
+    if (queued_ == batch_ || linger_.count() == 0) {
+        flushLocked();
+    }
+    return true;
+}
+
+void UdpBatchSender::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+}
+
+void UdpBatchSender::flushLocked() {
+    size_t sent = 0;
+    while (sent < queued_) {
+        int count = ::sendmmsg(socket_, messages_.get() + sent, static_cast<unsigned>(queued_ - sent), 0);
+        send_calls_.fetch_add(1, std::memory_order_relaxed);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // ECONNREFUSED only reports that an earlier datagram found no receiver.
+            if (errno != ECONNREFUSED) {
+                COMMS_LOG_ERROR("UdpBatchSender: Dropped {} datagram(s): {}", (queued_ - sent), std::strerror(errno));
+            }
+            break;
+        }
+        sent += static_cast<size_t>(count);
+    }
+    datagrams_sent_.fetch_add(sent, std::memory_order_relaxed);
+    queued_ = 0;
+}
+
+void UdpBatchSender::runFlusher() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (queued_ == 0) {
+            flusher_cv_.wait(lock);
+            continue;
+        }
+        const auto deadline = first_queued_at_ + linger_;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            flushLocked();
+            continue;
+        }
+        flusher_cv_.wait_until(lock, deadline);
+    }
+}
+
+// --- Receiver ---
+
+UdpBatchReceiver::UdpBatchReceiver() = default;
+
+UdpBatchReceiver::~UdpBatchReceiver() {
+    close();
+}
+
+bool UdpBatchReceiver::open(const BatchedUdpConfig& config) {
+    close();
+    sockaddr_in local;
+    in_addr interface_address;
+    if (!parseEndpoint(config, local) || !parseInterface(config, interface_address)) {
+        return false;
+    }
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        COMMS_LOG_ERROR("UdpBatchReceiver: socket() failed: {}", std::strerror(errno));
+        return false;
+    }
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)); // Several subscribers per multicast port
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER_BYTES, sizeof(SOCKET_BUFFER_BYTES)); // Best effort
+    // Bound to the group address for multicast, so other groups on the port are filtered out.
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        COMMS_LOG_ERROR("UdpBatchReceiver: bind({}:{}) failed: {}", config.address, config.port, std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    if (isMulticast(local)) {
+        ip_mreq membership;
+        membership.imr_multiaddr = local.sin_addr;
+        membership.imr_interface = interface_address;
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+            COMMS_LOG_ERROR("UdpBatchReceiver: Cannot join {}: {}", config.address, std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+    }
+    int wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        COMMS_LOG_ERROR("UdpBatchReceiver: eventfd() failed: {}", std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    socket_ = fd;
+    wake_fd_ = wake_fd;
+    batch_ = std::max<uint32_t>(1, config.batch);
+    // One byte of slack, so a datagram larger than max_payload shows up as truncated.
+    stride_ = SomeIpNotificationHeader::SIZE + std::min<size_t>(config.max_payload, MAX_UDP_PAYLOAD) + 1;
+    setupBatch(batch_, stride_, buffer_, iovecs_, messages_);
+    return true;
+}
+
+void UdpBatchReceiver::close() {
+    if (socket_ >= 0) {
+        ::close(socket_);
+        socket_ = -1;
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+void UdpBatchReceiver::wake() {
+    if (wake_fd_ >= 0) {
+        const uint64_t one = 1;
+        ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+int UdpBatchReceiver::receive(uint16_t service_id, const Handler& handler, std::chrono::milliseconds timeout) {
+    pollfd fds[2] = {{socket_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+    int ready = ::poll(fds, 2, static_cast<int>(timeout.count()));
+    if (ready <= 0) {
+        return ready == 0 || errno == EINTR ? 0 : -1;
+    }
+    if (fds[1].revents & POLLIN) {
+        uint64_t value;
+        ssize_t ignored = ::read(wake_fd_, &value, sizeof(value));
+        (void)ignored;
+    }
+    if (!(fds[0].revents & POLLIN)) {
+        return 0;
+    }
+
+    int count = ::recvmmsg(socket_, messages_.get(), static_cast<unsigned>(batch_), MSG_DONTWAIT, nullptr);
+    receive_calls_.fetch_add(1, std::memory_order_relaxed);
+    if (count < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+    }
+    int delivered = 0;
+    for (int i = 0; i < count; ++i) {
+        const uint8_t* datagram = buffer_.data() + static_cast<size_t>(i) * stride_;
+        SomeIpNotificationHeader header;
+        if ((messages_[i].msg_hdr.msg_flags & MSG_TRUNC) || !header.decode(datagram, messages_[i].msg_len)) {
+            malformed_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (header.service_id != service_id) {
+            continue;
+        }
+        handler(header, datagram + SomeIpNotificationHeader::SIZE);
+        ++delivered;
+    }
+    return delivered;
+}
+
+// --- Duplicate filter ---
+
+bool UdpDuplicateFilter::firstCopy(Path path, const uint8_t* data, size_t length) {
+    const uint64_t hash = fnv1a64(data, length);
+    const int64_t step = path == Path::Udp ? 1 : -1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = unmatched_.find(hash);
+    if (it != unmatched_.end() && (it->second > 0) != (step > 0)) {
+        // The twin of a copy that came the other way
+        it->second += step;
+        if (it->second == 0) {
+            unmatched_.erase(it);
+        }
+        return false;
+    }
+    unmatched_[hash] += step;
+    order_.emplace_back(hash, path);
+    while (order_.size() > capacity_) {
+        const auto oldest = order_.front();
+        order_.pop_front();
+        auto oldest_it = unmatched_.find(oldest.first);
+        // Skipped if the copy has been matched since
+        if (oldest_it != unmatched_.end() && (oldest_it->second > 0) == (oldest.second == Path::Udp)) {
+            oldest_it->second -= oldest.second == Path::Udp ? 1 : -1;
+            if (oldest_it->second == 0) {
+                unmatched_.erase(oldest_it);
+            }
+        }
+    }
+    return true;
+}
+
+void UdpDuplicateFilter::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unmatched_.clear();
+    order_.clear();
+}
+
+} // namespace comms_stack
@@ -0,0 +1,110 @@
+#include "vsomeip_transport.h"
+#include <vsomeip/vsomeip.hpp>
+
+namespace comms_stack {
+
+VsomeipTransport::VsomeipTransport(std::shared_ptr<vsomeip::application> app) : app_(std::move(app)) {}
+
+bool VsomeipTransport::init() {
+    return app_->init();
+}
+
+void VsomeipTransport::start() {
+    app_->start();
+}
+
+void VsomeipTransport::stop() {
+    app_->stop();
+}
+
+uint16_t VsomeipTransport::getClientId() const {
+    return app_->get_client();
+}
+
+void VsomeipTransport::offerService(uint16_t service_id, uint16_t instance_id) {
+    app_->offer_service(service_id, instance_id);
+}
+
+void VsomeipTransport::stopOfferService(uint16_t service_id, uint16_t instance_id) {
+    app_->stop_offer_service(service_id, instance_id);
+}
+
+void VsomeipTransport::requestService(uint16_t service_id, uint16_t instance_id) {
+    app_->request_service(service_id, instance_id);
+}
+
+void VsomeipTransport::releaseService(uint16_t service_id, uint16_t instance_id) {
+    app_->release_service(service_id, instance_id);
+}
+
+void VsomeipTransport::registerAvailabilityHandler(uint16_t service_id, uint16_t instance_id, AvailabilityHandler handler) {
+    app_->register_availability_handler(service_id, instance_id, std::move(handler));
+}
+
+void VsomeipTransport::unregisterAvailabilityHandler(uint16_t service_id, uint16_t instance_id) {
+    app_->unregister_availability_handler(service_id, instance_id);
+}
+
+void VsomeipTransport::registerMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id,
+                                              MessageHandler handler) {
+    app_->register_message_handler(service_id, instance_id, method_id, std::move(handler));
+}
+
+void VsomeipTransport::unregisterMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id) {
+    app_->unregister_message_handler(service_id, instance_id, method_id);
+}
+
+void VsomeipTransport::send(const std::shared_ptr<vsomeip::message>& message) {
+    app_->send(message);
+}
+
+void VsomeipTransport::offerEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                                  const std::set<uint16_t>& eventgroups, bool reliable) {
+    app_->offer_event(service_id, instance_id, event_id, eventgroups, vsomeip::event_type_e::ET_EVENT,
+                      std::chrono::milliseconds::zero(), false, true, nullptr,
+                      reliable ? vsomeip::reliability_type_e::RT_RELIABLE : vsomeip::reliability_type_e::RT_UNRELIABLE);
+}
+
+void VsomeipTransport::stopOfferEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) {
+    app_->stop_offer_event(service_id, instance_id, event_id);
+}
+
+void VsomeipTransport::requestEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                                    const std::set<uint16_t>& eventgroups) {
+    app_->request_event(service_id, instance_id, event_id, eventgroups, vsomeip::event_type_e::ET_EVENT);
+}
+
+void VsomeipTransport::releaseEvent(uint16_t service_id, uint16_t instance_id, uint16_t event_id) {
+    app_->release_event(service_id, instance_id, event_id);
+}
+
+void VsomeipTransport::subscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) {
+    app_->subscribe(service_id, instance_id, eventgroup_id);
+}
+
+void VsomeipTransport::unsubscribe(uint16_t service_id, uint16_t instance_id, uint16_t eventgroup_id) {
+    app_->unsubscribe(service_id, instance_id, eventgroup_id);
+}
+
+void VsomeipTransport::registerSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id,
+                                                         uint16_t eventgroup_id, uint16_t event_id,
+                                                         SubscriptionStatusHandler handler) {
+    app_->register_subscription_status_handler(service_id, instance_id, eventgroup_id, event_id, std::move(handler));
+}
+
+void VsomeipTransport::unregisterSubscriptionStatusHandler(uint16_t service_id, uint16_t instance_id,
+                                                           uint16_t eventgroup_id, uint16_t event_id) {
+    app_->unregister_subscription_status_handler(service_id, instance_id, eventgroup_id, event_id);
+}
+
+void VsomeipTransport::notify(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                              const std::shared_ptr<vsomeip::payload>& payload) {
+    app_->notify(service_id, instance_id, event_id, payload);
+}
+
+void VsomeipTransport::notifyOne(uint16_t service_id, uint16_t instance_id, uint16_t event_id,
+                                 const std::shared_ptr<vsomeip::payload>& payload, uint16_t client_id) {
+    app_->notify_one(service_id, instance_id, event_id, payload, client_id);
+}
+
+} // namespace comms_stack
@@ -0,0 +1,52 @@
+#include "write_once_table.h"
+#include <functional>
+#include <thread>
+
+namespace comms_stack {
+
+namespace {
+
+// Spreads reader threads over the counter stripes so they do not share a cache line.
+size_t threadStripe() {
+    thread_local const size_t stripe = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return stripe;
+}
+
+} // namespace
+
+constexpr size_t ReaderEpochs::STRIPES;
+
+ReaderEpochs::Token ReaderEpochs::enter() const {
+    const unsigned epoch = epoch_.load() & 1u;
+    const size_t stripe = threadStripe() % STRIPES;
+    // seq_cst: the caller's subsequent load of the protected pointer must not be ordered
+    // before this increment, or synchronize() could miss it.
+    counters_[epoch][stripe].value.fetch_add(1);
+    return static_cast<Token>((epoch << 8) | stripe);
+}
+
+void ReaderEpochs::exit(Token token) const {
+    counters_[(token >> 8) & 1u][token & 0xFF].value.fetch_sub(1, std::memory_order_release);
+}
+
+uint64_t ReaderEpochs::readers(unsigned epoch) const {
+    uint64_t total = 0;
+    for (const Counter& counter : counters_[epoch]) {
+        total += counter.value.load();
+    }
+    return total;
+}
+
+void ReaderEpochs::synchronize() const {
+    std::lock_guard<std::mutex> lock(synchronize_mutex_);
+    // Twice: a reader that read the epoch just before the first flip may have counted itself
+    // in the other set. New readers always go to the set not being drained.
+    for (int pass = 0; pass < 2; ++pass) {
+        const unsigned drained = epoch_.fetch_xor(1u) & 1u;
+        while (readers(drained) != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+} // namespace comms_stack
@@ -2,19 +2,25 @@
 #include <jni.h>
 #include <string>
 #include <vector>
-#include <iostream>
 #include <map>
+#include <memory>
+#include <algorithm>
 #include <mutex>
 #include <thread> // For detaching native threads if callbacks are on them
 #include <future> // For std::future
 #include <stdexcept> // For std::runtime_error
 
 #include "communication_manager.h" // From comms_stack_lib
+#include "logging.h"
 #include "publisher.h"
 #include "subscriber.h"
 #include "rpc_client.h"
 #include "common_messages.pb.h"    // For SimpleNotification
 #include "sample_rpc_service.pb.h" // For EchoRequest/Response, AddRequest/Response
+#include <chrono>
+
+// How long an RPC waits for its service to be discovered before failing
+static const std::chrono::seconds JNI_RPC_AVAILABILITY_TIMEOUT(5);
 
 // JNI OnLoad / OnUnload (optional but good practice)
 JavaVM* g_java_vm = nullptr;
@@ -27,12 +33,12 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved) {
     if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
         return JNI_ERR;
     }
-    std::cout << "JNI_OnLoad called successfully" << std::endl;
+    COMMS_LOG_INFO("JNI_OnLoad called successfully");
     return JNI_VERSION_1_6;
 }
 
 void JNI_OnUnload(JavaVM* vm, void* reserved) {
-    std::cout << "JNI_OnUnload called" << std::endl;
+    COMMS_LOG_INFO("JNI_OnUnload called");
     std::lock_guard<std::mutex> lock(g_vm_mutex);
     g_java_vm = nullptr;
 }
@@ -51,16 +57,16 @@ JniEnvContext getJniEnv() {
 
     int status = g_java_vm->GetEnv(reinterpret_cast<void**>(&context.env), JNI_VERSION_1_6);
     if (status == JNI_EDETACHED) {
-        std::cout << "JNI: Thread not attached, attempting to attach..." << std::endl;
+        COMMS_LOG_DEBUG("JNI: Thread not attached, attempting to attach...");
         if (g_java_vm->AttachCurrentThread(&context.env, nullptr) != JNI_OK) {
-            std::cerr << "JNI: Failed to attach current thread" << std::endl;
+            COMMS_LOG_ERROR("JNI: Failed to attach current thread");
             context.env = nullptr; // Ensure env is null on failure
         } else {
             context.attached = true;
-            std::cout << "JNI: Thread attached successfully." << std::endl;
+            COMMS_LOG_DEBUG("JNI: Thread attached successfully.");
         }
     } else if (status != JNI_OK) { // JNI_EVERSION or other error
-        std::cerr << "JNI: GetEnv failed with status: " << status << std::endl;
+        COMMS_LOG_ERROR("JNI: GetEnv failed with status: {}", status);
         context.env = nullptr; // Ensure env is null on failure
     }
     return context;
@@ -70,7 +76,7 @@ void detachCurrentThreadIfNeeded(bool attached) {
     std::lock_guard<std::mutex> lock(g_vm_mutex); // Protect g_java_vm
     if (attached && g_java_vm) {
         g_java_vm->DetachCurrentThread();
-        std::cout << "JNI: Detached current thread." << std::endl;
+        COMMS_LOG_DEBUG("JNI: Detached current thread.");
     }
 }
 
@@ -86,16 +92,60 @@ std::string jstringToStdString(JNIEnv* env, jstring jStr) {
 }
 
 // --- Global state for JNI (callbacks, etc.) ---
-struct SubscriptionContext {
-    jobject listener_global_ref;
-    std::shared_ptr<comms_stack::Subscriber> subscriber;
+// A Java listener. Its global reference is released with the last copy, so a listener that is
+// unsubscribed while a notification is being delivered to it stays valid until that call returns.
+struct JavaListener {
+    jobject global_ref;
     jmethodID on_notification_mid;
     jmethodID on_error_mid;
+
+    ~JavaListener() {
+        JniEnvContext ctx = getJniEnv();
+        if (ctx.env) {
+            ctx.env->DeleteGlobalRef(global_ref);
+            detachCurrentThreadIfNeeded(ctx.attached);
+        }
+    }
+};
+using JavaListeners = std::vector<std::shared_ptr<JavaListener>>;
+
+// The Java listeners of a topic share the manager's Subscriber for it: the transport holds one
+// message handler per event, so a Subscriber per listener would replace the others' handlers.
+// Its callback fans each notification out to the current listeners.
+struct TopicListeners {
+    std::shared_ptr<comms_stack::Subscriber> subscriber;
+    // Read by the callback without a lock; replaced, never modified, under g_subscriptions_mutex.
+    std::shared_ptr<const JavaListeners> listeners = std::make_shared<const JavaListeners>();
+};
+std::map<std::string, std::shared_ptr<TopicListeners>> g_topic_listeners;
+
+struct SubscriptionContext {
+    std::string topic_name;
+    std::shared_ptr<JavaListener> listener;
 };
 std::map<long, SubscriptionContext> g_subscriptions;
 long g_next_subscription_id = 1;
 std::mutex g_subscriptions_mutex;
 
+void deliverToListeners(const std::weak_ptr<TopicListeners>& weak_topic, const std::string& topicName,
+                        const comms_stack::protos::SimpleNotification& msg) {
+    std::shared_ptr<TopicListeners> topic = weak_topic.lock(); // Weak: the topic holds the Subscriber
+    if (!topic) return;
+    JniEnvContext ctx = getJniEnv();
+    if (!ctx.env) { COMMS_LOG_ERROR("JNI CB: Failed to get JNIEnv for {}", topicName); return; }
+    {
+        std::shared_ptr<const JavaListeners> listeners = std::atomic_load(&topic->listeners);
+        jstring java_content_str = ctx.env->NewStringUTF(msg.message_content().c_str());
+        for (const std::shared_ptr<JavaListener>& listener : *listeners) {
+            ctx.env->CallVoidMethod(listener->global_ref, listener->on_notification_mid,
+                                    static_cast<jint>(msg.id()), java_content_str, static_cast<jlong>(msg.timestamp()));
+            if (ctx.env->ExceptionCheck()) { ctx.env->ExceptionDescribe(); ctx.env->ExceptionClear(); }
+        }
+        if (java_content_str) ctx.env->DeleteLocalRef(java_content_str);
+    } // Drops the snapshot (and maybe the last reference to a listener) while still attached
+    detachCurrentThreadIfNeeded(ctx.attached);
+}
+
 
 // --- JNI Method Implementations ---
 extern "C" {
@@ -104,27 +154,19 @@ JNIEXPORT jboolean JNICALL
 Java_com_example_commsstack_CommsStackBridge_nativeInit(JNIEnv* env, jobject /* this */, jstring jAppName, jstring jConfigPath) {
     std::string appName = jstringToStdString(env, jAppName);
     std::string configPath = jstringToStdString(env, jConfigPath);
-    std::cout << "JNI: nativeInit called. AppName: " << appName << ", ConfigPath: " << configPath << std::endl;
+    COMMS_LOG_INFO("JNI: nativeInit called. AppName: {}, ConfigPath: {}", appName, configPath);
     return comms_stack::CommunicationManager::getInstance().init(appName, configPath);
 }
 
 JNIEXPORT void JNICALL
 Java_com_example_commsstack_CommsStackBridge_nativeShutdown(JNIEnv* env, jobject /* this */) {
-    std::cout << "JNI: nativeShutdown called." << std::endl;
+    COMMS_LOG_INFO("JNI: nativeShutdown called.");
     comms_stack::CommunicationManager::getInstance().shutdown();
 
     std::lock_guard<std::mutex> lock(g_subscriptions_mutex);
-    JniEnvContext ctx = getJniEnv(); // Need env for DeleteGlobalRef
-    if (ctx.env) {
-        for (auto const& [id, context] : g_subscriptions) {
-            if (context.listener_global_ref) {
-                ctx.env->DeleteGlobalRef(context.listener_global_ref);
-            }
-        }
-        detachCurrentThreadIfNeeded(ctx.attached);
-    }
-    g_subscriptions.clear();
-    std::cout << "JNI: Cleared global subscription references." << std::endl;
+    g_subscriptions.clear(); // Releases the listeners' global references
+    g_topic_listeners.clear();
+    COMMS_LOG_INFO("JNI: Cleared global subscription references.");
 }
 
 JNIEXPORT jboolean JNICALL
@@ -134,19 +176,11 @@ Java_com_example_commsstack_CommsStackBridge_nativePublishSimpleNotification(
     std::string topicName = jstringToStdString(env, jTopicName);
     std::string messageContent = jstringToStdString(env, jMessageContent);
 
-    auto& comm_mgr = comms_stack::CommunicationManager::getInstance();
-    auto vsomeip_app = comm_mgr.getVsomeipApplication();
-    if (!vsomeip_app) return false;
-
-    const uint16_t service_id = 0x1111;
-    const uint16_t instance_id = 0x0001;
-    const uint16_t eventgroup_id = 0x9100;
-
-    // This should use CommunicationManager::getPublisher which handles config lookup and caching.
-    // For now, direct construction for test.
-    comms_stack::Publisher publisher(topicName, vsomeip_app, service_id, instance_id, eventgroup_id, true);
-     if(!publisher.isOffered()){
-         std::cout << "JNI: Publisher for " << topicName << " trying to offer event..." << std::endl;
+    // IDs come from the manager's topic registry; the publisher is created once and cached.
+    auto publisher = comms_stack::CommunicationManager::getInstance().getPublisher(topicName);
+    if (!publisher) return false;
+     if(!publisher->isOffered()){
+         COMMS_LOG_DEBUG("JNI: Publisher for {} trying to offer event...", topicName);
          // Allow to proceed, publish might work if vsomeip is just slow to confirm offer
      }
 
@@ -155,8 +189,8 @@ Java_com_example_commsstack_CommsStackBridge_nativePublishSimpleNotification(
     msg.set_message_content(messageContent);
     msg.set_timestamp(static_cast<uint64_t>(timestamp));
 
-    std::cout << "JNI: Publishing to topic: " << topicName << ", ID: " << id << std::endl;
-    return publisher.publish(msg);
+    COMMS_LOG_DEBUG("JNI: Publishing to topic: {}, ID: {}", topicName, id);
+    return publisher->publish(msg);
 }
 
 
@@ -166,26 +200,23 @@ Java_com_example_commsstack_CommsStackBridge_nativeSubscribeSimpleNotification(
 
     std::string topicName = jstringToStdString(env, jTopicName);
     if (!jListener) {
-        std::cerr << "JNI: Listener cannot be null for subscription to " << topicName << std::endl;
+        COMMS_LOG_ERROR("JNI: Listener cannot be null for subscription to {}", topicName);
         return -1;
     }
-    std::cout << "JNI: nativeSubscribeSimpleNotification for topic: " << topicName << std::endl;
+    COMMS_LOG_INFO("JNI: nativeSubscribeSimpleNotification for topic: {}", topicName);
 
     auto& comm_mgr = comms_stack::CommunicationManager::getInstance();
-    auto vsomeip_app = comm_mgr.getVsomeipApplication();
-    if (!vsomeip_app) {
-        std::cerr << "JNI: vsomeip_app not available for subscription." << std::endl;
+    auto transport = comm_mgr.getTransport();
+    if (!transport) {
+        COMMS_LOG_ERROR("JNI: Transport not available for subscription.");
         return -2;
     }
 
-    const uint16_t service_id = 0x1111;
-    const uint16_t instance_id = 0x0001;
-    const uint16_t eventgroup_id = 0x9100;
-
-    // This should use CommunicationManager::getSubscriber which handles config lookup and caching.
-    // For now, direct construction for test.
-    auto subscriber = std::make_shared<comms_stack::Subscriber>(
-        topicName, vsomeip_app, service_id, instance_id, eventgroup_id, true);
+    const comms_stack::TopicEntry* topic = comm_mgr.getTopicRegistry().topic(comm_mgr.findTopic(topicName));
+    if (!topic) {
+        COMMS_LOG_ERROR("JNI: Unknown topic {}", topicName);
+        return -7;
+    }
 
     jobject listener_global_ref = env->NewGlobalRef(jListener);
     if (!listener_global_ref) { /* error handling */ return -3; }
@@ -197,45 +228,57 @@ Java_com_example_commsstack_CommsStackBridge_nativeSubscribeSimpleNotification(
     env->DeleteLocalRef(listener_class);
 
     if (!on_notification_mid || !on_error_mid) { /* error handling */ env->DeleteGlobalRef(listener_global_ref); return -5; }
+    auto listener = std::make_shared<JavaListener>(JavaListener{listener_global_ref, on_notification_mid, on_error_mid});
 
-    bool success = subscriber->subscribe(
-        [listener_global_ref, on_notification_mid, on_error_mid, topicName](const comms_stack::protos::SimpleNotification& msg) {
-            JniEnvContext ctx = getJniEnv();
-            if (!ctx.env) { std::cerr << "JNI CB: Failed to get JNIEnv for " << topicName << std::endl; return; }
-
-            jstring java_content_str = ctx.env->NewStringUTF(msg.message_content().c_str());
-            ctx.env->CallVoidMethod(listener_global_ref, on_notification_mid,
-                                static_cast<jint>(msg.id()), java_content_str, static_cast<jlong>(msg.timestamp()));
-            if (ctx.env->ExceptionCheck()) { ctx.env->ExceptionDescribe(); ctx.env->ExceptionClear(); }
-            if (java_content_str) ctx.env->DeleteLocalRef(java_content_str);
-            detachCurrentThreadIfNeeded(ctx.attached);
+    std::lock_guard<std::mutex> lock(g_subscriptions_mutex);
+    std::shared_ptr<TopicListeners>& topic_listeners = g_topic_listeners[topicName];
+    if (!topic_listeners) {
+        // First listener of the topic: subscribe the manager's Subscriber, created once and cached.
+        auto subscriber = comm_mgr.getSubscriber(topicName);
+        auto created = std::make_shared<TopicListeners>();
+        if (!subscriber || !subscriber->subscribe(
+                [weak_topic = std::weak_ptr<TopicListeners>(created), topicName](
+                    const comms_stack::protos::SimpleNotification& msg) {
+                    deliverToListeners(weak_topic, topicName, msg);
+                })) {
+            g_topic_listeners.erase(topicName);
+            return -6; // Releases the listener's global reference
         }
-    );
-
-    if (!success) { env->DeleteGlobalRef(listener_global_ref); return -6; }
+        created->subscriber = subscriber;
+        topic_listeners = created;
+    }
+    auto listeners = std::make_shared<JavaListeners>(*std::atomic_load(&topic_listeners->listeners));
+    listeners->push_back(listener);
+    std::atomic_store(&topic_listeners->listeners, std::shared_ptr<const JavaListeners>(std::move(listeners)));
 
-    std::lock_guard<std::mutex> lock(g_subscriptions_mutex);
     long current_id = g_next_subscription_id++;
-    g_subscriptions[current_id] = {listener_global_ref, subscriber, on_notification_mid, on_error_mid};
-    std::cout << "JNI: Subscribed to " << topicName << " with sub ID: " << current_id << std::endl;
+    g_subscriptions[current_id] = {topicName, listener};
+    COMMS_LOG_INFO("JNI: Subscribed to {} with sub ID: {}", topicName, current_id);
     return current_id;
 }
 
 JNIEXPORT void JNICALL
 Java_com_example_commsstack_CommsStackBridge_nativeUnsubscribe(JNIEnv* env, jobject /* this */, jlong subscriptionId) {
-    std::cout << "JNI: nativeUnsubscribe called for ID: " << subscriptionId << std::endl;
+    COMMS_LOG_INFO("JNI: nativeUnsubscribe called for ID: {}", subscriptionId);
     std::lock_guard<std::mutex> lock(g_subscriptions_mutex);
     auto it = g_subscriptions.find(subscriptionId);
-    if (it != g_subscriptions.end()) {
-        if (it->second.subscriber) { it->second.subscriber->unsubscribe(); }
-        JniEnvContext ctx = getJniEnv(); // Env needed for DeleteGlobalRef
-        if (it->second.listener_global_ref && ctx.env) {
-             ctx.env->DeleteGlobalRef(it->second.listener_global_ref);
+    if (it == g_subscriptions.end()) { /* error handling */ return; }
+
+    auto topic_it = g_topic_listeners.find(it->second.topic_name);
+    if (topic_it != g_topic_listeners.end()) {
+        std::shared_ptr<TopicListeners> topic_listeners = topic_it->second;
+        auto listeners = std::make_shared<JavaListeners>(*std::atomic_load(&topic_listeners->listeners));
+        listeners->erase(std::remove(listeners->begin(), listeners->end(), it->second.listener), listeners->end());
+        if (listeners->empty()) {
+            // Last listener of the topic: nothing is delivered once unsubscribe() returns.
+            topic_listeners->subscriber->unsubscribe();
+            g_topic_listeners.erase(topic_it);
+        } else {
+            std::atomic_store(&topic_listeners->listeners, std::shared_ptr<const JavaListeners>(std::move(listeners)));
         }
-        if(ctx.env) detachCurrentThreadIfNeeded(ctx.attached); // Detach if getJniEnv attached
-        g_subscriptions.erase(it);
-        std::cout << "JNI: Unsubscribed and cleaned up for ID: " << subscriptionId << std::endl;
-    } else { /* error handling */ }
+    }
+    g_subscriptions.erase(it); // The global reference goes with the last copy of the listener
+    COMMS_LOG_INFO("JNI: Unsubscribed and cleaned up for ID: {}", subscriptionId);
 }
 
 JNIEXPORT void JNICALL
@@ -245,18 +288,11 @@ Java_com_example_commsstack_CommsStackBridge_nativeCallEcho(
     std::string serviceName = jstringToStdString(env, jServiceName);
     std::string requestMessage = jstringToStdString(env, jRequestMessage);
     if (!jListener) { /* error handling */ return; }
-    std::cout << "JNI: nativeCallEcho for service: " << serviceName << " msg: " << requestMessage << std::endl;
-
-    auto& comm_mgr = comms_stack::CommunicationManager::getInstance();
-    auto vsomeip_app = comm_mgr.getVsomeipApplication();
-    if (!vsomeip_app) { /* error handling with callback */ return; }
-
-    const uint16_t service_id = 0x2222;
-    const uint16_t instance_id = 0x0001;
+    COMMS_LOG_DEBUG("JNI: nativeCallEcho for service: {} msg: {}", serviceName, requestMessage);
 
-    // This should use CommunicationManager::getRpcClient which handles config lookup and caching.
-    // For now, direct construction for test.
-    auto rpc_client = std::make_shared<comms_stack::RpcClient>(serviceName, vsomeip_app, service_id, instance_id);
+    // IDs come from the manager's service registry; the client is created once and cached.
+    auto rpc_client = comms_stack::CommunicationManager::getInstance().getRpcClient(serviceName);
+    if (!rpc_client) { /* error handling with callback */ return; }
 
     jobject listener_global_ref = env->NewGlobalRef(jListener); // Must manage this ref!
     jclass listener_class = env->GetObjectClass(listener_global_ref);
@@ -266,29 +302,25 @@ Java_com_example_commsstack_CommsStackBridge_nativeCallEcho(
 
     if (!on_response_mid || !on_error_mid) { /* error handling */ if(listener_global_ref) env->DeleteGlobalRef(listener_global_ref); return;}
 
-    if (!rpc_client->isServiceAvailable()) { // Basic check
-        std::cerr << "JNI: RPC service " << serviceName << " not immediately available." << std::endl;
-        jstring error_msg_jstr = env->NewStringUTF("Service not available");
-        env->CallVoidMethod(listener_global_ref, on_error_mid, error_msg_jstr);
-        if(error_msg_jstr) env->DeleteLocalRef(error_msg_jstr);
-        env->DeleteGlobalRef(listener_global_ref);
-        return;
-    }
-
     comms_stack::protos::EchoRequest req;
     req.set_request_message(requestMessage);
-    std::future<comms_stack::protos::EchoResponse> future_res = rpc_client->Echo(req);
 
-    std::thread([future_res = std::move(future_res), listener_global_ref, on_response_mid, on_error_mid, serviceName, rpc_client /*keep client alive*/]() mutable {
+    // The first call on a service usually comes right after the client was created, before
+    // discovery has finished; wait for it off the caller's thread instead of failing at once.
+    std::thread([req, listener_global_ref, on_response_mid, on_error_mid, serviceName, rpc_client /*keep client alive*/]() mutable {
         JniEnvContext ctx = getJniEnv();
         if (!ctx.env) {
-            std::cerr << "JNI RPC CB: Failed to get JNIEnv for Echo on " << serviceName << std::endl;
+            COMMS_LOG_ERROR("JNI RPC CB: Failed to get JNIEnv for Echo on {}", serviceName);
             std::lock_guard<std::mutex> lock(g_vm_mutex); // Protect g_java_vm
             if(listener_global_ref && g_java_vm) g_java_vm->DeleteGlobalRef(listener_global_ref);
             return;
         }
         try {
-            comms_stack::protos::EchoResponse res = future_res.get();
+            if (!rpc_client->waitForAvailability(JNI_RPC_AVAILABILITY_TIMEOUT)) {
+                COMMS_LOG_ERROR("JNI: RPC service {} not available.", serviceName);
+                throw std::runtime_error("Service not available");
+            }
+            comms_stack::protos::EchoResponse res = rpc_client->Echo(req).get();
             jstring java_res_msg = ctx.env->NewStringUTF(res.response_message().c_str());
             ctx.env->CallVoidMethod(listener_global_ref, on_response_mid, java_res_msg);
             if(java_res_msg) ctx.env->DeleteLocalRef(java_res_msg);
@@ -309,7 +341,7 @@ JNIEXPORT void JNICALL Java_com_example_commsstack_CommsStackBridge_nativeCallAd
     // using AddRequest, AddResponse, and the corresponding AddResponseListener methods.
     // For brevity, not fully implemented here but structure is the same.
     std::string serviceName = jstringToStdString(env, jServiceName);
-    std::cout << "JNI: nativeCallAdd for " << serviceName << " (" << a << ", " << b << ") - NOT FULLY IMPLEMENTED IN THIS EXAMPLE" << std::endl;
+    COMMS_LOG_WARN("JNI: nativeCallAdd for {} ({}, {}) - NOT FULLY IMPLEMENTED IN THIS EXAMPLE", serviceName, a, b);
 
     if (!jListener) return;
     jobject listener_global_ref = env->NewGlobalRef(jListener);
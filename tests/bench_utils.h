@@ -0,0 +1,41 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include "metrics.h"
+#include "sample_rpc_service.pb.h"
+#include <chrono>
+#include <cstdint>
+
+// Shared by the benchmark programs in this directory.
+
+// Answers at once, so the benchmarks measure the stack rather than the service.
+class FastSampleRpcImpl : public comms_stack::protos::SampleRpc {
+public:
+    void Echo(::google::protobuf::RpcController*, const comms_stack::protos::EchoRequest* request,
+              comms_stack::protos::EchoResponse* response, ::google::protobuf::Closure* done) override {
+        response->set_response_message(request->request_message());
+        done->Run();
+    }
+    void Add(::google::protobuf::RpcController*, const comms_stack::protos::AddRequest* request,
+             comms_stack::protos::AddResponse* response, ::google::protobuf::Closure* done) override {
+        response->set_sum(request->a() + request->b());
+        done->Run();
+    }
+};
+
+// Latencies are collected in the histogram Metrics uses (see metrics.h): fixed size however
+// many samples, percentiles to within its bucket width (1/16 of the value).
+inline void recordLatency(comms_stack::LatencyHistogram& histogram, std::chrono::steady_clock::duration latency) {
+    histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+}
+
+// `percentile` is 0-100, as in LatencyHistogram::percentile().
+inline double percentileUs(const comms_stack::LatencyHistogram& histogram, double percentile) {
+    return histogram.percentile(percentile) / 1e3;
+}
+
+inline double percentileMs(const comms_stack::LatencyHistogram& histogram, double percentile) {
+    return histogram.percentile(percentile) / 1e6;
+}
+
+#endif // BENCH_UTILS_H
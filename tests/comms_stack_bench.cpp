@@ -0,0 +1,436 @@
+#include "bench_utils.h"
+#include "communication_manager.h"
+#include "logging.h"
+#include "publisher.h"
+#include "rpc_client.h"
+#include "subscriber.h"
+#include "transport.h"
+#include "common_messages.pb.h"
+#include "sample_rpc_service.pb.h"
+#include <benchmark/benchmark.h>
+#include <vsomeip/vsomeip.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <new>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Microbenchmarks (Google Benchmark) of the stack's hot paths, each on the calling thread:
+//   SerializeToPayload       protobuf message -> vsomeip payload, as the publisher's wire path
+//   PublishDispatch          Publisher::publish() down to Transport::notify()
+//   SubscriberDispatch       a received notification through parsing to the user callback
+//   RpcRegisterFulfil        RpcClient call: pending-request registration, send, response
+//                            demultiplexing and promise fulfilment (canned response)
+//   ServerDispatch           a request through the server's parse, handler and response send
+//   RpcRoundTrip             the last two together
+// Transport handlers run on the benchmark's thread: what is sent is queued and delivered by
+// DirectTransport::flush() once the call that sent it has returned, as a dispatcher would, but
+// no dispatcher thread or cross-thread queue is part of the figures. Besides time, each benchmark reports
+// allocations per operation, bytes allocated per operation (copies of message data on these
+// paths all land in new buffers, so this bounds the bytes copied) and payload bytes handed to
+// the transport per operation.
+//
+// Usage: comms_stack_bench [--benchmark_filter=<regex>] [other Google Benchmark flags]
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+// Every replaceable allocation function below ends here and every deallocation function in
+// std::free(), so memory from any form of new can be released by any form of delete.
+void* countedAlloc(std::size_t size, std::size_t alignment) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size ? size : 1);
+    }
+    void* p = nullptr;
+    return posix_memalign(&p, alignment, size ? size : 1) == 0 ? p : nullptr;
+}
+
+void* countedAllocOrThrow(std::size_t size, std::size_t alignment) {
+    if (void* p = countedAlloc(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAllocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return countedAllocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocOrThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocOrThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+const uint16_t SERVICE_ID = 0x1111;
+const uint16_t INSTANCE_ID = 0x0001;
+const uint16_t EVENT_ID = 0x8001;
+const uint16_t RPC_SERVICE_ID = 0x2222;
+const uint16_t METHOD_ID_ADD = 0x0002;
+const uint16_t ANY = 0xFFFF;
+
+// Transport that runs handlers on the calling thread: send() queues the message and flush()
+// hands it to the peer's handler (or to `responder` when there is no peer), so no handler runs
+// inside the send() that caused it. Every service is available as soon as someone asks.
+// notify() only counts the payload.
+class DirectTransport : public comms_stack::Transport {
+public:
+    using Responder = std::function<std::shared_ptr<vsomeip::message>(const std::shared_ptr<vsomeip::message>&)>;
+
+    explicit DirectTransport(uint16_t client_id) : client_id_(client_id) {}
+
+    void connect(DirectTransport* peer) { peer_ = peer; }
+    void setResponder(Responder responder) { responder_ = std::move(responder); }
+    uint64_t payloadBytes() const { return payload_bytes_; }
+
+    // As if `message` had arrived from the network.
+    void deliver(const std::shared_ptr<vsomeip::message>& message) {
+        const MessageHandler* wildcard = nullptr;
+        for (const auto& entry : handlers_) {
+            uint16_t service, instance, method;
+            std::tie(service, instance, method) = entry.first;
+            if (service == message->get_service() && instance == message->get_instance() &&
+                method == message->get_method()) {
+                entry.second(message);
+                return;
+            }
+            if (!wildcard && (service == ANY || service == message->get_service()) &&
+                (instance == ANY || instance == message->get_instance()) &&
+                (method == ANY || method == message->get_method())) {
+                wildcard = &entry.second;
+            }
+        }
+        if (wildcard) {
+            (*wildcard)(message);
+        }
+    }
+
+    bool init() override { return true; }
+    void start() override {}
+    void stop() override {}
+    uint16_t getClientId() const override { return client_id_; }
+
+    void offerService(uint16_t, uint16_t) override {}
+    void stopOfferService(uint16_t, uint16_t) override {}
+    void requestService(uint16_t, uint16_t) override {}
+    void releaseService(uint16_t, uint16_t) override {}
+    void registerAvailabilityHandler(uint16_t service_id, uint16_t instance_id, AvailabilityHandler handler) override {
+        handler(service_id, instance_id == ANY ? INSTANCE_ID : instance_id, true);
+    }
+    void unregisterAvailabilityHandler(uint16_t, uint16_t) override {}
+
+    void registerMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id,
+                                MessageHandler handler) override {
+        handlers_.emplace_back(std::make_tuple(service_id, instance_id, method_id), std::move(handler));
+    }
+    void unregisterMessageHandler(uint16_t service_id, uint16_t instance_id, uint16_t method_id) override {
+        for (auto it = handlers_.begin(); it != handlers_.end(); ++it) {
+            if (it->first == std::make_tuple(service_id, instance_id, method_id)) {
+                handlers_.erase(it);
+                return;
+            }
+        }
+    }
+    void send(const std::shared_ptr<vsomeip::message>& message) override {
+        if (message->get_message_type() == vsomeip::message_type_e::MT_REQUEST) {
+            if (++session_ == 0) {
+                ++session_; // 0 is not a valid session ID
+            }
+            message->set_client(client_id_);
+            message->set_session(session_);
+        }
+        if (auto payload = message->get_payload()) {
+            payload_bytes_ += payload->get_length();
+        }
+        outbox_.push_back(message);
+    }
+
+    // Delivers the queued messages, and those the deliveries send in turn, on both ends.
+    void flush() {
+        bool delivered = true;
+        while (delivered) {
+            delivered = deliverOutbox();
+            if (peer_ && peer_->deliverOutbox()) {
+                delivered = true;
+            }
+        }
+    }
+
+    void offerEvent(uint16_t, uint16_t, uint16_t, const std::set<uint16_t>&, bool) override {}
+    void stopOfferEvent(uint16_t, uint16_t, uint16_t) override {}
+    void requestEvent(uint16_t, uint16_t, uint16_t, const std::set<uint16_t>&) override {}
+    void releaseEvent(uint16_t, uint16_t, uint16_t) override {}
+    void subscribe(uint16_t, uint16_t, uint16_t) override {}
+    void unsubscribe(uint16_t, uint16_t, uint16_t) override {}
+    void registerSubscriptionStatusHandler(uint16_t, uint16_t, uint16_t, uint16_t, SubscriptionStatusHandler) override {}
+    void unregisterSubscriptionStatusHandler(uint16_t, uint16_t, uint16_t, uint16_t) override {}
+    void notify(uint16_t, uint16_t, uint16_t, const std::shared_ptr<vsomeip::payload>& payload) override {
+        payload_bytes_ += payload->get_length();
+    }
+    void notifyOne(uint16_t, uint16_t, uint16_t, const std::shared_ptr<vsomeip::payload>& payload, uint16_t) override {
+        payload_bytes_ += payload->get_length();
+    }
+
+private:
+    // Without a peer or responder the messages are dropped.
+    bool deliverOutbox() {
+        if (outbox_.empty()) {
+            return false;
+        }
+        for (size_t i = 0; i < outbox_.size(); ++i) { // Deliveries may send more
+            std::shared_ptr<vsomeip::message> message = std::move(outbox_[i]);
+            if (peer_) {
+                peer_->deliver(message);
+            } else if (responder_) {
+                deliver(responder_(message));
+            }
+        }
+        outbox_.clear(); // Keeps the capacity, so the timed loops do not allocate for it
+        return true;
+    }
+
+    uint16_t client_id_;
+    uint16_t session_ = 0;
+    DirectTransport* peer_ = nullptr;
+    Responder responder_;
+    std::vector<std::shared_ptr<vsomeip::message>> outbox_;
+    std::vector<std::pair<std::tuple<uint16_t, uint16_t, uint16_t>, MessageHandler>> handlers_;
+    uint64_t payload_bytes_ = 0;
+};
+
+// Allocation and transport counters over the timed loop, reported per iteration.
+class OpCounters {
+public:
+    explicit OpCounters(const DirectTransport* transport = nullptr)
+        : transport_(transport),
+          allocations_(g_allocations.load(std::memory_order_relaxed)),
+          allocated_bytes_(g_allocated_bytes.load(std::memory_order_relaxed)),
+          payload_bytes_(transport ? transport->payloadBytes() : 0) {}
+
+    void report(benchmark::State& state) const {
+        const auto per_op = benchmark::Counter::kAvgIterations;
+        state.counters["allocs/op"] = benchmark::Counter(
+            static_cast<double>(g_allocations.load(std::memory_order_relaxed) - allocations_), per_op);
+        state.counters["alloc_bytes/op"] = benchmark::Counter(
+            static_cast<double>(g_allocated_bytes.load(std::memory_order_relaxed) - allocated_bytes_), per_op);
+        if (transport_) {
+            state.counters["payload_bytes/op"] =
+                benchmark::Counter(static_cast<double>(transport_->payloadBytes() - payload_bytes_), per_op);
+        }
+    }
+
+private:
+    const DirectTransport* transport_;
+    uint64_t allocations_;
+    uint64_t allocated_bytes_;
+    uint64_t payload_bytes_;
+};
+
+comms_stack::protos::SimpleNotification makeNotification(size_t content_size) {
+    comms_stack::protos::SimpleNotification notification;
+    notification.set_id(42);
+    notification.set_message_content(std::string(content_size, 'x'));
+    notification.set_timestamp(1700000000);
+    return notification;
+}
+
+// What the publisher's wire path does per message (see Publisher::sendEvent()).
+void BM_SerializeToPayload(benchmark::State& state) {
+    const comms_stack::protos::SimpleNotification notification = makeNotification(state.range(0));
+    auto runtime = vsomeip::runtime::get();
+    OpCounters counters;
+    for (auto _ : state) {
+        std::string serialized;
+        notification.SerializeToString(&serialized);
+        std::shared_ptr<vsomeip::payload> payload = runtime->create_payload();
+        std::vector<vsomeip::byte_t> data(serialized.begin(), serialized.end());
+        payload->set_data(data);
+        benchmark::DoNotOptimize(payload);
+    }
+    counters.report(state);
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(notification.ByteSizeLong()));
+}
+BENCHMARK(BM_SerializeToPayload)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_PublishDispatch(benchmark::State& state) {
+    auto transport = std::make_shared<DirectTransport>(0x0100);
+    comms_stack::Publisher publisher("BenchTopic", transport, SERVICE_ID, INSTANCE_ID, EVENT_ID);
+    const comms_stack::protos::SimpleNotification notification = makeNotification(state.range(0));
+    OpCounters counters(transport.get());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(publisher.publish(notification));
+    }
+    counters.report(state);
+}
+BENCHMARK(BM_PublishDispatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_SubscriberDispatch(benchmark::State& state) {
+    auto transport = std::make_shared<DirectTransport>(0x0100);
+    comms_stack::Subscriber subscriber("BenchTopic", transport, SERVICE_ID, INSTANCE_ID, EVENT_ID);
+    uint64_t received = 0;
+    subscriber.subscribe([&received](const comms_stack::protos::SimpleNotification& notification) {
+        received += notification.id();
+    });
+
+    auto runtime = vsomeip::runtime::get();
+    std::shared_ptr<vsomeip::message> message = runtime->create_notification();
+    message->set_service(SERVICE_ID);
+    message->set_instance(INSTANCE_ID);
+    message->set_method(EVENT_ID);
+    std::string serialized;
+    makeNotification(state.range(0)).SerializeToString(&serialized);
+    message->set_payload(runtime->create_payload(reinterpret_cast<const vsomeip::byte_t*>(serialized.data()),
+                                                 static_cast<vsomeip::length_t>(serialized.size())));
+
+    OpCounters counters;
+    for (auto _ : state) {
+        transport->deliver(message);
+    }
+    counters.report(state);
+    benchmark::DoNotOptimize(received);
+}
+BENCHMARK(BM_SubscriberDispatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_RpcRegisterFulfil(benchmark::State& state) {
+    auto transport = std::make_shared<DirectTransport>(0x0100);
+    auto runtime = vsomeip::runtime::get();
+    comms_stack::protos::AddResponse canned;
+    canned.set_sum(3);
+    std::string serialized;
+    canned.SerializeToString(&serialized);
+    const std::vector<vsomeip::byte_t> response_data(serialized.begin(), serialized.end());
+    transport->setResponder([runtime, &response_data](const std::shared_ptr<vsomeip::message>& request) {
+        std::shared_ptr<vsomeip::message> response = runtime->create_response(request);
+        std::shared_ptr<vsomeip::payload> payload = runtime->create_payload();
+        payload->set_data(response_data);
+        response->set_payload(payload);
+        return response;
+    });
+    comms_stack::RpcClient client("BenchRpc", transport, RPC_SERVICE_ID, INSTANCE_ID);
+    comms_stack::protos::AddRequest request;
+    request.set_a(1);
+    request.set_b(2);
+
+    OpCounters counters(transport.get());
+    for (auto _ : state) {
+        std::future<comms_stack::protos::AddResponse> response = client.Add(request);
+        transport->flush();
+        benchmark::DoNotOptimize(response.get().sum());
+    }
+    counters.report(state);
+}
+BENCHMARK(BM_RpcRegisterFulfil);
+
+// A server-side CommunicationManager on a DirectTransport; responses go to `client` if given.
+struct Server {
+    std::shared_ptr<DirectTransport> transport = std::make_shared<DirectTransport>(0x0200);
+    comms_stack::CommunicationManager manager;
+
+    explicit Server(DirectTransport* client = nullptr) {
+        transport->connect(client);
+        comms_stack::CommunicationManager::Options options;
+        options.app_name = "BenchServer";
+        options.transport = transport;
+        options.intra_process = false;
+        options.provision = false;
+        manager.init(options);
+        manager.registerRpcService("BenchRpc", RPC_SERVICE_ID, INSTANCE_ID, std::make_shared<FastSampleRpcImpl>());
+    }
+    ~Server() { manager.shutdown(); }
+};
+
+void BM_ServerDispatch(benchmark::State& state) {
+    Server server;
+    auto runtime = vsomeip::runtime::get();
+    comms_stack::protos::AddRequest add;
+    add.set_a(1);
+    add.set_b(2);
+    std::string serialized;
+    add.SerializeToString(&serialized);
+    std::shared_ptr<vsomeip::message> request = runtime->create_request(false);
+    request->set_service(RPC_SERVICE_ID);
+    request->set_instance(INSTANCE_ID);
+    request->set_method(METHOD_ID_ADD);
+    request->set_client(0x0100);
+    request->set_session(1);
+    request->set_payload(runtime->create_payload(reinterpret_cast<const vsomeip::byte_t*>(serialized.data()),
+                                                 static_cast<vsomeip::length_t>(serialized.size())));
+
+    OpCounters counters(server.transport.get());
+    for (auto _ : state) {
+        server.transport->deliver(request);
+        server.transport->flush(); // Drops the response
+    }
+    counters.report(state);
+}
+BENCHMARK(BM_ServerDispatch);
+
+void BM_RpcRoundTrip(benchmark::State& state) {
+    auto client_transport = std::make_shared<DirectTransport>(0x0100);
+    Server server(client_transport.get());
+    client_transport->connect(server.transport.get());
+    {
+        comms_stack::RpcClient client("BenchRpc", client_transport, RPC_SERVICE_ID, INSTANCE_ID);
+        comms_stack::protos::AddRequest request;
+        request.set_a(1);
+        request.set_b(2);
+
+        OpCounters counters(client_transport.get());
+        for (auto _ : state) {
+            std::future<comms_stack::protos::AddResponse> response = client.Add(request);
+            client_transport->flush();
+            benchmark::DoNotOptimize(response.get().sum());
+        }
+        counters.report(state);
+    }
+    client_transport->connect(nullptr);
+}
+BENCHMARK(BM_RpcRoundTrip);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    comms_stack::Logger::setLevel(comms_stack::LogLevel::Warn);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
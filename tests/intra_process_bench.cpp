@@ -0,0 +1,121 @@
+#include "bench_utils.h"
+#include "communication_manager.h"
+#include "publisher.h"
+#include "subscriber.h"
+#include "common_messages.pb.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Publish-to-callback latency between two co-located components: a publisher on one
+// CommunicationManager (CommsStackApp_Shard0) and a subscriber on another (CommsStackApp_Shard1)
+// in the same process, once through vsomeip and once with intra-process delivery. Messages are
+// sent one at a time, each after the previous one arrived.
+//
+// Usage: intra_process_bench [messages=2000] [payload_bytes=64]
+// Exits non-zero if a run could not be set up or no message arrived.
+
+struct Result {
+    comms_stack::LatencyHistogram latencies;
+    size_t lost = 0;
+    std::string error; // Empty if the run took place
+};
+
+Result run(bool intra_process, int messages, size_t payload_bytes) {
+    Result result;
+    comms_stack::CommunicationManager publisher_side;
+    comms_stack::CommunicationManager subscriber_side;
+    comms_stack::CommunicationManager::Options options;
+    options.intra_process = intra_process;
+    options.app_name = "CommsStackApp_Shard0";
+    if (!publisher_side.init(options)) {
+        result.error = "Failed to initialize CommunicationManager CommsStackApp_Shard0.";
+        return result;
+    }
+    options.app_name = "CommsStackApp_Shard1";
+    if (!subscriber_side.init(options)) {
+        publisher_side.shutdown();
+        result.error = "Failed to initialize CommunicationManager CommsStackApp_Shard1.";
+        return result;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t last_id = 0;
+    std::chrono::steady_clock::time_point received_at;
+
+    auto subscriber = subscriber_side.getSubscriber("TestTopic");
+    auto publisher = publisher_side.getPublisher("TestTopic");
+    if (!subscriber || !publisher) {
+        subscriber_side.shutdown();
+        publisher_side.shutdown();
+        result.error = "TestTopic is missing from the configuration.";
+        return result;
+    }
+    subscriber->subscribe([&](const comms_stack::protos::SimpleNotification& notification) {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        last_id = notification.id();
+        received_at = now;
+        cv.notify_one();
+    });
+    std::this_thread::sleep_for(std::chrono::seconds(1)); // Let the event subscription settle
+
+    comms_stack::protos::SimpleNotification notification;
+    notification.set_message_content(std::string(payload_bytes, 'x'));
+    for (int i = 1; i <= messages; ++i) {
+        notification.set_id(i);
+        auto sent_at = std::chrono::steady_clock::now();
+        publisher->publish(notification);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv.wait_for(lock, std::chrono::milliseconds(200), [&]() { return last_id == static_cast<uint32_t>(i); })) {
+            result.lost++;
+            continue;
+        }
+        recordLatency(result.latencies, received_at - sent_at);
+    }
+
+    subscriber->unsubscribe();
+    subscriber.reset();
+    publisher.reset();
+    subscriber_side.shutdown();
+    publisher_side.shutdown();
+    if (result.latencies.count() == 0) {
+        result.error = "No message arrived.";
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int messages = argc > 1 ? std::atoi(argv[1]) : 2000;
+    size_t payload_bytes = argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 64;
+
+    Result wire = run(false, messages, payload_bytes);
+    Result local = run(true, messages, payload_bytes);
+    bool failed = false;
+    for (const auto& [label, r] : {std::make_pair("vsomeip", &wire), std::make_pair("intra-process", &local)}) {
+        if (!r->error.empty()) {
+            std::cerr << label << " run failed: " << r->error << std::endl;
+            failed = true;
+        }
+    }
+    if (failed) {
+        return 1;
+    }
+
+    std::cout << "\n=== Co-located publish -> callback latency (" << messages << " messages, "
+              << payload_bytes << " byte payload, us) ===" << std::endl;
+    for (const auto& [label, r] : {std::make_pair("vsomeip", &wire), std::make_pair("intra-process", &local)}) {
+        std::cout << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(1)
+                  << " p50=" << std::setw(9) << percentileUs(r->latencies, 50)
+                  << " p99=" << std::setw(9) << percentileUs(r->latencies, 99)
+                  << " max=" << std::setw(9) << r->latencies.max() / 1e3
+                  << " lost=" << r->lost << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "bench_utils.h"
+#include "communication_manager.h"
+#include "loopback_transport.h"
+#include "logging.h"
+#include "metrics.h"
+#include "publisher.h"
+#include "rpc_client.h"
+#include "subscriber.h"
+#include "common_messages.pb.h"
+#include "sample_rpc_service.pb.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+// Checks that introspection stays off the hot paths: publishes and RPC calls run between two
+// managers on a LoopbackTransport, first alone and then while another thread fetches snapshots
+// from the publisher side's introspection socket as fast as it can. Prints the publish() and
+// round-trip latency of both runs, the snapshot rate, and the last snapshot.
+//
+// Usage: introspection_bench [messages=50000] [socket=@comms_stack_introspection_bench]
+
+const char* REGISTRY_JSON = R"({
+    "comms_stack" : {
+        "topics" : [ { "name" : "IntrospectTopic", "service" : "0x1111", "instance" : "0x0001", "event" : "0x8001" } ],
+        "services" : [ { "name" : "SampleRpc", "service" : "0x2222", "instance" : "0x0001" } ]
+    }
+})";
+
+// Reads one snapshot; empty on failure.
+std::string fetchSnapshot(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), std::min(path.size(), sizeof(address.sun_path) - 1));
+    socklen_t length = sizeof(address);
+    if (path[0] == '@') {
+        address.sun_path[0] = '\0';
+        length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), length) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return std::string();
+    }
+    std::string snapshot;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        snapshot.append(buffer, static_cast<size_t>(count));
+    }
+    ::close(fd);
+    return snapshot;
+}
+
+// Publishes `messages` notifications and makes one Add call per 10 of them; records the
+// duration of each publish() and each call.
+void runTraffic(comms_stack::Publisher& publisher, comms_stack::RpcClient& client, int messages,
+                comms_stack::LatencyHistogram& publish_latency, comms_stack::LatencyHistogram& rpc_latency) {
+    comms_stack::protos::SimpleNotification notification;
+    notification.set_message_content(std::string(64, 'x'));
+    for (int i = 0; i < messages; ++i) {
+        notification.set_id(static_cast<uint32_t>(i));
+        auto start = std::chrono::steady_clock::now();
+        publisher.publish(notification);
+        publish_latency.record(static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count()));
+        if (i % 10 == 0) {
+            comms_stack::protos::AddRequest request;
+            request.set_a(i);
+            request.set_b(1);
+            start = std::chrono::steady_clock::now();
+            auto future = client.Add(request);
+            if (future.wait_for(std::chrono::seconds(5)) == std::future_status::ready) {
+                rpc_latency.record(static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count()));
+            }
+        }
+    }
+}
+
+void printRow(const char* name, const comms_stack::LatencyHistogram& publish_latency,
+              const comms_stack::LatencyHistogram& rpc_latency) {
+    std::cout << std::setw(20) << name << std::fixed << std::setprecision(2) << std::setw(14)
+              << publish_latency.percentile(50) / 1000.0 << std::setw(14) << publish_latency.percentile(99) / 1000.0
+              << std::setw(14) << rpc_latency.percentile(50) / 1000.0 << std::setw(14)
+              << rpc_latency.percentile(99) / 1000.0 << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int messages = argc > 1 ? std::atoi(argv[1]) : 50000;
+    std::string socket_path = argc > 2 ? argv[2] : "@comms_stack_introspection_bench";
+    comms_stack::Logger::setLevel(comms_stack::LogLevel::Warn);
+
+    const std::string registry_path = "/tmp/introspection_bench_" + std::to_string(::getpid()) + ".json";
+    {
+        std::ofstream registry(registry_path);
+        registry << REGISTRY_JSON;
+    }
+    auto network = std::make_shared<comms_stack::LoopbackNetwork>();
+    comms_stack::CommunicationManager server_side;
+    comms_stack::CommunicationManager client_side;
+    comms_stack::CommunicationManager::Options options;
+    options.loopback = network;
+    options.intra_process = false;
+    options.config_path = registry_path;
+    options.app_name = "IntrospectedServer";
+    options.introspection_socket = socket_path;
+    bool initialized = server_side.init(options);
+    options.app_name = "IntrospectedClient";
+    options.introspection_socket.clear();
+    initialized = initialized && client_side.init(options);
+    ::unlink(registry_path.c_str());
+    if (!initialized) {
+        std::cerr << "Failed to initialize the managers" << std::endl;
+        return 1;
+    }
+
+    server_side.registerRpcService("SampleRpc", std::make_shared<FastSampleRpcImpl>());
+    auto publisher = server_side.getPublisher("IntrospectTopic");
+    auto subscriber = client_side.getSubscriber("IntrospectTopic");
+    auto client = client_side.getRpcClient("SampleRpc");
+    std::atomic<uint64_t> received{0};
+    if (!publisher || !subscriber || !client ||
+        !subscriber->subscribe([&](const comms_stack::protos::SimpleNotification&) { received++; }) ||
+        !client->waitForAvailability(std::chrono::seconds(1))) {
+        std::cerr << "Failed to set up the endpoints" << std::endl;
+        client_side.shutdown();
+        server_side.shutdown();
+        return 1;
+    }
+
+    std::cout << "\n=== Traffic with and without snapshot polling (" << messages << " messages) ===" << std::endl;
+    std::cout << std::setw(20) << "" << std::setw(14) << "publish p50" << std::setw(14) << "publish p99"
+              << std::setw(14) << "rpc p50" << std::setw(14) << "rpc p99" << "  (us)" << std::endl;
+    {
+        comms_stack::LatencyHistogram publish_latency;
+        comms_stack::LatencyHistogram rpc_latency;
+        runTraffic(*publisher, *client, messages, publish_latency, rpc_latency);
+        printRow("no snapshots", publish_latency, rpc_latency);
+    }
+
+    std::atomic<bool> polling{true};
+    std::atomic<uint64_t> snapshots{0};
+    std::string last_snapshot;
+    std::thread poller([&]() {
+        while (polling) {
+            std::string snapshot = fetchSnapshot(socket_path);
+            if (!snapshot.empty()) {
+                snapshots++;
+                last_snapshot.swap(snapshot);
+            }
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    comms_stack::LatencyHistogram publish_latency;
+    comms_stack::LatencyHistogram rpc_latency;
+    runTraffic(*publisher, *client, messages, publish_latency, rpc_latency);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    polling = false;
+    poller.join();
+    printRow("polling snapshots", publish_latency, rpc_latency);
+    std::cout << "\n" << snapshots << " snapshots in " << std::setprecision(2) << seconds << " s ("
+              << std::setprecision(0) << snapshots / seconds << "/s), " << received << " messages received"
+              << std::endl;
+    std::cout << "\n=== Last snapshot ===\n" << last_snapshot << std::endl;
+
+    publisher.reset();
+    subscriber.reset();
+    client.reset();
+    client_side.shutdown();
+    server_side.shutdown();
+    return 0;
+}
@@ -0,0 +1,463 @@
+#include "communication_manager.h"
+#include "logging.h"
+#include "loopback_transport.h"
+#include "metrics.h"
+#include "publisher.h"
+#include "rpc_client.h"
+#include "subscriber.h"
+#include "common_messages.pb.h"
+#include "sample_rpc_service.pb.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Load generator for capacity planning: drives pub/sub and RPC through the stack with a chosen
+// message size, rate, topic count, publisher and subscriber counts and RPC concurrency, and
+// prints latency percentiles and achieved throughput as JSON.
+//
+// Modes:
+//   open    Messages and calls are issued on a fixed schedule (rate / publishers per publisher
+//           thread, rpc-rate / rpc-concurrency per RPC worker), whether or not earlier ones have
+//           completed. Latency is measured from the scheduled time, not from when the send
+//           actually happened, so a stall shows up in every message it delayed rather than
+//           only in the one that hit it (no coordinated omission).
+//   closed  Every publisher thread and RPC worker sends back to back: the achieved throughput
+//           is the maximum, and latency includes the queueing that causes.
+//
+// Publishers and the RPC server share one CommunicationManager. Each subscriber is an
+// application of its own (a manager subscribing to every topic), as is the RPC client side,
+// so all traffic crosses the transport. Publisher thread p publishes to topics p, p +
+// publishers, ... in turn. Pub/sub latency is publish to callback, carried in the message's
+// timestamp field (steady clock), so it is only valid within one host. RPC calls are Echo with
+// a `size`-byte string.
+//
+// With --transport=vsomeip the applications are LoadGen_Server, LoadGen_Client and
+// LoadGen_Sub0, LoadGen_Sub1, ..., which need entries in the vsomeip configuration; the default
+// loopback transport needs none (see loopback_transport.h).
+//
+// Usage: load_generator [--mode=open|closed] [--workload=both|pubsub|rpc] [--rate=10000]
+//                       [--rpc-rate=2000] [--duration=10] [--warmup=1] [--size=64] [--topics=1]
+//                       [--publishers=1] [--subscribers=1] [--rpc-concurrency=4]
+//                       [--transport=loopback|vsomeip] [--config=path] [--output=file]
+
+const uint16_t TOPIC_SERVICE_ID = 0x1111;
+const uint16_t TOPIC_INSTANCE_ID = 0x0001;
+const uint16_t TOPIC_FIRST_EVENT_ID = 0x8001;
+const uint16_t RPC_SERVICE_ID = 0x2222;
+const uint16_t RPC_INSTANCE_ID = 0x0001;
+
+struct LoadConfig {
+    bool open_loop = true;
+    bool pubsub = true;
+    bool rpc = true;
+    double rate = 10000;    // Messages per second over all publishers (open loop)
+    double rpc_rate = 2000; // Calls per second over all RPC workers (open loop)
+    double duration_s = 10;
+    double warmup_s = 1;    // Run first, not measured
+    size_t size = 64;       // Message content / Echo string bytes
+    int topics = 1;
+    int publishers = 1;
+    int subscribers = 1;
+    int rpc_concurrency = 4;
+    bool loopback = true;
+    std::string config_path;
+    std::string output;
+};
+
+class EchoRpcImpl : public comms_stack::protos::SampleRpc {
+public:
+    void Echo(::google::protobuf::RpcController*, const comms_stack::protos::EchoRequest* request,
+              comms_stack::protos::EchoResponse* response, ::google::protobuf::Closure* done) override {
+        response->set_response_message(request->request_message());
+        done->Run();
+    }
+    void Add(::google::protobuf::RpcController*, const comms_stack::protos::AddRequest* request,
+             comms_stack::protos::AddResponse* response, ::google::protobuf::Closure* done) override {
+        response->set_sum(request->a() + request->b());
+        done->Run();
+    }
+};
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void sleepUntilNs(uint64_t ns) {
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns))));
+}
+
+// Results of one side of the load (a subscriber application, a publisher thread, an RPC worker).
+struct LoadStats {
+    std::mutex mutex; // Subscriber callbacks may run on several dispatcher threads
+    comms_stack::LatencyHistogram latency;
+    uint64_t messages = 0; // Measured: scheduled (open loop) or started (closed loop) after warmup
+    uint64_t failures = 0;
+};
+
+// Schedule shared by the workers: warmup from start_ns, measurement from measure_ns to end_ns.
+struct RunWindow {
+    uint64_t start_ns = 0;
+    uint64_t measure_ns = 0;
+    uint64_t end_ns = 0;
+};
+
+void publishLoop(const LoadConfig& config, const RunWindow& window, int index,
+                 const std::vector<std::shared_ptr<comms_stack::Publisher>>& publishers, LoadStats& stats) {
+    comms_stack::protos::SimpleNotification notification;
+    notification.set_message_content(std::string(config.size, 'x'));
+    const double interval_ns = 1e9 * config.publishers / config.rate;
+    size_t topic = static_cast<size_t>(index) % publishers.size();
+    for (uint64_t n = 0;; ++n) {
+        uint64_t scheduled = nowNs();
+        if (config.open_loop) {
+            // Offset the threads so their sends interleave instead of bunching up.
+            scheduled = window.start_ns + static_cast<uint64_t>((n + static_cast<double>(index) / config.publishers) * interval_ns);
+            if (scheduled >= window.end_ns) {
+                break;
+            }
+            if (scheduled > nowNs()) {
+                sleepUntilNs(scheduled);
+            }
+        } else if (scheduled >= window.end_ns) {
+            break;
+        }
+        notification.set_id(static_cast<uint32_t>(n));
+        notification.set_timestamp(scheduled);
+        const bool sent = publishers[topic]->publish(notification);
+        if (scheduled >= window.measure_ns) {
+            stats.messages++;
+            if (!sent) {
+                stats.failures++;
+            }
+        }
+        topic += static_cast<size_t>(config.publishers);
+        if (topic >= publishers.size()) {
+            topic = static_cast<size_t>(index) % publishers.size();
+        }
+    }
+}
+
+void rpcLoop(const LoadConfig& config, const RunWindow& window, int index, comms_stack::RpcClient& client,
+             LoadStats& stats) {
+    comms_stack::protos::EchoRequest request;
+    request.set_request_message(std::string(config.size, 'x'));
+    const double interval_ns = 1e9 * config.rpc_concurrency / config.rpc_rate;
+    for (uint64_t n = 0;; ++n) {
+        uint64_t scheduled = nowNs();
+        if (config.open_loop) {
+            scheduled = window.start_ns + static_cast<uint64_t>((n + static_cast<double>(index) / config.rpc_concurrency) * interval_ns);
+            if (scheduled >= window.end_ns) {
+                break;
+            }
+            if (scheduled > nowNs()) {
+                sleepUntilNs(scheduled);
+            }
+        } else if (scheduled >= window.end_ns) {
+            break;
+        }
+        auto future = client.Echo(request);
+        bool ok = future.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+        if (ok) {
+            try {
+                ok = future.get().response_message().size() == config.size;
+            } catch (const std::exception&) {
+                ok = false;
+            }
+        }
+        const uint64_t completed = nowNs();
+        if (scheduled < window.measure_ns) {
+            continue;
+        }
+        stats.messages++;
+        if (ok) {
+            stats.latency.record(completed - scheduled);
+        } else {
+            stats.failures++;
+        }
+    }
+}
+
+void writeLatency(std::ostream& out, const comms_stack::LatencyHistogram& latency) {
+    out << "{\"p50\": " << latency.percentile(50) / 1000.0 << ", \"p99\": " << latency.percentile(99) / 1000.0
+        << ", \"p999\": " << latency.percentile(99.9) / 1000.0 << ", \"max\": " << latency.max() / 1000.0
+        << ", \"mean\": " << latency.mean() / 1000.0 << "}";
+}
+
+bool parseArgs(int argc, char** argv, LoadConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t equals = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || equals == std::string::npos) {
+            std::cerr << "Unexpected argument: " << arg << std::endl;
+            return false;
+        }
+        const std::string key = arg.substr(2, equals - 2);
+        const std::string value = arg.substr(equals + 1);
+        if (key == "mode" && (value == "open" || value == "closed")) {
+            config.open_loop = value == "open";
+        } else if (key == "workload" && (value == "both" || value == "pubsub" || value == "rpc")) {
+            config.pubsub = value != "rpc";
+            config.rpc = value != "pubsub";
+        } else if (key == "transport" && (value == "loopback" || value == "vsomeip")) {
+            config.loopback = value == "loopback";
+        } else if (key == "rate") {
+            config.rate = std::atof(value.c_str());
+        } else if (key == "rpc-rate") {
+            config.rpc_rate = std::atof(value.c_str());
+        } else if (key == "duration") {
+            config.duration_s = std::atof(value.c_str());
+        } else if (key == "warmup") {
+            config.warmup_s = std::atof(value.c_str());
+        } else if (key == "size") {
+            config.size = static_cast<size_t>(std::atol(value.c_str()));
+        } else if (key == "topics") {
+            config.topics = std::atoi(value.c_str());
+        } else if (key == "publishers") {
+            config.publishers = std::atoi(value.c_str());
+        } else if (key == "subscribers") {
+            config.subscribers = std::atoi(value.c_str());
+        } else if (key == "rpc-concurrency") {
+            config.rpc_concurrency = std::atoi(value.c_str());
+        } else if (key == "config") {
+            config.config_path = value;
+        } else if (key == "output") {
+            config.output = value;
+        } else {
+            std::cerr << "Unknown option or value: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (config.rate <= 0 || config.rpc_rate <= 0 || config.duration_s <= 0 || config.warmup_s < 0 ||
+        config.topics < 1 || config.topics > 0x7FFE || config.publishers < 1 || config.subscribers < 1 ||
+        config.rpc_concurrency < 1) {
+        std::cerr << "Rates, duration, topics, publishers, subscribers and rpc-concurrency must be positive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    LoadConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        std::cerr << "Usage: load_generator [--mode=open|closed] [--workload=both|pubsub|rpc] [--rate=N] "
+                     "[--rpc-rate=N] [--duration=s] [--warmup=s] [--size=bytes] [--topics=N] [--publishers=N] "
+                     "[--subscribers=N] [--rpc-concurrency=N] [--transport=loopback|vsomeip] [--config=path] "
+                     "[--output=file]"
+                  << std::endl;
+        return 2;
+    }
+    comms_stack::Logger::setLevel(comms_stack::LogLevel::Warn);
+
+    comms_stack::CommunicationManager::Options options;
+    options.intra_process = false; // Keep every message on the transport
+    options.provision = false;
+    options.config_path = config.config_path;
+    if (config.loopback) {
+        options.loopback = std::make_shared<comms_stack::LoopbackNetwork>();
+    }
+    comms_stack::CommunicationManager server_side;
+    comms_stack::CommunicationManager client_side;
+    std::vector<std::unique_ptr<comms_stack::CommunicationManager>> subscriber_sides;
+    auto shutdownAll = [&]() {
+        for (auto& side : subscriber_sides) {
+            side->shutdown();
+        }
+        client_side.shutdown();
+        server_side.shutdown();
+    };
+    options.app_name = "LoadGen_Server";
+    if (!server_side.init(options)) {
+        std::cerr << "Failed to initialize LoadGen_Server" << std::endl;
+        return 1;
+    }
+    options.app_name = "LoadGen_Client";
+    if (config.rpc && !client_side.init(options)) {
+        std::cerr << "Failed to initialize LoadGen_Client" << std::endl;
+        shutdownAll();
+        return 1;
+    }
+    for (int s = 0; config.pubsub && s < config.subscribers; ++s) {
+        subscriber_sides.push_back(std::make_unique<comms_stack::CommunicationManager>());
+        options.app_name = "LoadGen_Sub" + std::to_string(s);
+        if (!subscriber_sides.back()->init(options)) {
+            std::cerr << "Failed to initialize " << options.app_name << std::endl;
+            shutdownAll();
+            return 1;
+        }
+    }
+
+    RunWindow window;
+    std::vector<std::unique_ptr<LoadStats>> publisher_stats;
+    std::vector<std::unique_ptr<LoadStats>> subscriber_stats;
+    std::vector<std::unique_ptr<LoadStats>> rpc_stats;
+    bool ready = true;
+    {
+        std::vector<std::shared_ptr<comms_stack::Publisher>> publishers;
+        std::vector<std::unique_ptr<comms_stack::Subscriber>> subscribers;
+        std::unique_ptr<comms_stack::RpcClient> client;
+        if (config.pubsub) {
+            server_side.getTransport()->offerService(TOPIC_SERVICE_ID, TOPIC_INSTANCE_ID);
+            for (int t = 0; t < config.topics; ++t) {
+                publishers.push_back(std::make_shared<comms_stack::Publisher>(
+                    "LoadTopic" + std::to_string(t), server_side.getTransport(), TOPIC_SERVICE_ID, TOPIC_INSTANCE_ID,
+                    static_cast<uint16_t>(TOPIC_FIRST_EVENT_ID + t)));
+            }
+            for (int s = 0; s < config.subscribers; ++s) {
+                subscriber_stats.push_back(std::make_unique<LoadStats>());
+                LoadStats* stats = subscriber_stats.back().get();
+                for (int t = 0; t < config.topics; ++t) {
+                    subscribers.push_back(std::make_unique<comms_stack::Subscriber>(
+                        "LoadTopic" + std::to_string(t), subscriber_sides[s]->getTransport(), TOPIC_SERVICE_ID,
+                        TOPIC_INSTANCE_ID, static_cast<uint16_t>(TOPIC_FIRST_EVENT_ID + t)));
+                    subscribers.back()->subscribe([stats, &window](const comms_stack::protos::SimpleNotification& message) {
+                        const uint64_t received = nowNs();
+                        if (message.timestamp() < window.measure_ns) {
+                            return;
+                        }
+                        std::lock_guard<std::mutex> lock(stats->mutex);
+                        stats->messages++;
+                        stats->latency.record(received > message.timestamp() ? received - message.timestamp() : 0);
+                    });
+                    ready = ready && subscribers.back()->waitForAvailability(std::chrono::seconds(5));
+                }
+            }
+        }
+        if (config.rpc) {
+            server_side.registerRpcService("LoadGenRpc", RPC_SERVICE_ID, RPC_INSTANCE_ID, std::make_shared<EchoRpcImpl>());
+            client = std::make_unique<comms_stack::RpcClient>("LoadGenRpc", client_side.getTransport(), RPC_SERVICE_ID,
+                                                              RPC_INSTANCE_ID);
+            ready = ready && client->waitForAvailability(std::chrono::seconds(5));
+        }
+        if (!ready) {
+            std::cerr << "Services did not become available" << std::endl;
+            subscribers.clear();
+            publishers.clear();
+            client.reset();
+            shutdownAll();
+            return 1;
+        }
+
+        // The window is fixed before any worker starts; subscriber callbacks read it from then on.
+        window.start_ns = nowNs() + 10000000; // 10 ms for the threads to start
+        window.measure_ns = window.start_ns + static_cast<uint64_t>(config.warmup_s * 1e9);
+        window.end_ns = window.measure_ns + static_cast<uint64_t>(config.duration_s * 1e9);
+        std::vector<std::thread> workers;
+        for (int p = 0; config.pubsub && p < config.publishers; ++p) {
+            publisher_stats.push_back(std::make_unique<LoadStats>());
+            workers.emplace_back([&, p, stats = publisher_stats.back().get()]() {
+                sleepUntilNs(window.start_ns);
+                publishLoop(config, window, p, publishers, *stats);
+            });
+        }
+        for (int w = 0; config.rpc && w < config.rpc_concurrency; ++w) {
+            rpc_stats.push_back(std::make_unique<LoadStats>());
+            workers.emplace_back([&, w, stats = rpc_stats.back().get()]() {
+                sleepUntilNs(window.start_ns);
+                rpcLoop(config, window, w, *client, *stats);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        // Let queued messages arrive; whatever has not after this counts as lost.
+        uint64_t sent = 0;
+        for (const auto& stats : publisher_stats) {
+            sent += stats->messages - stats->failures;
+        }
+        const auto drain_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (config.pubsub && std::chrono::steady_clock::now() < drain_deadline) {
+            uint64_t received = 0;
+            for (const auto& stats : subscriber_stats) {
+                std::lock_guard<std::mutex> lock(stats->mutex);
+                received += stats->messages;
+            }
+            if (received >= sent * config.subscribers) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        subscribers.clear();
+        publishers.clear();
+        client.reset();
+        if (config.pubsub) {
+            server_side.getTransport()->stopOfferService(TOPIC_SERVICE_ID, TOPIC_INSTANCE_ID);
+        }
+    }
+    shutdownAll();
+
+    uint64_t published = 0;
+    uint64_t publish_failures = 0;
+    for (const auto& stats : publisher_stats) {
+        published += stats->messages;
+        publish_failures += stats->failures;
+    }
+    uint64_t received = 0;
+    comms_stack::LatencyHistogram pubsub_latency;
+    for (const auto& stats : subscriber_stats) {
+        received += stats->messages;
+        pubsub_latency.merge(stats->latency);
+    }
+    uint64_t calls = 0;
+    uint64_t call_failures = 0;
+    comms_stack::LatencyHistogram rpc_latency;
+    for (const auto& stats : rpc_stats) {
+        calls += stats->messages;
+        call_failures += stats->failures;
+        rpc_latency.merge(stats->latency);
+    }
+    const uint64_t expected = (published - publish_failures) * static_cast<uint64_t>(config.subscribers);
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\n  \"config\": {\"mode\": \"" << (config.open_loop ? "open" : "closed") << "\", \"transport\": \""
+         << (config.loopback ? "loopback" : "vsomeip") << "\", \"duration_s\": " << config.duration_s
+         << ", \"warmup_s\": " << config.warmup_s << ", \"size\": " << config.size << ", \"topics\": " << config.topics
+         << ", \"publishers\": " << config.publishers << ", \"subscribers\": " << config.subscribers
+         << ", \"rpc_concurrency\": " << config.rpc_concurrency;
+    if (config.open_loop) {
+        json << ", \"rate\": " << config.rate << ", \"rpc_rate\": " << config.rpc_rate;
+    }
+    json << "}";
+    if (config.pubsub) {
+        json << ",\n  \"pubsub\": {\"published\": " << published << ", \"publish_failures\": " << publish_failures
+             << ", \"received\": " << received << ", \"lost\": " << (expected > received ? expected - received : 0)
+             << ", \"publish_rate\": " << published / config.duration_s
+             << ", \"receive_rate\": " << received / config.duration_s
+             << ", \"receive_mb_per_s\": " << received * static_cast<double>(config.size) / config.duration_s / 1e6
+             << ",\n             \"latency_us\": ";
+        writeLatency(json, pubsub_latency);
+        json << "}";
+    }
+    if (config.rpc) {
+        json << ",\n  \"rpc\": {\"calls\": " << calls << ", \"failures\": " << call_failures
+             << ", \"call_rate\": " << (calls - call_failures) / config.duration_s << ",\n          \"latency_us\": ";
+        writeLatency(json, rpc_latency);
+        json << "}";
+    }
+    json << "\n}\n";
+
+    if (config.output.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(config.output);
+        out << json.str();
+        if (!out) {
+            std::cerr << "Cannot write " << config.output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "bench_utils.h"
+#include "communication_manager.h"
+#include "loopback_transport.h"
+#include "publisher.h"
+#include "rpc_client.h"
+#include "subscriber.h"
+#include "common_messages.pb.h"
+#include "sample_rpc_service.pb.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// RPC and pub/sub through the stack's own code paths (Publisher, Subscriber, RpcClient,
+// ResponseDemultiplexer, server dispatch) on a LoopbackTransport, i.e. without vsomeip routing,
+// sockets or service discovery. Needs no configuration file, and results only depend on this
+// process, so regressions in the stack itself show up without network noise.
+//
+// Usage: loopback_bench [requests=20000] [messages=20000] [threads=4]
+
+const uint16_t RPC_SERVICE_ID = 0x2222;
+const uint16_t RPC_INSTANCE_ID = 0x0001;
+const uint16_t TOPIC_SERVICE_ID = 0x1111;
+const uint16_t TOPIC_INSTANCE_ID = 0x0001;
+const uint16_t TOPIC_EVENT_ID = 0x8001;
+
+void printLatencies(const char* name, const comms_stack::LatencyHistogram& latencies, size_t failures) {
+    std::cout << std::setw(14) << name << std::fixed << std::setprecision(1)
+              << std::setw(12) << percentileUs(latencies, 50)
+              << std::setw(12) << percentileUs(latencies, 99)
+              << std::setw(12) << percentileUs(latencies, 99.9)
+              << std::setw(10) << failures << std::endl;
+}
+
+// One call at a time, so each sample is a full round trip through both dispatchers.
+void benchRpcLatency(comms_stack::RpcClient& client, int requests) {
+    comms_stack::LatencyHistogram latencies;
+    size_t failures = 0;
+    for (int i = 0; i < requests; ++i) {
+        comms_stack::protos::AddRequest req;
+        req.set_a(i);
+        req.set_b(1);
+        auto start = std::chrono::steady_clock::now();
+        auto future = client.Add(req);
+        if (future.wait_for(std::chrono::seconds(5)) == std::future_status::timeout) {
+            failures++;
+            continue;
+        }
+        try {
+            if (future.get().sum() != i + 1) {
+                failures++;
+                continue;
+            }
+            recordLatency(latencies, std::chrono::steady_clock::now() - start);
+        } catch (const std::exception&) {
+            failures++;
+        }
+    }
+    printLatencies("rpc", latencies, failures);
+}
+
+// Several threads share the client; measures what the dispatchers sustain.
+void benchRpcThroughput(comms_stack::RpcClient& client, int requests, int threads) {
+    std::atomic<size_t> completed{0};
+    std::atomic<size_t> failures{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (int i = t; i < requests; i += threads) {
+                comms_stack::protos::AddRequest req;
+                req.set_a(i);
+                req.set_b(1);
+                auto future = client.Add(req);
+                if (future.wait_for(std::chrono::seconds(5)) == std::future_status::timeout) {
+                    failures++;
+                    continue;
+                }
+                try {
+                    future.get();
+                    completed++;
+                } catch (const std::exception&) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\nRPC throughput (" << threads << " threads): " << std::fixed << std::setprecision(0)
+              << (completed / seconds) << " req/s, " << failures << " failures" << std::endl;
+}
+
+// Publish-to-callback latency; each message is sent after the previous one arrived.
+void benchPubSub(comms_stack::CommunicationManager& publisher_side, comms_stack::CommunicationManager& subscriber_side,
+                 int messages) {
+    comms_stack::Publisher publisher("LoopbackTopic", publisher_side.getTransport(), TOPIC_SERVICE_ID,
+                                     TOPIC_INSTANCE_ID, TOPIC_EVENT_ID);
+    comms_stack::Subscriber subscriber("LoopbackTopic", subscriber_side.getTransport(), TOPIC_SERVICE_ID,
+                                       TOPIC_INSTANCE_ID, TOPIC_EVENT_ID);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t last_id = 0;
+    std::chrono::steady_clock::time_point received_at;
+    subscriber.subscribe([&](const comms_stack::protos::SimpleNotification& notification) {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        last_id = notification.id();
+        received_at = now;
+        cv.notify_one();
+    });
+
+    comms_stack::LatencyHistogram latencies;
+    size_t lost = 0;
+    comms_stack::protos::SimpleNotification notification;
+    notification.set_message_content(std::string(64, 'x'));
+    for (int i = 1; i <= messages; ++i) {
+        notification.set_id(i);
+        auto start = std::chrono::steady_clock::now();
+        publisher.publish(notification);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv.wait_for(lock, std::chrono::seconds(1), [&] { return last_id == static_cast<uint32_t>(i); })) {
+            lost++;
+            continue;
+        }
+        recordLatency(latencies, received_at - start);
+    }
+    printLatencies("pub/sub", latencies, lost);
+}
+
+int main(int argc, char** argv) {
+    int requests = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int messages = argc > 2 ? std::atoi(argv[2]) : 20000;
+    int threads = argc > 3 ? std::atoi(argv[3]) : 4;
+
+    // Server and client sides get separate transports, so every call crosses dispatchers as
+    // it would between two applications. Intra-process delivery is off to keep topics on the
+    // transport.
+    auto network = std::make_shared<comms_stack::LoopbackNetwork>();
+    comms_stack::CommunicationManager server_side;
+    comms_stack::CommunicationManager client_side;
+    comms_stack::CommunicationManager::Options options;
+    options.loopback = network;
+    options.intra_process = false;
+    options.app_name = "LoopbackServer";
+    if (!server_side.init(options)) {
+        std::cerr << "Failed to initialize the server side" << std::endl;
+        return 1;
+    }
+    options.app_name = "LoopbackClient";
+    if (!client_side.init(options)) {
+        std::cerr << "Failed to initialize the client side" << std::endl;
+        server_side.shutdown();
+        return 1;
+    }
+
+    server_side.registerRpcService("SampleRpc_Fast", RPC_SERVICE_ID, RPC_INSTANCE_ID,
+                                   std::make_shared<FastSampleRpcImpl>());
+    {
+        auto created_at = std::chrono::steady_clock::now();
+        comms_stack::RpcClient client("SampleRpc", client_side.getTransport(), RPC_SERVICE_ID, RPC_INSTANCE_ID);
+        if (!client.waitForAvailability(std::chrono::seconds(1))) {
+            std::cerr << "Service did not become available." << std::endl;
+            client_side.shutdown();
+            server_side.shutdown();
+            return 1;
+        }
+
+        std::cout << "\nService available " << std::fixed << std::setprecision(1)
+                  << std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - created_at).count()
+                  << " us after client creation" << std::endl;
+        std::cout << "\n=== Loopback transport (" << requests << " requests, " << messages << " messages) ===" << std::endl;
+        std::cout << std::setw(14) << "" << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)"
+                  << std::setw(12) << "p99.9 (us)" << std::setw(10) << "failures" << std::endl;
+        benchRpcLatency(client, requests);
+        benchPubSub(server_side, client_side, messages);
+        benchRpcThroughput(client, requests, threads);
+    }
+
+    client_side.shutdown();
+    server_side.shutdown();
+    return 0;
+}
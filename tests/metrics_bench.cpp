@@ -0,0 +1,82 @@
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Cost of recording one event (a message count, its size and a latency sample) from several
+// threads into the same endpoint:
+//   shared atomics - one set of counters updated with fetch_add by every thread
+//   metrics        - Metrics::Endpoint, which records into per-thread cells
+// The latency samples are synthetic, so the clock is not part of the figure.
+// No vsomeip application is needed.
+//
+// Usage: metrics_bench [events_per_thread=5000000]
+
+struct SharedCounters {
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> buckets[comms_stack::LatencyHistogram::BUCKETS] = {};
+};
+
+template<typename Record>
+double nsPerEvent(int threads, int events_per_thread, Record record) {
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < events_per_thread; ++i) {
+                record(t, i);
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    // Wall time spread over the cores actually in use: CPU time per event.
+    const unsigned cores = std::min<unsigned>(threads, std::max(1u, std::thread::hardware_concurrency()));
+    return ns * cores / (static_cast<double>(threads) * events_per_thread);
+}
+
+int main(int argc, char** argv) {
+    int events_per_thread = argc > 1 ? std::atoi(argv[1]) : 5000000;
+    int max_threads = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+    auto& metrics = comms_stack::Metrics::global();
+    comms_stack::Metrics::Endpoint endpoint = metrics.endpoint(comms_stack::Metrics::Kind::Publisher, "BenchTopic");
+    SharedCounters shared;
+
+    std::cout << "\n=== Recording cost (" << events_per_thread
+              << " events per thread, ns per event per core) ===" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(18) << "shared atomics" << std::setw(12) << "metrics"
+              << std::endl;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double atomics = nsPerEvent(threads, events_per_thread, [&](int t, int i) {
+            const uint64_t latency_ns = 1000 + ((t * 7919 + i) & 0xFFFF);
+            shared.messages.fetch_add(1, std::memory_order_relaxed);
+            shared.bytes.fetch_add(64, std::memory_order_relaxed);
+            shared.buckets[comms_stack::LatencyHistogram::bucketIndex(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+        });
+        double recorded = nsPerEvent(threads, events_per_thread, [&](int t, int i) {
+            endpoint.message(64);
+            endpoint.latency(std::chrono::nanoseconds(1000 + ((t * 7919 + i) & 0xFFFF)));
+        });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << threads << std::setw(18) << atomics
+                  << std::setw(12) << recorded << std::endl;
+    }
+
+    std::cout << "\n=== Metrics::print() ===" << std::endl;
+    metrics.print(std::cout);
+    return 0;
+}
@@ -7,11 +7,6 @@
 #include <csignal>
 #include <cstdlib> // For setenv if used, or use platform specific
 
-// Configuration values from vsomeip_host.json (for publisher)
-const uint16_t TEST_TOPIC_SERVICE_ID = 0x1111;
-const uint16_t TEST_TOPIC_INSTANCE_ID = 0x0001; // Publisher offers this instance
-const uint16_t TEST_TOPIC_EVENTGROUP_ID = 0x9100; // This is the eventgroup
-
 volatile bool keep_running = true;
 
 void signal_handler(int signum) {
@@ -45,21 +40,13 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-     auto pub_app = comm_mgr.getVsomeipApplication();
-     if (!pub_app) {
-         std::cerr << "Failed to get vsomeip application from comm_mgr" << std::endl;
-         comm_mgr.shutdown();
-         return 1;
-     }
-
-    auto test_publisher = std::make_shared<comms_stack::Publisher>(
-        "TestTopic",
-        pub_app,
-        TEST_TOPIC_SERVICE_ID,
-        TEST_TOPIC_INSTANCE_ID,
-        TEST_TOPIC_EVENTGROUP_ID,
-        true // It's an eventgroup
-    );
+    // Service/instance/eventgroup IDs come from the "comms_stack" section of vsomeip_host.json.
+    auto test_publisher = comm_mgr.getPublisher("TestTopic");
+    if (!test_publisher) {
+        std::cerr << "TestTopic is not in the topic registry (is VSOMEIP_CONFIGURATION set?)" << std::endl;
+        comm_mgr.shutdown();
+        return 1;
+    }
 
     std::cout << "Waiting for publisher to offer..." << std::endl;
     std::this_thread::sleep_for(std::chrono::seconds(1));
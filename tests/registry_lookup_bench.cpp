@@ -0,0 +1,103 @@
+#include "topic_registry.h"
+#include "write_once_table.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures concurrent lookups of cached endpoints, as CommunicationManager::getPublisher and
+// friends do from many (e.g. JNI) threads:
+//   mutex + map    - std::map<std::string, shared_ptr> behind a std::mutex
+//   name + table   - registry name lookup, then the lock-free WriteOnceTable
+//   handle + table - WriteOnceTable indexed by a pre-resolved handle (the hot path)
+// No vsomeip application is needed; the cached objects are stand-ins.
+//
+// Usage: registry_lookup_bench [lookups_per_thread=2000000] [topics=64]
+
+struct Endpoint {
+    explicit Endpoint(int id) : id(id) {}
+    int id;
+};
+
+template<typename Lookup>
+double run_threads(int threads, int lookups_per_thread, Lookup lookup) {
+    std::atomic<bool> go{false};
+    std::atomic<long> checksum{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            long sum = 0;
+            for (int i = 0; i < lookups_per_thread; ++i) {
+                sum += lookup(t, i);
+            }
+            checksum += sum; // Keeps the lookups from being optimized away
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(threads) * lookups_per_thread / seconds;
+}
+
+int main(int argc, char** argv) {
+    int lookups_per_thread = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    int topic_count = argc > 2 ? std::atoi(argv[2]) : 64;
+    int max_threads = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+    comms_stack::TopicRegistry registry;
+    std::vector<std::string> names;
+    std::vector<comms_stack::TopicHandle> handles;
+    std::map<std::string, std::shared_ptr<Endpoint>> locked_map;
+    std::mutex locked_map_mutex;
+    comms_stack::WriteOnceTable<Endpoint> table;
+
+    for (int i = 0; i < topic_count; ++i) {
+        comms_stack::TopicEntry entry;
+        entry.name = "vehicle/signal/topic_" + std::to_string(i);
+        entry.service_id = static_cast<uint16_t>(0x1000 + i);
+        entry.instance_id = 0x0001;
+        entry.event_id = 0x8001;
+        names.push_back(entry.name);
+        handles.push_back(registry.addTopic(entry));
+        locked_map[entry.name] = std::make_shared<Endpoint>(i);
+    }
+    table.reset(registry.topicCount());
+    for (int i = 0; i < topic_count; ++i) {
+        table.getOrCreate(handles[i], [i]() { return std::make_shared<Endpoint>(i); });
+    }
+
+    std::cout << "\n=== Cached endpoint lookups (" << topic_count << " topics, " << lookups_per_thread
+              << " lookups per thread, Mlookups/s) ===" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "mutex + map" << std::setw(16) << "name + table"
+              << std::setw(18) << "handle + table" << std::endl;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double locked = run_threads(threads, lookups_per_thread, [&](int t, int i) {
+            const std::string& name = names[(t + i) % topic_count];
+            std::lock_guard<std::mutex> lock(locked_map_mutex);
+            return locked_map.find(name)->second->id;
+        });
+        double by_name = run_threads(threads, lookups_per_thread, [&](int t, int i) {
+            return table.get(registry.findTopic(names[(t + i) % topic_count]))->id;
+        });
+        double by_handle = run_threads(threads, lookups_per_thread, [&](int t, int i) {
+            return table.get(handles[(t + i) % topic_count])->id;
+        });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << threads << std::setw(16) << locked / 1e6
+                  << std::setw(16) << by_name / 1e6 << std::setw(18) << by_handle / 1e6 << std::endl;
+    }
+    return 0;
+}
@@ -9,10 +9,6 @@
 #include <future> // For std::future status
 #include <stdexcept> // For std::runtime_error
 
-// Config values from vsomeip_host.json for SampleRpc client
-const uint16_t RPC_SERVICE_ID = 0x2222;
-const uint16_t RPC_INSTANCE_ID = 0x0001; // Instance ID the server offers
-
 volatile bool keep_running = true;
 
 void signal_handler(int signum) {
@@ -78,35 +74,26 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    // Similar to publisher, CommunicationManager::getRpcClient would ideally look up IDs.
-    // For test, constructing directly.
-    auto rpc_app = comm_mgr.getVsomeipApplication();
-    if(!rpc_app) {
-        std::cerr << "Failed to get vsomeip application from comm_mgr for RPC client" << std::endl;
+    // Service/instance IDs come from the "comms_stack" section of vsomeip_host.json.
+    auto rpc_client = comm_mgr.getRpcClient("SampleRpc");
+    if (!rpc_client) {
+        std::cerr << "SampleRpc is not in the service registry (is VSOMEIP_CONFIGURATION set?)" << std::endl;
         comm_mgr.shutdown();
         return 1;
     }
-    auto rpc_client = std::make_shared<comms_stack::RpcClient>(
-        "SampleRpc", // User-friendly name
-        rpc_app,
-        RPC_SERVICE_ID,
-        RPC_INSTANCE_ID
-    );
 
     std::cout << "RPC Client created. Waiting for service to become available..." << std::endl;
-    // Wait for service availability
-    int wait_count = 0;
-    while(!rpc_client->isServiceAvailable() && wait_count < 10 && keep_running) { // Wait up to 5s
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        wait_count++;
-    }
-
-    if (!rpc_client->isServiceAvailable()) {
+    // Returns the moment discovery reports the service; the time taken is our startup latency.
+    auto wait_start = std::chrono::steady_clock::now();
+    if (!rpc_client->waitForAvailability(std::chrono::seconds(5))) {
         std::cerr << "RPC Client: Service 'SampleRpc' did not become available. Exiting." << std::endl;
         rpc_client.reset();
         comm_mgr.shutdown();
         return 1;
     }
+    std::cout << "RPC Client: Service available after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wait_start).count()
+              << " ms." << std::endl;
     std::cout << "RPC Client: Service 'SampleRpc' is available." << std::endl;
 
     if(keep_running) make_echo_call(*rpc_client, "Hello RPC World!");
@@ -115,12 +102,60 @@ int main(int argc, char** argv) {
     if(keep_running) std::this_thread::sleep_for(std::chrono::seconds(1));
     if(keep_running) make_echo_call(*rpc_client, "Another call");
 
+    // Read-only calls can be served from the client-side cache: the second identical Add
+    // within the TTL never leaves the process.
+    rpc_client->enableResponseCache(0x0002, std::chrono::seconds(5)); // Add
+    if(keep_running) make_add_call(*rpc_client, 20, 22);
+    if(keep_running) make_add_call(*rpc_client, 20, 22);
+    comms_stack::RpcClientCache::Stats cache_stats = rpc_client->getCacheStats();
+    std::cout << "RPC Client: Cache stats: hits=" << cache_stats.hits
+              << ", misses=" << cache_stats.misses
+              << ", coalesced=" << cache_stats.coalesced << std::endl;
+
+    // Server-streaming call: items arrive one by one without a request per item.
+    if (keep_running) {
+        comms_stack::protos::CountRequest count_req;
+        count_req.set_start(100);
+        count_req.set_count(50);
+        count_req.set_interval_ms(10);
+        std::cout << "RPC Client: Opening Count stream (" << count_req.count() << " items)" << std::endl;
+        int items_received = 0;
+        auto stream = rpc_client->Count(
+            count_req,
+            [&items_received](const comms_stack::protos::CountItem& item) {
+                if (items_received++ % 10 == 0) {
+                    std::cout << "RPC Client: Count item " << item.value() << std::endl;
+                }
+            },
+            [](int status, const std::string& error) {
+                std::cout << "RPC Client: Count stream finished, status " << status
+                          << (error.empty() ? "" : " (" + error + ")") << std::endl;
+            });
+        int status = stream->wait();
+        std::cout << "RPC Client: Received " << items_received << " Count items, status " << status << std::endl;
+    }
+
+    // Cancellation: the future fails right away and the server is told to stop working on the call.
+    if (keep_running) {
+        comms_stack::CancellationToken token;
+        comms_stack::protos::EchoRequest req;
+        req.set_request_message("Never mind");
+        std::future<comms_stack::protos::EchoResponse> cancelled_future = rpc_client->Echo(req, token);
+        token.cancel();
+        try {
+            comms_stack::protos::EchoResponse res = cancelled_future.get();
+            std::cout << "RPC Client: Echo answered before it could be cancelled: \""
+                      << res.response_message() << "\"" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "RPC Client: Cancelled Echo: " << e.what() << std::endl;
+        }
+    }
 
     if (argc > 1 && std::string(argv[1]) == "short") {
         std::cout << "Short run requested, exiting RPC client." << std::endl;
     } else {
         // Keep running for a bit for more manual interaction if needed
-        wait_count = 0;
+        int wait_count = 0;
         while(keep_running && wait_count < 20) { // Run for 10 more seconds
              std::this_thread::sleep_for(std::chrono::milliseconds(500));
              wait_count++;
@@ -129,7 +164,7 @@ int main(int argc, char** argv) {
 
 
     std::cout << "RPC Client shutting down..." << std::endl;
-    rpc_client.reset(); // Explicitly destroy before comm_mgr shutdown
+    rpc_client.reset(); // The manager holds the cached client until shutdown()
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
     comm_mgr.shutdown();
     std::cout << "RPC Client finished." << std::endl;
@@ -0,0 +1,116 @@
+#include "bench_utils.h"
+#include "communication_manager.h"
+#include "rpc_client.h"
+#include "sample_rpc_service.pb.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Measures how RPC throughput and latency scale with the number of RpcClients sharing one
+// vsomeip application. Every client's responses go through the application's single
+// ResponseDemultiplexer, so per-response cost should stay flat as clients are added.
+//
+// Usage: rpc_demux_bench [requests_per_client=200] [max_clients=256]
+
+const uint16_t RPC_SERVICE_ID = 0x2222;
+const uint16_t RPC_INSTANCE_ID = 0x0001;
+
+struct ScaleResult {
+    size_t completed = 0;
+    size_t failures = 0;
+    double total_latency_ms = 0;
+    double wall_seconds = 0;
+};
+
+// Each client runs on its own thread and issues its requests back to back.
+ScaleResult run_clients(std::vector<std::unique_ptr<comms_stack::RpcClient>>& clients, int requests_per_client) {
+    std::atomic<size_t> completed{0};
+    std::atomic<size_t> failures{0};
+    std::atomic<uint64_t> latency_us{0};
+
+    auto run_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (auto& client : clients) {
+        threads.emplace_back([&, c = client.get()]() {
+            for (int i = 0; i < requests_per_client; ++i) {
+                comms_stack::protos::AddRequest req;
+                req.set_a(i);
+                req.set_b(1);
+                auto start = std::chrono::steady_clock::now();
+                auto future = c->Add(req);
+                if (future.wait_for(std::chrono::seconds(5)) == std::future_status::timeout) {
+                    failures++;
+                    continue;
+                }
+                try {
+                    future.get();
+                    latency_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+                    completed++;
+                } catch (const std::exception&) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ScaleResult result;
+    result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+    result.completed = completed;
+    result.failures = failures;
+    result.total_latency_ms = latency_us / 1000.0;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int requests_per_client = argc > 1 ? std::atoi(argv[1]) : 200;
+    int max_clients = argc > 2 ? std::atoi(argv[2]) : 256;
+
+    comms_stack::CommunicationManager& comm_mgr = comms_stack::CommunicationManager::getInstance();
+    if (!comm_mgr.init("CommsStackApp_Bench")) {
+        std::cerr << "Failed to initialize CommunicationManager" << std::endl;
+        return 1;
+    }
+    auto transport = comm_mgr.getTransport();
+    comm_mgr.registerRpcService("SampleRpc_Fast", RPC_SERVICE_ID, RPC_INSTANCE_ID,
+                                std::make_shared<FastSampleRpcImpl>());
+
+    std::cout << "\n=== RPC client scaling (" << requests_per_client << " requests per client) ===" << std::endl;
+    std::cout << std::setw(8) << "clients" << std::setw(14) << "req/s" << std::setw(16) << "mean (us)"
+              << std::setw(10) << "failures" << std::endl;
+
+    for (int n = 1; n <= max_clients; n *= 2) {
+        std::vector<std::unique_ptr<comms_stack::RpcClient>> clients;
+        for (int i = 0; i < n; ++i) {
+            clients.push_back(std::make_unique<comms_stack::RpcClient>("SampleRpc", transport, RPC_SERVICE_ID, RPC_INSTANCE_ID));
+        }
+        // Every client must see the service, not just the last one created.
+        bool available = true;
+        for (const auto& client : clients) {
+            available = available && client->waitForAvailability(std::chrono::seconds(5));
+        }
+        if (!available) {
+            std::cerr << "Service did not become available to every client." << std::endl;
+            break;
+        }
+
+        ScaleResult r = run_clients(clients, requests_per_client);
+        double mean_us = r.completed ? (r.total_latency_ms * 1000.0 / r.completed) : 0;
+        std::cout << std::setw(8) << n << std::fixed << std::setprecision(0)
+                  << std::setw(14) << (r.completed / r.wall_seconds)
+                  << std::setprecision(1) << std::setw(16) << mean_us
+                  << std::setw(10) << r.failures << std::endl;
+    }
+
+    comm_mgr.shutdown();
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "bench_utils.h"
+#include "communication_manager.h"
+#include "rpc_client.h"
+#include "sample_rpc_service.pb.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Local benchmark for multi-instance RPC: two instances of SampleRpc are served from this
+// process, one of them artificially slow. The same request load is run against
+//   1. a client pinned to the slow instance,
+//   2. a multi-instance client using power-of-two-choices,
+//   3. the same with request hedging enabled,
+// and the resulting latency percentiles are printed.
+//
+// Usage: rpc_load_balance_bench [requests=2000] [concurrency=8] [slow_ms=20]
+
+const uint16_t RPC_SERVICE_ID = 0x2222;
+const uint16_t FAST_INSTANCE_ID = 0x0001;
+const uint16_t SLOW_INSTANCE_ID = 0x0002;
+const uint16_t ANY_INSTANCE_ID = 0xFFFF;
+
+// Completes Echo/Add after a delay on a separate thread, so the vsomeip dispatcher is not blocked.
+class DelayedSampleRpcImpl : public comms_stack::protos::SampleRpc {
+public:
+    explicit DelayedSampleRpcImpl(std::chrono::milliseconds delay) : delay_(delay) {}
+
+    void Echo(::google::protobuf::RpcController* controller, const comms_stack::protos::EchoRequest* request,
+              comms_stack::protos::EchoResponse* response, ::google::protobuf::Closure* done) override {
+        response->set_response_message(request->request_message());
+        complete(controller, done);
+    }
+    void Add(::google::protobuf::RpcController* controller, const comms_stack::protos::AddRequest* request,
+             comms_stack::protos::AddResponse* response, ::google::protobuf::Closure* done) override {
+        response->set_sum(request->a() + request->b());
+        complete(controller, done);
+    }
+
+private:
+    void complete(::google::protobuf::RpcController* controller, ::google::protobuf::Closure* done) {
+        if (delay_.count() == 0) {
+            done->Run();
+            return;
+        }
+        // Sleeps in slices so a cancelled hedge loser frees its worker early.
+        std::thread([controller, done, delay = delay_]() {
+            const auto deadline = std::chrono::steady_clock::now() + delay;
+            while (!controller->IsCanceled() && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            done->Run();
+        }).detach();
+    }
+    std::chrono::milliseconds delay_;
+};
+
+struct RunResult {
+    comms_stack::LatencyHistogram latencies;
+    double wall_seconds = 0;
+    size_t failures = 0;
+};
+
+RunResult run_load(comms_stack::RpcClient& client, int requests, int concurrency) {
+    RunResult result;
+    auto run_start = std::chrono::steady_clock::now();
+
+    int issued = 0;
+    while (issued < requests) {
+        int batch = std::min(concurrency, requests - issued);
+        std::vector<std::pair<std::chrono::steady_clock::time_point, std::future<comms_stack::protos::AddResponse>>> in_flight;
+        for (int i = 0; i < batch; ++i) {
+            comms_stack::protos::AddRequest req;
+            req.set_a(issued + i + 1);
+            req.set_b(1);
+            in_flight.emplace_back(std::chrono::steady_clock::now(), client.Add(req));
+        }
+        for (auto& [start, future] : in_flight) {
+            if (future.wait_for(std::chrono::seconds(5)) == std::future_status::timeout) {
+                result.failures++;
+                continue;
+            }
+            try {
+                future.get();
+                recordLatency(result.latencies, std::chrono::steady_clock::now() - start);
+            } catch (const std::exception&) {
+                result.failures++;
+            }
+        }
+        issued += batch;
+    }
+    result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+    return result;
+}
+
+void print_result(const std::string& label, const RunResult& r) {
+    std::cout << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(2)
+              << " p50=" << std::setw(8) << percentileMs(r.latencies, 50) << " ms"
+              << " p99=" << std::setw(8) << percentileMs(r.latencies, 99) << " ms"
+              << " max=" << std::setw(8) << r.latencies.max() / 1e6 << " ms"
+              << " throughput=" << std::setw(9) << (r.latencies.count() / r.wall_seconds) << " req/s"
+              << " failures=" << r.failures << std::endl;
+}
+
+bool wait_available(comms_stack::RpcClient& client) {
+    return client.waitForAvailability(std::chrono::seconds(5));
+}
+
+int main(int argc, char** argv) {
+    int requests = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int concurrency = argc > 2 ? std::atoi(argv[2]) : 8;
+    std::chrono::milliseconds slow_delay(argc > 3 ? std::atoi(argv[3]) : 20);
+
+    comms_stack::CommunicationManager& comm_mgr = comms_stack::CommunicationManager::getInstance();
+    if (!comm_mgr.init("CommsStackApp_Bench")) {
+        std::cerr << "Failed to initialize CommunicationManager" << std::endl;
+        return 1;
+    }
+    auto transport = comm_mgr.getTransport();
+
+    comm_mgr.registerRpcService("SampleRpc_Fast", RPC_SERVICE_ID, FAST_INSTANCE_ID,
+                                std::make_shared<DelayedSampleRpcImpl>(std::chrono::milliseconds(0)));
+    comm_mgr.registerRpcService("SampleRpc_Slow", RPC_SERVICE_ID, SLOW_INSTANCE_ID,
+                                std::make_shared<DelayedSampleRpcImpl>(slow_delay));
+
+    std::vector<std::pair<std::string, RunResult>> results;
+    {
+        comms_stack::RpcClient pinned("SampleRpc", transport, RPC_SERVICE_ID, SLOW_INSTANCE_ID);
+        if (!wait_available(pinned)) {
+            std::cerr << "Slow instance did not become available." << std::endl;
+            comm_mgr.shutdown();
+            return 1;
+        }
+        results.emplace_back("pinned (slow instance)", run_load(pinned, requests, concurrency));
+    }
+    {
+        comms_stack::RpcClient balanced("SampleRpc", transport, RPC_SERVICE_ID, ANY_INSTANCE_ID);
+        wait_available(balanced);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Let both instances be discovered
+        results.emplace_back("power-of-two-choices", run_load(balanced, requests, concurrency));
+    }
+    {
+        comms_stack::RpcClient hedged("SampleRpc", transport, RPC_SERVICE_ID, ANY_INSTANCE_ID);
+        comms_stack::RpcClient::LoadBalancingConfig lb_config;
+        lb_config.hedging_enabled = true;
+        lb_config.hedge_percentile = 0.90;
+        lb_config.min_hedge_delay = std::chrono::milliseconds(1);
+        hedged.setLoadBalancingConfig(lb_config);
+        wait_available(hedged);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        results.emplace_back("p2c + hedging (p90)", run_load(hedged, requests, concurrency));
+        auto stats = hedged.getLoadBalancingStats();
+        std::cout << "Hedging: sent=" << stats.hedges_sent << ", won=" << stats.hedge_wins << std::endl;
+    }
+
+    std::cout << "\n=== RPC load balancing (" << requests << " requests, concurrency " << concurrency
+              << ", slow instance +" << slow_delay.count() << " ms) ===" << std::endl;
+    for (const auto& [label, result] : results) {
+        print_result(label, result);
+    }
+
+    comm_mgr.shutdown();
+    return 0;
+}
@@ -6,10 +6,6 @@
 #include <csignal>
 #include <cstdlib>
 
-// Config values from vsomeip_host.json for SampleRpc
-const uint16_t RPC_SERVICE_ID = 0x2222;
-const uint16_t RPC_INSTANCE_ID = 0x0001; // Instance ID the server will offer
-
 volatile bool keep_running = true;
 
 void signal_handler(int signum) {
@@ -33,16 +29,50 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // Service/instance IDs come from the "comms_stack" section of vsomeip_host.json.
+    const comms_stack::ServiceEntry* sample_rpc =
+        comm_mgr.getTopicRegistry().service(comm_mgr.findService("SampleRpc"));
+    if (!sample_rpc) {
+        std::cerr << "SampleRpc is not in the service registry (is VSOMEIP_CONFIGURATION set?)" << std::endl;
+        comm_mgr.shutdown();
+        return 1;
+    }
+
     auto rpc_service_impl = std::make_shared<comms_stack::MySampleRpcImpl>();
 
+    // Answer retransmitted/duplicated requests from the response cache instead of re-running
+    // the handler. Add depends only on its arguments, so its results are shared across clients.
+    comms_stack::RpcResponseCacheConfig cache_config;
+    cache_config.enabled = true;
+    cache_config.max_entries = 256;
+    cache_config.ttl = std::chrono::seconds(10);
+    cache_config.idempotent_methods = {0x0002}; // Add
+
     // The CommunicationManager::registerRpcService takes the specific generated type
     comm_mgr.registerRpcService(
-        "SampleRpc", // User-friendly name, used as key in manager's map
-        RPC_SERVICE_ID,
-        RPC_INSTANCE_ID,
-        rpc_service_impl
+        "SampleRpc", // Registry name, also used as key in manager's map
+        rpc_service_impl,
+        cache_config
     );
 
+    // Server-streaming Count: emits `count` consecutive values, paced by interval_ms. write()
+    // blocks while the client has no credit left and returns false once it cancels.
+    comm_mgr.registerStreamMethod(
+        "SampleRpc", sample_rpc->service_id, sample_rpc->instance_id, 0x0003, "Count",
+        comms_stack::makeStreamMethodHandler<comms_stack::protos::CountRequest>(
+            [](const comms_stack::protos::CountRequest& request, comms_stack::ServerStreamWriter& writer) {
+                for (int i = 0; i < request.count(); ++i) {
+                    comms_stack::protos::CountItem item;
+                    item.set_value(request.start() + i);
+                    if (!writer.write(item)) {
+                        return;
+                    }
+                    if (request.interval_ms() > 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(request.interval_ms()));
+                    }
+                }
+            }));
+
     std::cout << "RPC Server (SampleRpc) registered and offered. Waiting for requests..." << std::endl;
 
     int loop_count = 0;
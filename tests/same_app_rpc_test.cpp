@@ -0,0 +1,73 @@
+#include "communication_manager.h"
+#include "loopback_transport.h"
+#include "my_sample_rpc_impl.h"
+#include "rpc_client.h"
+#include "sample_rpc_service.pb.h"
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Calls a service through an RpcClient on the manager that registered it. The transport then
+// has both the service's handlers and the client side's catch-all handler, and each response
+// must reach the client rather than be taken for a new request. Exits non-zero on failure.
+
+const uint16_t SERVICE_ID = 0x2222;
+const uint16_t INSTANCE_ID = 0x0001;
+const auto CALL_TIMEOUT = std::chrono::seconds(2);
+
+template<typename Response>
+bool await(std::future<Response>& future, const char* method, Response& response) {
+    if (future.wait_for(CALL_TIMEOUT) == std::future_status::timeout) {
+        std::cerr << method << " timed out" << std::endl;
+        return false;
+    }
+    try {
+        response = future.get();
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << method << " failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int main() {
+    comms_stack::CommunicationManager manager;
+    comms_stack::CommunicationManager::Options options;
+    options.app_name = "SameAppRpcTest";
+    options.loopback = std::make_shared<comms_stack::LoopbackNetwork>();
+    if (!manager.init(options)) {
+        std::cerr << "Failed to initialize the manager" << std::endl;
+        return 1;
+    }
+    manager.registerRpcService("SampleRpc", SERVICE_ID, INSTANCE_ID, std::make_shared<comms_stack::MySampleRpcImpl>());
+
+    bool ok = true;
+    {
+        comms_stack::RpcClient client("SampleRpc", manager.getTransport(), SERVICE_ID, INSTANCE_ID);
+        if (!client.waitForAvailability(CALL_TIMEOUT)) {
+            std::cerr << "Service did not become available" << std::endl;
+            ok = false;
+        }
+        for (int i = 0; ok && i < 100; ++i) {
+            comms_stack::protos::AddRequest add;
+            add.set_a(i);
+            add.set_b(1);
+            auto add_future = client.Add(add);
+            comms_stack::protos::AddResponse sum;
+            ok = await(add_future, "Add", sum) && sum.sum() == i + 1;
+        }
+        if (ok) {
+            comms_stack::protos::EchoRequest echo;
+            echo.set_request_message("ping");
+            auto echo_future = client.Echo(echo);
+            comms_stack::protos::EchoResponse reply;
+            ok = await(echo_future, "Echo", reply) && reply.response_message() == "Echo from server: ping";
+        }
+    }
+
+    manager.shutdown();
+    std::cout << (ok ? "PASS" : "FAIL") << ": RPC to a service on the same manager" << std::endl;
+    return ok ? 0 : 1;
+}
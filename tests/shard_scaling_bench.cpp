@@ -0,0 +1,133 @@
+#include "sharded_communication_manager.h"
+#include "my_sample_rpc_impl.h"
+#include "rpc_client.h"
+#include "sample_rpc_service.pb.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures how RPC throughput scales with the number of CommunicationManager shards. For N
+// shards, shard i serves SampleRpc as instance i+1 and a client on shard (i+1) % N calls it with
+// a fixed window of outstanding requests, so every shard both dispatches requests and receives
+// responses. With a single application all of that funnels through one set of dispatcher
+// threads; with N applications it is spread over N.
+//
+// Uses the CommsStackApp_Shard0..3 entries of the vsomeip configuration.
+//
+// Usage: shard_scaling_bench [seconds_per_run=3] [window=32] [dispatcher_threads=2]
+
+const uint16_t BENCH_SERVICE_ID = 0x3333; // Local only, not listed in the configuration
+const size_t MAX_SHARDS = 4;
+
+bool wait_available(comms_stack::RpcClient& client) {
+    return client.waitForAvailability(std::chrono::seconds(5));
+}
+
+// Keeps `window` Add calls in flight until `stop` is set; returns the number completed.
+uint64_t drive(comms_stack::RpcClient& client, int window, const std::atomic<bool>& stop) {
+    uint64_t completed = 0;
+    std::vector<std::future<comms_stack::protos::AddResponse>> in_flight;
+    while (!stop.load(std::memory_order_relaxed)) {
+        in_flight.clear();
+        for (int i = 0; i < window; ++i) {
+            comms_stack::protos::AddRequest req;
+            req.set_a(i);
+            req.set_b(1);
+            in_flight.push_back(client.Add(req));
+        }
+        for (auto& future : in_flight) {
+            if (future.wait_for(std::chrono::seconds(5)) == std::future_status::ready) {
+                try {
+                    future.get();
+                    completed++;
+                } catch (const std::exception&) {
+                }
+            }
+        }
+    }
+    return completed;
+}
+
+// Returns calls per second across all shards, or a negative value if the run could not start.
+double run(size_t shard_count, int seconds, int window, unsigned dispatcher_threads) {
+    comms_stack::ShardedCommunicationManager sharded;
+    comms_stack::ShardedCommunicationManager::Options options;
+    for (size_t i = 0; i < shard_count; ++i) {
+        options.app_names.push_back("CommsStackApp_Shard" + std::to_string(i));
+    }
+    options.dispatcher_threads = dispatcher_threads;
+    if (!sharded.init(options)) {
+        return -1;
+    }
+
+    std::vector<std::unique_ptr<comms_stack::RpcClient>> clients;
+    for (size_t i = 0; i < shard_count; ++i) {
+        uint16_t instance_id = static_cast<uint16_t>(i + 1);
+        sharded.shard(i).registerRpcService("ShardBench_" + std::to_string(i), BENCH_SERVICE_ID, instance_id,
+                                            std::make_shared<comms_stack::MySampleRpcImpl>());
+        comms_stack::CommunicationManager& caller = sharded.shard((i + 1) % shard_count);
+        clients.emplace_back(new comms_stack::RpcClient("ShardBench", caller.getTransport(),
+                                                        BENCH_SERVICE_ID, instance_id));
+    }
+    for (auto& client : clients) {
+        if (!wait_available(*client)) {
+            std::cerr << "Bench service did not become available with " << shard_count << " shard(s)." << std::endl;
+            clients.clear();
+            sharded.shutdown();
+            return -1;
+        }
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<std::future<uint64_t>> drivers;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& client : clients) {
+        comms_stack::RpcClient* raw = client.get();
+        drivers.push_back(std::async(std::launch::async, [raw, window, &stop]() { return drive(*raw, window, stop); }));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    uint64_t completed = 0;
+    for (auto& driver : drivers) {
+        completed += driver.get();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    clients.clear();
+    sharded.shutdown();
+    return completed / elapsed;
+}
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+    int window = argc > 2 ? std::atoi(argv[2]) : 32;
+    unsigned dispatcher_threads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 2;
+    size_t max_shards = std::min<size_t>(MAX_SHARDS, std::max(1u, std::thread::hardware_concurrency()));
+
+    std::vector<std::pair<size_t, double>> results;
+    for (size_t shards = 1; shards <= max_shards; shards *= 2) {
+        results.emplace_back(shards, run(shards, seconds, window, dispatcher_threads));
+    }
+
+    std::cout << "\n=== Shard scaling (" << seconds << " s per run, window " << window << ", "
+              << dispatcher_threads << " dispatcher thread(s) per shard) ===" << std::endl;
+    std::cout << std::setw(8) << "shards" << std::setw(16) << "calls/s" << std::setw(10) << "speedup" << std::endl;
+    double baseline = results.empty() ? 0 : results.front().second;
+    for (const auto& [shards, calls_per_second] : results) {
+        if (calls_per_second < 0) {
+            std::cout << std::setw(8) << shards << std::setw(16) << "failed" << std::endl;
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(0) << std::setw(8) << shards << std::setw(16) << calls_per_second
+                  << std::setprecision(2) << std::setw(9) << (baseline > 0 ? calls_per_second / baseline : 0) << "x"
+                  << std::endl;
+    }
+    return 0;
+}
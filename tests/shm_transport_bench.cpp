@@ -0,0 +1,165 @@
+#include "bench_utils.h"
+#include "communication_manager.h"
+#include "publisher.h"
+#include "subscriber.h"
+#include "common_messages.pb.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compares the vsomeip data path ("TestTopic") with the shared-memory ring ("ShmTopic", see the
+// "shm" entry in the configuration) for payloads from 64 B to 1 MB. Publisher and subscriber sit
+// on different applications (CommsStackApp_Shard0/1) with intra-process delivery disabled, so
+// both paths behave as between processes on one host.
+//   latency    - one message at a time, publish() to callback
+//   throughput - back-to-back publishing; messages the subscriber fell behind on count as lost
+//
+// Usage: shm_transport_bench [latency_messages=500] [burst_messages=2000]
+
+struct Receiver {
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t last_id = 0;
+    uint64_t received = 0;
+    std::chrono::steady_clock::time_point received_at;
+
+    void onMessage(const comms_stack::protos::SimpleNotification& notification) {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        last_id = notification.id();
+        received++;
+        received_at = now;
+        cv.notify_one();
+    }
+};
+
+struct SizeResult {
+    double p50_us = 0;
+    double p99_us = 0;
+    double messages_per_second = 0;
+    double megabytes_per_second = 0;
+    uint64_t lost = 0;
+};
+
+SizeResult measure(comms_stack::Publisher& publisher, Receiver& receiver, size_t payload_bytes,
+                   int latency_messages, int burst_messages, uint32_t& next_id) {
+    SizeResult result;
+    comms_stack::protos::SimpleNotification notification;
+    notification.set_message_content(std::string(payload_bytes, 'x'));
+
+    comms_stack::LatencyHistogram latencies;
+    for (int i = 0; i < latency_messages; ++i) {
+        const uint32_t id = ++next_id;
+        notification.set_id(id);
+        auto sent_at = std::chrono::steady_clock::now();
+        publisher.publish(notification);
+        std::unique_lock<std::mutex> lock(receiver.mutex);
+        if (!receiver.cv.wait_for(lock, std::chrono::milliseconds(200), [&]() { return receiver.last_id == id; })) {
+            result.lost++;
+            continue;
+        }
+        recordLatency(latencies, receiver.received_at - sent_at);
+    }
+    result.p50_us = percentileUs(latencies, 50);
+    result.p99_us = percentileUs(latencies, 99);
+
+    uint64_t received_before;
+    {
+        std::lock_guard<std::mutex> lock(receiver.mutex);
+        received_before = receiver.received;
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint32_t last_sent = 0;
+    for (int i = 0; i < burst_messages; ++i) {
+        last_sent = ++next_id;
+        notification.set_id(last_sent);
+        publisher.publish(notification);
+    }
+    std::unique_lock<std::mutex> lock(receiver.mutex);
+    // Done when the last message arrived or nothing arrived for a while (it was lost).
+    uint64_t seen = receiver.received;
+    while (receiver.last_id != last_sent) {
+        if (!receiver.cv.wait_for(lock, std::chrono::milliseconds(200), [&]() { return receiver.received != seen; })) {
+            break;
+        }
+        seen = receiver.received;
+    }
+    const uint64_t delivered = std::min<uint64_t>(receiver.received - received_before, burst_messages);
+    const double seconds = std::chrono::duration<double>(receiver.received_at - start).count();
+    if (delivered > 0 && seconds > 0) {
+        result.messages_per_second = delivered / seconds;
+        result.megabytes_per_second = result.messages_per_second * payload_bytes / (1024.0 * 1024.0);
+    }
+    result.lost += burst_messages - delivered;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int latency_messages = argc > 1 ? std::atoi(argv[1]) : 500;
+    int burst_messages = argc > 2 ? std::atoi(argv[2]) : 2000;
+    const std::vector<size_t> sizes = {64, 1024, 16 * 1024, 256 * 1024, 1024 * 1024};
+
+    comms_stack::CommunicationManager publisher_side;
+    comms_stack::CommunicationManager subscriber_side;
+    comms_stack::CommunicationManager::Options options;
+    options.intra_process = false; // Measure the inter-process paths
+    options.app_name = "CommsStackApp_Shard0";
+    if (!publisher_side.init(options)) {
+        return 1;
+    }
+    options.app_name = "CommsStackApp_Shard1";
+    if (!subscriber_side.init(options)) {
+        publisher_side.shutdown();
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, std::vector<SizeResult>>> results;
+    uint32_t next_id = 0;
+    for (const char* topic : {"TestTopic", "ShmTopic"}) {
+        auto publisher = publisher_side.getPublisher(topic);
+        auto subscriber = subscriber_side.getSubscriber(topic);
+        if (!publisher || !subscriber) {
+            std::cerr << topic << " is missing from the configuration." << std::endl;
+            continue;
+        }
+        Receiver receiver;
+        subscriber->subscribe([&receiver](const comms_stack::protos::SimpleNotification& notification) {
+            receiver.onMessage(notification);
+        });
+        std::this_thread::sleep_for(std::chrono::seconds(1)); // Let the event subscription settle
+
+        std::vector<SizeResult> per_size;
+        for (size_t size : sizes) {
+            per_size.push_back(measure(*publisher, receiver, size, latency_messages, burst_messages, next_id));
+        }
+        subscriber->unsubscribe();
+        results.emplace_back(topic == std::string("ShmTopic") ? "shared memory" : "vsomeip", per_size);
+    }
+
+    std::cout << "\n=== vsomeip vs. shared-memory data path (" << latency_messages << " latency / "
+              << burst_messages << " burst messages per size) ===" << std::endl;
+    std::cout << std::left << std::setw(15) << "path" << std::right << std::setw(9) << "payload"
+              << std::setw(11) << "p50 us" << std::setw(11) << "p99 us" << std::setw(12) << "msg/s"
+              << std::setw(10) << "MB/s" << std::setw(8) << "lost" << std::endl;
+    for (const auto& [label, per_size] : results) {
+        for (size_t i = 0; i < per_size.size(); ++i) {
+            const SizeResult& r = per_size[i];
+            std::cout << std::left << std::setw(15) << label << std::right << std::setw(9) << sizes[i]
+                      << std::fixed << std::setprecision(1) << std::setw(11) << r.p50_us << std::setw(11) << r.p99_us
+                      << std::setprecision(0) << std::setw(12) << r.messages_per_second
+                      << std::setprecision(1) << std::setw(10) << r.megabytes_per_second
+                      << std::setw(8) << r.lost << std::endl;
+        }
+    }
+
+    subscriber_side.shutdown();
+    publisher_side.shutdown();
+    return 0;
+}
@@ -7,14 +7,6 @@
 #include <csignal>
 #include <cstdlib>
 
-// Configuration values from vsomeip_host.json (for subscriber)
-const uint16_t TEST_TOPIC_SERVICE_ID = 0x1111;
-// Subscriber usually listens for ANY_INSTANCE of the service offering the event,
-// unless a specific provider instance is required. For availability, it might watch a specific one or ANY.
-const uint16_t SERVICE_INSTANCE_TO_MONITOR = 0x0001; // Instance offered by publisher_test
-// const uint16_t SERVICE_INSTANCE_TO_MONITOR = 0xFFFF; // vsomeip::ANY_INSTANCE
-const uint16_t TEST_TOPIC_EVENTGROUP_ID = 0x9100;
-
 volatile bool keep_running = true;
 
 void signal_handler(int signum) {
@@ -49,27 +41,16 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    auto sub_app = comm_mgr.getVsomeipApplication();
-    if (!sub_app) {
-         std::cerr << "Failed to get vsomeip application from comm_mgr" << std::endl;
-         comm_mgr.shutdown();
-         return 1;
+    // Service/instance/eventgroup IDs come from the "comms_stack" section of vsomeip_host.json.
+    // Our Subscriber uses the configured instance for both availability and message handling,
+    // so it only gets events from that specific instance (the one publisher_test offers).
+    auto test_subscriber = comm_mgr.getSubscriber("TestTopic");
+    if (!test_subscriber) {
+        std::cerr << "TestTopic is not in the topic registry (is VSOMEIP_CONFIGURATION set?)" << std::endl;
+        comm_mgr.shutdown();
+        return 1;
     }
 
-    // For subscriber, instance_id in constructor is the instance of the service to monitor for availability.
-    // Our Subscriber implementation uses this instance_id for both availability and message handling/requesting.
-    // This means it will only get events from that specific instance.
-    // To get events from ANY instance offering the service/event, the Subscriber class would need
-    // to use vsomeip::ANY_INSTANCE in register_message_handler and request_event.
-    auto test_subscriber = std::make_shared<comms_stack::Subscriber>(
-        "TestTopic",
-        sub_app,
-        TEST_TOPIC_SERVICE_ID,
-        SERVICE_INSTANCE_TO_MONITOR,
-        TEST_TOPIC_EVENTGROUP_ID,
-        true // It's an eventgroup
-    );
-
     if (!test_subscriber->subscribe(on_message_received_cb)) {
         std::cerr << "Failed to subscribe to TestTopic" << std::endl;
         comm_mgr.shutdown();
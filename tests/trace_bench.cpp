@@ -0,0 +1,114 @@
+#include "communication_manager.h"
+#include "loopback_transport.h"
+#include "publisher.h"
+#include "subscriber.h"
+#include "tracing.h"
+#include "common_messages.pb.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Per-hop latency of pub/sub under load: several threads publish on a traced topic through a
+// LoopbackTransport, and the subscriber's callback does a little work. Prints the Tracer's
+// breakdown (publish, serialize, send, transit, parse, callback) and writes the spans as
+// Chrome trace JSON, to be opened in ui.perfetto.dev or chrome://tracing. Also compares the
+// publish cost with and without tracing.
+//
+// Usage: trace_bench [messages_per_thread=20000] [threads=2] [trace_file=trace_bench.json]
+
+const uint16_t TOPIC_SERVICE_ID = 0x1111;
+const uint16_t TOPIC_INSTANCE_ID = 0x0001;
+const uint16_t TOPIC_EVENT_ID = 0x8001;
+
+// Mean wall time of one publish() call, all threads publishing at once.
+double publishNs(comms_stack::Publisher& publisher, int messages_per_thread, int threads) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&publisher, messages_per_thread, t]() {
+            comms_stack::protos::SimpleNotification notification;
+            notification.set_message_content(std::string(64, 'x'));
+            for (int i = 0; i < messages_per_thread; ++i) {
+                notification.set_id(static_cast<uint32_t>(t * messages_per_thread + i));
+                publisher.publish(notification);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+           (static_cast<double>(messages_per_thread) * threads);
+}
+
+int main(int argc, char** argv) {
+    int messages_per_thread = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 2;
+    std::string trace_file = argc > 3 ? argv[3] : "trace_bench.json";
+
+    auto network = std::make_shared<comms_stack::LoopbackNetwork>();
+    comms_stack::CommunicationManager publisher_side;
+    comms_stack::CommunicationManager subscriber_side;
+    comms_stack::CommunicationManager::Options options;
+    options.loopback = network;
+    options.intra_process = false;
+    options.app_name = "TracePublisher";
+    if (!publisher_side.init(options)) {
+        std::cerr << "Failed to initialize the publisher side" << std::endl;
+        return 1;
+    }
+    options.app_name = "TraceSubscriber";
+    if (!subscriber_side.init(options)) {
+        std::cerr << "Failed to initialize the subscriber side" << std::endl;
+        publisher_side.shutdown();
+        return 1;
+    }
+
+    {
+        comms_stack::Publisher untraced("UntracedTopic", publisher_side.getTransport(), TOPIC_SERVICE_ID,
+                                        TOPIC_INSTANCE_ID, TOPIC_EVENT_ID + 1);
+        comms_stack::Publisher traced("TracedTopic", publisher_side.getTransport(), TOPIC_SERVICE_ID,
+                                      TOPIC_INSTANCE_ID, TOPIC_EVENT_ID);
+        traced.enableTracing();
+        comms_stack::Subscriber subscriber("TracedTopic", subscriber_side.getTransport(), TOPIC_SERVICE_ID,
+                                           TOPIC_INSTANCE_ID, TOPIC_EVENT_ID);
+        std::atomic<uint64_t> received{0};
+        std::atomic<uint64_t> checksum{0};
+        subscriber.subscribe([&](const comms_stack::protos::SimpleNotification& notification) {
+            uint64_t sum = 0;
+            for (char c : notification.message_content()) {
+                sum = sum * 31 + static_cast<unsigned char>(c);
+            }
+            checksum.fetch_add(sum, std::memory_order_relaxed);
+            received.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        double untraced_ns = publishNs(untraced, messages_per_thread, threads);
+        double traced_ns = publishNs(traced, messages_per_thread, threads);
+        const uint64_t expected = static_cast<uint64_t>(messages_per_thread) * threads;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (received < expected && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        std::cout << "\n=== Publish cost (" << threads << " threads, " << messages_per_thread
+                  << " messages each) ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(1) << "untraced: " << untraced_ns << " ns/msg, traced: "
+                  << traced_ns << " ns/msg, received " << received << "/" << expected << std::endl;
+        std::cout << "\n=== Per-hop latency (last " << comms_stack::Tracer::RING_EVENTS
+                  << " spans per thread) ===" << std::endl;
+        comms_stack::Tracer::global().print(std::cout);
+        if (comms_stack::Tracer::global().writeChromeTrace(trace_file)) {
+            std::cout << "\nWrote " << trace_file << std::endl;
+        }
+    }
+
+    subscriber_side.shutdown();
+    publisher_side.shutdown();
+    return 0;
+}
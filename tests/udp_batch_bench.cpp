@@ -0,0 +1,114 @@
+#include "topic_registry.h"
+#include "udp_batch.h"
+#include "common_messages.pb.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput of the batched UDP data plane (udp_batch.h) against itself over 127.0.0.1, for
+// several batch sizes. Batch size 1 is one syscall per event, as a plain socket write would be;
+// the syscall columns show how many sendmmsg()/recvmmsg() calls each message cost. Needs no
+// vsomeip configuration.
+//
+// Usage: udp_batch_bench [messages=200000] [payload_bytes=64] [port=40199]
+
+const uint16_t TOPIC_SERVICE_ID = 0x1113;
+const uint16_t TOPIC_EVENT_ID = 0x9300;
+
+struct BatchResult {
+    double seconds = 0;
+    uint64_t received = 0;
+    uint64_t send_calls = 0;
+    uint64_t receive_calls = 0;
+};
+
+BatchResult runBatch(const comms_stack::BatchedUdpConfig& config, int messages, size_t payload_bytes) {
+    BatchResult result;
+    comms_stack::UdpBatchReceiver receiver;
+    comms_stack::UdpBatchSender sender;
+    if (!receiver.open(config) || !sender.open(config)) {
+        return result;
+    }
+
+    std::atomic<uint64_t> received{0};
+    std::atomic<int64_t> last_arrival_ns{0};
+    std::atomic<bool> stop{false};
+    std::thread reader([&]() {
+        auto handler = [&](const comms_stack::SomeIpNotificationHeader&, const uint8_t* payload) {
+            (void)payload;
+            received.fetch_add(1, std::memory_order_relaxed);
+            last_arrival_ns.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                                  std::memory_order_relaxed);
+        };
+        while (!stop) {
+            if (receiver.receive(TOPIC_SERVICE_ID, handler, std::chrono::milliseconds(100)) < 0) {
+                break;
+            }
+        }
+    });
+
+    comms_stack::protos::SimpleNotification notification;
+    notification.set_message_content(std::string(payload_bytes, 'x'));
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= messages; ++i) {
+        notification.set_id(i);
+        const size_t size = notification.ByteSizeLong();
+        sender.send(TOPIC_SERVICE_ID, TOPIC_EVENT_ID, size, [&](uint8_t* payload) {
+            return notification.SerializeToArray(payload, static_cast<int>(size));
+        });
+    }
+    sender.flush();
+    // Loopback UDP drops when the receive buffer overflows; stop once arrivals settle.
+    uint64_t last = 0;
+    do {
+        last = received;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    } while (received != last && received < static_cast<uint64_t>(messages));
+    const std::chrono::steady_clock::time_point last_arrival{
+        std::chrono::steady_clock::duration(last_arrival_ns.load())};
+    result.seconds = std::chrono::duration<double>(last_arrival - start).count();
+
+    stop = true;
+    receiver.wake();
+    reader.join();
+    result.received = received;
+    result.send_calls = sender.sendCalls();
+    result.receive_calls = receiver.receiveCalls();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int messages = argc > 1 ? std::atoi(argv[1]) : 200000;
+    size_t payload_bytes = argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 64;
+    int port = argc > 3 ? std::atoi(argv[3]) : 40199;
+
+    std::cout << "\n=== Batched UDP over loopback (" << messages << " messages, " << payload_bytes
+              << " byte payloads) ===" << std::endl;
+    std::cout << std::setw(8) << "batch" << std::setw(14) << "msgs/s" << std::setw(12) << "received"
+              << std::setw(16) << "sends/msg" << std::setw(16) << "recvs/msg" << std::endl;
+
+    const std::vector<uint32_t> batches = {1, 8, 32, 64};
+    for (uint32_t batch : batches) {
+        comms_stack::BatchedUdpConfig config;
+        config.enabled = true;
+        config.address = "127.0.0.1";
+        config.port = static_cast<uint16_t>(port);
+        config.batch = batch;
+        config.linger_us = 100;
+        BatchResult r = runBatch(config, messages, payload_bytes);
+        if (r.received == 0) {
+            std::cerr << "Nothing received on 127.0.0.1:" << port << std::endl;
+            return 1;
+        }
+        std::cout << std::setw(8) << batch << std::fixed << std::setprecision(0)
+                  << std::setw(14) << (r.received / r.seconds) << std::setw(12) << r.received
+                  << std::setprecision(3) << std::setw(16) << (r.send_calls / static_cast<double>(messages))
+                  << std::setw(16) << (r.receive_calls / static_cast<double>(r.received)) << std::endl;
+    }
+    return 0;
+}
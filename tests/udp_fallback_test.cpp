@@ -0,0 +1,100 @@
+#include "loopback_transport.h"
+#include "publisher.h"
+#include "subscriber.h"
+#include "topic_registry.h"
+#include "common_messages.pb.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// A subscriber receiving a topic over batched UDP must get every message exactly once, whether
+// the publisher's UDP sender works or failed to open (then it publishes over the transport only),
+// and whether or not it also sends the transport copy (wire). Runs on loopback transports with
+// the datagrams on 127.0.0.1. Exits non-zero on failure.
+
+const uint16_t SERVICE_ID = 0x1111;
+const uint16_t INSTANCE_ID = 0x0001;
+const uint16_t EVENT_ID = 0x8001;
+const int MESSAGES = 200;
+
+bool runCase(const char* name, bool sender_opens, bool wire, uint16_t port) {
+    auto network = std::make_shared<comms_stack::LoopbackNetwork>();
+    auto publisher_transport = std::make_shared<comms_stack::LoopbackTransport>(network, "UdpFallbackPub");
+    auto subscriber_transport = std::make_shared<comms_stack::LoopbackTransport>(network, "UdpFallbackSub");
+    publisher_transport->start();
+    subscriber_transport->start();
+
+    comms_stack::BatchedUdpConfig config;
+    config.enabled = true;
+    config.address = "127.0.0.1";
+    config.port = port;
+    config.linger_us = 0;
+    config.wire = wire;
+
+    std::mutex mutex;
+    std::map<uint32_t, int> received; // id -> deliveries
+    bool ok = true;
+    {
+        comms_stack::Subscriber subscriber("UdpFallbackTopic", subscriber_transport, SERVICE_ID, INSTANCE_ID, EVENT_ID);
+        subscriber.enableBatchedUdp(config);
+        subscriber.subscribe([&](const comms_stack::protos::SimpleNotification& notification) {
+            std::lock_guard<std::mutex> lock(mutex);
+            received[notification.id()]++;
+        });
+
+        comms_stack::Publisher publisher("UdpFallbackTopic", publisher_transport, SERVICE_ID, INSTANCE_ID, EVENT_ID);
+        comms_stack::BatchedUdpConfig publisher_config = config;
+        if (!sender_opens) {
+            publisher_config.address = "not-an-address";
+        }
+        if (publisher.enableBatchedUdp(publisher_config) != sender_opens) {
+            std::cerr << name << ": UDP sender " << (sender_opens ? "failed to open" : "opened") << std::endl;
+            ok = false;
+        }
+
+        comms_stack::protos::SimpleNotification notification;
+        notification.set_message_content("udp fallback");
+        for (int i = 1; ok && i <= MESSAGES; ++i) {
+            notification.set_id(i);
+            publisher.publish(notification);
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (std::chrono::steady_clock::now() < deadline) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (received.size() == static_cast<size_t>(MESSAGES)) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Let late duplicates arrive
+        subscriber.unsubscribe();
+    }
+    publisher_transport->stop();
+    subscriber_transport->stop();
+
+    size_t duplicates = 0;
+    for (const auto& entry : received) {
+        duplicates += entry.second - 1;
+    }
+    ok = ok && received.size() == static_cast<size_t>(MESSAGES) && duplicates == 0;
+    std::cout << (ok ? "PASS" : "FAIL") << ": " << name << " (" << received.size() << "/" << MESSAGES
+              << " received, " << duplicates << " duplicates)" << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+    ok = runCase("sender failed to open", false, false, 47311) && ok;
+    ok = runCase("sender failed to open, wire", false, true, 47312) && ok;
+    ok = runCase("sender open", true, false, 47313) && ok;
+    ok = runCase("sender open, wire", true, true, 47314) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include "communication_manager.h"
+#include "rpc_client.h"
+#include "subscriber.h"
+#include "common_messages.pb.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Time to first use after boot, with and without the discovery cache. Run it twice with the
+// same cache file while rpc_server_test and publisher_test are running: the first run starts
+// cold and writes the cache, the second pre-requests "SampleRpc" and pre-subscribes "TestTopic"
+// from it. startup_delay_ms stands in for the application's own initialization between
+// CommunicationManager::init() and creating its clients, which the cache lets discovery overlap.
+//
+// Usage: warm_start_bench [cache_path=/tmp/CommsStackApp_RpcClient.discovery.json] [startup_delay_ms=0]
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::string cache_path = argc > 1 ? argv[1] : "/tmp/CommsStackApp_RpcClient.discovery.json";
+    int startup_delay_ms = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    auto boot = std::chrono::steady_clock::now();
+    comms_stack::CommunicationManager comm_mgr;
+    comms_stack::CommunicationManager::Options options;
+    options.app_name = "CommsStackApp_RpcClient";
+    options.discovery_cache_path = cache_path;
+    if (!comm_mgr.init(options)) {
+        std::cerr << "Failed to initialize CommunicationManager" << std::endl;
+        return 1;
+    }
+    double init_ms = msSince(boot);
+    std::this_thread::sleep_for(std::chrono::milliseconds(startup_delay_ms));
+
+    auto subscriber = comm_mgr.getSubscriber("TestTopic");
+    auto client = comm_mgr.getRpcClient("SampleRpc");
+    if (!subscriber || !client) {
+        std::cerr << "TestTopic/SampleRpc are not in the registry (is VSOMEIP_CONFIGURATION set?)" << std::endl;
+        comm_mgr.shutdown();
+        return 1;
+    }
+    std::mutex mutex;
+    std::condition_variable cv;
+    double first_message_ms = -1;
+    subscriber->subscribe([&](const comms_stack::protos::SimpleNotification&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (first_message_ms < 0) {
+            first_message_ms = msSince(boot);
+            cv.notify_all();
+        }
+    });
+
+    double rpc_ms = -1;
+    if (client->waitForAvailability(std::chrono::seconds(10))) {
+        comms_stack::protos::EchoRequest request;
+        request.set_request_message("warm start");
+        auto future = client->Echo(request);
+        if (future.wait_for(std::chrono::seconds(5)) == std::future_status::ready) {
+            try {
+                future.get();
+                rpc_ms = msSince(boot);
+            } catch (const std::exception& e) {
+                std::cerr << "Echo failed: " << e.what() << std::endl;
+            }
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(10), [&] { return first_message_ms >= 0; });
+    }
+
+    std::cout << "\n=== Warm start (" << cache_path << ") ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "init():                  " << init_ms << " ms" << std::endl
+              << "first RPC response:      " << rpc_ms << " ms" << std::endl
+              << "first TestTopic message: " << first_message_ms << " ms" << std::endl;
+    std::cout << std::setw(10) << "service" << std::setw(10) << "instance" << std::setw(16) << "available (ms)"
+              << std::setw(18) << "previous run (ms)" << std::setw(15) << "pre-requested" << std::endl;
+    for (const auto& timing : comm_mgr.getDiscoveryTimings()) {
+        std::cout << std::hex << std::setw(10) << timing.service_id << std::setw(10) << timing.instance_id << std::dec
+                  << std::setw(16) << timing.available_after_ms << std::setw(18) << timing.previous_run_ms
+                  << std::setw(15) << (timing.pre_requested ? "yes" : "no") << std::endl;
+    }
+
+    subscriber.reset();
+    client.reset();
+    comm_mgr.shutdown(); // Writes the cache for the next run
+    return 0;
+}